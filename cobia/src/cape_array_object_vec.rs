@@ -9,6 +9,7 @@ pub struct CapeArrayObjectVec<ElementImpl,ElementInterface> {
 	vec: Vec<ElementImpl>,
 	interface_vec: Vec<ElementInterface>,
 	interface_ptr_vec: Vec<*mut ElementInterface>,
+	spare: Vec<ElementImpl>, //elements removed by resize, kept for reuse
 }
 
 #[allow(private_bounds)]
@@ -31,6 +32,7 @@ impl<ElementImpl,ElementInterface> CapeArrayObjectVec<ElementImpl,ElementInterfa
 			vec: Vec::new(),
 			interface_vec: Vec::new(),
 			interface_ptr_vec: Vec::new(),
+			spare: Vec::new(),
 		}
 	}
 
@@ -250,6 +252,7 @@ impl CapeArrayStringVec {
 			vec: vec,
 			interface_vec,
 			interface_ptr_vec,
+			spare: Vec::new(),
 		}
 	}
 
@@ -297,18 +300,26 @@ impl CapeArrayStringVec {
 		let old_size = self.vec.len();
 		let size = size as usize;
 		if size < old_size {
-			self.vec.truncate(size);
+			//keep the removed strings, so that growing again reuses their storage
+			self.spare.extend(self.vec.drain(size..));
 			self.interface_vec.truncate(size);
 			self.interface_ptr_vec.truncate(size);
 		} else {
 			self.vec.reserve((size - old_size) as usize);
 			for _ in old_size..size {
-				self.vec.push(CapeStringImpl::new());
+				let s = match self.spare.pop() {
+					Some(mut s) => {
+						s.set_string("");
+						s
+					},
+					None => CapeStringImpl::new(),
+				};
+				self.vec.push(s);
 				self.interface_vec.push(self.vec.last_mut().unwrap().as_cape_string_out());
 			}
-			//vector may have been re-allocated, redo interfaces
+			//vectors may have been re-allocated, redo all interfaces
 			self.interface_ptr_vec.resize(size, std::ptr::null_mut());
-			for i in old_size..size {
+			for i in 0..size {
 				self.interface_vec[i]=self.vec[i].as_cape_string_out();
 				self.interface_ptr_vec[i]=(&self.interface_vec[i] as *const C::ICapeString).cast_mut();
 			}
@@ -624,9 +635,9 @@ impl CapeArrayValueVec {
 				self.vec.push(CapeValueImpl::new());
 				self.interface_vec.push(self.vec.last_mut().unwrap().as_cape_value_out());
 			}
-			//vector may have been re-allocated, redo interfaces
+			//vectors may have been re-allocated, redo all interfaces
 			self.interface_ptr_vec.resize(size, std::ptr::null_mut());
-			for i in old_size..size {
+			for i in 0..size {
 				self.interface_vec[i]=self.vec[i].as_cape_value_out();
 				self.interface_ptr_vec[i]=(&self.interface_vec[i] as *const C::ICapeValue).cast_mut();
 			}
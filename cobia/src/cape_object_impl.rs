@@ -20,7 +20,7 @@ pub struct CapeObjectData {
 	/// Reference count for the object.
 	ref_count: i32,
 	/// Interface map
-	interface_map: std::collections::HashMap<CapeUUID, *mut C::ICapeInterface>,
+	interface_map: CapeUUIDMap<*mut C::ICapeInterface>,
 }
 
 /// This trait is implemented by all CAPE-OPEN objects.
@@ -68,7 +68,7 @@ pub trait ICapeInterfaceImpl: std::fmt::Display {
 			last_error: None,
 			last_error_scope: None,
 			ref_count: 0,
-			interface_map: std::collections::HashMap::new(),
+			interface_map: CapeUUIDMap::default(),
 		}
 	}
 
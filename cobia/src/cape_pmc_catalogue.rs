@@ -0,0 +1,474 @@
+use crate::C;
+use crate::*;
+use bitflags::bitflags;
+use std::cell::OnceCell;
+
+bitflags! {
+	/// Fields of the PMC registration details that are loaded into a `CapePMCCatalogue`
+	#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+	pub struct CapePMCCatalogueFields : u32 {
+		const Name = 0x001;
+		const Description = 0x002;
+		const CapeVersion = 0x004;
+		const ComponentVersion = 0x008;
+		const VendorURL = 0x010;
+		const HelpURL = 0x020;
+		const About = 0x040;
+		const ProgId = 0x080;
+		const VersionIndependentProgId = 0x100;
+		const CatIds = 0x200;
+		const Flags = 0x400;
+	}
+}
+
+/// The string fields, in the order of the string columns of the catalogue
+const STRING_FIELDS: [CapePMCCatalogueFields; 9] = [
+	CapePMCCatalogueFields::Name,
+	CapePMCCatalogueFields::Description,
+	CapePMCCatalogueFields::CapeVersion,
+	CapePMCCatalogueFields::ComponentVersion,
+	CapePMCCatalogueFields::VendorURL,
+	CapePMCCatalogueFields::HelpURL,
+	CapePMCCatalogueFields::About,
+	CapePMCCatalogueFields::ProgId,
+	CapePMCCatalogueFields::VersionIndependentProgId,
+];
+
+/// Offset of a string that is not present in the registry
+const ABSENT: u32 = u32::MAX;
+
+/// A string field of all PMCs
+struct StringColumn {
+	/// The content of the strings
+	arena: String,
+	/// Offset in the arena and length of the string of each PMC
+	spans: Vec<(u32, u32)>,
+}
+
+/// The category IDs of all PMCs
+struct CatIdColumn {
+	/// Range in `cat_ids` of the category IDs of each PMC
+	ranges: Vec<(u32, u32)>,
+	/// The category IDs of all PMCs
+	cat_ids: Vec<CapeUUID>,
+}
+
+/// Registration details of a set of PMCs, loaded in bulk
+///
+/// Reading the fields of many `CapePMCRegistrationDetails` one getter at
+/// a time allocates a `String` or `Vec` per call. The catalogue instead
+/// loads the selected fields of all PMCs in a single pass, into one column
+/// per field; the strings of a field share a single arena, and a single
+/// string buffer is reused for all interface calls. Fields that are not
+/// selected are loaded, for all PMCs, on first access; several of them
+/// can be loaded in a single pass with `load`.
+///
+/// PMCs are addressed by index, in the order of the collection from which
+/// the catalogue is created.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// use cobia::prelude::*;
+/// cobia::cape_open_initialize().unwrap();
+/// let pmc_enumerator = cobia::CapePMCEnumerator::new().unwrap();
+/// let catalogue = pmc_enumerator.describe_all_pmcs(cobia::CapePMCCatalogueFields::Name|cobia::CapePMCCatalogueFields::Description).unwrap();
+/// for index in 0..catalogue.len() {
+///     println!("Found PMC: {} ({})",catalogue.get_name(index).unwrap_or(""),catalogue.get_description(index).unwrap_or(""));
+/// }
+/// cobia::cape_open_cleanup();
+/// ```
+
+pub struct CapePMCCatalogue {
+	/// The registration details, for loading further fields and for creating PMCs
+	details: Vec<CapePMCRegistrationDetails>,
+	/// The UUID of each PMC, which is always loaded
+	uuids: Vec<CapeUUID>,
+	/// The string fields, once loaded
+	strings: [OnceCell<StringColumn>; STRING_FIELDS.len()],
+	/// The category IDs, once loaded
+	cat_ids: OnceCell<CatIdColumn>,
+	/// The registration flags of each PMC, once loaded
+	flags: OnceCell<Vec<CapePMCRegistrationFlags>>,
+}
+
+impl CapePMCCatalogue {
+
+	/// Create a catalogue from a collection of PMC registration details
+	///
+	/// # Arguments
+	///
+	/// * `pmcs` - The PMCs, as returned by `CapePMCEnumerator::pmcs` or `CapePMCEnumerator::all_pmcs`
+	/// * `fields` - The fields to load up front
+	///
+	/// # Returns
+	///
+	/// The catalogue if successful, otherwise a COBIAError.
+
+	pub fn from_collection(pmcs: CobiaCollection<CapePMCRegistrationDetails>, fields: CapePMCCatalogueFields) -> Result<CapePMCCatalogue, COBIAError> {
+		let details: Vec<CapePMCRegistrationDetails> = pmcs.into_iter().collect();
+		let mut uuids = Vec::with_capacity(details.len());
+		for pmc in &details {
+			let mut uuid = CapeUUID::null();
+			let result = unsafe {
+				((*(*pmc.interface).vTbl).getUUID.unwrap())((*pmc.interface).me, &mut uuid as *mut C::CapeUUID)
+			};
+			if result != COBIAERR_NOERROR {
+				return Err(COBIAError::from_object(result, pmc));
+			}
+			uuids.push(uuid);
+		}
+		let catalogue = CapePMCCatalogue {
+			details,
+			uuids,
+			strings: Default::default(),
+			cat_ids: OnceCell::new(),
+			flags: OnceCell::new(),
+		};
+		catalogue.load(fields);
+		Ok(catalogue)
+	}
+
+	/// Load additional fields
+	///
+	/// The fields that are not yet loaded are loaded for all PMCs in a single pass.
+	/// Values that cannot be obtained from the registry are absent. Loading
+	/// is optional: fields that are not loaded are loaded on first access,
+	/// one field per pass.
+	///
+	/// # Arguments
+	///
+	/// * `fields` - The fields to load
+
+	pub fn load(&self, fields: CapePMCCatalogueFields) {
+		let fields = fields.difference(self.loaded_fields());
+		if fields.is_empty() {
+			return;
+		}
+		let count = self.details.len();
+		let mut columns: Vec<(usize, StringColumn)> = (0..STRING_FIELDS.len())
+			.filter(|&column| fields.contains(STRING_FIELDS[column]))
+			.map(|column| (column, StringColumn { arena: String::new(), spans: Vec::with_capacity(count) }))
+			.collect();
+		let mut cat_ids = fields.contains(CapePMCCatalogueFields::CatIds)
+			.then(|| CatIdColumn { ranges: Vec::with_capacity(count), cat_ids: Vec::new() });
+		let mut flags = fields.contains(CapePMCCatalogueFields::Flags).then(|| Vec::with_capacity(count));
+		let mut s = CapeStringImpl::new();
+		let mut a = CapeArrayStringVec::new();
+		for pmc in &self.details {
+			let vtbl = unsafe { &*(*pmc.interface).vTbl };
+			let me = unsafe { (*pmc.interface).me };
+			for (column, content) in &mut columns {
+				let getter = match column {
+					0 => vtbl.getName,
+					1 => vtbl.getDescription,
+					2 => vtbl.getCapeVersion,
+					3 => vtbl.getComponentVersion,
+					4 => vtbl.getVendorURL,
+					5 => vtbl.getHelpURL,
+					6 => vtbl.getAbout,
+					7 => vtbl.getProgId,
+					_ => vtbl.getVersionIndependentProgId,
+				};
+				let result = unsafe { getter.unwrap()(me, (&s.as_cape_string_out() as *const C::ICapeString).cast_mut()) };
+				let span = if result == COBIAERR_NOERROR {
+					let offset = content.arena.len() as u32;
+					s.append_to(&mut content.arena);
+					(offset, content.arena.len() as u32 - offset)
+				} else {
+					(ABSENT, 0)
+				};
+				content.spans.push(span);
+			}
+			if let Some(content) = &mut cat_ids {
+				let first = content.cat_ids.len() as u32;
+				let result = unsafe {
+					(vtbl.getCatIDs.unwrap())(me, (&a.as_cape_array_string_out() as *const C::ICapeArrayString).cast_mut())
+				};
+				if result == COBIAERR_NOERROR {
+					for cat_id in a.iter() {
+						let mut uuid = CapeUUID::null();
+						if unsafe { C::capeUUIDFromString(cat_id.as_capechar_const(), &mut uuid) } == COBIAERR_NOERROR {
+							content.cat_ids.push(uuid);
+						}
+					}
+				}
+				content.ranges.push((first, content.cat_ids.len() as u32 - first));
+			}
+			if let Some(content) = &mut flags {
+				let mut flags: C::CapePMCRegistrationFlags = 0;
+				let result = unsafe { (vtbl.getFlags.unwrap())(me, &mut flags as *mut C::CapePMCRegistrationFlags) };
+				content.push(if result == COBIAERR_NOERROR {
+					CapePMCRegistrationFlags::from_bits_truncate(flags as i32)
+				} else {
+					CapePMCRegistrationFlags::None
+				});
+			}
+		}
+		//the cells are empty, as only fields that are not loaded are loaded
+		for (column, content) in columns {
+			let _ = self.strings[column].set(content);
+		}
+		if let Some(content) = cat_ids {
+			let _ = self.cat_ids.set(content);
+		}
+		if let Some(content) = flags {
+			let _ = self.flags.set(content);
+		}
+	}
+
+	/// Get the fields that have been loaded
+
+	pub fn loaded_fields(&self) -> CapePMCCatalogueFields {
+		let mut loaded = CapePMCCatalogueFields::empty();
+		for (column, field) in STRING_FIELDS.iter().enumerate() {
+			if self.strings[column].get().is_some() {
+				loaded |= *field;
+			}
+		}
+		if self.cat_ids.get().is_some() {
+			loaded |= CapePMCCatalogueFields::CatIds;
+		}
+		if self.flags.get().is_some() {
+			loaded |= CapePMCCatalogueFields::Flags;
+		}
+		loaded
+	}
+
+	/// Get the number of PMCs in the catalogue
+
+	pub fn len(&self) -> usize {
+		self.details.len()
+	}
+
+	/// Check whether the catalogue is empty
+
+	pub fn is_empty(&self) -> bool {
+		self.details.is_empty()
+	}
+
+	/// Get the index of a PMC by its UUID
+	///
+	/// # Arguments
+	///
+	/// * `uuid` - The UUID of the PMC
+	///
+	/// # Returns
+	///
+	/// The index, or None if the PMC is not in the catalogue.
+
+	pub fn find_uuid(&self, uuid: &CapeUUID) -> Option<usize> {
+		self.uuids.iter().position(|u| u.data == uuid.data)
+	}
+
+	/// Get the UUID of a PMC
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_uuid(&self, index: usize) -> CapeUUID {
+		self.uuids[index]
+	}
+
+	/// Get the registration details of a PMC, for example to create it
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_registration_details(&self, index: usize) -> &CapePMCRegistrationDetails {
+		&self.details[index]
+	}
+
+	fn string(&self, column: usize, index: usize) -> Option<&str> {
+		if self.strings[column].get().is_none() {
+			self.load(STRING_FIELDS[column]);
+		}
+		let content = self.strings[column].get().unwrap();
+		let (offset, length) = content.spans[index];
+		if offset == ABSENT {
+			None
+		} else {
+			Some(&content.arena[offset as usize..(offset + length) as usize])
+		}
+	}
+
+	/// Get the name of a PMC
+	///
+	/// Returns None if the PMC has no name.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_name(&self, index: usize) -> Option<&str> {
+		self.string(0, index)
+	}
+
+	/// Get the description of a PMC
+	///
+	/// Returns None if the PMC has no description.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_description(&self, index: usize) -> Option<&str> {
+		self.string(1, index)
+	}
+
+	/// Get the CAPE-OPEN version of a PMC
+	///
+	/// Returns None if the PMC has no CAPE-OPEN version.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_cape_version(&self, index: usize) -> Option<&str> {
+		self.string(2, index)
+	}
+
+	/// Get the component version of a PMC
+	///
+	/// Returns None if the PMC has no component version.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_component_version(&self, index: usize) -> Option<&str> {
+		self.string(3, index)
+	}
+
+	/// Get the vendor URL of a PMC
+	///
+	/// Returns None if the PMC has no vendor URL.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_vendor_url(&self, index: usize) -> Option<&str> {
+		self.string(4, index)
+	}
+
+	/// Get the help URL of a PMC
+	///
+	/// Returns None if the PMC has no help URL.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_help_url(&self, index: usize) -> Option<&str> {
+		self.string(5, index)
+	}
+
+	/// Get the about text of a PMC
+	///
+	/// Returns None if the PMC has no about text.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_about(&self, index: usize) -> Option<&str> {
+		self.string(6, index)
+	}
+
+	/// Get the ProgID of a PMC
+	///
+	/// Returns None if the PMC has no ProgID.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_prog_id(&self, index: usize) -> Option<&str> {
+		self.string(7, index)
+	}
+
+	/// Get the version independent ProgID of a PMC
+	///
+	/// Returns None if the PMC has no version independent ProgID.
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_version_independent_prog_id(&self, index: usize) -> Option<&str> {
+		self.string(8, index)
+	}
+
+	/// Get the category IDs of a PMC
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_cat_ids(&self, index: usize) -> &[CapeUUID] {
+		if self.cat_ids.get().is_none() {
+			self.load(CapePMCCatalogueFields::CatIds);
+		}
+		let content = self.cat_ids.get().unwrap();
+		let (first, count) = content.ranges[index];
+		&content.cat_ids[first as usize..(first + count) as usize]
+	}
+
+	/// Get the registration flags of a PMC
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+
+	pub fn get_flags(&self, index: usize) -> CapePMCRegistrationFlags {
+		if self.flags.get().is_none() {
+			self.load(CapePMCCatalogueFields::Flags);
+		}
+		self.flags.get().unwrap()[index]
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use crate::*;
+
+	#[test]
+	fn fields_are_loaded_on_access() {
+		cape_open_initialize().unwrap();
+		let pmc_enumerator = CapePMCEnumerator::new().unwrap();
+		let complete = pmc_enumerator.describe_all_pmcs(CapePMCCatalogueFields::all()).unwrap();
+		assert_eq!(complete.loaded_fields(), CapePMCCatalogueFields::all());
+		let catalogue = pmc_enumerator.describe_all_pmcs(CapePMCCatalogueFields::Name).unwrap();
+		assert_eq!(catalogue.len(), complete.len());
+		assert_eq!(catalogue.loaded_fields(), CapePMCCatalogueFields::Name);
+		for index in 0..catalogue.len() {
+			assert_eq!(catalogue.get_uuid(index).data, complete.get_uuid(index).data);
+			assert_eq!(catalogue.get_description(index), complete.get_description(index));
+			assert_eq!(catalogue.get_prog_id(index), complete.get_prog_id(index));
+			assert_eq!(catalogue.get_cat_ids(index).len(), complete.get_cat_ids(index).len());
+			assert_eq!(catalogue.get_flags(index), complete.get_flags(index));
+		}
+		if !catalogue.is_empty() {
+			assert_eq!(catalogue.loaded_fields(), CapePMCCatalogueFields::Name | CapePMCCatalogueFields::Description
+				| CapePMCCatalogueFields::ProgId | CapePMCCatalogueFields::CatIds | CapePMCCatalogueFields::Flags);
+		}
+	}
+
+	#[test]
+	fn fields_match_registration_details() {
+		cape_open_initialize().unwrap();
+		let pmc_enumerator = CapePMCEnumerator::new().unwrap();
+		let catalogue = pmc_enumerator.describe_all_pmcs(CapePMCCatalogueFields::empty()).unwrap();
+		for index in 0..catalogue.len() {
+			let pmc = catalogue.get_registration_details(index);
+			assert_eq!(catalogue.get_name(index), pmc.get_name().ok().as_deref());
+			assert_eq!(catalogue.get_version_independent_prog_id(index), pmc.get_version_independent_prog_id().ok().as_deref());
+			assert_eq!(catalogue.get_uuid(index).data, pmc.get_uuid().unwrap().data);
+			assert_eq!(catalogue.find_uuid(&catalogue.get_uuid(index)), Some(index));
+		}
+	}
+}
@@ -1,5 +1,6 @@
 use crate::C;
 use crate::*;
+use std::cell::OnceCell;
 
 /// Enumerator for all registered PMCs.
 ///
@@ -8,6 +9,8 @@ use crate::*;
 
 pub struct CapePMCEnumerator {
 	pub(crate) interface: *mut C::ICapePMCEnumerator,
+	/// Index of the registered PMCs, built on first use
+	index: OnceCell<CapePMCIndex>,
 }
 
 impl CapePMCEnumerator {
@@ -30,7 +33,7 @@ impl CapePMCEnumerator {
 		let result =
 			unsafe { C::capeGetPMCEnumerator(&mut interface as *mut *mut C::ICapePMCEnumerator) };
 		if result == COBIAERR_NOERROR {
-			Ok(CapePMCEnumerator { interface })
+			Ok(CapePMCEnumerator { interface, index: OnceCell::new() })
 		} else {
 			Err(COBIAError::Code(result))
 		}
@@ -137,13 +140,10 @@ impl CapePMCEnumerator {
 	pub fn pmcs(&self,cat_ids: &[CapeUUID]) -> Result<CobiaCollection<CapePMCRegistrationDetails>,COBIAError> {
 		let mut p: *mut C::ICobiaCollection = std::ptr::null_mut();
 		let result = unsafe {
-			//let cat_ids_repr: std::raw::Slice<CapeUUID> = cat_ids.repr(); TODO std::raw::Slice is unstable, use when available
-			let mut v: std::vec::Vec<CapeUUID> = Vec::new(); //work-around: store in a local vector
-			v.extend_from_slice(cat_ids);
 			((*(*self.interface).vTbl).getPMCsByCategory.unwrap())(
 				(*self.interface).me,
-				v.as_ptr(),
-				v.len() as C::CapeSize,
+				cat_ids.as_ptr(),
+				cat_ids.len() as C::CapeSize,
 				&mut p as *mut *mut C::ICobiaCollection
 			)
 		};
@@ -201,6 +201,96 @@ impl CapePMCEnumerator {
 		}
 	}
 
+	/// Describe all registered PMCs of specific type(s).
+	///
+	/// Loads the selected registration details of all PMCs of the given type(s)
+	/// in a single pass. This is much faster than calling the getters of each
+	/// `CapePMCRegistrationDetails` in the collection returned by `pmcs`,
+	/// for example to populate a list from which the user picks a PMC.
+	///
+	/// # Arguments
+	///
+	/// * `cat_ids` - The category IDs of the PMC types
+	/// * `fields` - The fields to load; further fields can be loaded with `CapePMCCatalogue::load`
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// use cobia::cape_open;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let pmc_enumerator = cobia::CapePMCEnumerator::new().unwrap();
+	/// let pmc_types=[cape_open::CATEGORYID_PROPERTYPACKAGEMANAGER,cape_open::CATEGORYID_STANDALONEPROPERTYPACKAGE];
+	/// let catalogue = pmc_enumerator.describe_pmcs(&pmc_types,cobia::CapePMCCatalogueFields::Name).unwrap();
+	/// for index in 0..catalogue.len() {
+	///     println!("Found Thermo-PMC: {}",catalogue.get_name(index).unwrap_or(""));
+	/// }
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	pub fn describe_pmcs(&self, cat_ids: &[CapeUUID], fields: CapePMCCatalogueFields) -> Result<CapePMCCatalogue, COBIAError> {
+		CapePMCCatalogue::from_collection(self.pmcs(cat_ids)?, fields)
+	}
+
+	/// Describe all registered PMCs of any type.
+	///
+	/// Loads the selected registration details of all PMCs in a single pass.
+	///
+	/// # Arguments
+	///
+	/// * `fields` - The fields to load; further fields can be loaded with `CapePMCCatalogue::load`
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let pmc_enumerator = cobia::CapePMCEnumerator::new().unwrap();
+	/// let catalogue = pmc_enumerator.describe_all_pmcs(cobia::CapePMCCatalogueFields::all()).unwrap();
+	/// for index in 0..catalogue.len() {
+	///     println!("Found PMC: {} ({})",catalogue.get_name(index).unwrap_or(""),catalogue.get_description(index).unwrap_or(""));
+	/// }
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	pub fn describe_all_pmcs(&self, fields: CapePMCCatalogueFields) -> Result<CapePMCCatalogue, COBIAError> {
+		CapePMCCatalogue::from_collection(self.all_pmcs()?, fields)
+	}
+
+	/// Get the index of all registered PMCs.
+	///
+	/// The index is built on the first call, and kept for the lifetime of the
+	/// enumerator. Repeated queries by category, ProgID or UUID are then
+	/// answered without calls into COBIA. Only the fields that the index
+	/// requires are loaded up front; other fields of the catalogue of the
+	/// index are loaded on first access.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// use cobia::cape_open;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let pmc_enumerator = cobia::CapePMCEnumerator::new().unwrap();
+	/// let index = pmc_enumerator.index().unwrap();
+	/// let pmc_types=[cape_open::CATEGORYID_PROPERTYPACKAGEMANAGER,cape_open::CATEGORYID_STANDALONEPROPERTYPACKAGE];
+	/// for pmc in index.pmcs(&pmc_types) {
+	///     println!("Found Thermo-PMC: {}",index.catalogue().get_name(pmc).unwrap_or(""));
+	/// }
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	pub fn index(&self) -> Result<&CapePMCIndex, COBIAError> {
+		if let Some(index) = self.index.get() {
+			return Ok(index);
+		}
+		let catalogue = self.describe_all_pmcs(CapePMCCatalogueFields::empty())?;
+		Ok(self.index.get_or_init(|| CapePMCIndex::from_catalogue(catalogue)))
+	}
+
 }
 
 /// Release pointer
@@ -228,6 +318,7 @@ impl Clone for CapePMCEnumerator {
 		}
 		CapePMCEnumerator {
 			interface: self.interface,
+			index: OnceCell::new(),
 		}
 	}
 }
@@ -0,0 +1,332 @@
+use crate::*;
+
+/// Fields that the index requires
+const INDEX_FIELDS: CapePMCCatalogueFields = CapePMCCatalogueFields::ProgId
+	.union(CapePMCCatalogueFields::VersionIndependentProgId)
+	.union(CapePMCCatalogueFields::CatIds);
+
+/// Compare two strings, ignoring ASCII case
+///
+/// ProgIDs are not case sensitive. Characters outside the ASCII range are
+/// compared as is.
+
+fn cmp_ignore_ascii_case(a: &str, b: &str) -> std::cmp::Ordering {
+	a.bytes().map(|c| c.to_ascii_lowercase()).cmp(b.bytes().map(|c| c.to_ascii_lowercase()))
+}
+
+/// Sort the PMCs that have a string by that string, ignoring ASCII case
+///
+/// # Arguments
+///
+/// * `count` - The number of PMCs
+/// * `get` - Gets the string of a PMC, if any
+///
+/// # Returns
+///
+/// The indices of the PMCs that have the string, sorted by the string.
+
+fn sort_by_string<'a>(count: u32, get: impl Fn(u32) -> Option<&'a str>) -> Vec<u32> {
+	let mut indices: Vec<u32> = (0..count).filter(|&pmc| get(pmc).is_some()).collect();
+	indices.sort_by(|&a, &b| cmp_ignore_ascii_case(get(a).unwrap_or_default(), get(b).unwrap_or_default()));
+	indices
+}
+
+/// Find a PMC by its string, ignoring ASCII case
+///
+/// # Arguments
+///
+/// * `sorted` - The indices of the PMCs, as sorted by `sort_by_string`
+/// * `get` - Gets the string of a PMC, if any
+/// * `key` - The string to find
+///
+/// # Returns
+///
+/// The index of a PMC with the string, or None if there is no such PMC.
+
+fn find_by_string<'a>(sorted: &[u32], get: impl Fn(u32) -> Option<&'a str>, key: &str) -> Option<u32> {
+	sorted
+		.binary_search_by(|&pmc| cmp_ignore_ascii_case(get(pmc).unwrap_or_default(), key))
+		.ok()
+		.map(|position| sorted[position])
+}
+
+/// Group PMCs by category
+///
+/// # Arguments
+///
+/// * `pairs` - The (category ID, PMC index) pairs, in catalogue order
+///
+/// # Returns
+///
+/// The sorted category IDs, each with the range of its PMCs in the
+/// members, and the members. A PMC that lists a category more than once
+/// is a member of that category once.
+
+fn group_by_category(mut pairs: Vec<(CapeUUID, u32)>) -> (Vec<(CapeUUID, u32, u32)>, Vec<u32>) {
+	//the sort is stable, so PMCs remain in catalogue order
+	pairs.sort_by_key(|(cat_id, _)| cat_id.data);
+	pairs.dedup_by(|a, b| a.0.data == b.0.data && a.1 == b.1);
+	let mut categories: Vec<(CapeUUID, u32, u32)> = Vec::new();
+	let mut members = Vec::with_capacity(pairs.len());
+	for (cat_id, pmc) in pairs {
+		match categories.last_mut() {
+			Some(category) if category.0.data == cat_id.data => category.2 += 1,
+			_ => categories.push((cat_id, members.len() as u32, members.len() as u32 + 1)),
+		}
+		members.push(pmc);
+	}
+	(categories, members)
+}
+
+/// Index of the registered PMCs by category ID, ProgID and UUID
+///
+/// The index is built once from a `CapePMCCatalogue`; subsequent lookups
+/// neither call into COBIA nor allocate. Lookups by category return the
+/// PMCs of that category directly, so that the cost of a query depends on
+/// the number of results rather than on the number of registered PMCs.
+///
+/// PMCs are identified by their index in `catalogue()`.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// use cobia::prelude::*;
+/// use cobia::cape_open;
+/// cobia::cape_open_initialize().unwrap();
+/// let pmc_enumerator = cobia::CapePMCEnumerator::new().unwrap();
+/// let index = pmc_enumerator.index().unwrap();
+/// for pmc in index.pmcs_by_category(&cape_open::CATEGORYID_UNITOPERATION) {
+///     println!("Found unit operation: {}",index.catalogue().get_name(pmc).unwrap_or(""));
+/// }
+/// cobia::cape_open_cleanup();
+/// ```
+
+pub struct CapePMCIndex {
+	/// The registration details
+	catalogue: CapePMCCatalogue,
+	/// PMC indices, sorted by UUID
+	by_uuid: Vec<u32>,
+	/// PMC indices with a ProgID, sorted by ProgID ignoring ASCII case
+	by_prog_id: Vec<u32>,
+	/// PMC indices with a version independent ProgID, sorted by version independent ProgID ignoring ASCII case
+	by_version_independent_prog_id: Vec<u32>,
+	/// Category IDs, sorted, with the range of their PMCs in `members`
+	categories: Vec<(CapeUUID, u32, u32)>,
+	/// PMC indices grouped by category, in catalogue order within a category
+	members: Vec<u32>,
+}
+
+impl CapePMCIndex {
+
+	/// Create an index from a catalogue
+	///
+	/// The ProgID, version independent ProgID and category ID fields are
+	/// loaded into the catalogue if they are not yet loaded.
+	///
+	/// # Arguments
+	///
+	/// * `catalogue` - The catalogue of PMCs to index
+
+	pub fn from_catalogue(catalogue: CapePMCCatalogue) -> CapePMCIndex {
+		catalogue.load(INDEX_FIELDS);
+		let count = catalogue.len() as u32;
+		let mut by_uuid: Vec<u32> = (0..count).collect();
+		by_uuid.sort_by_key(|&pmc| catalogue.get_uuid(pmc as usize).data);
+		let by_prog_id = sort_by_string(count, |pmc| catalogue.get_prog_id(pmc as usize));
+		let by_version_independent_prog_id = sort_by_string(count, |pmc| catalogue.get_version_independent_prog_id(pmc as usize));
+		let (categories, members) = group_by_category((0..count)
+			.flat_map(|pmc| catalogue.get_cat_ids(pmc as usize).iter().map(move |cat_id| (*cat_id, pmc)))
+			.collect());
+		CapePMCIndex {
+			catalogue,
+			by_uuid,
+			by_prog_id,
+			by_version_independent_prog_id,
+			categories,
+			members,
+		}
+	}
+
+	/// Get the catalogue, that holds the registration details of the indexed PMCs
+
+	pub fn catalogue(&self) -> &CapePMCCatalogue {
+		&self.catalogue
+	}
+
+	/// Get the catalogue back from the index
+
+	pub fn into_catalogue(self) -> CapePMCCatalogue {
+		self.catalogue
+	}
+
+	/// Get the PMCs of a category
+	///
+	/// # Arguments
+	///
+	/// * `cat_id` - The category ID
+	///
+	/// # Returns
+	///
+	/// The indices of the PMCs in `catalogue()`, in catalogue order.
+
+	pub fn pmcs_by_category<'a>(&'a self, cat_id: &CapeUUID) -> impl ExactSizeIterator<Item = usize> + use<'a> {
+		let members = match self.categories.binary_search_by(|category| category.0.data.cmp(&cat_id.data)) {
+			Ok(position) => {
+				let (_, start, end) = self.categories[position];
+				&self.members[start as usize..end as usize]
+			},
+			Err(_) => &[],
+		};
+		members.iter().map(|&pmc| pmc as usize)
+	}
+
+	/// Get the PMCs of any of a number of categories
+	///
+	/// A PMC that is in more than one of the categories is returned once.
+	///
+	/// # Arguments
+	///
+	/// * `cat_ids` - The category IDs
+	///
+	/// # Returns
+	///
+	/// The indices of the PMCs in `catalogue()`, grouped by category.
+
+	pub fn pmcs<'a>(&'a self, cat_ids: &'a [CapeUUID]) -> impl Iterator<Item = usize> + 'a {
+		cat_ids.iter().enumerate().flat_map(move |(position, cat_id)| {
+			let earlier = &cat_ids[..position];
+			self.pmcs_by_category(cat_id).filter(move |&pmc| {
+				//skip PMCs that were returned for an earlier category
+				!earlier.iter().any(|earlier_id| self.catalogue.get_cat_ids(pmc).iter().any(|id| id.data == earlier_id.data))
+			})
+		})
+	}
+
+	/// Get the categories of the indexed PMCs
+	///
+	/// # Returns
+	///
+	/// The category IDs, with the number of PMCs in each category.
+
+	pub fn categories(&self) -> impl ExactSizeIterator<Item = (&CapeUUID, usize)> + '_ {
+		self.categories.iter().map(|(cat_id, start, end)| (cat_id, (end - start) as usize))
+	}
+
+	/// Get a PMC by its UUID
+	///
+	/// # Arguments
+	///
+	/// * `uuid` - The UUID of the PMC
+	///
+	/// # Returns
+	///
+	/// The index of the PMC in `catalogue()`, or None if it is not registered.
+
+	pub fn find_uuid(&self, uuid: &CapeUUID) -> Option<usize> {
+		self.by_uuid
+			.binary_search_by(|&pmc| self.catalogue.get_uuid(pmc as usize).data.cmp(&uuid.data))
+			.ok()
+			.map(|position| self.by_uuid[position] as usize)
+	}
+
+	/// Get a PMC by its ProgID
+	///
+	/// Either the ProgID or the version independent ProgID may be specified.
+	/// As ProgIDs are not case sensitive, ASCII case is ignored.
+	///
+	/// # Arguments
+	///
+	/// * `prog_id` - The ProgID of the PMC
+	///
+	/// # Returns
+	///
+	/// The index of the PMC in `catalogue()`, or None if it is not registered.
+
+	pub fn find_prog_id(&self, prog_id: &str) -> Option<usize> {
+		find_by_string(&self.by_prog_id, |pmc| self.catalogue.get_prog_id(pmc as usize), prog_id)
+			.or_else(|| find_by_string(&self.by_version_independent_prog_id, |pmc| self.catalogue.get_version_independent_prog_id(pmc as usize), prog_id))
+			.map(|pmc| pmc as usize)
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	fn uuid(byte: u8) -> CapeUUID {
+		CapeUUID::from_slice(&[byte; 16])
+	}
+
+	#[test]
+	fn strings_are_sorted() {
+		let strings = [Some("b"), None, Some("a"), Some("c"), None, Some("a")];
+		let sorted = sort_by_string(strings.len() as u32, |pmc| strings[pmc as usize]);
+		//PMCs without the string are left out, and equal strings keep catalogue order
+		assert_eq!(sorted, [2, 5, 0, 3]);
+		assert!(sort_by_string(0, |_| Some("a")).is_empty());
+	}
+
+	#[test]
+	fn prog_ids_ignore_case() {
+		let prog_ids = [Some("COBIA.Unit.1"), Some("cobia.flash.1"), None, Some("Cobia.Mixer.1"), Some("cobia.unit")];
+		let get = |pmc: u32| prog_ids[pmc as usize];
+		let sorted = sort_by_string(prog_ids.len() as u32, get);
+		assert_eq!(sorted, [1, 3, 4, 0]);
+		assert_eq!(find_by_string(&sorted, get, "cobia.unit.1"), Some(0));
+		assert_eq!(find_by_string(&sorted, get, "COBIA.FLASH.1"), Some(1));
+		assert_eq!(find_by_string(&sorted, get, "cobia.MIXER.1"), Some(3));
+		assert_eq!(find_by_string(&sorted, get, "Cobia.Unit"), Some(4));
+		assert_eq!(find_by_string(&sorted, get, "cobia.unit.2"), None);
+		assert_eq!(find_by_string(&[], get, "cobia.unit.1"), None);
+	}
+
+	#[test]
+	fn categories_are_grouped() {
+		let pairs = vec![(uuid(3), 0), (uuid(1), 0), (uuid(3), 1), (uuid(2), 2), (uuid(1), 3), (uuid(3), 3)];
+		let (categories, members) = group_by_category(pairs);
+		let ranges: Vec<([u8; 16], u32, u32)> = categories.iter().map(|(cat_id, start, end)| (cat_id.data, *start, *end)).collect();
+		assert_eq!(ranges, [([1; 16], 0, 2), ([2; 16], 2, 3), ([3; 16], 3, 6)]);
+		assert_eq!(members, [0, 3, 2, 0, 1, 3]);
+	}
+
+	#[test]
+	fn duplicate_categories_are_removed() {
+		let pairs = vec![(uuid(1), 0), (uuid(1), 0), (uuid(2), 0), (uuid(1), 1), (uuid(2), 0), (uuid(1), 1)];
+		let (categories, members) = group_by_category(pairs);
+		assert_eq!(categories.iter().map(|(_, start, end)| end - start).collect::<Vec<_>>(), [2, 1]);
+		assert_eq!(members, [0, 1, 0]);
+		let (categories, members) = group_by_category(Vec::new());
+		assert!(categories.is_empty() && members.is_empty());
+	}
+
+	#[test]
+	fn index_matches_catalogue() {
+		cape_open_initialize().unwrap();
+		let pmc_enumerator = CapePMCEnumerator::new().unwrap();
+		let index = pmc_enumerator.index().unwrap();
+		let catalogue = index.catalogue();
+		let mut previous: Option<[u8; 16]> = None;
+		for (cat_id, count) in index.categories() {
+			assert!(previous.is_none_or(|previous| previous < cat_id.data));
+			previous = Some(cat_id.data);
+			let pmcs: Vec<usize> = index.pmcs_by_category(cat_id).collect();
+			assert_eq!(pmcs.len(), count);
+			assert!(pmcs.windows(2).all(|pair| pair[0] < pair[1]));
+			assert!(pmcs.iter().all(|&pmc| catalogue.get_cat_ids(pmc).iter().any(|id| id.data == cat_id.data)));
+		}
+		for pmc in 0..catalogue.len() {
+			assert_eq!(index.find_uuid(&catalogue.get_uuid(pmc)), Some(pmc));
+			if let Some(prog_id) = catalogue.get_prog_id(pmc) {
+				assert_eq!(index.find_prog_id(prog_id).and_then(|found| catalogue.get_prog_id(found)), Some(prog_id));
+				for differently_cased in [prog_id.to_ascii_uppercase(), prog_id.to_ascii_lowercase()] {
+					let found = index.find_prog_id(&differently_cased).and_then(|found| catalogue.get_prog_id(found));
+					assert!(found.is_some_and(|found| found.eq_ignore_ascii_case(prog_id)));
+				}
+			}
+			for cat_id in catalogue.get_cat_ids(pmc) {
+				assert!(index.pmcs_by_category(cat_id).any(|member| member == pmc));
+			}
+		}
+	}
+}
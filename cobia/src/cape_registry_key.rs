@@ -1,6 +1,23 @@
 use crate::C;
 use crate::*;
 
+/// Open a sub key of a registry key, given the sub key name as COBIA string
+fn open_sub_key(iface: *mut C::ICapeRegistryKey, key_name: &CapeStringImpl) -> Result<CapeRegistryKey, COBIAError> {
+	let mut key: *mut C::ICapeRegistryKey = std::ptr::null_mut();
+	let result = unsafe {
+		((*(*iface).vTbl).getSubKey.unwrap())(
+			(*iface).me,
+			key_name.as_capechar_const(),
+			&mut key as *mut *mut C::ICapeRegistryKey,
+		)
+	};
+	if result == COBIAERR_NOERROR {
+		Ok(CapeRegistryKey { interface: key })
+	} else {
+		Err(COBIAError::Code(result))
+	}
+}
+
 /// Private trait that provides the key to the registry key
 /// used by CapeRegistryKeyReader trait
 pub(crate) trait CapeRegistryKeyReaderKey {
@@ -43,16 +60,37 @@ pub trait CapeRegistryKeyReader: CapeRegistryKeyReaderKey {
 	/// ```
 
 	fn get_values(&self) -> Result<Vec<String>, COBIAError> {
-		let mut sa = CapeArrayStringVec::new();
+		let mut names = CapeRegistryNames::new();
+		self.read_values(&mut names)?;
+		Ok(names.iter().map(String::from).collect())
+	}
+
+	/// Read the value names in the key into a reusable buffer
+	///
+	/// Unlike `get_values`, the names are not copied into a vector of strings;
+	/// they can be iterated as string slices. The storage of `names` is reused,
+	/// so that reading many keys into the same buffer does not allocate per key.
+	///
+	/// # Arguments
+	///
+	/// * `names` - Receives the value names; its previous content is replaced
+	///
+	/// # Example
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let lib_key=cobia::CapeRegistryKey::from_path("/types/libraries/{8d1d724f-ab15-48e5-80e4-a612468e68d4}").unwrap(); //points to the CAPE-OPEN 1.2 type library
+	/// let mut names=cobia::CapeRegistryNames::new();
+	/// lib_key.read_values(&mut names).unwrap();
+	/// assert!(names.iter().any(|name| name=="name")); //see that 'name' is amongst them
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	fn read_values(&self, names: &mut CapeRegistryNames) -> Result<(), COBIAError> {
 		let iface = self.get_read_key();
-		let result = unsafe {
-			((*(*iface).vTbl).getValues.unwrap())((*iface).me,(&sa.as_cape_array_string_out() as *const C::ICapeArrayString).cast_mut())
-		};
-		if result == COBIAERR_NOERROR {
-			Ok(sa.as_string_vec())
-		} else {
-			Err(COBIAError::Code(result))
-		}
+		names.fill(|sa| unsafe { ((*(*iface).vTbl).getValues.unwrap())((*iface).me, sa) })
 	}
 	
 	/// Get a list of all sub key names in the key
@@ -75,15 +113,37 @@ pub trait CapeRegistryKeyReader: CapeRegistryKeyReaderKey {
 	/// ```
 
 	fn get_keys(&self) -> Result<Vec<String>, COBIAError> {
-		let mut sa = CapeArrayStringVec::new();
+		let mut names = CapeRegistryNames::new();
+		self.read_keys(&mut names)?;
+		Ok(names.iter().map(String::from).collect())
+	}
+
+	/// Read the sub key names in the key into a reusable buffer
+	///
+	/// Unlike `get_keys`, the names are not copied into a vector of strings;
+	/// they can be iterated as string slices. The storage of `names` is reused,
+	/// so that reading many keys into the same buffer does not allocate per key.
+	///
+	/// # Arguments
+	///
+	/// * `names` - Receives the sub key names; its previous content is replaced
+	///
+	/// # Example
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let types_key=cobia::CapeRegistryKey::from_path("/types").unwrap();
+	/// let mut names=cobia::CapeRegistryNames::new();
+	/// types_key.read_keys(&mut names).unwrap();
+	/// assert!(names.iter().any(|name| name=="interfaces")); //see that 'interfaces' is amongst them
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	fn read_keys(&self, names: &mut CapeRegistryNames) -> Result<(), COBIAError> {
 		let iface = self.get_read_key();
-		let result =
-			unsafe { ((*(*iface).vTbl).getKeys.unwrap())((*iface).me, (&sa.as_cape_array_string_out() as *const C::ICapeArrayString).cast_mut()) };
-		if result == COBIAERR_NOERROR {
-			Ok(sa.as_string_vec())
-		} else {
-			Err(COBIAError::Code(result))
-		}
+		names.fill(|sa| unsafe { ((*(*iface).vTbl).getKeys.unwrap())((*iface).me, sa) })
 	}
 
 	/// Get the type of a value
@@ -338,20 +398,7 @@ pub trait CapeRegistryKeyReader: CapeRegistryKeyReaderKey {
 	/// ```
 
 	fn get_sub_key(&self, key_name: &str) -> Result<CapeRegistryKey, COBIAError> {
-		let mut key: *mut C::ICapeRegistryKey = std::ptr::null_mut();
-		let iface = self.get_read_key();
-		let result = unsafe {
-			((*(*iface).vTbl).getSubKey.unwrap())(
-				(*iface).me,
-				CapeStringImpl::from(key_name).as_capechar_const(),
-				&mut key as *mut *mut C::ICapeRegistryKey,
-			)
-		};
-		if result == COBIAERR_NOERROR {
-			Ok(CapeRegistryKey { interface: key })
-		} else {
-			Err(COBIAError::Code(result))
-		}
+		open_sub_key(self.get_read_key(), &CapeStringImpl::from(key_name))
 	}
 
 	/// Check whether a particular value is in the registry for all users or just the current user
@@ -479,6 +526,219 @@ impl CapeRegistryKey {
 			Err(COBIAError::Code(result))
 		}
 	}
+
+	/// Walk the tree of sub keys
+	///
+	/// The visitor is called for this key and, recursively, for all its sub keys,
+	/// parents before children. Name buffers are reused across the entire walk,
+	/// so that the walk does not allocate per key.
+	///
+	/// # Arguments
+	///
+	/// * `visitor` - Called with the path of the key relative to this key (empty for this key),
+	///   the key and its value names; returns whether to visit the sub keys of the key
+	///
+	/// # Returns
+	///
+	/// The first error returned by the visitor or encountered while reading the registry.
+	///
+	/// # Example
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let libraries_key=cobia::CapeRegistryKey::from_path("/types/libraries").unwrap();
+	/// let mut value_count=0;
+	/// libraries_key.walk(|path,_key,values| {
+	///     value_count+=values.len();
+	///     Ok(path.is_empty()) //only visit the direct sub keys
+	/// }).unwrap();
+	/// assert!(value_count>0);
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	pub fn walk<F>(&self, mut visitor: F) -> Result<(), COBIAError>
+	where
+		F: FnMut(&str, &CapeRegistryKey, &CapeRegistryNames) -> Result<bool, COBIAError>,
+	{
+		let mut walk = CapeRegistryWalk {
+			path: String::new(),
+			key_name: CapeStringImpl::new(),
+			levels: Vec::new(),
+		};
+		walk.visit(self, 0, &mut visitor)
+	}
+}
+
+/// Scratch state of CapeRegistryKey::walk, shared by all keys in the walk
+struct CapeRegistryWalk {
+	/// Path of the current key
+	path: String,
+	/// Name of the sub key being opened
+	key_name: CapeStringImpl,
+	/// Value and sub key names, per depth
+	levels: Vec<(CapeRegistryNames, CapeRegistryNames)>,
+}
+
+impl CapeRegistryWalk {
+
+	fn visit<F>(&mut self, key: &CapeRegistryKey, depth: usize, visitor: &mut F) -> Result<(), COBIAError>
+	where
+		F: FnMut(&str, &CapeRegistryKey, &CapeRegistryNames) -> Result<bool, COBIAError>,
+	{
+		if self.levels.len() == depth {
+			self.levels.push(Default::default());
+		}
+		//the names are moved out while the sub keys are visited, and put back for the next key at this depth
+		let (mut values, mut keys) = std::mem::take(&mut self.levels[depth]);
+		key.read_values(&mut values)?;
+		if visitor(&self.path, key, &values)? {
+			key.read_keys(&mut keys)?;
+			let path_len = self.path.len();
+			for name in keys.iter() {
+				if path_len != 0 {
+					self.path.push('/');
+				}
+				self.path.push_str(name);
+				self.key_name.set_string(name);
+				let sub_key = open_sub_key(key.interface, &self.key_name)?;
+				self.visit(&sub_key, depth + 1, visitor)?;
+				self.path.truncate(path_len);
+			}
+		}
+		self.levels[depth] = (values, keys);
+		Ok(())
+	}
+}
+
+/// Names of the values or sub keys of a registry key
+///
+/// The names are kept in the string array into which COBIA returns them, and
+/// are iterated as string slices, without copying them into a vector of strings.
+/// The buffer can be reused: reading names into it replaces the previous names
+/// and keeps the allocated storage.
+///
+/// On Windows, COBIA strings are UTF-16; the names are then decoded once into a
+/// single string that is reused as well.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// use cobia::prelude::*;
+/// cobia::cape_open_initialize().unwrap();
+/// let mut names=cobia::CapeRegistryNames::new();
+/// for path in ["/types/categories","/types/interfaces"] {
+///     cobia::CapeRegistryKey::from_path(path).unwrap().read_keys(&mut names).unwrap();
+///     for name in names.iter() {
+///         println!("{path}/{name}");
+///     }
+/// }
+/// cobia::cape_open_cleanup();
+/// ```
+
+pub struct CapeRegistryNames {
+	/// The names as received from COBIA
+	names: CapeArrayStringVec,
+	/// The names, decoded from UTF-16
+	#[cfg(target_os = "windows")]
+	text: String,
+	/// The end of each name in text
+	#[cfg(target_os = "windows")]
+	ends: Vec<usize>,
+}
+
+impl CapeRegistryNames {
+
+	/// Create an empty name buffer
+
+	pub fn new() -> Self {
+		CapeRegistryNames {
+			names: CapeArrayStringVec::new(),
+			#[cfg(target_os = "windows")]
+			text: String::new(),
+			#[cfg(target_os = "windows")]
+			ends: Vec::new(),
+		}
+	}
+
+	/// Get the number of names
+
+	pub fn len(&self) -> usize {
+		self.names.size()
+	}
+
+	/// Check whether there are no names
+
+	pub fn is_empty(&self) -> bool {
+		self.names.is_empty()
+	}
+
+	/// Get a name by index
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the name
+	///
+	/// # Returns
+	///
+	/// The name, or None if the index is out of range.
+
+	pub fn get(&self, index: usize) -> Option<&str> {
+		if index < self.len() {
+			Some(self.name(index))
+		} else {
+			None
+		}
+	}
+
+	/// Iterate over the names
+
+	pub fn iter(&self) -> impl ExactSizeIterator<Item = &str> + '_ {
+		(0..self.len()).map(|index| self.name(index))
+	}
+
+	#[cfg(not(target_os = "windows"))]
+	fn name(&self, index: usize) -> &str {
+		self.names[index].as_str()
+	}
+
+	#[cfg(target_os = "windows")]
+	fn name(&self, index: usize) -> &str {
+		let start = if index == 0 { 0 } else { self.ends[index - 1] };
+		&self.text[start..self.ends[index]]
+	}
+
+	/// Fill the names by a COBIA call that takes a string array
+	fn fill<F: FnOnce(*mut C::ICapeArrayString) -> C::CapeResult>(&mut self, get: F) -> Result<(), COBIAError> {
+		let result = get((&self.names.as_cape_array_string_out() as *const C::ICapeArrayString).cast_mut());
+		if result != COBIAERR_NOERROR {
+			self.names.resize(0);
+			#[cfg(target_os = "windows")]
+			{
+				self.text.clear();
+				self.ends.clear();
+			}
+			return Err(COBIAError::Code(result));
+		}
+		#[cfg(target_os = "windows")]
+		{
+			self.text.clear();
+			self.ends.clear();
+			for name in self.names.iter() {
+				name.append_to(&mut self.text);
+				self.ends.push(self.text.len());
+			}
+		}
+		Ok(())
+	}
+}
+
+impl Default for CapeRegistryNames {
+	fn default() -> Self {
+		Self::new()
+	}
 }
 
 impl CapeRegistryKeyReaderKey for CapeRegistryKey {
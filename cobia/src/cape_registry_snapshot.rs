@@ -0,0 +1,939 @@
+use crate::*;
+use std::hash::{Hash, Hasher};
+use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::time::UNIX_EPOCH;
+
+/// Identifies a registry snapshot file
+const SNAPSHOT_MAGIC: [u8; 4] = *b"CRSS";
+/// Version of the snapshot layout; snapshots of other versions are rebuilt
+const SNAPSHOT_VERSION: u32 = 1;
+
+//sections of the snapshot, in order of appearance
+const SECTION_PMCS: usize = 0;
+const SECTION_CAT_IDS: usize = 1;
+const SECTION_SERVICES: usize = 2;
+const SECTION_LIBRARIES: usize = 3;
+const SECTION_STRINGS: usize = 4;
+const SECTION_COUNT: usize = 5;
+
+/// Size of the header: magic, version, stamp, and the offset and length of each section
+const HEADER_SIZE: usize = 16 + 8 * SECTION_COUNT;
+
+/// Offset of a string that is not present in the registry
+const ABSENT: u32 = u32::MAX;
+
+//strings of a PMC record, in order of appearance
+const PMC_NAME: usize = 0;
+const PMC_DESCRIPTION: usize = 1;
+const PMC_CAPE_VERSION: usize = 2;
+const PMC_COMPONENT_VERSION: usize = 3;
+const PMC_VENDOR_URL: usize = 4;
+const PMC_HELP_URL: usize = 5;
+const PMC_ABOUT: usize = 6;
+const PMC_PROG_ID: usize = 7;
+const PMC_VERSION_INDEPENDENT_PROG_ID: usize = 8;
+const PMC_STRING_COUNT: usize = 9;
+
+//PMC record: UUID, flags, strings, range of CAT-IDs, range of services
+const PMC_FLAGS: usize = 16;
+const PMC_STRINGS: usize = 20;
+const PMC_CAT_IDS: usize = PMC_STRINGS + 8 * PMC_STRING_COUNT;
+const PMC_SERVICES: usize = PMC_CAT_IDS + 8;
+const PMC_RECORD_SIZE: usize = PMC_SERVICES + 8;
+
+//service record: service type, registered for all users, location
+const SERVICE_ALL_USERS: usize = 4;
+const SERVICE_LOCATION: usize = 8;
+const SERVICE_RECORD_SIZE: usize = 16;
+
+//library record: UUID, name, version, path
+const LIBRARY_NAME: usize = 16;
+const LIBRARY_VERSION: usize = 24;
+const LIBRARY_PATH: usize = 32;
+const LIBRARY_RECORD_SIZE: usize = 40;
+
+const UUID_SIZE: usize = 16;
+
+/// Maximum depth at which the COBIA data folders are inspected for changes
+const STAMP_DEPTH: usize = 4;
+
+fn read_u32(data: &[u8], pos: usize) -> u32 {
+	u32::from_le_bytes(data[pos..pos + 4].try_into().unwrap())
+}
+
+fn read_uuid(data: &[u8], pos: usize) -> CapeUUID {
+	CapeUUID::from_slice(data[pos..pos + UUID_SIZE].try_into().unwrap())
+}
+
+fn push_u32(buffer: &mut Vec<u8>, value: u32) {
+	buffer.extend_from_slice(&value.to_le_bytes());
+}
+
+/// Read-only snapshot of the PMC and type library registrations
+///
+/// Enumerating the registry through `CapePMCEnumerator` and `CapeTypeLibraries`
+/// takes an interface call per PMC per field. The snapshot holds the same
+/// information in a single flat buffer, that is stored in a cache file and
+/// loaded with a single read on subsequent start-ups. All accessors refer
+/// into the buffer; no data is copied or converted when accessing it.
+///
+/// The layout is position independent and little endian, so that the file
+/// may equally be memory mapped: a header, followed by fixed size PMC,
+/// CAT-ID, service and library records, followed by the UTF-8 strings the
+/// records refer to.
+///
+/// The cache file is removed by `CapeRegistryWriter::commit`, and the snapshot
+/// is rebuilt by the next call to `load`. Changes made by other processes are
+/// detected by a stamp of the COBIA version and the file system meta data of
+/// the COBIA data folders; see `registry_stamp` for its limitations.
+///
+/// Lookups by UUID and ProgID use indices that are sorted when the snapshot
+/// is loaded, and do not scan the PMC records.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// cobia::cape_open_initialize().unwrap();
+/// let snapshot = cobia::CapeRegistrySnapshot::load().unwrap();
+/// for pmc in snapshot.pmcs() {
+///     println!("Found PMC: {}",pmc.get_name().unwrap_or(""));
+/// }
+/// cobia::cape_open_cleanup();
+/// ```
+
+pub struct CapeRegistrySnapshot {
+	/// The snapshot content
+	data: Vec<u8>,
+	/// Offset and length of each section
+	sections: [(usize, usize); SECTION_COUNT],
+	/// PMC indices, sorted by UUID
+	by_uuid: Vec<u32>,
+	/// PMC indices with a ProgID, sorted by ProgID
+	by_prog_id: Vec<u32>,
+	/// PMC indices with a version independent ProgID, sorted by version independent ProgID
+	by_version_independent_prog_id: Vec<u32>,
+}
+
+impl CapeRegistrySnapshot {
+
+	/// Load the registry snapshot
+	///
+	/// The snapshot is read from the cache file if that is present and up to date;
+	/// otherwise it is built from the registry, and the cache file is written.
+	///
+	/// # Returns
+	///
+	/// The snapshot if successful, otherwise a COBIAError.
+	///
+	/// # Example
+	///
+	/// ```
+	/// use cobia;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let snapshot = cobia::CapeRegistrySnapshot::load().unwrap();
+	/// assert!(snapshot.library_count() > 0); //normally the CAPE-OPEN type libraries are registered
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	pub fn load() -> Result<CapeRegistrySnapshot, COBIAError> {
+		let path = Self::cache_path();
+		let stamp = Self::registry_stamp();
+		if let Some(data) = path.as_ref().and_then(|path| std::fs::read(path).ok()) {
+			if let Ok(snapshot) = Self::from_bytes(data) {
+				if snapshot.get_stamp() == stamp {
+					return Ok(snapshot);
+				}
+			}
+		}
+		let snapshot = Self::build(stamp)?;
+		//failure to write the cache only costs time at the next start-up
+		if let Some(path) = path {
+			let _ = snapshot.save(&path);
+		}
+		Ok(snapshot)
+	}
+
+	/// Build a snapshot from the registry
+	///
+	/// This function enumerates all registered PMCs and type libraries. It is
+	/// called by `load` if the cache file is absent or out of date.
+	///
+	/// # Arguments
+	///
+	/// * `stamp` - The stamp that identifies the state of the registry, see `registry_stamp`
+	///
+	/// # Returns
+	///
+	/// The snapshot if successful, otherwise a COBIAError.
+
+	pub fn build(stamp: u64) -> Result<CapeRegistrySnapshot, COBIAError> {
+		let mut writer = SnapshotWriter::new();
+		let catalogue = CapePMCEnumerator::new()?.describe_all_pmcs(CapePMCCatalogueFields::all())?;
+		for index in 0..catalogue.len() {
+			let pmc = catalogue.get_registration_details(index);
+			let strings = [
+				catalogue.get_name(index),
+				catalogue.get_description(index),
+				catalogue.get_cape_version(index),
+				catalogue.get_component_version(index),
+				catalogue.get_vendor_url(index),
+				catalogue.get_help_url(index),
+				catalogue.get_about(index),
+				catalogue.get_prog_id(index),
+				catalogue.get_version_independent_prog_id(index),
+			];
+			let services: Vec<(CapePMCServiceType, Option<bool>, Option<String>)> = pmc.get_service_types()?
+				.into_iter()
+				.map(|service_type| (service_type, pmc.registered_for_all_users(service_type).ok(), pmc.get_location(service_type).ok()))
+				.collect();
+			writer.add_pmc(
+				&catalogue.get_uuid(index),
+				catalogue.get_flags(index),
+				&strings,
+				catalogue.get_cat_ids(index),
+				&services,
+			);
+		}
+		for library in CapeTypeLibraries::new()?.libraries()? {
+			writer.add_library(
+				&library.get_uuid()?,
+				library.get_name().ok().as_deref(),
+				library.get_library_version().ok().as_deref(),
+				library.get_library_path().ok().as_ref().and_then(|p| p.to_str()),
+			);
+		}
+		Self::from_bytes(writer.finish(stamp)?)
+	}
+
+	/// Create a snapshot from its content
+	///
+	/// The content is validated, so that subsequent access cannot fail.
+	///
+	/// # Arguments
+	///
+	/// * `data` - The content, as obtained from `as_bytes`
+	///
+	/// # Returns
+	///
+	/// The snapshot if the content is valid, otherwise a COBIAError.
+
+	pub fn from_bytes(data: Vec<u8>) -> Result<CapeRegistrySnapshot, COBIAError> {
+		let invalid = |what: &str| COBIAError::Message(format!("Invalid registry snapshot: {}", what));
+		if data.len() < HEADER_SIZE || data[0..4] != SNAPSHOT_MAGIC {
+			return Err(invalid("not a snapshot"));
+		}
+		if read_u32(&data, 4) != SNAPSHOT_VERSION {
+			return Err(invalid("version mismatch"));
+		}
+		let mut sections = [(0usize, 0usize); SECTION_COUNT];
+		let record_sizes = [PMC_RECORD_SIZE, UUID_SIZE, SERVICE_RECORD_SIZE, LIBRARY_RECORD_SIZE, 1];
+		for (index, section) in sections.iter_mut().enumerate() {
+			let offset = read_u32(&data, 16 + 8 * index) as usize;
+			let length = read_u32(&data, 20 + 8 * index) as usize;
+			if offset < HEADER_SIZE || offset.checked_add(length).is_none_or(|end| end > data.len()) {
+				return Err(invalid("section out of range"));
+			}
+			if length % record_sizes[index] != 0 {
+				return Err(invalid("incomplete record"));
+			}
+			*section = (offset, length);
+		}
+		let mut snapshot = CapeRegistrySnapshot {
+			data,
+			sections,
+			by_uuid: Vec::new(),
+			by_prog_id: Vec::new(),
+			by_version_independent_prog_id: Vec::new(),
+		};
+		//check that all references are in range, and that strings are valid UTF-8
+		let strings = snapshot.section(SECTION_STRINGS);
+		let strings = std::str::from_utf8(strings).map_err(|_| invalid("invalid UTF-8"))?;
+		let check_string = |record: &[u8], pos: usize| {
+			let offset = read_u32(record, pos);
+			let length = read_u32(record, pos + 4) as usize;
+			offset == ABSENT || (offset as usize).checked_add(length).is_some_and(|end| {
+				end <= strings.len() && strings.is_char_boundary(offset as usize) && strings.is_char_boundary(end)
+			})
+		};
+		let check_range = |record: &[u8], pos: usize, section: usize, size: usize| {
+			let first = read_u32(record, pos) as usize;
+			let count = read_u32(record, pos + 4) as usize;
+			first.checked_add(count).is_some_and(|end| end <= snapshot.sections[section].1 / size)
+		};
+		for record in snapshot.section(SECTION_PMCS).chunks_exact(PMC_RECORD_SIZE) {
+			if !(0..PMC_STRING_COUNT).all(|index| check_string(record, PMC_STRINGS + 8 * index))
+				|| !check_range(record, PMC_CAT_IDS, SECTION_CAT_IDS, UUID_SIZE)
+				|| !check_range(record, PMC_SERVICES, SECTION_SERVICES, SERVICE_RECORD_SIZE) {
+				return Err(invalid("PMC record out of range"));
+			}
+		}
+		for record in snapshot.section(SECTION_SERVICES).chunks_exact(SERVICE_RECORD_SIZE) {
+			if !check_string(record, SERVICE_LOCATION) {
+				return Err(invalid("service record out of range"));
+			}
+		}
+		for record in snapshot.section(SECTION_LIBRARIES).chunks_exact(LIBRARY_RECORD_SIZE) {
+			if ![LIBRARY_NAME, LIBRARY_VERSION, LIBRARY_PATH].into_iter().all(|pos| check_string(record, pos)) {
+				return Err(invalid("library record out of range"));
+			}
+		}
+		snapshot.build_indices();
+		Ok(snapshot)
+	}
+
+	/// Sort the PMC indices by UUID and ProgID, for lookups
+
+	fn build_indices(&mut self) {
+		let count = self.pmc_count() as u32;
+		let mut by_uuid: Vec<u32> = (0..count).collect();
+		by_uuid.sort_by_key(|&index| self.pmc(index as usize).get_uuid().data);
+		let sorted_by = |string: usize| {
+			let mut indices: Vec<u32> = (0..count).filter(|&index| self.pmc_string(index, string).is_some()).collect();
+			indices.sort_by(|&a, &b| self.pmc_string(a, string).cmp(&self.pmc_string(b, string)));
+			indices
+		};
+		let by_prog_id = sorted_by(PMC_PROG_ID);
+		let by_version_independent_prog_id = sorted_by(PMC_VERSION_INDEPENDENT_PROG_ID);
+		self.by_uuid = by_uuid;
+		self.by_prog_id = by_prog_id;
+		self.by_version_independent_prog_id = by_version_independent_prog_id;
+	}
+
+	/// Get the content of the snapshot
+	///
+	/// # Returns
+	///
+	/// The content, which can be stored and passed to `from_bytes`.
+
+	pub fn as_bytes(&self) -> &[u8] {
+		&self.data
+	}
+
+	/// Write the snapshot to a file
+	///
+	/// The content is written to a new temporary file that then replaces the
+	/// file, so that a concurrent reader does not see a partial snapshot. The
+	/// temporary file is created exclusively, so that an existing file or link
+	/// of that name is not written through, and on Unix it is readable and
+	/// writable by the owner only. The folder is created if it does not exist.
+	///
+	/// # Arguments
+	///
+	/// * `path` - The file to write
+
+	pub fn save(&self, path: &Path) -> Result<(), COBIAError> {
+		let error = |e: std::io::Error| COBIAError::Message(format!("Failed to write registry snapshot {}: {}", path.display(), e));
+		if let Some(folder) = path.parent() {
+			let mut builder = std::fs::DirBuilder::new();
+			builder.recursive(true);
+			#[cfg(unix)]
+			std::os::unix::fs::DirBuilderExt::mode(&mut builder, 0o700);
+			builder.create(folder).map_err(error)?;
+		}
+		let temporary = path.with_extension(format!("{}.tmp", std::process::id()));
+		let mut options = std::fs::OpenOptions::new();
+		options.write(true).create_new(true);
+		#[cfg(unix)]
+		std::os::unix::fs::OpenOptionsExt::mode(&mut options, 0o600);
+		let mut file = options.open(&temporary).map_err(error)?;
+		file.write_all(&self.data)
+			.and_then(|_| file.sync_all())
+			.and_then(|_| {
+				drop(file);
+				std::fs::rename(&temporary, path)
+			})
+			.map_err(|e| {
+				let _ = std::fs::remove_file(&temporary);
+				error(e)
+			})
+	}
+
+	/// Remove the cache file
+	///
+	/// Called after the registry has been changed, so that the next call to `load`
+	/// rebuilds the snapshot.
+
+	pub fn invalidate() {
+		if let Some(path) = Self::cache_path() {
+			let _ = std::fs::remove_file(path);
+		}
+	}
+
+	/// Get the location of the cache file
+	///
+	/// The cache file is located in a `cobia` folder in the cache folder of the
+	/// user: `%LOCALAPPDATA%` on Windows, `~/Library/Caches` on macOS, and
+	/// `$XDG_CACHE_HOME` or else `~/.cache` on other systems. It is not located
+	/// in the COBIA data folder, the modification time of which is part of the
+	/// stamp, nor in the shared temporary folder, where other users could
+	/// replace it. Its name depends on the COBIA user data folder.
+	///
+	/// # Returns
+	///
+	/// The path of the cache file, or None if the cache folder of the user
+	/// cannot be determined, in which case no cache file is used.
+
+	pub fn cache_path() -> Option<PathBuf> {
+		let cache_folder = if cfg!(target_os = "windows") {
+			std::env::var_os("LOCALAPPDATA").map(PathBuf::from)
+		} else if cfg!(target_os = "macos") {
+			std::env::var_os("HOME").map(|home| PathBuf::from(home).join("Library").join("Caches"))
+		} else {
+			std::env::var_os("XDG_CACHE_HOME").map(PathBuf::from).filter(|folder| folder.is_absolute())
+				.or_else(|| std::env::var_os("HOME").map(|home| PathBuf::from(home).join(".cache")))
+		}.filter(|folder| folder.is_absolute())?;
+		let folder = get_cobia_user_data_folder();
+		Some(cache_folder.join("cobia").join(format!("registry_{:016x}.snapshot", fxhash::hash64(&folder))))
+	}
+
+	/// Compute the stamp of the current state of the registry
+	///
+	/// The stamp covers the COBIA version, and the number, sizes and latest
+	/// modification time of the files in the COBIA data folders. This only
+	/// involves file system meta data, which is much cheaper than enumerating
+	/// the registry.
+	///
+	/// The stamp is a heuristic. A change that leaves the number and total size
+	/// of the files unchanged, and that is made within the time resolution of
+	/// the file system or sets an older modification time (such as restoring
+	/// a backup), is not detected, nor are changes in folders deeper than the
+	/// inspected depth. Registry changes made through `CapeRegistryWriter`
+	/// remove the cache file; after changes made by other means, `invalidate`
+	/// removes it.
+	///
+	/// # Returns
+	///
+	/// The stamp, that is stored in the snapshot.
+
+	pub fn registry_stamp() -> u64 {
+		let mut hasher = fxhash::FxHasher64::default();
+		get_cobia_version().hash(&mut hasher);
+		for folder in [get_cobia_user_data_folder(), PathBuf::from(get_cobia_system_data_folder())] {
+			let mut summary = (0u64, 0u64, 0u128);
+			Self::summarize_folder(&folder, STAMP_DEPTH, &mut summary);
+			folder.hash(&mut hasher);
+			summary.hash(&mut hasher);
+		}
+		hasher.finish()
+	}
+
+	/// Accumulate the number of entries, total size and latest modification time in a folder
+	///
+	/// # Arguments
+	///
+	/// * `folder` - The folder
+	/// * `depth` - The number of levels of sub folders to include
+	/// * `summary` - The accumulated number of entries, size and modification time, in nanoseconds
+
+	fn summarize_folder(folder: &Path, depth: usize, summary: &mut (u64, u64, u128)) {
+		let Ok(entries) = std::fs::read_dir(folder) else {
+			return;
+		};
+		for entry in entries.flatten() {
+			let Ok(metadata) = entry.metadata() else {
+				continue;
+			};
+			summary.0 += 1;
+			summary.1 = summary.1.wrapping_add(metadata.len());
+			if let Some(modified) = metadata.modified().ok().and_then(|t| t.duration_since(UNIX_EPOCH).ok()) {
+				summary.2 = summary.2.max(modified.as_nanos());
+			}
+			if metadata.is_dir() && depth > 0 {
+				Self::summarize_folder(&entry.path(), depth - 1, summary);
+			}
+		}
+	}
+
+	/// Get the stamp of the registry state from which the snapshot was built
+
+	pub fn get_stamp(&self) -> u64 {
+		u64::from_le_bytes(self.data[8..16].try_into().unwrap())
+	}
+
+	fn section(&self, section: usize) -> &[u8] {
+		let (offset, length) = self.sections[section];
+		&self.data[offset..offset + length]
+	}
+
+	fn string(&self, record: &[u8], pos: usize) -> Option<&str> {
+		let offset = read_u32(record, pos);
+		if offset == ABSENT {
+			return None;
+		}
+		let offset = offset as usize;
+		let length = read_u32(record, pos + 4) as usize;
+		let strings = self.section(SECTION_STRINGS);
+		//validated by from_bytes
+		Some(unsafe { std::str::from_utf8_unchecked(&strings[offset..offset + length]) })
+	}
+
+	/// Get a string of a PMC record
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index of the PMC
+	/// * `string` - The string, such as PMC_PROG_ID
+
+	fn pmc_string(&self, index: u32, string: usize) -> Option<&str> {
+		self.string(self.pmc(index as usize).record, PMC_STRINGS + 8 * string)
+	}
+
+	/// Get the number of registered PMCs
+
+	pub fn pmc_count(&self) -> usize {
+		self.sections[SECTION_PMCS].1 / PMC_RECORD_SIZE
+	}
+
+	/// Get the registration of a PMC by index
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index, which must be less than `pmc_count`
+	///
+	/// # Panics
+	///
+	/// This function panics if the index is out of range.
+
+	pub fn pmc(&self, index: usize) -> CapeSnapshotPMC<'_> {
+		let start = index * PMC_RECORD_SIZE;
+		CapeSnapshotPMC {
+			snapshot: self,
+			record: &self.section(SECTION_PMCS)[start..start + PMC_RECORD_SIZE],
+		}
+	}
+
+	/// Iterate over the registrations of all PMCs
+
+	pub fn pmcs(&self) -> impl ExactSizeIterator<Item = CapeSnapshotPMC<'_>> {
+		(0..self.pmc_count()).map(|index| self.pmc(index))
+	}
+
+	/// Get the registration of a PMC by its UUID
+	///
+	/// # Arguments
+	///
+	/// * `uuid` - The UUID of the PMC
+	///
+	/// # Returns
+	///
+	/// The registration, or None if the PMC is not registered.
+
+	pub fn get_pmc_by_uuid(&self, uuid: &CapeUUID) -> Option<CapeSnapshotPMC<'_>> {
+		self.by_uuid
+			.binary_search_by(|&index| self.pmc(index as usize).record[0..UUID_SIZE].cmp(&uuid.data))
+			.ok()
+			.map(|position| self.pmc(self.by_uuid[position] as usize))
+	}
+
+	/// Get the registration of a PMC by its ProgID
+	///
+	/// Either the ProgID or the version independent ProgID may be specified.
+	///
+	/// # Arguments
+	///
+	/// * `prog_id` - The ProgID of the PMC
+	///
+	/// # Returns
+	///
+	/// The registration, or None if the PMC is not registered.
+
+	pub fn get_pmc_by_prog_id(&self, prog_id: &str) -> Option<CapeSnapshotPMC<'_>> {
+		let find = |sorted: &[u32], string: usize| {
+			sorted
+				.binary_search_by(|&index| self.pmc_string(index, string).unwrap_or_default().cmp(prog_id))
+				.ok()
+				.map(|position| self.pmc(sorted[position] as usize))
+		};
+		find(&self.by_prog_id, PMC_PROG_ID)
+			.or_else(|| find(&self.by_version_independent_prog_id, PMC_VERSION_INDEPENDENT_PROG_ID))
+	}
+
+	/// Get the number of registered type libraries
+
+	pub fn library_count(&self) -> usize {
+		self.sections[SECTION_LIBRARIES].1 / LIBRARY_RECORD_SIZE
+	}
+
+	/// Get the details of a type library by index
+	///
+	/// # Arguments
+	///
+	/// * `index` - The index, which must be less than `library_count`
+	///
+	/// # Panics
+	///
+	/// This function panics if the index is out of range.
+
+	pub fn library(&self, index: usize) -> CapeSnapshotLibrary<'_> {
+		let start = index * LIBRARY_RECORD_SIZE;
+		CapeSnapshotLibrary {
+			snapshot: self,
+			record: &self.section(SECTION_LIBRARIES)[start..start + LIBRARY_RECORD_SIZE],
+		}
+	}
+
+	/// Iterate over the details of all type libraries
+
+	pub fn libraries(&self) -> impl ExactSizeIterator<Item = CapeSnapshotLibrary<'_>> {
+		(0..self.library_count()).map(|index| self.library(index))
+	}
+
+	/// Get the details of a type library by its UUID
+	///
+	/// # Arguments
+	///
+	/// * `library_id` - The UUID of the library
+	///
+	/// # Returns
+	///
+	/// The details, or None if the library is not registered.
+
+	pub fn get_library_by_library_id(&self, library_id: &CapeUUID) -> Option<CapeSnapshotLibrary<'_>> {
+		self.libraries().find(|library| library.record[0..UUID_SIZE] == library_id.data)
+	}
+
+	/// Get the details of a type library by its name
+	///
+	/// # Arguments
+	///
+	/// * `name` - The name of the library
+	///
+	/// # Returns
+	///
+	/// The details, or None if the library is not registered.
+
+	pub fn get_library_by_name(&self, name: &str) -> Option<CapeSnapshotLibrary<'_>> {
+		self.libraries().find(|library| library.get_name() == Some(name))
+	}
+}
+
+/// PMC registration in a registry snapshot
+///
+/// This provides the same information as `CapePMCRegistrationDetails`, from
+/// the snapshot. Values that are not present in the registry are None.
+
+#[derive(Clone, Copy)]
+pub struct CapeSnapshotPMC<'a> {
+	snapshot: &'a CapeRegistrySnapshot,
+	record: &'a [u8],
+}
+
+impl<'a> CapeSnapshotPMC<'a> {
+
+	/// Get the name of the PMC
+	pub fn get_name(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_NAME)
+	}
+
+	/// Get the description of the PMC
+	pub fn get_description(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_DESCRIPTION)
+	}
+
+	/// Get the CAPE-OPEN version of the PMC
+	pub fn get_cape_version(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_CAPE_VERSION)
+	}
+
+	/// Get the component version of the PMC
+	pub fn get_component_version(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_COMPONENT_VERSION)
+	}
+
+	/// Get the vendor URL of the PMC
+	pub fn get_vendor_url(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_VENDOR_URL)
+	}
+
+	/// Get the help URL of the PMC
+	pub fn get_help_url(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_HELP_URL)
+	}
+
+	/// Get the about text of the PMC
+	pub fn get_about(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_ABOUT)
+	}
+
+	/// Get the UUID of the PMC
+	pub fn get_uuid(&self) -> CapeUUID {
+		read_uuid(self.record, 0)
+	}
+
+	/// Get the ProgID of the PMC
+	pub fn get_prog_id(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_PROG_ID)
+	}
+
+	/// Get the version independent ProgID of the PMC
+	pub fn get_version_independent_prog_id(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, PMC_STRINGS + 8 * PMC_VERSION_INDEPENDENT_PROG_ID)
+	}
+
+	/// Get the registration flags of the PMC
+	pub fn get_flags(&self) -> CapePMCRegistrationFlags {
+		CapePMCRegistrationFlags::from_bits_truncate(read_u32(self.record, PMC_FLAGS) as i32)
+	}
+
+	fn range(&self, pos: usize, size: usize, section: usize) -> &'a [u8] {
+		let first = read_u32(self.record, pos) as usize;
+		let count = read_u32(self.record, pos + 4) as usize;
+		&self.snapshot.section(section)[first * size..(first + count) * size]
+	}
+
+	/// Get the category IDs that the PMC implements
+	pub fn get_cat_ids(self) -> impl ExactSizeIterator<Item = CapeUUID> + 'a {
+		self.range(PMC_CAT_IDS, UUID_SIZE, SECTION_CAT_IDS)
+			.chunks_exact(UUID_SIZE)
+			.map(|uuid| CapeUUID::from_slice(uuid.try_into().unwrap()))
+	}
+
+	/// Check whether the PMC implements a category ID
+	pub fn implements_cat_id(&self, cat_id: &CapeUUID) -> bool {
+		self.range(PMC_CAT_IDS, UUID_SIZE, SECTION_CAT_IDS)
+			.chunks_exact(UUID_SIZE)
+			.any(|uuid| uuid == cat_id.data)
+	}
+
+	fn service(&self, service_type: CapePMCServiceType) -> Option<&'a [u8]> {
+		self.range(PMC_SERVICES, SERVICE_RECORD_SIZE, SECTION_SERVICES)
+			.chunks_exact(SERVICE_RECORD_SIZE)
+			.find(|service| read_u32(service, 0) as i32 == service_type as i32)
+	}
+
+	/// Get the service types under which the PMC is registered
+	pub fn get_service_types(self) -> impl Iterator<Item = CapePMCServiceType> + 'a {
+		self.range(PMC_SERVICES, SERVICE_RECORD_SIZE, SECTION_SERVICES)
+			.chunks_exact(SERVICE_RECORD_SIZE)
+			.filter_map(|service| CapePMCServiceType::from(read_u32(service, 0) as i32))
+	}
+
+	/// Get the location of the PMC for a service type
+	///
+	/// # Arguments
+	///
+	/// * `service_type` - The service type
+	pub fn get_location(&self, service_type: CapePMCServiceType) -> Option<&'a str> {
+		self.service(service_type).and_then(|service| self.snapshot.string(service, SERVICE_LOCATION))
+	}
+
+	/// Check whether the PMC is registered for all users for a service type
+	///
+	/// # Arguments
+	///
+	/// * `service_type` - The service type
+	pub fn registered_for_all_users(&self, service_type: CapePMCServiceType) -> Option<bool> {
+		self.service(service_type).and_then(|service| match read_u32(service, SERVICE_ALL_USERS) {
+			0 => Some(false),
+			1 => Some(true),
+			_ => None,
+		})
+	}
+
+	/// Get the registration details of the PMC from the registry
+	///
+	/// The registration details are required to create the PMC.
+	///
+	/// # Returns
+	///
+	/// The registration details if successful, otherwise a COBIAError.
+
+	pub fn get_registration_details(&self) -> Result<CapePMCRegistrationDetails, COBIAError> {
+		CapePMCEnumerator::new()?.get_pmc_by_uuid(&self.get_uuid())
+	}
+}
+
+/// Type library details in a registry snapshot
+///
+/// This provides the same information as `CapeLibraryDetails`, from the
+/// snapshot. Values that are not present in the registry are None.
+
+#[derive(Clone, Copy)]
+pub struct CapeSnapshotLibrary<'a> {
+	snapshot: &'a CapeRegistrySnapshot,
+	record: &'a [u8],
+}
+
+impl<'a> CapeSnapshotLibrary<'a> {
+
+	/// Get the UUID of the library
+	pub fn get_uuid(&self) -> CapeUUID {
+		read_uuid(self.record, 0)
+	}
+
+	/// Get the name of the library
+	pub fn get_name(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, LIBRARY_NAME)
+	}
+
+	/// Get the version of the library
+	pub fn get_library_version(&self) -> Option<&'a str> {
+		self.snapshot.string(self.record, LIBRARY_VERSION)
+	}
+
+	/// Get the path of the library
+	pub fn get_library_path(&self) -> Option<&'a Path> {
+		self.snapshot.string(self.record, LIBRARY_PATH).map(Path::new)
+	}
+}
+
+/// Composes the content of a registry snapshot
+struct SnapshotWriter {
+	pmcs: Vec<u8>,
+	cat_ids: Vec<u8>,
+	services: Vec<u8>,
+	libraries: Vec<u8>,
+	strings: Vec<u8>,
+}
+
+impl SnapshotWriter {
+
+	fn new() -> Self {
+		Self {
+			pmcs: Vec::new(),
+			cat_ids: Vec::new(),
+			services: Vec::new(),
+			libraries: Vec::new(),
+			strings: Vec::new(),
+		}
+	}
+
+	/// Append a string reference to a record, and the string to the strings section
+	fn push_string(strings: &mut Vec<u8>, record: &mut Vec<u8>, value: Option<&str>) {
+		match value {
+			Some(value) => {
+				push_u32(record, strings.len() as u32);
+				push_u32(record, value.len() as u32);
+				strings.extend_from_slice(value.as_bytes());
+			},
+			None => {
+				push_u32(record, ABSENT);
+				push_u32(record, 0);
+			}
+		}
+	}
+
+	fn add_pmc(&mut self, uuid: &CapeUUID, flags: CapePMCRegistrationFlags, strings: &[Option<&str>; PMC_STRING_COUNT],
+			cat_ids: &[CapeUUID], services: &[(CapePMCServiceType, Option<bool>, Option<String>)]) {
+		self.pmcs.extend_from_slice(&uuid.data);
+		push_u32(&mut self.pmcs, flags.bits() as u32);
+		for value in strings {
+			Self::push_string(&mut self.strings, &mut self.pmcs, *value);
+		}
+		push_u32(&mut self.pmcs, (self.cat_ids.len() / UUID_SIZE) as u32);
+		push_u32(&mut self.pmcs, cat_ids.len() as u32);
+		for cat_id in cat_ids {
+			self.cat_ids.extend_from_slice(&cat_id.data);
+		}
+		push_u32(&mut self.pmcs, (self.services.len() / SERVICE_RECORD_SIZE) as u32);
+		push_u32(&mut self.pmcs, services.len() as u32);
+		for (service_type, all_users, location) in services {
+			push_u32(&mut self.services, *service_type as i32 as u32);
+			push_u32(&mut self.services, match all_users {
+				Some(false) => 0,
+				Some(true) => 1,
+				None => 2,
+			});
+			Self::push_string(&mut self.strings, &mut self.services, location.as_deref());
+		}
+	}
+
+	fn add_library(&mut self, uuid: &CapeUUID, name: Option<&str>, version: Option<&str>, path: Option<&str>) {
+		self.libraries.extend_from_slice(&uuid.data);
+		for value in [name, version, path] {
+			Self::push_string(&mut self.strings, &mut self.libraries, value);
+		}
+	}
+
+	fn finish(self, stamp: u64) -> Result<Vec<u8>, COBIAError> {
+		let sections = [self.pmcs, self.cat_ids, self.services, self.libraries, self.strings];
+		let size = HEADER_SIZE + sections.iter().map(|s| s.len()).sum::<usize>();
+		if size >= ABSENT as usize {
+			return Err(COBIAError::Message("Registry snapshot too large".into()));
+		}
+		let mut data = Vec::with_capacity(size);
+		data.extend_from_slice(&SNAPSHOT_MAGIC);
+		push_u32(&mut data, SNAPSHOT_VERSION);
+		data.extend_from_slice(&stamp.to_le_bytes());
+		let mut offset = HEADER_SIZE;
+		for section in &sections {
+			push_u32(&mut data, offset as u32);
+			push_u32(&mut data, section.len() as u32);
+			offset += section.len();
+		}
+		for section in &sections {
+			data.extend_from_slice(section);
+		}
+		Ok(data)
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	#[test]
+	fn round_trip() {
+		let pmc_id = CapeUUID::from_slice(&[1; 16]);
+		let cat_id = CapeUUID::from_slice(&[2; 16]);
+		let library_id = CapeUUID::from_slice(&[3; 16]);
+		let mut writer = SnapshotWriter::new();
+		let mut strings = [None; PMC_STRING_COUNT];
+		strings[PMC_NAME] = Some("Distillation «shortcut»");
+		strings[PMC_PROG_ID] = Some("Shortcut.1");
+		strings[PMC_VERSION_INDEPENDENT_PROG_ID] = Some("Shortcut");
+		writer.add_pmc(&pmc_id, CapePMCRegistrationFlags::RestrictedThreading, &strings, &[cat_id],
+			&[(CapePMCServiceType::Inproc64, Some(false), Some("/lib/shortcut.so".into()))]);
+		writer.add_library(&library_id, Some("CAPEOPEN_1_2"), None, Some("/types/co12.cidl"));
+		let snapshot = CapeRegistrySnapshot::from_bytes(writer.finish(42).unwrap()).unwrap();
+		assert_eq!(snapshot.get_stamp(), 42);
+		assert_eq!(snapshot.pmc_count(), 1);
+		let pmc = snapshot.get_pmc_by_prog_id("Shortcut").unwrap();
+		assert_eq!(pmc.get_uuid().data, pmc_id.data);
+		assert_eq!(pmc.get_name(), Some("Distillation «shortcut»"));
+		assert_eq!(pmc.get_description(), None);
+		assert_eq!(pmc.get_flags(), CapePMCRegistrationFlags::RestrictedThreading);
+		assert!(pmc.implements_cat_id(&cat_id) && !pmc.implements_cat_id(&pmc_id));
+		assert_eq!(pmc.get_cat_ids().count(), 1);
+		assert_eq!(pmc.get_service_types().collect::<Vec<_>>(), [CapePMCServiceType::Inproc64]);
+		assert_eq!(pmc.get_location(CapePMCServiceType::Inproc64), Some("/lib/shortcut.so"));
+		assert_eq!(pmc.registered_for_all_users(CapePMCServiceType::Inproc64), Some(false));
+		assert_eq!(pmc.get_location(CapePMCServiceType::COM64), None);
+		assert!(snapshot.get_pmc_by_uuid(&cat_id).is_none());
+		let library = snapshot.get_library_by_library_id(&library_id).unwrap();
+		assert_eq!(library.get_name(), Some("CAPEOPEN_1_2"));
+		assert_eq!(library.get_library_version(), None);
+		assert_eq!(library.get_library_path(), Some(Path::new("/types/co12.cidl")));
+		//a damaged snapshot is rejected
+		let mut data = snapshot.as_bytes().to_vec();
+		let strings_offset = read_u32(&data, 16 + 8 * SECTION_STRINGS) as usize;
+		data[strings_offset + 14] = 0xff;
+		assert!(CapeRegistrySnapshot::from_bytes(data).is_err());
+		assert!(CapeRegistrySnapshot::from_bytes(snapshot.as_bytes()[..HEADER_SIZE + 10].to_vec()).is_err());
+	}
+
+	#[test]
+	fn lookups() {
+		//PMCs in an order that differs from the order of their UUIDs and ProgIDs
+		let mut writer = SnapshotWriter::new();
+		let prog_ids = [Some("C.1"), None, Some("A.1"), Some("B.1")];
+		for (index, prog_id) in prog_ids.iter().enumerate() {
+			let mut strings = [None; PMC_STRING_COUNT];
+			strings[PMC_PROG_ID] = *prog_id;
+			strings[PMC_VERSION_INDEPENDENT_PROG_ID] = prog_id.map(|prog_id| &prog_id[..1]);
+			writer.add_pmc(&CapeUUID::from_slice(&[9 - index as u8; 16]), CapePMCRegistrationFlags::None, &strings, &[], &[]);
+		}
+		let snapshot = CapeRegistrySnapshot::from_bytes(writer.finish(0).unwrap()).unwrap();
+		for (index, pmc) in snapshot.pmcs().enumerate() {
+			assert_eq!(snapshot.get_pmc_by_uuid(&pmc.get_uuid()).unwrap().get_uuid().data, [9 - index as u8; 16]);
+		}
+		assert!(snapshot.get_pmc_by_uuid(&CapeUUID::from_slice(&[1; 16])).is_none());
+		for (prog_id, uuid) in [("A.1", 7), ("B.1", 6), ("C.1", 9), ("A", 7), ("B", 6), ("C", 9)] {
+			assert_eq!(snapshot.get_pmc_by_prog_id(prog_id).unwrap().get_uuid().data, [uuid; 16], "{}", prog_id);
+		}
+		assert!(snapshot.get_pmc_by_prog_id("").is_none());
+		assert!(snapshot.get_pmc_by_prog_id("D").is_none());
+	}
+}
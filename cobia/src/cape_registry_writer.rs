@@ -331,6 +331,9 @@ impl CapeRegistryWriter {
 	/// This function commits changes to the registry. Changes are not
 	/// written to the registry until this function is called.
 	///
+	/// The cached `CapeRegistrySnapshot` and `CapeTypeLibraryIndex` are
+	/// discarded, so that they are rebuilt when they are next used.
+	///
 	/// # Example
 	///
 	/// ```
@@ -353,6 +356,9 @@ impl CapeRegistryWriter {
 	pub fn commit(&self) -> Result<(), COBIAError> {
 		let result = unsafe { ((*(*self.interface).vTbl).commit.unwrap())((*self.interface).me) };
 		if result == COBIAERR_NOERROR {
+			//the registry snapshot and type library index are rebuilt on their next use
+			CapeRegistrySnapshot::invalidate();
+			CapeTypeLibraryIndex::invalidate();
 			Ok(())
 		} else {
 			Err(COBIAError::Code(result))
@@ -393,6 +399,8 @@ impl CapeRegistryWriter {
 	/// typically called. It is called for example by the cobiaRegister
 	/// registration tool.
 	///
+	/// The `CapeTypeLibraryIndex` is invalidated.
+	///
 	/// # Arguments
 	///
 	/// * `idl_files` - A vector of strings containing the paths to the IDL files.
@@ -408,6 +416,7 @@ impl CapeRegistryWriter {
 			)
 		};
 		if result == COBIAERR_NOERROR {
+			CapeTypeLibraryIndex::invalidate();
 			Ok(())
 		} else {
 			Err(COBIAError::Code(result))
@@ -439,6 +448,8 @@ impl CapeRegistryWriter {
 	/// This function is not 
 	/// typically called. It is called for example by the cobiaRegister
 	/// registration tool.
+	///
+	/// The `CapeTypeLibraryIndex` is invalidated.
 	/// 
 	/// # Arguments
 	///
@@ -452,6 +463,7 @@ impl CapeRegistryWriter {
 			)
 		};
 		if result == COBIAERR_NOERROR {
+			CapeTypeLibraryIndex::invalidate();
 			Ok(())
 		} else {
 			Err(COBIAError::Code(result))
@@ -85,6 +85,20 @@ impl CapeStringImpl {
 		self.data[..self.data.len() - 1].into()
 	}
 
+	///Return as string slice, without copying
+	pub(crate) fn as_str(&self) -> &str {
+		&self.data[..self.data.len() - 1]
+	}
+
+	///Append to a string, without allocating an intermediate string
+	///
+	/// # Arguments
+	///
+	/// * `target` - The string to append to
+	pub(crate) fn append_to(&self, target: &mut String) {
+		target.push_str(&self.data[..self.data.len() - 1]);
+	}
+
 	///Set string
 	///
 	/// # Arguments
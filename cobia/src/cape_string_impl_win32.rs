@@ -97,6 +97,18 @@ impl CapeStringImpl {
 		}
 	}
 
+	///Append to a string, without allocating an intermediate string
+	///
+	/// # Arguments
+	///
+	/// * `target` - The string to append to
+	pub(crate) fn append_to(&self, target: &mut String) {
+		if !self.data.is_empty() {
+			let len = self.data.len() - 1;
+			target.extend(char::decode_utf16(self.data[..len].iter().copied()).map(|c| c.unwrap_or(char::REPLACEMENT_CHARACTER)));
+		}
+	}
+
 	///Set string
 	///
 	/// # Arguments
@@ -0,0 +1,467 @@
+use crate::C;
+use crate::*;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, RwLock};
+
+/// Service types for which proxy interface provider locations are cached, in order of their value
+const SERVICE_TYPES: [CapePMCServiceType; 6] = [
+	CapePMCServiceType::Inproc32,
+	CapePMCServiceType::Inproc64,
+	CapePMCServiceType::COM32,
+	CapePMCServiceType::COM64,
+	CapePMCServiceType::Remote,
+	CapePMCServiceType::Local,
+];
+
+/// Cached details of a registered type library
+///
+/// Unlike `CapeLibraryDetails`, the details are read from COBIA once,
+/// and are returned without allocation.
+
+pub struct CapeTypeLibraryInfo {
+	uuid: CapeUUID,
+	name: String,
+	library_version: String,
+	library_path: PathBuf,
+	proxy_interface_provider_locations: [Option<PathBuf>; SERVICE_TYPES.len()],
+}
+
+impl CapeTypeLibraryInfo {
+
+	/// Read the details of a library from COBIA
+	///
+	/// # Arguments
+	///
+	/// * `details` - The library details
+
+	fn from_details(details: &CapeLibraryDetails) -> Result<CapeTypeLibraryInfo, COBIAError> {
+		Ok(CapeTypeLibraryInfo {
+			uuid: details.get_uuid()?,
+			name: details.get_name()?,
+			library_version: details.get_library_version()?,
+			library_path: details.get_library_path()?,
+			proxy_interface_provider_locations: SERVICE_TYPES.map(|service| details.get_proxy_interface_provider_location(service)),
+		})
+	}
+
+	/// Get the UUID of the library
+	pub fn get_uuid(&self) -> CapeUUID {
+		self.uuid
+	}
+
+	/// Get the name of the library
+	pub fn get_name(&self) -> &str {
+		&self.name
+	}
+
+	/// Get the version of the library
+	pub fn get_library_version(&self) -> &str {
+		&self.library_version
+	}
+
+	/// Get the path of the library
+	pub fn get_library_path(&self) -> &Path {
+		&self.library_path
+	}
+
+	/// Get the location of the proxy interface provider for a service type
+	///
+	/// # Arguments
+	///
+	/// * `service` - The service type
+	///
+	/// # Returns
+	///
+	/// The location, or None if no proxy interface provider is registered for the service type.
+
+	pub fn get_proxy_interface_provider_location(&self, service: CapePMCServiceType) -> Option<&Path> {
+		self.proxy_interface_provider_locations[service as usize].as_deref()
+	}
+}
+
+/// Content of the type library index
+struct TypeLibraryIndex {
+	/// The generation of the index state in which the index was built
+	generation: u64,
+	/// Library details by library UUID
+	libraries: CapeUUIDMap<Arc<CapeTypeLibraryInfo>>,
+	/// Library UUIDs by library name; names are case insensitive
+	names: CapeOpenMap<CapeUUID>,
+	/// Library UUID or COBIA error by interface UUID; filled as interfaces are looked up
+	interfaces: CapeUUIDMap<Result<CapeUUID, C::CapeResult>>,
+}
+
+impl TypeLibraryIndex {
+
+	/// Read the details of all registered libraries
+	///
+	/// # Arguments
+	///
+	/// * `generation` - The generation of the index state at the start of the build
+	/// * `source` - The source of the library details
+
+	fn build<S: TypeLibrarySource>(generation: u64, source: &S) -> Result<TypeLibraryIndex, COBIAError> {
+		let mut index = TypeLibraryIndex {
+			generation,
+			libraries: CapeUUIDMap::default(),
+			names: CapeOpenMap::new(),
+			interfaces: CapeUUIDMap::default(),
+		};
+		for library in source.libraries()? {
+			index.insert(library);
+		}
+		Ok(index)
+	}
+
+	/// Add a library, unless it is already present
+	fn insert(&mut self, library: CapeTypeLibraryInfo) -> &Arc<CapeTypeLibraryInfo> {
+		let library_id = library.uuid;
+		self.names.entry(CapeStringHashKey::from_string(&library.name)).or_insert(library_id);
+		self.libraries.entry(library_id).or_insert_with(|| Arc::new(library))
+	}
+}
+
+/// Source of the library details from which the index is built
+
+trait TypeLibrarySource {
+
+	/// Read the details of all registered libraries
+	///
+	/// # Returns
+	///
+	/// The details of the libraries that could be read.
+
+	fn libraries(&self) -> Result<Vec<CapeTypeLibraryInfo>, COBIAError>;
+
+	/// Read the details of the library that contains an interface
+	///
+	/// # Arguments
+	///
+	/// * `interface_id` - The UUID of the interface
+	///
+	/// # Returns
+	///
+	/// The library details or the COBIA result for the interface, both of which are cached,
+	/// or an error that is not cached.
+
+	fn library_by_interface_id(&self, interface_id: &CapeUUID) -> Result<Result<CapeTypeLibraryInfo, C::CapeResult>, COBIAError>;
+}
+
+/// The library details as registered with COBIA
+struct CobiaTypeLibraries;
+
+impl TypeLibrarySource for CobiaTypeLibraries {
+
+	fn libraries(&self) -> Result<Vec<CapeTypeLibraryInfo>, COBIAError> {
+		//a library whose details cannot be read is left out, rather than failing all lookups
+		Ok(CapeTypeLibraries::new()?
+			.libraries()?
+			.into_iter()
+			.filter_map(|library| CapeTypeLibraryInfo::from_details(&library).ok())
+			.collect())
+	}
+
+	fn library_by_interface_id(&self, interface_id: &CapeUUID) -> Result<Result<CapeTypeLibraryInfo, C::CapeResult>, COBIAError> {
+		match CapeTypeLibraries::new()?.get_library_by_interface_id(interface_id) {
+			Ok(details) => Ok(Ok(CapeTypeLibraryInfo::from_details(&details)?)),
+			Err(COBIAError::Code(result)) => Ok(Err(result)),
+			Err(err) => Err(err),
+		}
+	}
+}
+
+/// State of a type library index
+struct IndexState {
+	/// Incremented on each invalidation
+	generation: u64,
+	/// The index; None until first used or after invalidation
+	index: Option<TypeLibraryIndex>,
+}
+
+/// A type library index that is built on first use, and again after invalidation
+struct IndexCell(RwLock<IndexState>);
+
+impl IndexCell {
+
+	/// Create an index that is not yet built
+	const fn new() -> IndexCell {
+		IndexCell(RwLock::new(IndexState { generation: 0, index: None }))
+	}
+
+	/// Invalidate the index
+	fn invalidate(&self) {
+		let mut state = self.0.write().unwrap();
+		state.generation += 1;
+		state.index = None;
+	}
+
+	/// Evaluate a function on the index, building the index if needed
+	///
+	/// # Arguments
+	///
+	/// * `source` - The source of the library details
+	/// * `f` - The function
+
+	fn with_index<S: TypeLibrarySource, R, F: FnOnce(&TypeLibraryIndex) -> R>(&self, source: &S, f: F) -> Result<R, COBIAError> {
+		loop {
+			let generation = {
+				let state = self.0.read().unwrap();
+				if let Some(index) = state.index.as_ref() {
+					return Ok(f(index));
+				}
+				state.generation
+			};
+			//built without holding the lock; if another thread was faster, its index is kept
+			let index = TypeLibraryIndex::build(generation, source)?;
+			let mut state = self.0.write().unwrap();
+			//an index that was built across an invalidation may be stale, and is built again
+			if state.generation == generation {
+				return Ok(f(state.index.get_or_insert(index)));
+			}
+		}
+	}
+
+	/// Get the details of the library that contains an interface
+	///
+	/// # Arguments
+	///
+	/// * `source` - The source of the library details
+	/// * `interface_id` - The UUID of the interface
+
+	fn get_library_by_interface_id<S: TypeLibrarySource>(&self, source: &S, interface_id: &CapeUUID) -> Result<Arc<CapeTypeLibraryInfo>, COBIAError> {
+		let (cached, generation) = self.with_index(source, |index| {
+			(index.interfaces.get(interface_id).map(|library_id| match library_id {
+				Ok(library_id) => index.libraries.get(library_id).cloned().ok_or(COBIAError::Code(COBIAERR_NOSUCHITEM)),
+				Err(result) => Err(COBIAError::Code(*result)),
+			}), index.generation)
+		})?;
+		if let Some(library) = cached {
+			return library;
+		}
+		//not yet looked up; the source is called without holding the lock
+		let library = source.library_by_interface_id(interface_id)?;
+		let mut state = self.0.write().unwrap();
+		//the index may have been invalidated, and possibly rebuilt, meanwhile; the result is then not cached
+		let index = match state.index.as_mut() {
+			Some(index) if index.generation == generation => index,
+			_ => return library.map(Arc::new).map_err(COBIAError::Code),
+		};
+		match library {
+			Ok(library) => {
+				let library = index.insert(library).clone();
+				index.interfaces.insert(*interface_id, Ok(library.uuid));
+				Ok(library)
+			},
+			Err(result) => {
+				index.interfaces.insert(*interface_id, Err(result));
+				Err(COBIAError::Code(result))
+			},
+		}
+	}
+}
+
+/// The process wide type library index
+static INDEX: IndexCell = IndexCell::new();
+
+/// Process wide index of the registered type libraries
+///
+/// The details of all registered libraries are read from COBIA on first use;
+/// a library whose details cannot be read is left out of the index.
+/// The library that contains an interface is looked up in COBIA once per interface,
+/// after which the result, including the absence of a library, is a hash lookup.
+///
+/// The index is invalidated when types are registered or unregistered through
+/// `CapeRegistryWriter`; it can also be invalidated explicitly, e.g. after
+/// the registry was modified by another process.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// use cobia::cape_open_1_2;
+/// cobia::cape_open_initialize().unwrap();
+/// let library = cobia::CapeTypeLibraryIndex::get_library_by_interface_id(&cape_open_1_2::ICAPEIDENTIFICATION_UUID).unwrap();
+/// assert_eq!(library.get_name(),"CAPEOPEN_1_2");
+/// //the second lookup does not call into COBIA
+/// let library = cobia::CapeTypeLibraryIndex::get_library_by_interface_id(&cape_open_1_2::ICAPEIDENTIFICATION_UUID).unwrap();
+/// assert_eq!(library.get_uuid().data,cape_open_1_2::LIBRARY_ID.data);
+/// cobia::cape_open_cleanup();
+/// ```
+
+pub struct CapeTypeLibraryIndex;
+
+impl CapeTypeLibraryIndex {
+
+	/// Get the library details by library UUID
+	///
+	/// # Arguments
+	///
+	/// * `library_id` - The UUID of the library
+	///
+	/// # Returns
+	///
+	/// The library details, or COBIAERR_NOSUCHITEM if the library is not registered.
+
+	pub fn get_library_by_library_id(library_id: &CapeUUID) -> Result<Arc<CapeTypeLibraryInfo>, COBIAError> {
+		INDEX.with_index(&CobiaTypeLibraries, |index| index.libraries.get(library_id).cloned())?
+			.ok_or(COBIAError::Code(COBIAERR_NOSUCHITEM))
+	}
+
+	/// Get the library details by library name
+	///
+	/// # Arguments
+	///
+	/// * `lib_name` - The name of the library, which is case insensitive
+	///
+	/// # Returns
+	///
+	/// The library details, or COBIAERR_NOSUCHITEM if the library is not registered.
+
+	pub fn get_library_by_name(lib_name: &str) -> Result<Arc<CapeTypeLibraryInfo>, COBIAError> {
+		let lib_name = CapeStringImpl::from_string(lib_name);
+		INDEX.with_index(&CobiaTypeLibraries, |index| index.names.get(&lib_name).and_then(|library_id| index.libraries.get(library_id)).cloned())?
+			.ok_or(COBIAError::Code(COBIAERR_NOSUCHITEM))
+	}
+
+	/// Get the details of the library that contains an interface
+	///
+	/// # Arguments
+	///
+	/// * `interface_id` - The UUID of the interface
+	///
+	/// # Returns
+	///
+	/// The library details, or the error that COBIA returned for the interface.
+
+	pub fn get_library_by_interface_id(interface_id: &CapeUUID) -> Result<Arc<CapeTypeLibraryInfo>, COBIAError> {
+		INDEX.get_library_by_interface_id(&CobiaTypeLibraries, interface_id)
+	}
+
+	/// Invalidate the index
+	///
+	/// The index is rebuilt on its next use.
+
+	pub fn invalidate() {
+		INDEX.invalidate();
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+	use std::cell::Cell;
+
+	/// Library details that are counted as they are read, and that can invalidate the index while being read
+	struct Libraries<'a> {
+		/// The index that is invalidated
+		cell: &'a IndexCell,
+		/// The number of registered libraries, each with one interface
+		count: Cell<u8>,
+		/// The number of reads
+		reads: Cell<usize>,
+		/// Invalidate the index during the next read
+		invalidate: Cell<bool>,
+	}
+
+	impl<'a> Libraries<'a> {
+		fn new(cell: &'a IndexCell, count: u8) -> Libraries<'a> {
+			Libraries { cell, count: Cell::new(count), reads: Cell::new(0), invalidate: Cell::new(false) }
+		}
+
+		fn read(&self) {
+			self.reads.set(self.reads.get() + 1);
+			if self.invalidate.replace(false) {
+				self.cell.invalidate();
+			}
+		}
+	}
+
+	fn library(number: u8) -> CapeTypeLibraryInfo {
+		CapeTypeLibraryInfo {
+			uuid: CapeUUID::from_slice(&[number; 16]),
+			name: format!("Library{number}"),
+			library_version: "1.0".to_string(),
+			library_path: PathBuf::from(format!("library{number}")),
+			proxy_interface_provider_locations: Default::default(),
+		}
+	}
+
+	fn interface(number: u8) -> CapeUUID {
+		CapeUUID::from_slice(&[number + 100; 16])
+	}
+
+	impl TypeLibrarySource for Libraries<'_> {
+
+		fn libraries(&self) -> Result<Vec<CapeTypeLibraryInfo>, COBIAError> {
+			self.read();
+			Ok((1..=self.count.get()).map(library).collect())
+		}
+
+		fn library_by_interface_id(&self, interface_id: &CapeUUID) -> Result<Result<CapeTypeLibraryInfo, C::CapeResult>, COBIAError> {
+			self.read();
+			let number = interface_id.data[0] - 100;
+			Ok(if number <= self.count.get() { Ok(library(number)) } else { Err(COBIAERR_NOSUCHITEM) })
+		}
+	}
+
+	fn name_of(cell: &IndexCell, source: &Libraries, name: &str) -> Option<String> {
+		let name = CapeStringImpl::from_string(name);
+		cell.with_index(source, |index| index.names.get(&name).map(|library_id| index.libraries[library_id].name.clone())).unwrap()
+	}
+
+	#[test]
+	fn lookup() {
+		let cell = IndexCell::new();
+		let source = Libraries::new(&cell, 2);
+		assert_eq!(name_of(&cell, &source, "LIBRARY2").as_deref(), Some("Library2"));
+		assert_eq!(name_of(&cell, &source, "library3"), None);
+		assert_eq!(cell.get_library_by_interface_id(&source, &interface(1)).unwrap().get_name(), "Library1");
+		assert!(matches!(cell.get_library_by_interface_id(&source, &interface(3)), Err(COBIAError::Code(COBIAERR_NOSUCHITEM))));
+		//results, including errors, are cached
+		assert_eq!(cell.get_library_by_interface_id(&source, &interface(1)).unwrap().get_name(), "Library1");
+		assert!(cell.get_library_by_interface_id(&source, &interface(3)).is_err());
+		assert_eq!(source.reads.get(), 3);
+		//a library that is registered after the index was built is added as its interface is looked up
+		cell.invalidate();
+		assert_eq!(name_of(&cell, &source, "library1").as_deref(), Some("Library1"));
+		source.count.set(3);
+		assert_eq!(cell.get_library_by_interface_id(&source, &interface(3)).unwrap().get_name(), "Library3");
+		assert_eq!(name_of(&cell, &source, "library3").as_deref(), Some("Library3"));
+		assert_eq!(source.reads.get(), 5);
+	}
+
+	#[test]
+	fn invalidated_while_building() {
+		let cell = IndexCell::new();
+		let source = Libraries::new(&cell, 1);
+		source.invalidate.set(true);
+		assert_eq!(name_of(&cell, &source, "library1").as_deref(), Some("Library1"));
+		//the index that was built across the invalidation is discarded
+		assert_eq!(source.reads.get(), 2);
+		assert_eq!(cell.0.read().unwrap().index.as_ref().map(|index| index.generation), Some(1));
+		assert_eq!(name_of(&cell, &source, "library1").as_deref(), Some("Library1"));
+		assert_eq!(source.reads.get(), 2);
+	}
+
+	#[test]
+	fn interface_looked_up_across_invalidation() {
+		let cell = IndexCell::new();
+		let source = Libraries::new(&cell, 2);
+		assert_eq!(name_of(&cell, &source, "library2").as_deref(), Some("Library2"));
+		assert_eq!(source.reads.get(), 1);
+		//the result is returned, but not cached in the index that is built after the invalidation
+		source.invalidate.set(true);
+		assert_eq!(cell.get_library_by_interface_id(&source, &interface(2)).unwrap().get_name(), "Library2");
+		assert_eq!(source.reads.get(), 2);
+		assert_eq!(cell.get_library_by_interface_id(&source, &interface(2)).unwrap().get_name(), "Library2");
+		assert_eq!(source.reads.get(), 4);
+		assert_eq!(cell.get_library_by_interface_id(&source, &interface(2)).unwrap().get_name(), "Library2");
+		assert_eq!(source.reads.get(), 4);
+		//same for an error
+		source.invalidate.set(true);
+		assert!(cell.get_library_by_interface_id(&source, &interface(3)).is_err());
+		assert!(cell.get_library_by_interface_id(&source, &interface(3)).is_err());
+		assert!(cell.get_library_by_interface_id(&source, &interface(3)).is_err());
+		assert_eq!(source.reads.get(), 7);
+	}
+}
@@ -0,0 +1,217 @@
+use crate::*;
+
+/// Hasher for maps keyed by CapeUUID
+///
+/// CapeUUID hashes as two 64-bit words; the Fx hasher combines each
+/// word with a single rotate, xor and multiply.
+
+pub type CapeUUIDBuildHasher = fxhash::FxBuildHasher;
+
+/// Hash map keyed by CapeUUID
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// let mut map=cobia::CapeUUIDMap::default();
+/// map.insert(cobia::uuid!("{12345678-9abc-def0-1234-567890abcdef}"),1);
+/// assert_eq!(map.get(&cobia::CapeUUID::from_slice(&[0x12,0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0,0x12,0x34,0x56,0x78,0x90,0xab,0xcd,0xef])),Some(&1));
+/// ```
+
+pub type CapeUUIDMap<V> = std::collections::HashMap<CapeUUID, V, CapeUUIDBuildHasher>;
+
+/// Marks a character that is not a hexadecimal digit in HEX_VALUES
+const INVALID_HEX: u8 = 0x10;
+
+/// Value of each character as hexadecimal digit, or INVALID_HEX
+const HEX_VALUES: [u8; 256] = {
+	let mut values = [INVALID_HEX; 256];
+	let mut c = 0;
+	while c < 10 {
+		values[b'0' as usize + c] = c as u8;
+		c += 1;
+	}
+	c = 0;
+	while c < 6 {
+		values[b'a' as usize + c] = 10 + c as u8;
+		values[b'A' as usize + c] = 10 + c as u8;
+		c += 1;
+	}
+	values
+};
+
+const HEX_DIGITS: &[u8; 16] = b"0123456789abcdef";
+
+/// Length of the string form without braces: 32 digits and 4 dashes
+const UUID_STRING_LENGTH: usize = 36;
+
+/// Position of the first digit of each byte in the string form without braces
+const BYTE_POSITIONS: [usize; 16] = [0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34];
+
+/// Position of the dashes in the string form without braces
+const DASH_POSITIONS: [usize; 4] = [8, 13, 18, 23];
+
+/// Parse the string form of a UUID
+///
+/// Accepts `{12345678-9abc-def0-1234-567890abcdef}` as formatted by COBIA,
+/// in either case, with or without braces.
+///
+/// # Arguments
+///
+/// * `s` - The string
+///
+/// # Returns
+///
+/// The bytes of the UUID, or None if the string is not in the expected form.
+
+pub(crate) const fn parse_uuid(s: &[u8]) -> Option<[u8; 16]> {
+	if s.len() == UUID_STRING_LENGTH {
+		parse_uuid_at(s, 0)
+	} else {
+		parse_braced_uuid(s)
+	}
+}
+
+/// Parse the string form of a UUID, with braces
+///
+/// Accepts `{12345678-9abc-def0-1234-567890abcdef}` as formatted by COBIA,
+/// in either case. This is the form that `capeUUIDFromString` is known to
+/// accept; other forms are left to COBIA.
+///
+/// # Arguments
+///
+/// * `s` - The string
+///
+/// # Returns
+///
+/// The bytes of the UUID, or None if the string is not in the expected form.
+
+pub(crate) const fn parse_braced_uuid(s: &[u8]) -> Option<[u8; 16]> {
+	if s.len() == UUID_STRING_LENGTH + 2 && s[0] == b'{' && s[UUID_STRING_LENGTH + 1] == b'}' {
+		parse_uuid_at(s, 1)
+	} else {
+		None
+	}
+}
+
+/// Decode the digits and check the dashes of the string form of a UUID
+///
+/// The digits are decoded by table lookup, without branching on their value.
+///
+/// # Arguments
+///
+/// * `s` - The string, which must hold `UUID_STRING_LENGTH` characters from `offset`
+/// * `offset` - Position of the first digit
+///
+/// # Returns
+///
+/// The bytes of the UUID, or None if a digit or dash is invalid.
+
+const fn parse_uuid_at(s: &[u8], offset: usize) -> Option<[u8; 16]> {
+	let mut data = [0u8; 16];
+	let mut invalid = 0u8;
+	let mut i = 0;
+	while i < 16 {
+		let high = HEX_VALUES[s[offset + BYTE_POSITIONS[i]] as usize];
+		let low = HEX_VALUES[s[offset + BYTE_POSITIONS[i] + 1] as usize];
+		invalid |= high | low;
+		data[i] = (high << 4) | (low & 0x0f);
+		i += 1;
+	}
+	i = 0;
+	while i < 4 {
+		invalid |= ((s[offset + DASH_POSITIONS[i]] != b'-') as u8) * INVALID_HEX;
+		i += 1;
+	}
+	if invalid & INVALID_HEX == 0 {
+		Some(data)
+	} else {
+		None
+	}
+}
+
+/// Format a UUID in the string form used by COBIA
+///
+/// # Arguments
+///
+/// * `data` - The bytes of the UUID
+///
+/// # Returns
+///
+/// The lower case string form, with braces, as ASCII characters.
+
+pub(crate) fn format_uuid(data: &[u8; 16]) -> [u8; UUID_STRING_LENGTH + 2] {
+	let mut s = [b'-'; UUID_STRING_LENGTH + 2];
+	s[0] = b'{';
+	s[UUID_STRING_LENGTH + 1] = b'}';
+	for (byte, position) in data.iter().zip(BYTE_POSITIONS) {
+		s[1 + position] = HEX_DIGITS[(byte >> 4) as usize];
+		s[2 + position] = HEX_DIGITS[(byte & 0x0f) as usize];
+	}
+	s
+}
+
+/// Create a CapeUUID from a string literal at compile time
+///
+/// The literal has the form `{12345678-9abc-def0-1234-567890abcdef}`, in either
+/// case, with or without braces. An invalid literal is a compile time error.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// const ICAPEIDENTIFICATION: cobia::CapeUUID = cobia::uuid!("{12345678-9abc-def0-1234-567890abcdef}");
+/// assert_eq!(ICAPEIDENTIFICATION.data[0],0x12);
+/// ```
+
+#[macro_export]
+macro_rules! uuid {
+	( $uuid:literal ) => {
+		const { $crate::CapeUUID::from_literal($uuid) }
+	};
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	#[test]
+	fn parse_and_format() {
+		let data = [0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56, 0x78, 0x90, 0xab, 0xcd, 0xef];
+		assert_eq!(parse_uuid(b"{12345678-9abc-def0-1234-567890abcdef}"), Some(data));
+		assert_eq!(parse_uuid(b"12345678-9ABC-DEF0-1234-567890ABCDEF"), Some(data));
+		assert_eq!(&format_uuid(&data), b"{12345678-9abc-def0-1234-567890abcdef}");
+		assert_eq!(parse_uuid(b"{12345678-9abc-def0-1234-567890abcdeg}"), None);
+		assert_eq!(parse_uuid(b"{12345678-9abc-def0-1234+567890abcdef}"), None);
+		assert_eq!(parse_uuid(b"{12345678-9abc-def0-1234-567890abcdef"), None);
+		assert_eq!(parse_uuid(b"12345678-9abc-def0-1234-567890abcdef}"), None);
+	}
+
+	#[test]
+	fn parse_braced_only() {
+		let data = [0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56, 0x78, 0x90, 0xab, 0xcd, 0xef];
+		assert_eq!(parse_braced_uuid(b"{12345678-9ABC-def0-1234-567890abcdef}"), Some(data));
+		assert_eq!(parse_braced_uuid(b"12345678-9abc-def0-1234-567890abcdef"), None);
+		assert_eq!(parse_braced_uuid(b"{12345678-9abc-def0-1234-567890abcdef"), None);
+		assert_eq!(parse_braced_uuid(b"{12345678-9abc-def0-1234-567890abcde}"), None);
+		assert_eq!(parse_braced_uuid(b""), None);
+	}
+
+	#[test]
+	fn from_string_matches_cobia() {
+		cape_open_initialize().unwrap();
+		let braced = CapeUUID::from_string("{12345678-9abc-DEF0-1234-567890abcdef}").unwrap();
+		assert_eq!(braced, uuid!("{12345678-9abc-def0-1234-567890abcdef}"));
+		//other forms are parsed by COBIA, with the same result as before the fast path
+		for s in ["12345678-9abc-def0-1234-567890abcdef", "{12345678-9abc-def0-1234-567890abcdeg}", "", "{}"] {
+			let mut uuid = CapeUUID::null();
+			let str_uuid = CapeStringImpl::from_string(s);
+			let res = unsafe { C::capeUUIDFromString(str_uuid.as_capechar_const(), &mut uuid) };
+			match CapeUUID::from_string(s) {
+				Ok(parsed) => assert!(res == COBIAERR_NOERROR && parsed == uuid),
+				Err(COBIAError::Code(code)) => assert_eq!(code, res),
+				Err(_) => panic!("unexpected error"),
+			}
+		}
+	}
+}
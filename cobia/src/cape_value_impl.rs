@@ -35,8 +35,178 @@ pub enum CapeValueContent {
 
 #[derive (Clone)]
 pub struct CapeValueImpl {
-	value: CapeValueContent,
-	str_val: CapeStringImpl, //used to internally store string values, for which the pointer is returned to the external caller
+	value: CapeValueData,
+}
+
+//the value, including the string buffer that is handed out by get_string_value, must fit in a cache line
+const _: () = assert!(std::mem::size_of::<CapeValueImpl>() <= 64);
+
+/// Code unit of strings in the encoding that COBIA uses
+#[cfg(not(target_os = "windows"))]
+type CapeValueChar = u8;
+#[cfg(target_os = "windows")]
+type CapeValueChar = u16;
+
+/// Number of code units, excluding the null terminator, of a string that is stored without allocation
+const INLINE_STRING_CAPACITY: usize = 40 / std::mem::size_of::<CapeValueChar>() - 1;
+
+/// Content of CapeValueImpl
+#[derive(Clone)]
+enum CapeValueData {
+	Empty,
+	String(CapeValueString),
+	Integer(CapeInteger),
+	Boolean(bool),
+	Real(CapeReal),
+}
+
+/// String value, stored null terminated in the encoding that COBIA uses
+///
+/// The same storage serves Rust access and the pointer that is returned to
+/// COBIA, so that a string is neither stored twice nor converted when it is
+/// passed. Short strings are stored inline.
+#[derive(Clone)]
+enum CapeValueString {
+	/// Number of code units, and the code units followed by a null terminator
+	Inline(u8, [CapeValueChar; INLINE_STRING_CAPACITY + 1]),
+	/// The code units followed by a null terminator
+	Heap(Vec<CapeValueChar>),
+}
+
+impl CapeValueString {
+
+	/// Create from a string slice
+	fn from_str(value: &str) -> Self {
+		let mut s = CapeValueString::Inline(0, [0; INLINE_STRING_CAPACITY + 1]);
+		s.set_str(value);
+		s
+	}
+
+	/// Create from a string, taking over its storage if the string is not stored inline
+	fn from_string(value: String) -> Self {
+		let mut s = CapeValueString::Inline(0, [0; INLINE_STRING_CAPACITY + 1]);
+		s.set_string(value);
+		s
+	}
+
+	/// Set from a string, taking over its storage if the string is not stored inline
+	///
+	/// The storage of the string is taken over if it has room for the null
+	/// terminator; otherwise, allocated storage is reused.
+	fn set_string(&mut self, value: String) {
+		#[cfg(not(target_os = "windows"))]
+		if value.len() > INLINE_STRING_CAPACITY && value.capacity() > value.len() {
+			let mut data = value.into_bytes();
+			data.push(0);
+			*self = CapeValueString::Heap(data);
+			return;
+		}
+		self.set_str(&value);
+	}
+
+	/// Set the code units, reusing allocated storage
+	///
+	/// # Arguments
+	///
+	/// * `len` - The number of code units
+	/// * `units` - Produces the code units
+	fn set_units<I: Iterator<Item = CapeValueChar>>(&mut self, len: usize, units: I) {
+		if len <= INLINE_STRING_CAPACITY {
+			let mut data = [0; INLINE_STRING_CAPACITY + 1];
+			for (target, unit) in data.iter_mut().zip(units) {
+				*target = unit;
+			}
+			*self = CapeValueString::Inline(len as u8, data);
+		} else {
+			match self {
+				CapeValueString::Heap(data) => data.clear(),
+				CapeValueString::Inline(..) => *self = CapeValueString::Heap(Vec::with_capacity(len + 1)),
+			}
+			if let CapeValueString::Heap(data) = self {
+				data.extend(units);
+				data.push(0);
+			}
+		}
+	}
+
+	/// Set from a string slice, reusing allocated storage
+	#[cfg(not(target_os = "windows"))]
+	fn set_str(&mut self, value: &str) {
+		self.set_units(value.len(), value.bytes());
+	}
+
+	/// Set from a string slice, reusing allocated storage
+	#[cfg(target_os = "windows")]
+	fn set_str(&mut self, value: &str) {
+		self.set_units(value.encode_utf16().count(), value.encode_utf16());
+	}
+
+	/// Set from data received from COBIA, reusing allocated storage
+	///
+	/// # Safety
+	///
+	/// `data` must point to `size` code units.
+	unsafe fn set_raw(&mut self, data: *const CapeCharacter, size: C::CapeSize) {
+		let units = if size == 0 {
+			&[]
+		} else {
+			unsafe { std::slice::from_raw_parts(data as *const CapeValueChar, size as usize) }
+		};
+		//on UTF-8 platforms, invalid data is replaced, so that the content can be used as str
+		#[cfg(not(target_os = "windows"))]
+		if std::str::from_utf8(units).is_err() {
+			self.set_str(&String::from_utf8_lossy(units));
+			return;
+		}
+		self.set_units(units.len(), units.iter().copied());
+	}
+
+	/// The code units, excluding the null terminator
+	fn units(&self) -> &[CapeValueChar] {
+		match self {
+			CapeValueString::Inline(len, data) => &data[..*len as usize],
+			CapeValueString::Heap(data) => &data[..data.len() - 1],
+		}
+	}
+
+	/// Borrow as string slice; converted on platforms that do not use UTF-8
+	fn as_str(&self) -> std::borrow::Cow<'_, str> {
+		//on UTF-8 platforms, the content is valid UTF-8, as invalid data is replaced in set_raw
+		#[cfg(not(target_os = "windows"))]
+		return std::borrow::Cow::Borrowed(unsafe { std::str::from_utf8_unchecked(self.units()) });
+		#[cfg(target_os = "windows")]
+		return std::borrow::Cow::Owned(String::from_utf16_lossy(self.units()));
+	}
+
+	/// Convert to string
+	fn to_string(&self) -> String {
+		#[cfg(not(target_os = "windows"))]
+		return String::from_utf8_lossy(self.units()).into_owned();
+		#[cfg(target_os = "windows")]
+		return String::from_utf16_lossy(self.units());
+	}
+
+	/// Compare to a string slice
+	fn eq_str(&self, value: &str) -> bool {
+		#[cfg(not(target_os = "windows"))]
+		return self.units() == value.as_bytes();
+		#[cfg(target_os = "windows")]
+		return self.units().iter().copied().eq(value.encode_utf16());
+	}
+}
+
+impl CapeValueData {
+
+	/// Convert from content
+	fn from_content(value: CapeValueContent) -> Self {
+		match value {
+			CapeValueContent::Empty => CapeValueData::Empty,
+			CapeValueContent::String(s) => CapeValueData::String(CapeValueString::from_string(s)),
+			CapeValueContent::Integer(i) => CapeValueData::Integer(i),
+			CapeValueContent::Boolean(b) => CapeValueData::Boolean(b),
+			CapeValueContent::Real(r) => CapeValueData::Real(r),
+		}
+	}
 }
 
 impl CapeValueImpl {
@@ -60,8 +230,7 @@ impl CapeValueImpl {
 	/// ```
 	pub fn new() -> Self {
 		Self {
-			value: CapeValueContent::Empty,
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::Empty,
 		}
 	}
 
@@ -88,8 +257,7 @@ impl CapeValueImpl {
 
 	pub fn from_str(value: &str) -> Self {
 		Self {
-			value: CapeValueContent::String(value.to_string()),
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::String(CapeValueString::from_str(value)),
 		}
 	}
 
@@ -116,8 +284,7 @@ impl CapeValueImpl {
 
 	pub fn from_string(value: String) -> Self {
 		Self {
-			value: CapeValueContent::String(value),
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::String(CapeValueString::from_string(value)),
 		}
 	}
 
@@ -144,8 +311,7 @@ impl CapeValueImpl {
 
 	pub fn from_content(value: CapeValueContent) -> Self {
 		Self {
-			value,
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::from_content(value),
 		}
 	}
 
@@ -172,8 +338,7 @@ impl CapeValueImpl {
 
 	pub fn from_integer(value: CapeInteger) -> Self {
 		Self {
-			value: CapeValueContent::Integer(value),
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::Integer(value),
 		}
 	}
 
@@ -200,8 +365,7 @@ impl CapeValueImpl {
 
 	pub fn from_boolean(value: bool) -> Self {
 		Self {
-			value: CapeValueContent::Boolean(value),
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::Boolean(value),
 		}
 	}
 
@@ -228,8 +392,7 @@ impl CapeValueImpl {
 
 	pub fn from_real(value: CapeReal) -> Self {
 		Self {
-			value: CapeValueContent::Real(value),
-			str_val: CapeStringImpl::new()
+			value: CapeValueData::Real(value),
 		}
 	}
 
@@ -246,7 +409,7 @@ impl CapeValueImpl {
 	/// assert_eq!(val.value(), CapeValueContent::Empty);
 	/// ```
 	pub fn reset(&mut self) {
-		self.value=CapeValueContent::Empty;
+		self.value=CapeValueData::Empty;
 	}
 
 	/// Set to string
@@ -267,7 +430,10 @@ impl CapeValueImpl {
 	/// ```
 
 	pub fn set_string(&mut self,value: String) {
-		self.value = CapeValueContent::String(value);
+		match &mut self.value {
+			CapeValueData::String(s) => s.set_string(value),
+			_ => self.value = CapeValueData::String(CapeValueString::from_string(value)),
+		}
 	}
 
 	/// Set to string
@@ -288,7 +454,10 @@ impl CapeValueImpl {
 	/// ```
 
 	pub fn set_str<T: AsRef<str>>(&mut self,value: T) {
-		self.value = CapeValueContent::String(value.as_ref().into());
+		match &mut self.value {
+			CapeValueData::String(s) => s.set_str(value.as_ref()),
+			_ => self.value = CapeValueData::String(CapeValueString::from_str(value.as_ref())),
+		}
 	}
 
 	/// Set to integer
@@ -309,7 +478,7 @@ impl CapeValueImpl {
 	/// ```
 
 	pub fn set_integer(&mut self,value: CapeInteger) {
-		self.value=CapeValueContent::Integer(value);
+		self.value=CapeValueData::Integer(value);
 	}
 
 	/// Set to boolean
@@ -332,7 +501,7 @@ impl CapeValueImpl {
 	/// ```
 
 	pub fn set_boolean(&mut self,value: bool) {
-		self.value=CapeValueContent::Boolean(value);
+		self.value=CapeValueData::Boolean(value);
 	}
 
 	/// Set to real
@@ -353,7 +522,7 @@ impl CapeValueImpl {
 	/// ```
 
 	pub fn set_real(&mut self,value: CapeReal) {
-		self.value=CapeValueContent::Real(value);
+		self.value=CapeValueData::Real(value);
 	}
 
 	/// Set the content of the value from any object that implements CapeValueProviderIn.
@@ -391,43 +560,152 @@ impl CapeValueImpl {
 		Ok(())
 	}
 
-	/// Get a reference to the value
+	/// Get the type of the value
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let val = cobia::CapeValueImpl::from_str("test");
+	/// assert_eq!(val.get_type(),cobia::CapeValueType::String);
+	/// ```
+
+	pub fn get_type(&self) -> CapeValueType {
+		match self.value {
+			CapeValueData::Empty => CapeValueType::Empty,
+			CapeValueData::String(_) => CapeValueType::String,
+			CapeValueData::Integer(_) => CapeValueType::Integer,
+			CapeValueData::Boolean(_) => CapeValueType::Boolean,
+			CapeValueData::Real(_) => CapeValueType::Real,
+		}
+	}
+
+	/// Get the string value
 	///
-	/// Returns a reference to the value
+	/// Returns None if the value is not a string.
 	///
 	/// # Examples
 	///
 	/// ```
 	/// use cobia;
 	/// let val = cobia::CapeValueImpl::from_str("test");
-	/// assert_eq!(val.value_ref(),&cobia::CapeValueContent::String("test".into()));
+	/// assert_eq!(val.get_string(),Some("test".into()));
+	/// assert_eq!(cobia::CapeValueImpl::from_integer(2).get_string(),None);
 	/// ```
 
-	pub fn value_ref(&self) -> &CapeValueContent {
-		&self.value
+	pub fn get_string(&self) -> Option<String> {
+		match &self.value {
+			CapeValueData::String(s) => Some(s.to_string()),
+			_ => None,
+		}
 	}
 
-	/// Get a mutable reference to the value
+	/// Borrow the string value
 	///
-	/// Returns a mutable reference to the value
+	/// Returns None if the value is not a string. Unlike `get_string`, this
+	/// does not allocate on platforms where COBIA uses UTF-8; on Windows, the
+	/// UTF-16 content is converted.
 	///
 	/// # Examples
 	///
 	/// ```
 	/// use cobia;
-	/// use cobia::prelude::*;
-	/// let mut val = cobia::CapeValueImpl::from_integer(2);
-	/// *val.value_ref_mut()=cobia::CapeValueContent::Boolean(false);
-	/// assert_eq!(val.value_ref(),&cobia::CapeValueContent::Boolean(false));
+	/// let val = cobia::CapeValueImpl::from_str("test");
+	/// assert_eq!(val.get_str().as_deref(),Some("test"));
+	/// assert_eq!(cobia::CapeValueImpl::from_integer(2).get_str(),None);
+	/// ```
+
+	pub fn get_str(&self) -> Option<std::borrow::Cow<'_, str>> {
+		match &self.value {
+			CapeValueData::String(s) => Some(s.as_str()),
+			_ => None,
+		}
+	}
+
+	/// Check whether the value is a string that is equal to the given string
+	///
+	/// The comparison is case sensitive, and does not allocate.
+	///
+	/// # Arguments
+	///
+	/// * `value` - The string to compare to
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let val = cobia::CapeValueImpl::from_str("test");
+	/// assert!(val.is_string("test"));
+	/// assert!(!val.is_string("Test"));
+	/// ```
+
+	pub fn is_string(&self, value: &str) -> bool {
+		match &self.value {
+			CapeValueData::String(s) => s.eq_str(value),
+			_ => false,
+		}
+	}
+
+	/// Get the integer value
+	///
+	/// Returns None if the value is not an integer.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let val = cobia::CapeValueImpl::from_integer(2);
+	/// assert_eq!(val.get_integer(),Some(2));
 	/// ```
 
-	pub fn value_ref_mut(&mut self) -> &mut CapeValueContent {
-		&mut self.value
+	pub fn get_integer(&self) -> Option<CapeInteger> {
+		match self.value {
+			CapeValueData::Integer(i) => Some(i),
+			_ => None,
+		}
 	}
 
-	/// Get a clone of the value
+	/// Get the boolean value
 	///
-	/// Returns a clone of the value
+	/// Returns None if the value is not a boolean.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let val = cobia::CapeValueImpl::from_boolean(true);
+	/// assert_eq!(val.get_boolean(),Some(true));
+	/// ```
+
+	pub fn get_boolean(&self) -> Option<bool> {
+		match self.value {
+			CapeValueData::Boolean(b) => Some(b),
+			_ => None,
+		}
+	}
+
+	/// Get the real value
+	///
+	/// Returns None if the value is not a real.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let val = cobia::CapeValueImpl::from_real(2.5);
+	/// assert_eq!(val.get_real(),Some(2.5));
+	/// ```
+
+	pub fn get_real(&self) -> Option<CapeReal> {
+		match self.value {
+			CapeValueData::Real(r) => Some(r),
+			_ => None,
+		}
+	}
+
+	/// Get a copy of the value
+	///
+	/// Returns the value as CapeValueContent
 	///
 	/// # Examples
 	///
@@ -439,7 +717,62 @@ impl CapeValueImpl {
 	/// ```
 	 
 	pub fn value(&self) -> CapeValueContent {
-		self.value.clone()
+		match &self.value {
+			CapeValueData::Empty => CapeValueContent::Empty,
+			CapeValueData::String(s) => CapeValueContent::String(s.to_string()),
+			CapeValueData::Integer(i) => CapeValueContent::Integer(*i),
+			CapeValueData::Boolean(b) => CapeValueContent::Boolean(*b),
+			CapeValueData::Real(r) => CapeValueContent::Real(*r),
+		}
+	}
+
+	/// Get a reference to the value
+	///
+	/// The value is no longer stored as CapeValueContent; the returned
+	/// object holds a copy of the value.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let val = cobia::CapeValueImpl::from_str("test");
+	/// #[allow(deprecated)]
+	/// let content = val.value_ref();
+	/// assert_eq!(content,&cobia::CapeValueContent::String("test".into()));
+	/// ```
+
+	#[deprecated(note = "use get_type, get_str, get_integer, get_boolean, get_real or value instead")]
+	pub fn value_ref(&self) -> CapeValueContentRef<'_> {
+		CapeValueContentRef {
+			content: self.value(),
+			value: std::marker::PhantomData,
+		}
+	}
+
+	/// Get a mutable reference to the value
+	///
+	/// The value is no longer stored as CapeValueContent; the returned
+	/// object holds a copy of the value, that is stored back into the
+	/// value when the object is dropped.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// let mut val = cobia::CapeValueImpl::from_integer(2);
+	/// #[allow(deprecated)]
+	/// {
+	///     *val.value_ref_mut()=cobia::CapeValueContent::Boolean(false);
+	/// }
+	/// assert_eq!(val.get_boolean(),Some(false));
+	/// ```
+
+	#[deprecated(note = "use the set_ functions or reset instead")]
+	pub fn value_ref_mut(&mut self) -> CapeValueContentMut<'_> {
+		CapeValueContentMut {
+			content: self.value(),
+			value: self,
+		}
 	}
 
 	/// Interface member function
@@ -447,13 +780,7 @@ impl CapeValueImpl {
 	extern "C" fn get_value_type(me: *mut ::std::os::raw::c_void) -> C::CapeValueType {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
-		match myself.value {
-			CapeValueContent::Empty => CapeValueType::Empty as C::CapeValueType,
-			CapeValueContent::String(_) => CapeValueType::String as C::CapeValueType,
-			CapeValueContent::Integer(_) => CapeValueType::Integer as C::CapeValueType,
-			CapeValueContent::Boolean(_) => CapeValueType::Boolean as C::CapeValueType,
-			CapeValueContent::Real(_) => CapeValueType::Real as C::CapeValueType,
-		}	
+		myself.get_type() as C::CapeValueType
 	}
 
 	/// Interface member function
@@ -462,12 +789,12 @@ impl CapeValueImpl {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
 		match &myself.value {
-			CapeValueContent::String(s) => {
-				myself.str_val.set_string(s); 
-				let (d, s)=myself.str_val.as_capechar_const_with_length();
+			CapeValueData::String(s) => {
+				//the string is stored null terminated in COBIA encoding; no conversion needed
+				let units = s.units();
 				unsafe {
-					*data = d;
-					*size = s;
+					*data = units.as_ptr() as *const CapeCharacter;
+					*size = units.len() as C::CapeSize;
 				}
 				COBIAERR_NOERROR
 			}
@@ -481,7 +808,7 @@ impl CapeValueImpl {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
 		match &myself.value {
-			CapeValueContent::Integer(i) => {
+			CapeValueData::Integer(i) => {
 				unsafe {
 					*value = *i;
 				}
@@ -497,7 +824,7 @@ impl CapeValueImpl {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
 		match &myself.value {
-			CapeValueContent::Boolean(b) => {
+			CapeValueData::Boolean(b) => {
 				unsafe {
 					*value = *b as CapeBoolean;
 				}
@@ -513,7 +840,7 @@ impl CapeValueImpl {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
 		match &myself.value {
-			CapeValueContent::Real(r) => {
+			CapeValueData::Real(r) => {
 				unsafe {
 					*value = *r;
 				}
@@ -528,8 +855,12 @@ impl CapeValueImpl {
 	extern "C" fn set_string_value(me: *mut ::std::os::raw::c_void,data: *const CapeCharacter,size: C::CapeSize) -> CapeResult {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
-		myself.str_val = unsafe { CapeStringImpl::from_raw_data(data,size) };
-		myself.value=CapeValueContent::String(myself.str_val.as_string());
+		if !matches!(myself.value, CapeValueData::String(_)) {
+			myself.value = CapeValueData::String(CapeValueString::from_str(""));
+		}
+		if let CapeValueData::String(s) = &mut myself.value {
+			unsafe { s.set_raw(data,size) };
+		}
 		COBIAERR_NOERROR
 	}
 
@@ -538,7 +869,7 @@ impl CapeValueImpl {
 	extern "C" fn set_integer_value(me: *mut ::std::os::raw::c_void,value: CapeInteger) -> CapeResult {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
-		myself.value = CapeValueContent::Integer(value);
+		myself.value = CapeValueData::Integer(value);
 		COBIAERR_NOERROR
 	}
 
@@ -547,7 +878,7 @@ impl CapeValueImpl {
 	extern "C" fn set_boolean_value(me: *mut ::std::os::raw::c_void,value: CapeBoolean) -> CapeResult {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
-		myself.value = CapeValueContent::Boolean(value!=0);
+		myself.value = CapeValueData::Boolean(value!=0);
 		COBIAERR_NOERROR
 	}
 
@@ -556,7 +887,7 @@ impl CapeValueImpl {
 	extern "C" fn set_real_value(me: *mut ::std::os::raw::c_void,value: CapeReal) -> CapeResult {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
-		myself.value = CapeValueContent::Real(value);
+		myself.value = CapeValueData::Real(value);
 		COBIAERR_NOERROR
 	}
 
@@ -565,7 +896,7 @@ impl CapeValueImpl {
 	extern "C" fn clear(me: *mut ::std::os::raw::c_void) -> CapeResult {
 		let p = me as *mut Self;
 		let myself: &mut Self = unsafe { &mut *p };
-		myself.value = CapeValueContent::Empty;
+		myself.value = CapeValueData::Empty;
 		COBIAERR_NOERROR
 	}
 
@@ -587,6 +918,60 @@ impl CapeValueImpl {
 }
 
 
+/// Copy of the content of a CapeValueImpl, returned by the deprecated `CapeValueImpl::value_ref`
+#[derive(Debug)]
+pub struct CapeValueContentRef<'a> {
+	content: CapeValueContent,
+	value: std::marker::PhantomData<&'a CapeValueImpl>,
+}
+
+impl std::ops::Deref for CapeValueContentRef<'_> {
+	type Target = CapeValueContent;
+	fn deref(&self) -> &CapeValueContent {
+		&self.content
+	}
+}
+
+impl PartialEq<&CapeValueContent> for CapeValueContentRef<'_> {
+	fn eq(&self, other: &&CapeValueContent) -> bool {
+		self.content == **other
+	}
+}
+
+impl PartialEq<CapeValueContent> for CapeValueContentRef<'_> {
+	fn eq(&self, other: &CapeValueContent) -> bool {
+		self.content == *other
+	}
+}
+
+/// Modifiable copy of the content of a CapeValueImpl, returned by the deprecated `CapeValueImpl::value_ref_mut`
+///
+/// The content is stored into the CapeValueImpl when this object is dropped.
+pub struct CapeValueContentMut<'a> {
+	content: CapeValueContent,
+	value: &'a mut CapeValueImpl,
+}
+
+impl std::ops::Deref for CapeValueContentMut<'_> {
+	type Target = CapeValueContent;
+	fn deref(&self) -> &CapeValueContent {
+		&self.content
+	}
+}
+
+impl std::ops::DerefMut for CapeValueContentMut<'_> {
+	fn deref_mut(&mut self) -> &mut CapeValueContent {
+		&mut self.content
+	}
+}
+
+impl Drop for CapeValueContentMut<'_> {
+	fn drop(&mut self) {
+		let content = std::mem::replace(&mut self.content, CapeValueContent::Empty);
+		self.value.value = CapeValueData::from_content(content);
+	}
+}
+
 impl CapeValueProviderIn for CapeValueImpl {
 	/// Convert to ICapeValue
 	///
@@ -668,27 +1053,27 @@ impl<T: CapeValueProviderIn> PartialEq<T> for CapeValueImpl {
 		let other=provider.as_cape_value_in(); 
 		//compare the values
 		match self.value {
-			CapeValueContent::Empty => {
+			CapeValueData::Empty => {
 				if other.get_type().unwrap() != CapeValueType::Empty {
 					return false;
 				}
 			},
-			CapeValueContent::String(ref s) => {
-				if other.get_type().unwrap() != CapeValueType::String || other.get_string().unwrap() != *s {
+			CapeValueData::String(ref s) => {
+				if other.get_type().unwrap() != CapeValueType::String || !s.eq_str(&other.get_string().unwrap()) {
 					return false;
 				}
 			},
-			CapeValueContent::Integer(i) => {
+			CapeValueData::Integer(i) => {
 				if other.get_type().unwrap() != CapeValueType::Integer || other.get_integer().unwrap() != i {
 					return false;
 				}
 			},
-			CapeValueContent::Boolean(b) => {
+			CapeValueData::Boolean(b) => {
 				if other.get_type().unwrap() != CapeValueType::Boolean || other.get_boolean().unwrap() != b {
 					return false;
 				}
 			},
-			CapeValueContent::Real(r) => {
+			CapeValueData::Real(r) => {
 				if other.get_type().unwrap() != CapeValueType::Real || other.get_real().unwrap() != r {
 					return false;
 				}
@@ -696,4 +1081,107 @@ impl<T: CapeValueProviderIn> PartialEq<T> for CapeValueImpl {
 		}
 		true
 	}
-}
\ No newline at end of file
+}
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	/// Get the string storage of a value
+	fn storage(value: &CapeValueImpl) -> &CapeValueString {
+		match &value.value {
+			CapeValueData::String(s) => s,
+			_ => panic!("not a string"),
+		}
+	}
+
+	/// Get the string data as it is handed out to COBIA
+	fn string_value(value: &CapeValueImpl) -> &[CapeValueChar] {
+		let mut data: *const CapeCharacter = std::ptr::null();
+		let mut size: C::CapeSize = 0;
+		let me = (value as *const CapeValueImpl).cast_mut() as *mut std::os::raw::c_void;
+		assert_eq!(CapeValueImpl::get_string_value(me, &mut data, &mut size), COBIAERR_NOERROR);
+		//including the null terminator
+		unsafe { std::slice::from_raw_parts(data as *const CapeValueChar, size as usize + 1) }
+	}
+
+	#[test]
+	fn inline_and_heap_boundary() {
+		let longest_inline = "x".repeat(INLINE_STRING_CAPACITY);
+		let shortest_heap = "x".repeat(INLINE_STRING_CAPACITY + 1);
+		let value = CapeValueImpl::from_str(&longest_inline);
+		assert!(matches!(storage(&value), CapeValueString::Inline(..)));
+		assert_eq!(value.get_str().as_deref(), Some(longest_inline.as_str()));
+		assert_eq!(string_value(&value).len(), INLINE_STRING_CAPACITY + 1);
+		assert_eq!(string_value(&value).last(), Some(&0));
+		let value = CapeValueImpl::from_str(&shortest_heap);
+		assert!(matches!(storage(&value), CapeValueString::Heap(..)));
+		assert_eq!(value.get_str().as_deref(), Some(shortest_heap.as_str()));
+		assert_eq!(string_value(&value).len(), INLINE_STRING_CAPACITY + 2);
+		assert_eq!(string_value(&value).last(), Some(&0));
+		//back to inline
+		let mut value = value;
+		value.set_str("");
+		assert!(matches!(storage(&value), CapeValueString::Inline(0, _)));
+		assert_eq!(string_value(&value), [0]);
+		#[cfg(not(target_os = "windows"))]
+		assert_eq!(INLINE_STRING_CAPACITY, 39);
+	}
+
+	#[test]
+	fn heap_storage_is_reused() {
+		let mut value = CapeValueImpl::from_str(&"a".repeat(100));
+		let data = string_value(&value).as_ptr();
+		value.set_str("b".repeat(60));
+		assert_eq!(string_value(&value).as_ptr(), data);
+		//a string without room for the null terminator is copied into the existing storage
+		let mut exact = "c".repeat(80);
+		exact.shrink_to_fit();
+		value.set_string(exact);
+		assert_eq!(string_value(&value).as_ptr(), data);
+		assert!(value.is_string(&"c".repeat(80)));
+	}
+
+	#[cfg(not(target_os = "windows"))]
+	#[test]
+	fn set_string_takes_over_storage() {
+		let mut content = String::with_capacity(100);
+		content.push_str(&"d".repeat(50));
+		let data = content.as_ptr();
+		let mut value = CapeValueImpl::from_str(&"a".repeat(100));
+		value.set_string(content);
+		assert_eq!(string_value(&value).as_ptr(), data);
+		assert!(value.is_string(&"d".repeat(50)));
+		//short strings are stored inline regardless
+		value.set_string(String::with_capacity(100));
+		assert!(matches!(storage(&value), CapeValueString::Inline(0, _)));
+	}
+
+	#[cfg(not(target_os = "windows"))]
+	#[test]
+	fn set_raw_replaces_invalid_utf8() {
+		let mut value = CapeValueImpl::from_integer(1);
+		let me = (&mut value as *mut CapeValueImpl) as *mut std::os::raw::c_void;
+		let data = [b'a', 0xff, b'b'];
+		assert_eq!(CapeValueImpl::set_string_value(me, data.as_ptr() as *const CapeCharacter, data.len() as C::CapeSize), COBIAERR_NOERROR);
+		assert_eq!(value.get_str().as_deref(), Some("a\u{fffd}b"));
+		assert_eq!(value.get_string(), Some("a\u{fffd}b".into()));
+		let data = "ü".repeat(30);
+		assert_eq!(CapeValueImpl::set_string_value(me, data.as_ptr() as *const CapeCharacter, data.len() as C::CapeSize), COBIAERR_NOERROR);
+		assert!(value.is_string(&data));
+		assert_eq!(CapeValueImpl::set_string_value(me, std::ptr::null(), 0), COBIAERR_NOERROR);
+		assert!(value.is_string(""));
+	}
+
+	#[test]
+	#[allow(deprecated)]
+	fn deprecated_references() {
+		let mut value = CapeValueImpl::from_str("test");
+		assert_eq!(value.value_ref(), &CapeValueContent::String("test".into()));
+		*value.value_ref_mut() = CapeValueContent::Real(2.5);
+		assert_eq!(value.get_real(), Some(2.5));
+		if let CapeValueContent::Real(r) = &mut *value.value_ref_mut() {
+			*r += 1.0;
+		}
+		assert_eq!(value.get_real(), Some(3.5));
+	}
+}
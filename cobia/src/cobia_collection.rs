@@ -212,6 +212,35 @@ impl<Element:CapeSmartPointer> CobiaCollectionBase<Element> {
 		}
 	}
 
+	/// Create a cached view of the collection
+	///
+	/// The cached view obtains all elements and their names once, so that
+	/// subsequent access by index or name does not call into COBIA.
+	///
+	/// # Arguments
+	///
+	/// * `name_of` - Obtains the name of an element, by which the collection identifies it, into a string
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// use cobia::prelude::*;
+	/// cobia::cape_open_initialize().unwrap();
+	/// let library_enumerator = cobia::CapeTypeLibraries::new().unwrap();
+	/// fn name_of(library: &cobia::CapeLibraryDetails, name: &mut cobia::CapeStringImpl) -> Result<(), cobia::COBIAError> {
+	/// 	name.set_string(library.get_name()?);
+	/// 	Ok(())
+	/// }
+	/// let libraries = library_enumerator.libraries().unwrap().into_cache(name_of).unwrap();
+	/// assert!(libraries.get("CAPEOPEN_1_2").is_some());
+	/// cobia::cape_open_cleanup();
+	/// ```
+
+	pub fn into_cache(self, name_of: fn(&Element, &mut CapeStringImpl) -> Result<(), COBIAError>) -> Result<CobiaCollectionCache<Element, Self>, COBIAError> {
+		CobiaCollectionCache::new(self, name_of)
+	}
+
 }
 
 /// Iterator that consumes a CobiaCollectionBase
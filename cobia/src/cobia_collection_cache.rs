@@ -0,0 +1,434 @@
+use crate::*;
+use cape_smart_pointer::CapeSmartPointer;
+use std::cell::RefCell;
+
+/// A collection that can be cached by a `CobiaCollectionCache`
+///
+/// This is implemented for the collections that COBIA returns, `CobiaCollection`,
+/// and for CAPE-OPEN 1.2 collections, `cape_open_1_2::CapeCollection`, such as
+/// the parameter collection of a PMC or the port collection of a unit operation.
+
+pub trait CacheableCollection<Element> {
+
+	/// Get the number of elements in the collection
+
+	fn element_count(&self) -> Result<usize, COBIAError>;
+
+	/// Get an element by index
+	///
+	/// # Arguments
+	///
+	/// * `index` - The zero-based index of the element
+
+	fn element_at(&self, index: usize) -> Result<Element, COBIAError>;
+}
+
+impl<Element: CapeSmartPointer> CacheableCollection<Element> for CobiaCollection<Element> {
+
+	fn element_count(&self) -> Result<usize, COBIAError> {
+		Ok(self.size())
+	}
+
+	fn element_at(&self, index: usize) -> Result<Element, COBIAError> {
+		self.at(index)
+	}
+}
+
+impl<Element: CapeSmartPointer> CacheableCollection<Element> for cape_open_1_2::CapeCollection<Element> {
+
+	fn element_count(&self) -> Result<usize, COBIAError> {
+		Ok(self.get_count()? as usize)
+	}
+
+	fn element_at(&self, index: usize) -> Result<Element, COBIAError> {
+		self.item_by_index(index as CapeInteger)
+	}
+}
+
+impl<Element: CapeSmartPointer> cape_open_1_2::CapeCollection<Element> {
+
+	/// Obtain all elements and their names into a cache
+	///
+	/// The elements are identified by their component name.
+	///
+	/// # Returns
+	///
+	/// The cache, or the first error obtaining an element or its name.
+
+	pub fn into_cache(self) -> Result<CobiaCollectionCache<Element, Self>, COBIAError> {
+		CobiaCollectionCache::new(self, component_name)
+	}
+}
+
+/// Get the component name of a CAPE-OPEN 1.2 collection element
+///
+/// # Arguments
+///
+/// * `element` - The element, which must implement ICapeIdentification
+/// * `name` - Receives the component name
+
+fn component_name<Element: CapeSmartPointer>(element: &Element, name: &mut CapeStringImpl) -> Result<(), COBIAError> {
+	let identification = cape_open_1_2::CapeIdentification::from_object(element)?;
+	identification.get_component_name(name)
+}
+
+/// Cached view of a collection with a case insensitive name index
+///
+/// Each access to a collection calls into COBIA or into the PMC: obtaining an
+/// element by index returns a new element pointer, and obtaining an element by
+/// name marshals the name across the ABI and lets the collection search for it.
+/// The cache obtains all elements and their names once; after that, access by
+/// index or by name neither calls into the collection nor allocates.
+///
+/// The cache does not observe changes to the collection. `is_current()`
+/// only compares the number of elements, at the cost of a single call.
+/// `verify()` also compares the name of each element with that of the
+/// collection, which detects replaced and renamed elements at the cost of
+/// two calls per element; `refresh()` rebuilds the cache unconditionally.
+///
+/// # Example
+///
+/// ```
+/// use cobia;
+/// use cobia::prelude::*;
+/// cobia::cape_open_initialize().unwrap();
+/// let library_enumerator = cobia::CapeTypeLibraries::new().unwrap();
+/// fn name_of(library: &cobia::CapeLibraryDetails, name: &mut cobia::CapeStringImpl) -> Result<(), cobia::COBIAError> {
+/// 	name.set_string(library.get_name()?);
+/// 	Ok(())
+/// }
+/// let libraries = library_enumerator.libraries().unwrap().into_cache(name_of).unwrap();
+/// let library = libraries.get("capeopen_1_2").unwrap(); //names are case insensitive
+/// assert_eq!(library.get_name().unwrap(),"CAPEOPEN_1_2");
+/// assert!(libraries.is_current());
+/// assert!(libraries.verify());
+/// cobia::cape_open_cleanup();
+/// ```
+
+pub struct CobiaCollectionCache<Element, Collection: CacheableCollection<Element>> {
+	/// The cached collection
+	collection: Collection,
+	/// Obtains the name of an element
+	name_of: fn(&Element, &mut CapeStringImpl) -> Result<(), COBIAError>,
+	/// The elements, in collection order
+	elements: Vec<Element>,
+	/// Element indices by name
+	names: CapeOpenMap<usize>,
+	/// For each element, the index that its name resolves to; that of an earlier element if the name is not unique
+	resolved: Vec<usize>,
+	/// Buffer for the names that are looked up or obtained from the collection
+	lookup: RefCell<CapeStringImpl>,
+}
+
+impl<Element, Collection: CacheableCollection<Element>> CobiaCollectionCache<Element, Collection> {
+
+	/// Create a cache of a collection
+	///
+	/// # Arguments
+	///
+	/// * `collection` - The collection
+	/// * `name_of` - Obtains the name of an element, by which the collection identifies it, into a string
+	///
+	/// # Returns
+	///
+	/// The cache, or the first error obtaining an element or its name.
+
+	pub fn new(collection: Collection, name_of: fn(&Element, &mut CapeStringImpl) -> Result<(), COBIAError>) -> Result<Self, COBIAError> {
+		let mut cache = CobiaCollectionCache {
+			collection,
+			name_of,
+			elements: Vec::new(),
+			names: CapeOpenMap::new(),
+			resolved: Vec::new(),
+			lookup: RefCell::new(CapeStringImpl::new()),
+		};
+		cache.refresh()?;
+		Ok(cache)
+	}
+
+	/// Rebuild the cache from the collection
+	///
+	/// The storage of the cache is reused. If an error occurs, the cache is left empty.
+
+	pub fn refresh(&mut self) -> Result<(), COBIAError> {
+		self.clear();
+		let result = self.load();
+		if result.is_err() {
+			self.clear();
+		}
+		result
+	}
+
+	/// Remove all cached elements, keeping the storage
+	fn clear(&mut self) {
+		self.elements.clear();
+		self.names.clear();
+		self.resolved.clear();
+	}
+
+	/// Obtain the elements and their names from the collection
+	fn load(&mut self) -> Result<(), COBIAError> {
+		let size = self.collection.element_count()?;
+		self.elements.reserve(size);
+		self.names.reserve(size);
+		self.resolved.reserve(size);
+		let name = self.lookup.get_mut();
+		for index in 0..size {
+			let element = self.collection.element_at(index)?;
+			(self.name_of)(&element, name)?;
+			//names should be unique; if not, the first element is found by name
+			let (ptr, len) = name.as_capechar_const_with_length();
+			let resolved = *self.names.entry(CapeStringHashKey::from_cape_char_const(ptr, len)).or_insert(index);
+			self.resolved.push(resolved);
+			self.elements.push(element);
+		}
+		Ok(())
+	}
+
+	/// Check whether the collection has as many elements as the cache
+	///
+	/// This detects added and removed elements, but not replaced or renamed
+	/// elements; see `verify()`. A collection that cannot be read does not match.
+
+	pub fn is_current(&self) -> bool {
+		self.collection.element_count().ok() == Some(self.elements.len())
+	}
+
+	/// Check whether the cache matches the collection
+	///
+	/// The cache matches if the collection has as many elements, and the name
+	/// of each element of the collection resolves to the same element as the
+	/// name of the cached element at that index. A collection that cannot be
+	/// read does not match.
+
+	pub fn verify(&self) -> bool {
+		if !self.is_current() {
+			return false;
+		}
+		//the names are obtained into a buffer that is reused across elements
+		let mut name = self.lookup.borrow_mut();
+		(0..self.elements.len()).all(|index| {
+			self.collection.element_at(index)
+				.and_then(|element| (self.name_of)(&element, &mut name))
+				.is_ok_and(|()| self.names.get(&*name) == Some(&self.resolved[index]))
+		})
+	}
+
+	/// Rebuild the cache if the collection changed
+	///
+	/// The collection is compared with the cache by `verify()`.
+	///
+	/// # Returns
+	///
+	/// Whether the cache was rebuilt.
+
+	pub fn refresh_if_changed(&mut self) -> Result<bool, COBIAError> {
+		if self.verify() {
+			Ok(false)
+		} else {
+			self.refresh()?;
+			Ok(true)
+		}
+	}
+
+	/// Get the cached collection
+
+	pub fn collection(&self) -> &Collection {
+		&self.collection
+	}
+
+	/// Get the number of cached elements
+
+	pub fn len(&self) -> usize {
+		self.elements.len()
+	}
+
+	/// Check whether there are no cached elements
+
+	pub fn is_empty(&self) -> bool {
+		self.elements.is_empty()
+	}
+
+	/// Get an element by index
+	///
+	/// # Arguments
+	///
+	/// * `index` - The zero-based index of the element
+	///
+	/// # Returns
+	///
+	/// The element, or None if the index is out of range.
+
+	pub fn at(&self, index: usize) -> Option<&Element> {
+		self.elements.get(index)
+	}
+
+	/// Get an element by name
+	///
+	/// The name is case insensitive.
+	///
+	/// # Arguments
+	///
+	/// * `id` - The name of the element
+	///
+	/// # Returns
+	///
+	/// The element, or None if there is no element by this name.
+
+	pub fn get(&self, id: &str) -> Option<&Element> {
+		self.position(id).map(|index| &self.elements[index])
+	}
+
+	/// Get an element by name, given as CAPE-OPEN string
+	///
+	/// The name is case insensitive. Unlike `get`, this does not convert the name.
+	///
+	/// # Arguments
+	///
+	/// * `id` - The name of the element
+	///
+	/// # Returns
+	///
+	/// The element, or None if there is no element by this name.
+
+	pub fn get_by_cape_string<T: CapeStringConstProvider>(&self, id: &T) -> Option<&Element> {
+		self.names.get(id).map(|&index| &self.elements[index])
+	}
+
+	/// Get the index of an element by name
+	///
+	/// # Arguments
+	///
+	/// * `id` - The name of the element
+	///
+	/// # Returns
+	///
+	/// The index of the element, or None if there is no element by this name.
+
+	pub fn position(&self, id: &str) -> Option<usize> {
+		//the name is converted into a buffer that is reused across lookups
+		let mut lookup = self.lookup.borrow_mut();
+		lookup.set_string(id);
+		self.names.get(&*lookup).copied()
+	}
+
+	/// Iterate over the cached elements, in collection order
+
+	pub fn iter(&self) -> std::slice::Iter<'_, Element> {
+		self.elements.iter()
+	}
+}
+
+impl<'a, Element, Collection: CacheableCollection<Element>> IntoIterator for &'a CobiaCollectionCache<Element, Collection> {
+	type Item = &'a Element;
+	type IntoIter = std::slice::Iter<'a, Element>;
+	fn into_iter(self) -> Self::IntoIter {
+		self.elements.iter()
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use crate::*;
+	use std::cell::RefCell;
+
+	/// A collection of elements that are identified by their content
+	struct Names(RefCell<Vec<&'static str>>);
+
+	impl Names {
+		fn new(names: &[&'static str]) -> Names {
+			Names(RefCell::new(names.to_vec()))
+		}
+	}
+
+	impl CacheableCollection<String> for Names {
+
+		fn element_count(&self) -> Result<usize, COBIAError> {
+			Ok(self.0.borrow().len())
+		}
+
+		fn element_at(&self, index: usize) -> Result<String, COBIAError> {
+			self.0.borrow().get(index).map(|name| name.to_string()).ok_or(COBIAError::Code(COBIAERR_NOSUCHITEM))
+		}
+	}
+
+	fn name_of(element: &String, name: &mut CapeStringImpl) -> Result<(), COBIAError> {
+		match element.as_str() {
+			"unnamed" => Err(COBIAError::Code(COBIAERR_NOSUCHITEM)),
+			element => {
+				name.set_string(element);
+				Ok(())
+			},
+		}
+	}
+
+	#[test]
+	fn lookup() {
+		let cache = CobiaCollectionCache::new(Names::new(&["feed", "Product", "FEED"]), name_of).unwrap();
+		assert_eq!(cache.len(), 3);
+		assert_eq!(cache.iter().map(String::as_str).collect::<Vec<_>>(), ["feed", "Product", "FEED"]);
+		assert_eq!(cache.get("PRODUCT").map(String::as_str), Some("Product"));
+		assert_eq!(cache.get_by_cape_string(&CapeStringImpl::from_string("product")).map(String::as_str), Some("Product"));
+		//the first of equally named elements is found by name
+		assert_eq!(cache.position("Feed"), Some(0));
+		assert_eq!(cache.get("energy"), None);
+		assert_eq!(cache.at(2).map(String::as_str), Some("FEED"));
+		assert_eq!(cache.at(3), None);
+	}
+
+	#[test]
+	fn changes_are_detected() {
+		let cache = CobiaCollectionCache::new(Names::new(&["feed", "product"]), name_of).unwrap();
+		assert!(cache.is_current());
+		assert!(cache.verify());
+		//renamed
+		*cache.collection().0.borrow_mut() = vec!["feed", "bottoms"];
+		assert!(cache.is_current());
+		assert!(!cache.verify());
+		//reordered
+		*cache.collection().0.borrow_mut() = vec!["product", "feed"];
+		assert!(cache.is_current());
+		assert!(!cache.verify());
+		//added
+		*cache.collection().0.borrow_mut() = vec!["feed", "product", "distillate"];
+		assert!(!cache.is_current());
+		assert!(!cache.verify());
+		//removed
+		*cache.collection().0.borrow_mut() = vec!["feed"];
+		assert!(!cache.is_current());
+		//same names in a different case
+		*cache.collection().0.borrow_mut() = vec!["FEED", "Product"];
+		assert!(cache.verify());
+		//a name that cannot be obtained
+		*cache.collection().0.borrow_mut() = vec!["feed", "unnamed"];
+		assert!(cache.is_current());
+		assert!(!cache.verify());
+		//names that are not unique
+		let cache = CobiaCollectionCache::new(Names::new(&["feed", "product", "Feed"]), name_of).unwrap();
+		assert!(cache.verify());
+		*cache.collection().0.borrow_mut() = vec!["feed", "product", "Product"];
+		assert!(!cache.verify());
+	}
+
+	#[test]
+	fn refresh() {
+		let mut cache = CobiaCollectionCache::new(Names::new(&["feed"]), name_of).unwrap();
+		assert!(!cache.refresh_if_changed().unwrap());
+		*cache.collection().0.borrow_mut() = vec!["feed", "product"];
+		assert!(cache.refresh_if_changed().unwrap());
+		assert_eq!(cache.position("product"), Some(1));
+		assert!(cache.verify());
+		//renamed
+		*cache.collection().0.borrow_mut() = vec!["feed", "distillate"];
+		assert!(cache.refresh_if_changed().unwrap());
+		assert_eq!(cache.position("distillate"), Some(1));
+		assert_eq!(cache.position("product"), None);
+		//an error leaves the cache empty
+		*cache.collection().0.borrow_mut() = vec!["feed", "unnamed"];
+		assert!(cache.refresh().is_err());
+		assert!(cache.is_empty());
+		assert_eq!(cache.get("feed"), None);
+		assert!(!cache.is_current());
+		assert!(CobiaCollectionCache::new(Names::new(&["unnamed"]), name_of).is_err());
+	}
+}
@@ -116,6 +116,8 @@ mod cape_array_object_vec;
 pub use cape_array_object_vec::{CapeArrayStringVec,CapeArrayValueVec};
 mod cobia_collection;
 pub use cobia_collection::CobiaCollection;
+mod cobia_collection_cache;
+pub use cobia_collection_cache::{CacheableCollection,CobiaCollectionCache};
 mod cobia_identification;
 pub use cobia_identification::CobiaIdentification;
 pub use C::CapeBoolean;
@@ -185,10 +187,20 @@ mod cape_pmc_registration_details;
 pub use cape_pmc_registration_details::CapePMCRegistrationDetails;
 mod cape_pmc_enumerator;
 pub use cape_pmc_enumerator::CapePMCEnumerator;
+mod cape_pmc_catalogue;
+pub use cape_pmc_catalogue::{CapePMCCatalogue,CapePMCCatalogueFields};
+mod cape_pmc_index;
+pub use cape_pmc_index::CapePMCIndex;
+mod cape_uuid;
+pub use cape_uuid::{CapeUUIDBuildHasher,CapeUUIDMap};
 mod cape_type_library_details;
 pub use cape_type_library_details::CapeLibraryDetails;
 mod cape_type_library_enumerator;
 pub use cape_type_library_enumerator::CapeTypeLibraries;
+mod cape_type_library_index;
+pub use cape_type_library_index::{CapeTypeLibraryIndex,CapeTypeLibraryInfo};
+mod cape_registry_snapshot;
+pub use cape_registry_snapshot::{CapeRegistrySnapshot,CapeSnapshotPMC,CapeSnapshotLibrary};
 mod cobia_pmc_helpers;
 pub use cobia_pmc_helpers::*;
 mod cape_object_impl;
@@ -358,6 +370,33 @@ impl CapeUUID {
 		Self {data: *slice}
 	}
 
+	/// #Create a CapeUUID from a string at compile time
+	///
+	/// Creates a new CapeUUID from a string of the form `{12345678-9abc-def0-1234-567890abcdef}`,
+	/// in either case, with or without braces. Typically used through the `uuid!` macro.
+	///
+	/// # Arguments
+	///
+	/// * `s` - A string slice to be converted to a CapeUUID
+	///
+	/// # Panics
+	///
+	/// Panics if the string is not a valid UUID; in a const context this is a compile time error.
+	///
+	/// # Examples
+	///
+	/// ```
+	/// use cobia;
+	/// const UUID: cobia::CapeUUID = cobia::CapeUUID::from_literal("{12345678-9abc-def0-1234-567890abcdef}");
+	/// assert_eq!(UUID,cobia::CapeUUID::from_slice(&[0x12u8,0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0,0x12,0x34,0x56,0x78,0x90,0xab,0xcd,0xef]));
+	/// ```
+	pub const fn from_literal(s: &str) -> Self {
+		match cape_uuid::parse_uuid(s.as_bytes()) {
+			Some(data) => Self {data},
+			None => panic!("invalid UUID literal"),
+		}
+	}
+
 	/// #Create a new CapeUUID from a string
 	///
 	/// Creates a new CapeUUID from a string
@@ -376,6 +415,10 @@ impl CapeUUID {
 	/// assert_eq!(uuid_1,uuid_2);
 	/// ```
 	pub fn from_string(s: &str) -> Result<Self, COBIAError> {
+		if let Some(data) = cape_uuid::parse_braced_uuid(s.as_bytes()) {
+			return Ok(Self {data});
+		}
+		//not in the form that COBIA formats; leave it to COBIA, which decides what else it accepts
 		let mut uuid = CapeUUID::null();
 		let str_uuid = CapeStringImpl::from_string(s);
 		let res = unsafe { C::capeUUIDFromString(str_uuid.as_capechar_const(), &mut uuid) };
@@ -400,11 +443,8 @@ impl CapeUUID {
 	/// assert_eq!(&s,"{12345678-9abc-def0-1234-567890abcdef}");
 	/// ```
 	pub fn as_string(&self) -> String {
-		let mut s = CapeStringImpl::new();
-		unsafe {
-			C::capeStringFromUUID(self as *const CapeUUID, (&s.as_cape_string_out() as *const C::ICapeString).cast_mut());
-		}
-		s.as_string()
+		//ASCII only
+		String::from_utf8(cape_uuid::format_uuid(&self.data).to_vec()).unwrap()
 	}
 
 	/// #Compare two CapeUUIDs
@@ -487,12 +527,7 @@ impl PartialEq for CapeUUID {
 	/// ```
 
 	fn eq(&self, other: &Self) -> bool {
-		unsafe {
-			C::capeUUID_Equal(
-				self as *const CapeUUID,
-				other as *const CapeUUID,
-			)
-		}
+		u128::from_ne_bytes(self.data) == u128::from_ne_bytes(other.data)
 	}
 }
 
@@ -500,7 +535,10 @@ impl Eq for CapeUUID {}
 
 impl Hash for CapeUUID {
 	fn hash<H: Hasher>(&self, state: &mut H) {
-		state.write(&self.data);
+		//two words rather than a byte slice; no length prefix, no byte loop
+		let (low, high) = self.data.split_at(8);
+		state.write_u64(u64::from_ne_bytes(low.try_into().unwrap()));
+		state.write_u64(u64::from_ne_bytes(high.try_into().unwrap()));
 	}
 }
 
@@ -517,7 +555,8 @@ impl std::fmt::Display for CapeUUID {
 	/// ```
 
 	fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
-		write!(f, "{}", self.as_string())
+		//ASCII only
+		f.write_str(std::str::from_utf8(&cape_uuid::format_uuid(&self.data)).unwrap())
 	}
 }
 
@@ -1,6 +1,13 @@
 extern crate winres;
 
 fn main() {
+  //embed the dialog assets, precompressed
+  html_dialog_build::embed_assets("gui_assets.rs", &[
+    ("GUI_HTML", "src/gui/gui.html", "text/html"),
+    ("GUI_CSS", "src/gui/gui.css", "text/css"),
+    ("GUI_JS", "src/gui/gui.js", "text/javascript"),
+    ("GUI_PNG", "src/gui/gui.png", "image/png"),
+  ]).unwrap();
   if cfg!(target_os = "windows") {
     let res = winres::WindowsResource::new();
     res.compile().unwrap();
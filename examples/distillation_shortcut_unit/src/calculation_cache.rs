@@ -0,0 +1,491 @@
+use cobia::*;
+use std::hash::{Hash,Hasher};
+use crate::performance::{Performance,ExternalCall};
+use crate::validation_cache::PortToken;
+
+/// The string constants needed to capture and replay the state of a material object.
+///
+/// These are created once per capture or replay, rather than once per property access.
+
+pub(crate) struct MaterialStateLiterals {
+	/// The string literal 'temperature'
+	temperature : CapeStringImpl,
+	/// The string literal 'pressure'
+	pressure : CapeStringImpl,
+	/// The string literal 'flow'
+	flow : CapeStringImpl,
+	/// The string literal 'phaseFraction'
+	phase_fraction : CapeStringImpl,
+	/// The string literal 'fraction'
+	fraction : CapeStringImpl,
+	/// The string literal 'mole'
+	mole : CapeStringImpl,
+	/// Empty string literal, used to indicate that no basis applies to a property
+	no_basis : CapeStringImpl,
+}
+
+impl MaterialStateLiterals {
+
+	/// Creates the string literals
+	pub fn new() -> Self {
+		Self {
+			temperature : CapeStringImpl::from("temperature"),
+			pressure : CapeStringImpl::from("pressure"),
+			flow : CapeStringImpl::from("flow"),
+			phase_fraction : CapeStringImpl::from("phaseFraction"),
+			fraction : CapeStringImpl::from("fraction"),
+			mole : CapeStringImpl::from("mole"),
+			no_basis : CapeStringImpl::new(),
+		}
+	}
+}
+
+/// The equilibrium state of a material object.
+///
+/// Contains the overall temperature, pressure and compound flows, and
+/// for each present phase its phase status, phase fraction and composition:
+/// this is the information that a unit operation passes to a product
+/// material object after the phase equilibrium calculation. For the feed,
+/// it is the information from which the feed enthalpy is calculated.
+
+pub(crate) struct MaterialState {
+	/// Overall temperature, K
+	temperature : CapeArrayRealScalar,
+	/// Overall pressure, Pa
+	pressure : CapeArrayRealScalar,
+	/// Compound flow rates, mol/s
+	flows : CapeArrayRealVec,
+	/// The IDs of the present phases
+	present_phases : CapeArrayStringVec,
+	/// The status of the present phases
+	present_phase_status : CapeArrayEnumerationVec<cape_open_1_2::CapePhaseStatus>,
+	/// Phase fraction for each present phase, mol/mol
+	phase_fractions : Vec<CapeArrayRealScalar>,
+	/// Composition for each present phase, mol/mol
+	phase_compositions : Vec<CapeArrayRealVec>,
+}
+
+impl MaterialState {
+
+	/// Creates an empty material state
+	pub fn new() -> Self {
+		Self {
+			temperature : CapeArrayRealScalar::new(),
+			pressure : CapeArrayRealScalar::new(),
+			flows : CapeArrayRealVec::new(),
+			present_phases : CapeArrayStringVec::new(),
+			present_phase_status : CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>::new(),
+			phase_fractions : Vec::new(),
+			phase_compositions : Vec::new(),
+		}
+	}
+
+	/// The overall pressure, Pa
+	pub fn pressure(&self) -> &CapeArrayRealScalar {
+		&self.pressure
+	}
+
+	/// The compound flow rates, mol/s
+	pub fn flows(&self) -> &CapeArrayRealVec {
+		&self.flows
+	}
+
+	/// Add the state to a hash.
+	///
+	/// The feed enthalpy follows from the phase fractions and phase compositions;
+	/// at given temperature, pressure and overall composition a feed at a phase
+	/// boundary can still differ in its vapor fraction, so these are all included.
+	///
+	/// # Arguments:
+	/// * `hasher` - The hasher to which the state is added
+
+	pub fn hash<H:Hasher>(&self,hasher:&mut H) {
+		hasher.write_u64(self.temperature.value().to_bits());
+		hasher.write_u64(self.pressure.value().to_bits());
+		for flow in self.flows.as_vec().iter() {
+			hasher.write_u64(flow.to_bits());
+		}
+		hasher.write_usize(self.present_phases.size());
+		for (i,phase_id) in self.present_phases.iter().enumerate() {
+			phase_id.hash(hasher);
+			hasher.write_i32(self.present_phase_status.as_vec()[i] as i32);
+			hasher.write_u64(self.phase_fractions[i].value().to_bits());
+			for x in self.phase_compositions[i].as_vec().iter() {
+				hasher.write_u64(x.to_bits());
+			}
+		}
+	}
+
+	/// Obtain the state from a material object at equilibrium.
+	///
+	/// # Arguments:
+	/// * `material_object` - The material object from which the state is obtained
+	/// * `literals` - The string literals for the property names
+	/// * `performance` - Records the CAPE-OPEN calls
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn capture(&mut self,material_object:&cape_open_1_2::CapeThermoMaterial,literals:&MaterialStateLiterals,performance:&Performance) -> Result<(),COBIAError> {
+		performance.call(ExternalCall::GetOverallProp,|| material_object.get_overall_prop(&literals.temperature,&literals.no_basis,&mut self.temperature))?;
+		performance.call(ExternalCall::GetOverallProp,|| material_object.get_overall_prop(&literals.pressure,&literals.no_basis,&mut self.pressure))?;
+		performance.call(ExternalCall::GetOverallProp,|| material_object.get_overall_prop(&literals.flow,&literals.mole,&mut self.flows))?;
+		performance.call(ExternalCall::GetPresentPhases,|| material_object.get_present_phases(&mut self.present_phases,&mut self.present_phase_status))?;
+		let phase_count=self.present_phases.size();
+		self.phase_fractions.resize_with(phase_count,CapeArrayRealScalar::new);
+		self.phase_compositions.resize_with(phase_count,CapeArrayRealVec::new);
+		for (i,phase_id) in self.present_phases.iter().enumerate() {
+			performance.call(ExternalCall::GetSinglePhaseProp,|| material_object.get_single_phase_prop(&literals.phase_fraction,phase_id,&literals.mole,&mut self.phase_fractions[i]))?;
+			performance.call(ExternalCall::GetSinglePhaseProp,|| material_object.get_single_phase_prop(&literals.fraction,phase_id,&literals.mole,&mut self.phase_compositions[i]))?;
+		}
+		Ok(())
+	}
+
+	/// Put the state on a material object.
+	///
+	/// # Arguments:
+	/// * `material_object` - The material object on which the state is set
+	/// * `literals` - The string literals for the property names
+	/// * `performance` - Records the CAPE-OPEN calls
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn replay(&self,material_object:&cape_open_1_2::CapeThermoMaterial,literals:&MaterialStateLiterals,performance:&Performance) -> Result<(),COBIAError> {
+		performance.call(ExternalCall::SetOverallProp,|| material_object.set_overall_prop(&literals.flow,&literals.mole,&self.flows))?;
+		performance.call(ExternalCall::SetOverallProp,|| material_object.set_overall_prop(&literals.temperature,&literals.no_basis,&self.temperature))?;
+		performance.call(ExternalCall::SetOverallProp,|| material_object.set_overall_prop(&literals.pressure,&literals.no_basis,&self.pressure))?;
+		performance.call(ExternalCall::SetPresentPhases,|| material_object.set_present_phases(&self.present_phases,&self.present_phase_status))?;
+		for (i,phase_id) in self.present_phases.iter().enumerate() {
+			performance.call(ExternalCall::SetSinglePhaseProp,|| material_object.set_single_phase_prop(&literals.phase_fraction,phase_id,&literals.mole,&self.phase_fractions[i]))?;
+			performance.call(ExternalCall::SetSinglePhaseProp,|| material_object.set_single_phase_prop(&literals.fraction,phase_id,&literals.mole,&self.phase_compositions[i]))?;
+		}
+		Ok(())
+	}
+}
+
+/// The inputs of a calculation of the unit operation.
+///
+/// These are all values that the results of a calculation depend on: the state of
+/// the feed, the values of all input parameters, and the identity and compound list
+/// of the connected material objects; the material objects carry the property package
+/// that performs the property and phase equilibrium calculations.
+///
+/// A property package is not identified through its material object. Instead, the port
+/// tokens include a hash of the compound list, with the compound constants, and the phase
+/// list of each material object. Swapping or reconfiguring the property package behind a
+/// material object changes these lists, unless the new package reports the same compounds,
+/// constants and phases; such a change is not detected.
+
+pub(crate) struct CalculationInputs<'a> {
+	/// The state of the feed
+	pub feed : &'a MaterialState,
+	/// The identity tokens of the material objects connected to the feed, distillate and bottoms ports
+	pub ports : [PortToken;3],
+	/// The compound IDs of the feed material object
+	pub compound_ids : &'a CapeArrayStringVec,
+	/// The ID of the vapor phase
+	pub vapor_phase_id : &'a CapeStringImpl,
+	/// The light key compound
+	pub light_key_compound : &'a CapeStringImpl,
+	/// The heavy key compound
+	pub heavy_key_compound : &'a CapeStringImpl,
+	/// The recovery of the light key compound
+	pub light_key_compound_recovery : f64,
+	/// The recovery of the heavy key compound
+	pub heavy_key_compound_recovery : f64,
+	/// The factor of the reflux ratio above minimum reflux ratio
+	pub reflux_ratio_factor : f64,
+	/// The maximum number of iterations
+	pub maximum_iterations : i32,
+	/// The convergence tolerance
+	pub convergence_tolerance : f64,
+}
+
+impl<'a> CalculationInputs<'a> {
+
+	/// Calculate a fingerprint of the inputs
+	///
+	/// # Returns:
+	/// * The fingerprint
+
+	pub fn fingerprint(&self) -> u64 {
+		let mut hasher=std::hash::DefaultHasher::new();
+		self.feed.hash(&mut hasher);
+		for port in self.ports {
+			hasher.write_usize(port.object);
+			hasher.write_u64(port.lists);
+		}
+		hasher.write_usize(self.compound_ids.size());
+		for compound_id in self.compound_ids.iter() {
+			compound_id.hash(&mut hasher);
+		}
+		self.vapor_phase_id.hash(&mut hasher);
+		self.light_key_compound.hash(&mut hasher);
+		self.heavy_key_compound.hash(&mut hasher);
+		hasher.write_u64(self.light_key_compound_recovery.to_bits());
+		hasher.write_u64(self.heavy_key_compound_recovery.to_bits());
+		hasher.write_u64(self.reflux_ratio_factor.to_bits());
+		hasher.write_i32(self.maximum_iterations);
+		hasher.write_u64(self.convergence_tolerance.to_bits());
+		hasher.finish()
+	}
+}
+
+/// Cache of the results of the last successful calculation.
+///
+/// The cache is keyed on a fingerprint of all calculation inputs. If the unit operation
+/// is asked to calculate with the same inputs, the cached product states are put on the
+/// product material objects rather than repeating the calculation. The output parameters
+/// of the unit operation retain the values of the last successful calculation.
+
+pub(crate) struct CalculationCache {
+	/// Fingerprint of the inputs of the last successful calculation; None if no valid results are cached
+	fingerprint : Option<u64>,
+	/// State of the distillate product
+	distillate : MaterialState,
+	/// State of the bottoms product
+	bottoms : MaterialState,
+	/// Number of calculations that were skipped, since creation of the unit
+	pub hits : u64,
+}
+
+impl std::default::Default for CalculationCache {
+	/// Creates an empty cache
+	fn default() -> Self {
+		Self {
+			fingerprint: None,
+			distillate: MaterialState::new(),
+			bottoms: MaterialState::new(),
+			hits: 0,
+		}
+	}
+}
+
+impl CalculationCache {
+
+	/// Check whether the cache contains results for the given inputs
+	///
+	/// A match is counted as a hit; the caller must then replay the cached results.
+	///
+	/// # Arguments:
+	/// * `fingerprint` - The fingerprint of the current inputs
+	///
+	/// # Returns:
+	/// * Whether cached results are available
+
+	pub fn lookup(&mut self,fingerprint:u64) -> bool {
+		let matches=self.fingerprint==Some(fingerprint);
+		if matches {
+			self.hits+=1;
+		}
+		matches
+	}
+
+	/// Drop the cached results
+	pub fn invalidate(&mut self) {
+		self.fingerprint=None;
+	}
+
+	/// Store the product states after a successful calculation
+	///
+	/// # Arguments:
+	/// * `fingerprint` - The fingerprint of the inputs of the calculation
+	/// * `distillate_material_object` - The distillate product material object
+	/// * `bottoms_material_object` - The bottoms product material object
+	/// * `performance` - Records the CAPE-OPEN calls
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn store(&mut self,fingerprint:u64,distillate_material_object:&cape_open_1_2::CapeThermoMaterial,bottoms_material_object:&cape_open_1_2::CapeThermoMaterial,performance:&Performance) -> Result<(),COBIAError> {
+		self.fingerprint=None;
+		let literals=MaterialStateLiterals::new();
+		self.distillate.capture(distillate_material_object,&literals,performance)?;
+		self.bottoms.capture(bottoms_material_object,&literals,performance)?;
+		self.fingerprint=Some(fingerprint);
+		Ok(())
+	}
+
+	/// Put the cached product states on the product material objects
+	///
+	/// # Arguments:
+	/// * `distillate_material_object` - The distillate product material object
+	/// * `bottoms_material_object` - The bottoms product material object
+	/// * `performance` - Records the CAPE-OPEN calls
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn replay(&self,distillate_material_object:&cape_open_1_2::CapeThermoMaterial,bottoms_material_object:&cape_open_1_2::CapeThermoMaterial,performance:&Performance) -> Result<(),COBIAError> {
+		let literals=MaterialStateLiterals::new();
+		self.distillate.replay(distillate_material_object,&literals,performance)?;
+		self.bottoms.replay(bottoms_material_object,&literals,performance)
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+	use crate::validation_cache::MaterialLists;
+
+	/// A two-phase feed at the given vapor fraction
+	fn feed(temperature:f64,pressure:f64,flows:&[f64],vapor_fraction:f64) -> MaterialState {
+		let mut state=MaterialState::new();
+		state.temperature=CapeArrayRealScalar::from(temperature);
+		state.pressure=CapeArrayRealScalar::from(pressure);
+		state.flows=CapeArrayRealVec::from_slice(flows);
+		state.present_phases=CapeArrayStringVec::from(&["Vapor","Liquid"]);
+		state.present_phase_status=CapeArrayEnumerationVec::from_slice(&[cape_open_1_2::CapePhaseStatus::CapeAtequilibrium,cape_open_1_2::CapePhaseStatus::CapeAtequilibrium]);
+		state.phase_fractions=vec![CapeArrayRealScalar::from(vapor_fraction),CapeArrayRealScalar::from(1.0-vapor_fraction)];
+		state.phase_compositions=vec![CapeArrayRealVec::from_slice(&[0.6,0.4]),CapeArrayRealVec::from_slice(&[0.4,0.6])];
+		state
+	}
+
+	/// The data referenced by the reference inputs
+	struct Reference {
+		feed : MaterialState,
+		compound_ids : CapeArrayStringVec,
+		vapor_phase_id : CapeStringImpl,
+		light_key_compound : CapeStringImpl,
+		heavy_key_compound : CapeStringImpl,
+	}
+
+	impl Reference {
+		fn new() -> Self {
+			Self {
+				feed : feed(350.0,101325.0,&[1.0,1.0],0.5),
+				compound_ids : CapeArrayStringVec::from(&["benzene","toluene"]),
+				vapor_phase_id : CapeStringImpl::from("Vapor"),
+				light_key_compound : CapeStringImpl::from("benzene"),
+				heavy_key_compound : CapeStringImpl::from("toluene"),
+			}
+		}
+
+		fn inputs(&self) -> CalculationInputs<'_> {
+			CalculationInputs {
+				feed : &self.feed,
+				ports : [1,2,3].map(|object| PortToken{object,lists:7}),
+				compound_ids : &self.compound_ids,
+				vapor_phase_id : &self.vapor_phase_id,
+				light_key_compound : &self.light_key_compound,
+				heavy_key_compound : &self.heavy_key_compound,
+				light_key_compound_recovery : 0.99,
+				heavy_key_compound_recovery : 0.99,
+				reflux_ratio_factor : 1.3,
+				maximum_iterations : 100,
+				convergence_tolerance : 1e-8,
+			}
+		}
+	}
+
+	#[test]
+	fn every_input_changes_fingerprint() {
+		let data=Reference::new();
+		let reference=data.inputs().fingerprint();
+		assert_eq!(reference,Reference::new().inputs().fingerprint());
+		let heated=feed(351.0,101325.0,&[1.0,1.0],0.5);
+		let compressed=feed(350.0,101326.0,&[1.0,1.0],0.5);
+		let richer=feed(350.0,101325.0,&[1.0,1.1],0.5);
+		//same temperature, pressure and overall composition, different enthalpy
+		let vaporized=feed(350.0,101325.0,&[1.0,1.0],0.6);
+		let mut liquid=feed(350.0,101325.0,&[1.0,1.0],0.5);
+		liquid.phase_compositions[1]=CapeArrayRealVec::from_slice(&[0.41,0.59]);
+		let mut single_phase=feed(350.0,101325.0,&[1.0,1.0],1.0);
+		single_phase.present_phases=CapeArrayStringVec::from(&["Vapor"]);
+		single_phase.present_phase_status=CapeArrayEnumerationVec::from_slice(&[cape_open_1_2::CapePhaseStatus::CapeAtequilibrium]);
+		single_phase.phase_fractions.truncate(1);
+		single_phase.phase_compositions.truncate(1);
+		let three_compounds=CapeArrayStringVec::from(&["benzene","toluene","xylene"]);
+		let gas=CapeStringImpl::from("Gas");
+		let xylene=CapeStringImpl::from("xylene");
+		let mut changed=Vec::new();
+		for feed in [&heated,&compressed,&richer,&vaporized,&liquid,&single_phase] {
+			let mut inputs=data.inputs();
+			inputs.feed=feed;
+			changed.push(inputs.fingerprint());
+		}
+		for i in 0..3 {
+			let mut inputs=data.inputs();
+			inputs.ports[i].object=4;
+			changed.push(inputs.fingerprint());
+			//same material object, property package swapped or reconfigured
+			let mut inputs=data.inputs();
+			inputs.ports[i].lists=8;
+			changed.push(inputs.fingerprint());
+		}
+		let mut inputs=data.inputs();
+		inputs.compound_ids=&three_compounds;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.vapor_phase_id=&gas;
+		changed.push(inputs.fingerprint());
+		//parameter edits
+		let mut inputs=data.inputs();
+		inputs.light_key_compound=&xylene;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.heavy_key_compound=&xylene;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.light_key_compound_recovery=0.98;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.heavy_key_compound_recovery=0.98;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.reflux_ratio_factor=1.5;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.maximum_iterations=50;
+		changed.push(inputs.fingerprint());
+		let mut inputs=data.inputs();
+		inputs.convergence_tolerance=1e-6;
+		changed.push(inputs.fingerprint());
+		for (i,fingerprint) in changed.iter().enumerate() {
+			assert_ne!(*fingerprint,reference,"input {} does not change the fingerprint",i);
+		}
+	}
+
+	#[test]
+	fn hits_and_misses() {
+		let data=Reference::new();
+		let reference=data.inputs().fingerprint();
+		let mut cache=CalculationCache::default();
+		assert!(!cache.lookup(reference));
+		//as after store
+		cache.fingerprint=Some(reference);
+		assert!(cache.lookup(reference));
+		assert!(cache.lookup(reference));
+		assert_eq!(cache.hits,2);
+		//parameter edit
+		let mut inputs=data.inputs();
+		inputs.reflux_ratio_factor=1.5;
+		assert!(!cache.lookup(inputs.fingerprint()));
+		assert_eq!(cache.hits,2);
+		cache.invalidate();
+		assert!(!cache.lookup(reference));
+		assert_eq!(cache.hits,2);
+	}
+
+	#[test]
+	fn property_package_change_misses() {
+		let data=Reference::new();
+		let mut lists=MaterialLists::new();
+		lists.compound_ids=CapeArrayStringVec::from(&["benzene","toluene"]);
+		lists.molwts=CapeArrayRealVec::from_slice(&[78.11,92.14]);
+		lists.phase_ids=CapeArrayStringVec::from(&["Vapor","Liquid"]);
+		lists.states_of_aggregation=CapeArrayStringVec::from(&["Vapor","Liquid"]);
+		let mut inputs=data.inputs();
+		inputs.ports[0].lists=lists.hash();
+		let reference=inputs.fingerprint();
+		let mut cache=CalculationCache::default();
+		cache.fingerprint=Some(reference);
+		assert!(cache.lookup(reference));
+		//the PME swaps the property package behind the feed material object for one with other compound constants
+		lists.molwts=CapeArrayRealVec::from_slice(&[78.0,92.0]);
+		inputs.ports[0].lists=lists.hash();
+		assert!(!cache.lookup(inputs.fingerprint()));
+		assert_eq!(cache.hits,1);
+	}
+}
@@ -0,0 +1,574 @@
+use std::io::Write;
+
+/// Column data of the last rigorous calculation, needed to evaluate the
+/// shortcut method at different specifications.
+///
+/// The relative volatilities follow from the K values of the converged
+/// rigorous pass; they are kept constant over the case study, so that no
+/// further property or equilibrium calculations are needed. The Underwood
+/// root depends only on feed composition, feed quality and relative
+/// volatilities, so it is also shared by all points of the case study.
+
+#[derive(Clone)]
+pub(crate) struct ColumnData {
+	/// Feed compound flow rates, mol/s
+	pub feed_rates : Vec<f64>,
+	/// Relative volatility of each compound with respect to the heavy key compound
+	pub alpha : Vec<f64>,
+	/// Root of the Underwood equation
+	pub theta : f64,
+	/// Index of the light key compound
+	pub light_key_compound_index : usize,
+	/// Index of the heavy key compound
+	pub heavy_key_compound_index : usize,
+}
+
+/// Result of the shortcut method at a single point of the case study
+#[derive(Clone,Copy,Debug)]
+pub(crate) struct CaseStudyPoint {
+	/// Recovery of the light key compound to the distillate, mol/mol
+	pub light_key_compound_recovery : f64,
+	/// Recovery of the heavy key compound to the bottoms, mol/mol
+	pub heavy_key_compound_recovery : f64,
+	/// Factor of reflux ratio above minimum reflux ratio
+	pub reflux_ratio_factor : f64,
+	/// Minimum number of stages
+	pub min_number_of_stages : f64,
+	/// Minimum reflux ratio
+	pub min_reflux_ratio : f64,
+	/// Reflux ratio
+	pub reflux_ratio : f64,
+	/// Number of stages
+	pub number_of_stages : f64,
+	/// Feed stage location
+	pub feed_stage_location : f64,
+	/// Reason why the point could not be evaluated, None if the point was evaluated
+	pub error : Option<&'static str>,
+}
+
+impl CaseStudyPoint {
+
+	/// Creates a point that has not (yet) been evaluated
+	///
+	/// # Arguments:
+	/// * `light_key_compound_recovery` - The light key compound recovery
+	/// * `heavy_key_compound_recovery` - The heavy key compound recovery
+	/// * `reflux_ratio_factor` - The factor of reflux ratio above minimum reflux ratio
+
+	fn new(light_key_compound_recovery:f64,heavy_key_compound_recovery:f64,reflux_ratio_factor:f64) -> Self {
+		Self {
+			light_key_compound_recovery,
+			heavy_key_compound_recovery,
+			reflux_ratio_factor,
+			min_number_of_stages : f64::NAN,
+			min_reflux_ratio : f64::NAN,
+			reflux_ratio : f64::NAN,
+			number_of_stages : f64::NAN,
+			feed_stage_location : f64::NAN,
+			error : None,
+		}
+	}
+}
+
+/// Estimate the number of stages from the Gilliland correlation
+///
+/// # Arguments:
+/// * `reflux_ratio` - The reflux ratio
+/// * `min_reflux_ratio` - The minimum reflux ratio
+/// * `min_number_of_stages` - The minimum number of stages
+///
+/// # Returns:
+/// * The number of stages
+
+pub(crate) fn gilliland_number_of_stages(reflux_ratio:f64,min_reflux_ratio:f64,min_number_of_stages:f64) -> f64 {
+	let gilliland_x=(reflux_ratio-min_reflux_ratio)/(reflux_ratio+1.0);
+	let gilliland_y=1.0-f64::exp((1.0-54.4*gilliland_x)*(gilliland_x-1.0)/((11.0+117.2*gilliland_x)*f64::sqrt(gilliland_x)));
+	(gilliland_y+min_number_of_stages)/(1.0-gilliland_y)
+}
+
+/// Estimate the feed stage location from the Kirkbride correlation
+///
+/// # Arguments:
+/// * `number_of_stages` - The number of stages
+/// * `feed_rates` - The feed compound flow rates
+/// * `distillate_rates` - The distillate compound flow rates
+/// * `bottoms_rates` - The bottoms compound flow rates
+/// * `light_key_compound_index` - The index of the light key compound
+/// * `heavy_key_compound_index` - The index of the heavy key compound
+///
+/// # Returns:
+/// * The feed stage location, counted from the top
+
+pub(crate) fn kirkbride_feed_stage(number_of_stages:f64,feed_rates:&[f64],distillate_rates:&[f64],bottoms_rates:&[f64],light_key_compound_index:usize,heavy_key_compound_index:usize) -> f64 {
+	let total_distillate_rate=distillate_rates.iter().sum::<f64>();
+	let total_bottoms_rate=bottoms_rates.iter().sum::<f64>();
+	let ratio=(total_distillate_rate*feed_rates[heavy_key_compound_index]*bottoms_rates[light_key_compound_index]*bottoms_rates[light_key_compound_index])/
+			  (total_bottoms_rate*feed_rates[light_key_compound_index]*distillate_rates[heavy_key_compound_index]*distillate_rates[heavy_key_compound_index]);
+	let ratio=f64::powf(ratio,0.206);
+	number_of_stages/(ratio+1.0)
+}
+
+/// Calculate the minimum reflux ratio from the Underwood root
+///
+/// # Arguments:
+/// * `theta` - The root of the Underwood equation
+/// * `alpha` - The relative volatilities
+/// * `distillate_rates` - The distillate compound flow rates
+///
+/// # Returns:
+/// * The minimum reflux ratio
+
+pub(crate) fn underwood_min_reflux_ratio(theta:f64,alpha:&[f64],distillate_rates:&[f64]) -> f64 {
+	let total_distillate_rate=distillate_rates.iter().sum::<f64>();
+	let mut r_min=-1.0;
+	for (alpha,distillate_rate) in alpha.iter().zip(distillate_rates.iter()) {
+		r_min+=(alpha*distillate_rate)/(total_distillate_rate*(alpha-theta));
+	}
+	r_min
+}
+
+impl ColumnData {
+
+	/// Evaluate the shortcut method at a single point.
+	///
+	/// At constant relative volatility the Fenske distribution is explicit, so
+	/// no iteration is required.
+	///
+	/// # Arguments:
+	/// * `point` - The point to evaluate; the specifications are read and the results are set
+	/// * `distillate_rates` - Scratch space for the distillate compound flow rates
+	/// * `bottoms_rates` - Scratch space for the bottoms compound flow rates
+
+	fn evaluate(&self,point:&mut CaseStudyPoint,distillate_rates:&mut Vec<f64>,bottoms_rates:&mut Vec<f64>) {
+		if !(point.light_key_compound_recovery>0.0 && point.light_key_compound_recovery<1.0) {
+			point.error=Some("light key compound recovery must be between 0 and 1");
+			return;
+		}
+		if !(point.heavy_key_compound_recovery>0.0 && point.heavy_key_compound_recovery<1.0) {
+			point.error=Some("heavy key compound recovery must be between 0 and 1");
+			return;
+		}
+		if !(point.reflux_ratio_factor>1.0) {
+			point.error=Some("reflux ratio factor must exceed 1");
+			return;
+		}
+		//Part 1: Fenske
+		let feed_light_key=self.feed_rates[self.light_key_compound_index];
+		let feed_heavy_key=self.feed_rates[self.heavy_key_compound_index];
+		let rate_light_key_compound_distillate=point.light_key_compound_recovery*feed_light_key;
+		let rate_light_key_compound_bottoms=(1.0-point.light_key_compound_recovery)*feed_light_key;
+		let rate_heavy_key_compound_bottoms=point.heavy_key_compound_recovery*feed_heavy_key;
+		let rate_heavy_key_compound_distillate=(1.0-point.heavy_key_compound_recovery)*feed_heavy_key;
+		let min_number_of_stages=f64::ln((rate_light_key_compound_distillate*rate_heavy_key_compound_bottoms)/(rate_light_key_compound_bottoms*rate_heavy_key_compound_distillate))/
+			f64::ln(self.alpha[self.light_key_compound_index]);
+		let heavy_key_split=rate_heavy_key_compound_distillate/rate_heavy_key_compound_bottoms;
+		distillate_rates.clear();
+		bottoms_rates.clear();
+		for (feed_rate,alpha) in self.feed_rates.iter().zip(self.alpha.iter()) {
+			let bottoms_rate=feed_rate/(1.0+heavy_key_split*f64::powf(*alpha,min_number_of_stages));
+			bottoms_rates.push(bottoms_rate);
+			distillate_rates.push(f64::max(feed_rate-bottoms_rate,0.0));
+		}
+		//Part 2: Underwood
+		let min_reflux_ratio=underwood_min_reflux_ratio(self.theta,&self.alpha,distillate_rates);
+		let reflux_ratio=point.reflux_ratio_factor*min_reflux_ratio;
+		//Part 3: Gilliland
+		let number_of_stages=gilliland_number_of_stages(reflux_ratio,min_reflux_ratio,min_number_of_stages);
+		//Part 4: Kirkbride
+		let feed_stage_location=kirkbride_feed_stage(number_of_stages,&self.feed_rates,distillate_rates,bottoms_rates,self.light_key_compound_index,self.heavy_key_compound_index);
+		point.min_number_of_stages=min_number_of_stages;
+		point.min_reflux_ratio=min_reflux_ratio;
+		point.reflux_ratio=reflux_ratio;
+		point.number_of_stages=number_of_stages;
+		point.feed_stage_location=feed_stage_location;
+	}
+
+	/// Evaluate the shortcut method at a number of points, distributed over the available cores.
+	///
+	/// # Arguments:
+	/// * `points` - The points to evaluate
+
+	pub fn evaluate_points(&self,points:&mut [CaseStudyPoint]) {
+		//each thread has its own scratch space
+		let thread_count=std::thread::available_parallelism().map_or(1,|n| n.get());
+		let chunk_size=usize::max(1,points.len().div_ceil(thread_count));
+		std::thread::scope(|scope| {
+			for chunk in points.chunks_mut(chunk_size) {
+				scope.spawn(move || {
+					let mut distillate_rates=Vec::with_capacity(self.feed_rates.len());
+					let mut bottoms_rates=Vec::with_capacity(self.feed_rates.len());
+					for point in chunk.iter_mut() {
+						self.evaluate(point,&mut distillate_rates,&mut bottoms_rates);
+					}
+				});
+			}
+		});
+	}
+}
+
+/// The specification grid of a case study.
+///
+/// The case study is evaluated at all combinations of the values.
+
+#[derive(Clone,Debug,PartialEq)]
+pub struct CaseStudyGrid {
+	/// Values for the light key compound recovery, mol/mol
+	pub light_key_compound_recoveries : Vec<f64>,
+	/// Values for the heavy key compound recovery, mol/mol
+	pub heavy_key_compound_recoveries : Vec<f64>,
+	/// Values for the factor of reflux ratio above minimum reflux ratio
+	pub reflux_ratio_factors : Vec<f64>,
+}
+
+impl CaseStudyGrid {
+
+	/// Creates the default grid around the current specifications.
+	///
+	/// The recoveries range from the current specification to 0.999 in 5 steps,
+	/// and the reflux ratio factor ranges from 1.05 to twice the current specification
+	/// in 10 steps.
+	///
+	/// # Arguments:
+	/// * `light_key_compound_recovery` - The current light key compound recovery
+	/// * `heavy_key_compound_recovery` - The current heavy key compound recovery
+	/// * `reflux_ratio_factor` - The current reflux ratio factor
+
+	pub fn around(light_key_compound_recovery:f64,heavy_key_compound_recovery:f64,reflux_ratio_factor:f64) -> Self {
+		fn range(from:f64,to:f64,count:usize) -> Vec<f64> {
+			let to=f64::max(from,to);
+			(0..count).map(|i| from+(to-from)*(i as f64)/((count-1) as f64)).collect()
+		}
+		Self {
+			light_key_compound_recoveries : range(light_key_compound_recovery,0.999,5),
+			heavy_key_compound_recoveries : range(heavy_key_compound_recovery,0.999,5),
+			reflux_ratio_factors : range(1.05,2.0*reflux_ratio_factor,10),
+		}
+	}
+
+	/// The number of points in the grid
+	pub fn len(&self) -> usize {
+		self.light_key_compound_recoveries.len()*self.heavy_key_compound_recoveries.len()*self.reflux_ratio_factors.len()
+	}
+
+	/// The points of the grid, not yet evaluated
+	pub(crate) fn points(&self) -> Vec<CaseStudyPoint> {
+		let mut points=Vec::with_capacity(self.len());
+		for light_key_compound_recovery in self.light_key_compound_recoveries.iter() {
+			for heavy_key_compound_recovery in self.heavy_key_compound_recoveries.iter() {
+				for reflux_ratio_factor in self.reflux_ratio_factors.iter() {
+					points.push(CaseStudyPoint::new(*light_key_compound_recovery,*heavy_key_compound_recovery,*reflux_ratio_factor));
+				}
+			}
+		}
+		points
+	}
+}
+
+/// Parametric case study of the shortcut column.
+///
+/// The case study evaluates the Fenske-Underwood-Gilliland-Kirkbride method
+/// over a grid of specifications, using the column data of the last successful
+/// calculation. Points are distributed over all available cores.
+///
+/// The results are kept together with the grid for which they were evaluated. The
+/// default grid follows the current specifications, so that changing a specification
+/// invalidates the results of the default grid.
+
+pub(crate) struct CaseStudy {
+	/// Column data of the last successful calculation
+	data : Option<ColumnData>,
+	/// Incremented whenever the column data changes
+	generation : u64,
+	/// The specification grid; None to use the default grid around the current specifications
+	grid : Option<CaseStudyGrid>,
+	/// The results and the grid for which they were evaluated; None if the case study needs to be evaluated
+	results : Option<(CaseStudyGrid,Vec<CaseStudyPoint>)>,
+}
+
+/// A copy of the column data and the grid of a case study, to evaluate it elsewhere,
+/// such as on another thread.
+
+pub(crate) struct CaseStudySnapshot {
+	/// Column data of the last successful calculation
+	pub data : ColumnData,
+	/// The specification grid
+	pub grid : CaseStudyGrid,
+	/// The generation of the column data
+	generation : u64,
+}
+
+impl std::default::Default for CaseStudy {
+	/// Creates a case study without column data
+	fn default() -> Self {
+		Self {
+			data: None,
+			generation: 0,
+			grid: None,
+			results: None,
+		}
+	}
+}
+
+impl CaseStudy {
+
+	/// Set the column data after a successful calculation, or clear it
+	///
+	/// # Arguments:
+	/// * `data` - The column data, or None if no valid calculation results exist
+
+	pub fn set_data(&mut self,data:Option<ColumnData>) {
+		self.data=data;
+		self.generation+=1;
+		self.results=None;
+	}
+
+	/// Set the specification grid
+	///
+	/// # Arguments:
+	/// * `grid` - The grid, or None to use the default grid
+
+	pub fn set_grid(&mut self,grid:Option<CaseStudyGrid>) {
+		self.grid=grid;
+	}
+
+	/// Evaluate the case study, unless results are available for the grid
+	///
+	/// # Arguments:
+	/// * `default_grid` - The grid that is used if no grid is set
+	///
+	/// # Returns:
+	/// * The results, or an error if no column data is available
+
+	pub fn evaluate(&mut self,default_grid:CaseStudyGrid) -> Result<&[CaseStudyPoint],String> {
+		let grid=self.grid.clone().unwrap_or(default_grid);
+		if !matches!(&self.results,Some((evaluated_grid,_)) if *evaluated_grid==grid) {
+			let data=self.data.as_ref().ok_or_else(|| Self::no_data_error())?;
+			let mut points=grid.points();
+			data.evaluate_points(&mut points);
+			self.results=Some((grid,points));
+		}
+		Ok(&self.results.as_ref().unwrap().1)
+	}
+
+	/// Copy the column data and the grid, to evaluate the case study elsewhere, such as on another thread
+	///
+	/// # Arguments:
+	/// * `default_grid` - The grid that is used if no grid is set
+	///
+	/// # Returns:
+	/// * The column data and the grid, or an error if no column data is available
+
+	pub fn snapshot(&self,default_grid:CaseStudyGrid) -> Result<CaseStudySnapshot,String> {
+		let data=self.data.as_ref().ok_or_else(|| Self::no_data_error())?;
+		Ok(CaseStudySnapshot {
+			data : data.clone(),
+			grid : self.grid.clone().unwrap_or(default_grid),
+			generation : self.generation,
+		})
+	}
+
+	/// Keep the results of a case study that was evaluated elsewhere
+	///
+	/// The results are ignored if the column data has changed since the snapshot was taken.
+	///
+	/// # Arguments:
+	/// * `snapshot` - The snapshot from which the results were evaluated
+	/// * `points` - The results, for all points of the grid of the snapshot
+
+	pub fn store(&mut self,snapshot:CaseStudySnapshot,points:Vec<CaseStudyPoint>) {
+		if snapshot.generation==self.generation && self.data.is_some() {
+			self.results=Some((snapshot.grid,points));
+		}
+	}
+
+	/// The error if no column data is available
+	fn no_data_error() -> String {
+		"Case study requires a successful calculation of the unit operation".to_string()
+	}
+
+	/// Write the results as comma separated values
+	///
+	/// # Arguments:
+	/// * `results` - The case study results
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_csv<W:Write>(results:&[CaseStudyPoint],writer:&mut W) -> std::io::Result<()> {
+		writeln!(writer,"Light key recovery,Heavy key recovery,Reflux ratio factor,Minimum number of stages,Minimum reflux ratio,Reflux ratio,Number of stages,Feed stage location,Error")?;
+		for point in results {
+			writeln!(writer,"{},{},{},{},{},{},{},{},{}",
+				point.light_key_compound_recovery,
+				point.heavy_key_compound_recovery,
+				point.reflux_ratio_factor,
+				point.min_number_of_stages,
+				point.min_reflux_ratio,
+				point.reflux_ratio,
+				point.number_of_stages,
+				point.feed_stage_location,
+				point.error.unwrap_or(""))?;
+		}
+		Ok(())
+	}
+
+	/// Write the results as JSON
+	///
+	/// The results are written as an array of objects, one per point; values that
+	/// could not be evaluated are written as null.
+	///
+	/// # Arguments:
+	/// * `results` - The case study results
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_json<W:Write>(results:&[CaseStudyPoint],writer:&mut W) -> std::io::Result<()> {
+		//JSON has no representation for NaN or infinity
+		struct Number(f64);
+		impl std::fmt::Display for Number {
+			fn fmt(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
+				if self.0.is_finite() {
+					write!(f,"{}",self.0)
+				} else {
+					write!(f,"null")
+				}
+			}
+		}
+		writeln!(writer,"[")?;
+		for (i,point) in results.iter().enumerate() {
+			write!(writer,"{{\"lightKeyRecovery\":{},\"heavyKeyRecovery\":{},\"refluxRatioFactor\":{},\"minNumberOfStages\":{},\"minRefluxRatio\":{},\"refluxRatio\":{},\"numberOfStages\":{},\"feedStageLocation\":{}",
+				Number(point.light_key_compound_recovery),
+				Number(point.heavy_key_compound_recovery),
+				Number(point.reflux_ratio_factor),
+				Number(point.min_number_of_stages),
+				Number(point.min_reflux_ratio),
+				Number(point.reflux_ratio),
+				Number(point.number_of_stages),
+				Number(point.feed_stage_location))?;
+			if let Some(error)=point.error {
+				//error messages are static and contain no characters that need escaping
+				write!(writer,",\"error\":\"{}\"",error)?;
+			}
+			writeln!(writer,"}}{}",if i+1<results.len() {","} else {""})?;
+		}
+		writeln!(writer,"]")
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	/// Three compounds, with the middle one the heavy key compound, in a saturated liquid feed
+	fn column_data() -> ColumnData {
+		ColumnData {
+			feed_rates : vec![1.0,2.0,1.0],
+			alpha : vec![2.5,1.0,0.4],
+			theta : 1.7048464610561465,
+			light_key_compound_index : 0,
+			heavy_key_compound_index : 1,
+		}
+	}
+
+	fn grid() -> CaseStudyGrid {
+		CaseStudyGrid {
+			light_key_compound_recoveries : vec![0.9,0.95],
+			heavy_key_compound_recoveries : vec![0.9,0.95,0.99],
+			reflux_ratio_factors : vec![1.2,1.5],
+		}
+	}
+
+	#[test]
+	fn evaluate_grid() {
+		let mut case_study=CaseStudy::default();
+		assert!(case_study.evaluate(grid()).is_err());
+		case_study.set_data(Some(column_data()));
+		let points=case_study.evaluate(grid()).unwrap();
+		assert_eq!(points.len(),12);
+		for point in points {
+			assert!(point.error.is_none());
+			//Fenske at constant relative volatility
+			let split=(point.light_key_compound_recovery*point.heavy_key_compound_recovery)/((1.0-point.light_key_compound_recovery)*(1.0-point.heavy_key_compound_recovery));
+			assert!((point.min_number_of_stages-split.ln()/2.5f64.ln()).abs()<1e-12);
+			assert!(point.min_reflux_ratio>0.0);
+			assert!((point.reflux_ratio-point.reflux_ratio_factor*point.min_reflux_ratio).abs()<1e-12);
+			assert_eq!(point.number_of_stages,gilliland_number_of_stages(point.reflux_ratio,point.min_reflux_ratio,point.min_number_of_stages));
+			assert!(point.feed_stage_location>0.0 && point.feed_stage_location<point.number_of_stages);
+		}
+		//more stages at higher recovery
+		assert!(points[2].min_number_of_stages>points[0].min_number_of_stages);
+		assert!(points[6].min_number_of_stages>points[0].min_number_of_stages);
+		//the same as a single evaluation
+		let mut point=CaseStudyPoint::new(0.95,0.99,1.5);
+		column_data().evaluate(&mut point,&mut Vec::new(),&mut Vec::new());
+		assert_eq!(point.number_of_stages,points[11].number_of_stages);
+		assert_eq!(point.feed_stage_location,points[11].feed_stage_location);
+	}
+
+	#[test]
+	fn invalid_specifications() {
+		let mut case_study=CaseStudy::default();
+		case_study.set_data(Some(column_data()));
+		let points=case_study.evaluate(CaseStudyGrid {
+			light_key_compound_recoveries : vec![1.0],
+			heavy_key_compound_recoveries : vec![0.0,0.9],
+			reflux_ratio_factors : vec![0.5,1.5],
+		}).unwrap();
+		assert_eq!(points.len(),4);
+		for point in points {
+			assert!(point.error.is_some());
+			assert!(point.number_of_stages.is_nan());
+		}
+		let mut json=Vec::new();
+		CaseStudy::write_json(points,&mut json).unwrap();
+		let json=String::from_utf8(json).unwrap();
+		assert!(json.contains("\"numberOfStages\":null"));
+		assert!(!json.contains("NaN"));
+	}
+
+	#[test]
+	fn results_follow_grid_and_data() {
+		let mut case_study=CaseStudy::default();
+		case_study.set_data(Some(column_data()));
+		let first=case_study.evaluate(grid()).unwrap().as_ptr();
+		//same grid: no evaluation
+		assert_eq!(case_study.evaluate(grid()).unwrap().as_ptr(),first);
+		//a changed specification changes the default grid
+		let around=CaseStudyGrid::around(0.9,0.95,1.3);
+		let points=case_study.evaluate(around.clone()).unwrap();
+		assert_eq!(points.len(),around.len());
+		assert_eq!(points[0].light_key_compound_recovery,0.9);
+		let points=case_study.evaluate(CaseStudyGrid::around(0.95,0.95,1.3)).unwrap();
+		assert_eq!(points[0].light_key_compound_recovery,0.95);
+		//a grid that is set overrides the default grid
+		case_study.set_grid(Some(grid()));
+		assert_eq!(case_study.evaluate(around.clone()).unwrap().len(),12);
+		case_study.set_grid(None);
+		assert_eq!(case_study.evaluate(around.clone()).unwrap().len(),around.len());
+		//new column data
+		case_study.set_data(None);
+		assert!(case_study.evaluate(around).is_err());
+	}
+
+	#[test]
+	fn store_snapshot_results() {
+		let mut case_study=CaseStudy::default();
+		assert!(case_study.snapshot(grid()).is_err());
+		case_study.set_data(Some(column_data()));
+		//points are marked, to tell them from evaluated points
+		let snapshot=case_study.snapshot(grid()).unwrap();
+		let mut points=snapshot.grid.points();
+		points[0].error=Some("stored");
+		case_study.store(snapshot,points);
+		assert_eq!(case_study.evaluate(grid()).unwrap()[0].error,Some("stored"));
+		//results of a snapshot of previous column data are ignored
+		let snapshot=case_study.snapshot(grid()).unwrap();
+		let mut points=snapshot.grid.points();
+		points[0].error=Some("stale");
+		case_study.set_data(Some(column_data()));
+		case_study.store(snapshot,points);
+		assert_eq!(case_study.evaluate(grid()).unwrap()[0].error,None);
+	}
+}
@@ -3,8 +3,8 @@ use cobia::*;
 use std::collections::HashSet;
 use std::io::Write;
 use std::cell::RefCell;
+use std::rc::Rc;
 use std::default::Default;
-use chrono;
 use crate::shared_unit_data::*;
 use crate::port_collection::PortCollection;
 use crate::material_port::MaterialPort;
@@ -12,6 +12,15 @@ use crate::parameter_collection::ParameterCollection;
 use crate::real_parameter::RealParameter;
 use crate::integer_parameter::IntegerParameter;
 use crate::string_parameter::StringParameter;
+use crate::solver_telemetry::SolverTelemetry;
+use crate::calculation_cache::{CalculationCache,CalculationInputs,MaterialState,MaterialStateLiterals};
+use crate::validation_cache::{ValidationCache,PortToken};
+use crate::case_study::*;
+use crate::persisted_state::{StateEncoder,StateDecoder};
+use crate::run_log::{RunLog,RunEvent};
+use crate::report_format::{UnitReport,ReportFormat,ReportLiterals};
+use crate::saturation_flash::{self,FlashSettings,FlashMaterial,FreeThreadedMaterial,SaturationFlash};
+use crate::performance::{Performance,Phase,ExternalCall,PerformanceSnapshot};
 
 #[cfg(target_os = "windows")]
 use crate::gui;
@@ -52,8 +61,22 @@ pub struct DistillationShortcutUnit {
 	description: CapeStringImpl,
 	/// The name of the last run report
 	last_run_report_name: CapeStringImpl,
-	/// The content of the last run report
-	last_run_report : String,
+	/// The events of the last calculation
+	run_log : RunLog,
+	/// String constants for matching report specifications
+	report_literals : ReportLiterals,
+	/// The name of the solver statistics report
+	solver_report_name: CapeStringImpl,
+	/// Convergence statistics of the iterative solves
+	solver_telemetry : SolverTelemetry,
+	/// The name of the case study report
+	case_study_report_name: CapeStringImpl,
+	/// Parametric case study over the column specifications
+	case_study : CaseStudy,
+	/// The name of the performance report
+	performance_report_name: CapeStringImpl,
+	/// Time spent per calculation phase and per CAPE-OPEN method
+	performance : Rc<Performance>,
 	/// The collection of ports for this unit operation
 	port_collection: cape_open_1_2::CapeCollection<cape_open_1_2::CapeUnitPort>,
 	/// The feed port of the unit operation
@@ -82,6 +105,12 @@ pub struct DistillationShortcutUnit {
 	maximum_iterations : cape_open_1_2::CapeIntegerParameter,
 	/// Parameter to specify the convergence tolerance
 	convergence_tolerance : cape_open_1_2::CapeRealParameter,
+	/// Parameter to specify whether the calculation is skipped if the inputs are unchanged
+	incremental_calculation : cape_open_1_2::CapeIntegerParameter,
+	/// Parameter to specify whether the events of a calculation are recorded for the last run report
+	calculation_report : cape_open_1_2::CapeIntegerParameter,
+	/// Parameter to specify whether the product flashes may run concurrently
+	concurrent_flashes : cape_open_1_2::CapeIntegerParameter,
 	/// Number of stages result
 	number_of_stages : cape_open_1_2::CapeRealParameter,
 	/// Reflux ratio result
@@ -100,6 +129,10 @@ pub struct DistillationShortcutUnit {
 	phase_ids : CapeArrayStringVec,
 	//diagnostics interface of the simulation context
 	diagnostics : Option<cape_open_1_2::CapeDiagnostic>,
+	//results of the last successful calculation, keyed on the calculation inputs
+	calculation_cache : CalculationCache,
+	//outcome of the last successful port validation, keyed on the identity of the connected material objects
+	validation_cache : ValidationCache,
 }
 
 impl DistillationShortcutUnit {
@@ -109,6 +142,10 @@ impl DistillationShortcutUnit {
 	const DESCRIPTION: &'static str = "Distillation ShortCut unit operation based on Fenske-Underwood-Gilliland-Kirkbride method";
 	/// The ProgID of the unit operation, used for registration in the COBIA registry
 	const PROGID: &'static str = "DistillationShortcut.DistillationShortcutUnit";
+	/// The name of the binary state record in the persisted data
+	const STATE_RECORD_NAME: &'static str = "State";
+	/// The version of the layout of the binary state record
+	const STATE_RECORD_VERSION: u16 = 3;
 
 	/// Creates a new instance of the DistillationShortcutUnit.
 	///
@@ -123,7 +160,14 @@ impl DistillationShortcutUnit {
 			cobia_object_data: Default::default(), //this member is generated by cape_object_implementation and can be set to default()
 			description: CapeStringImpl::from_string(Self::DESCRIPTION),
 			last_run_report_name: CapeStringImpl::from_string("Calculation Report"),
-			last_run_report : "Report not available".to_string(),
+			run_log : RunLog::new(),
+			report_literals : ReportLiterals::new(),
+			solver_report_name: CapeStringImpl::from_string("Solver Statistics"),
+			solver_telemetry : SolverTelemetry::default(),
+			case_study_report_name: CapeStringImpl::from_string("Case Study"),
+			case_study : CaseStudy::default(),
+			performance_report_name: CapeStringImpl::from_string("Performance"),
+			performance : Rc::new(Performance::new()),
 			port_collection : PortCollection::create(shared_unit_data.clone()),
 			feed : MaterialPort::create(
 					CapeStringImpl::from(format!("Feed")),
@@ -211,6 +255,33 @@ impl DistillationShortcutUnit {
                 1e-12,
                 dimensionless.clone()
             ),
+			incremental_calculation : IntegerParameter::create(
+				CapeStringImpl::from(format!("Incremental calculation")),
+				CapeStringImpl::from(format!("Skip calculation if inputs are unchanged since the last successful calculation (1) or always calculate (0)")),
+				true,
+				shared_unit_data.clone(),
+				1,
+				0,
+				1,
+			),
+			calculation_report : IntegerParameter::create(
+				CapeStringImpl::from(format!("Calculation report")),
+				CapeStringImpl::from(format!("Record the calculation for the last run report and pass warnings to the simulation context (1), or skip all calculation reporting (0)")),
+				true,
+				shared_unit_data.clone(),
+				1,
+				0,
+				1,
+			),
+			concurrent_flashes : IntegerParameter::create(
+				CapeStringImpl::from(format!("Concurrent flashes")),
+				CapeStringImpl::from(format!("Flash distillate and bottoms products at the same time on different threads (1) or one after the other (0). Only enable if the material objects of the simulation environment may be used from any thread")),
+				true,
+				shared_unit_data.clone(),
+				0,
+				0,
+				1,
+			),
 			number_of_stages : RealParameter::create(
 				CapeStringImpl::from(format!("Number of stages")),
 				CapeStringImpl::from(format!("Estimated number of stages in the column")),
@@ -247,6 +318,8 @@ impl DistillationShortcutUnit {
             liquid_phase_ids : CapeArrayStringVec::new(),
 			phase_ids : CapeArrayStringVec::new(),
             diagnostics : None,
+			calculation_cache : CalculationCache::default(),
+			validation_cache : ValidationCache::default(),
 		};
 		//add ports to collection
 		let port_collection=unsafe {PortCollection::borrow_mut(&mut unit_operation.port_collection)};
@@ -262,6 +335,9 @@ impl DistillationShortcutUnit {
 		parameter_collection.add_parameter(unit_operation.reflux_ratio_factor.clone());
 		parameter_collection.add_parameter(unit_operation.maximum_iterations.clone());
 		parameter_collection.add_parameter(unit_operation.convergence_tolerance.clone());
+		parameter_collection.add_parameter(unit_operation.incremental_calculation.clone());
+		parameter_collection.add_parameter(unit_operation.calculation_report.clone());
+		parameter_collection.add_parameter(unit_operation.concurrent_flashes.clone());
 		parameter_collection.add_parameter(unit_operation.number_of_stages.clone());
 		parameter_collection.add_parameter(unit_operation.reflux_ratio.clone());
 		parameter_collection.add_parameter(unit_operation.feed_stage_location.clone());
@@ -354,6 +430,170 @@ impl DistillationShortcutUnit {
 		self.convergence_tolerance.set_value(tolerance)
 	}
 
+	pub fn get_incremental_calculation(&self) -> bool {
+		self.incremental_calculation.get_value().unwrap()!=0
+	}
+
+	pub fn set_incremental_calculation(&mut self, incremental: bool) -> Result<(),COBIAError> {
+		self.incremental_calculation.set_value(incremental as i32)
+	}
+
+	pub fn get_calculation_report(&self) -> bool {
+		self.calculation_report.get_value().unwrap()!=0
+	}
+
+	pub fn set_calculation_report(&mut self, enabled: bool) -> Result<(),COBIAError> {
+		self.calculation_report.set_value(enabled as i32)
+	}
+
+	/// Set the grid of the case study.
+	///
+	/// The grid is set from the case study page of the dialog, and applies to the
+	/// case study report until it is reset.
+	///
+	/// # Arguments:
+	/// * `grid` - The specification grid, or None to use the default grid around the current specifications
+
+	pub fn set_case_study_grid(&mut self, grid: Option<CaseStudyGrid>) {
+		self.case_study.set_grid(grid);
+	}
+
+	/// Evaluate the case study, if not already evaluated.
+	///
+	/// The case study uses the relative volatilities of the last successful calculation.
+	///
+	/// # Returns:
+	/// * The results for each point in the grid
+
+	fn evaluate_case_study(&mut self) -> Result<&[CaseStudyPoint],COBIAError> {
+		let default_grid=self.default_case_study_grid();
+		self.case_study.evaluate(default_grid).or_else(|e| Err(COBIAError::Message(e)))
+	}
+
+	/// Copy what is needed to evaluate the case study on another thread.
+	///
+	/// # Returns:
+	/// * The column data of the last successful calculation and the specification grid
+
+	pub(crate) fn case_study_snapshot(&self) -> Result<CaseStudySnapshot,COBIAError> {
+		self.case_study.snapshot(self.default_case_study_grid()).or_else(|e| Err(COBIAError::Message(e)))
+	}
+
+	/// Keep the results of a case study that was evaluated on another thread.
+	///
+	/// # Arguments:
+	/// * `snapshot` - The snapshot from which the case study was evaluated
+	/// * `points` - The results for each point in the grid of the snapshot
+
+	pub(crate) fn store_case_study_results(&mut self,snapshot:CaseStudySnapshot,points:Vec<CaseStudyPoint>) {
+		self.case_study.store(snapshot,points);
+	}
+
+	/// The case study grid around the current specifications
+	pub(crate) fn default_case_study_grid(&self) -> CaseStudyGrid {
+		CaseStudyGrid::around(
+			unsafe{RealParameter::borrow(&self.light_key_compound_recovery).value},
+			unsafe{RealParameter::borrow(&self.heavy_key_compound_recovery).value},
+			unsafe{RealParameter::borrow(&self.reflux_ratio_factor).value})
+	}
+
+	/// The report with the given name, and the formats available for it.
+	///
+	/// The first format is the default format.
+	///
+	/// # Arguments:
+	/// * `name` - The name of the report
+	///
+	/// # Returns:
+	/// * The report and its formats, or None if there is no report with the given name
+
+	fn report_formats(&self, name:&CapeStringIn) -> Option<(UnitReport,&'static [ReportFormat])> {
+		if name.eq_ignore_case(&self.last_run_report_name) {
+			Some((UnitReport::LastRun,&[ReportFormat::Text,ReportFormat::Json,ReportFormat::Csv]))
+		} else if name.eq_ignore_case(&self.solver_report_name) {
+			Some((UnitReport::SolverStatistics,&[ReportFormat::Text]))
+		} else if name.eq_ignore_case(&self.case_study_report_name) {
+			Some((UnitReport::CaseStudy,&[ReportFormat::Csv,ReportFormat::Json]))
+		} else if name.eq_ignore_case(&self.performance_report_name) {
+			Some((UnitReport::Performance,&[ReportFormat::Text,ReportFormat::Json]))
+		} else {
+			None
+		}
+	}
+
+	/// Resolve a report specification.
+	///
+	/// # Arguments:
+	/// * `name` - The name of the report
+	/// * `_type` - The MIME type of the report; if empty, the default format of the report is used
+	/// * `locale` - The locale of the report
+	///
+	/// # Returns:
+	/// * The report and its format, or an error if the specification is not valid
+
+	fn report_spec(&self, name:&CapeStringIn, _type:&CapeStringIn, locale:&CapeStringIn) -> Result<(UnitReport,ReportFormat),COBIAError> {
+		let (report,formats)=self.report_formats(name).ok_or_else(|| COBIAError::Message("Invalid report name".into()))?;
+		let format=self.report_literals.format(_type,formats).ok_or_else(|| COBIAError::Message("Invalid/unsupported report mime type".into()))?;
+		if !self.report_literals.is_supported_locale(locale) {
+			return Err(COBIAError::Message("Invalid/unsupported report locale".into()));
+		}
+		Ok((report,format))
+	}
+
+	/// Write a report.
+	///
+	/// The report is rendered directly to the destination.
+	///
+	/// # Arguments:
+	/// * `report` - The report to write
+	/// * `format` - The format of the report, must be available for the report
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	fn write_report<W:Write>(&mut self, report:UnitReport, format:ReportFormat, writer: &mut W) -> Result<(),COBIAError> {
+		let res=match (report,format) {
+			(UnitReport::LastRun,ReportFormat::Text) => self.run_log.write_text(&self.compound_names,writer),
+			(UnitReport::LastRun,ReportFormat::Csv) => self.run_log.write_csv(&self.compound_names,writer),
+			(UnitReport::LastRun,ReportFormat::Json) => self.run_log.write_json(&self.compound_names,writer),
+			(UnitReport::SolverStatistics,_) => writer.write_all(self.solver_telemetry.report().as_bytes()),
+			(UnitReport::CaseStudy,ReportFormat::Json) => CaseStudy::write_json(self.evaluate_case_study()?,writer),
+			(UnitReport::CaseStudy,_) => CaseStudy::write_csv(self.evaluate_case_study()?,writer),
+			(UnitReport::Performance,ReportFormat::Json) => self.performance_snapshot().write_json(writer),
+			(UnitReport::Performance,_) => self.performance_snapshot().write_text(writer),
+		};
+		res.or_else(|e| Err(COBIAError::Message(format!("Error writing report: {}",e))))
+	}
+
+	/// Snapshot of the time spent per calculation phase and per CAPE-OPEN method,
+	/// accumulated since creation of the unit operation or since the last reset.
+
+	pub fn performance_snapshot(&self) -> PerformanceSnapshot {
+		self.performance.snapshot()
+	}
+
+	pub fn get_concurrent_flashes(&self) -> bool {
+		self.concurrent_flashes.get_value().unwrap()!=0
+	}
+
+	/// Allow the distillate and bottoms flashes to run concurrently.
+	///
+	/// CAPE-OPEN does not provide a means to detect whether a property package is thread-safe;
+	/// this must only be enabled if the material objects connected to the product ports may be
+	/// used from any thread, for example when they are provided by an in-process free-threaded
+	/// property package.
+	///
+	/// # Arguments:
+	/// * `concurrent` - Whether the product flashes may run concurrently
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn set_concurrent_flashes(&mut self, concurrent: bool) -> Result<(),COBIAError> {
+		self.concurrent_flashes.set_value(concurrent as i32)
+	}
+
 	pub fn get_number_of_stages(&self) -> f64 {
 		self.number_of_stages.get_value().unwrap()
 	}
@@ -593,7 +833,10 @@ impl cape_open_1_2::ICapeUtilities for DistillationShortcutUnit {
 		#[cfg(target_os = "windows")]
 		{
 			let mut unit_dlg=gui::UnitDialogHandler::new(parent,self);
-			match unit_dlg.show() {
+			let shown=unit_dlg.show();
+			//keep the case study results that arrived after the last request
+			unit_dlg.get_handler().store_case_study_results();
+			match shown {
 				Ok(_) => {
 					Ok(
 						if unit_dlg.get_handler().is_modified() {
@@ -619,6 +862,62 @@ impl cape_open_1_2::ICapeUtilities for DistillationShortcutUnit {
 
 impl DistillationShortcutUnit {
 
+	/// Check the compound and phase lists of the material objects connected to the ports.
+	///
+	/// The lists must have been obtained in the validation cache. The compound and phase lists
+	/// of the feed are taken over, and the vapor and liquid phase IDs are determined.
+	///
+	/// # Returns:
+	/// * A `Result` indicating whether the ports are consistent.
+
+	fn validate_ports(&mut self) -> Result<(),COBIAError> {
+		let vapor = CapeStringImpl::from_string("vapor");
+		let liquid = CapeStringImpl::from_string("liquid");
+		let [feed,distillate,bottoms]=&self.validation_cache.ports;
+		//check feed
+		self.compound_ids.set(&feed.compound_ids)?;
+		self.compound_names.set(&feed.compound_names)?;
+		self.phase_ids.set(&feed.phase_ids)?;
+		if self.compound_ids.size()==0 {
+			return Err(COBIAError::Message("Material Object connected to feed does not contain any compounds".into()));
+		}
+		if feed.phase_ids.size()!=feed.states_of_aggregation.size() {
+			return Err(COBIAError::Message("Material Object connected to feed returns inconsistent number of phases and states of aggregation".into()));
+		}
+		//determine which is the vapor phase ID
+		// we assume that the vapor phase ID is the same for the feed, distillate product, and bottom product material objects
+		self.vapor_phase_id.set_string("");
+		self.liquid_phase_ids.resize(0);
+		for (i, state_of_aggregation) in feed.states_of_aggregation.iter().enumerate() {
+			if state_of_aggregation.eq_ignore_case(&vapor) {
+				if !self.vapor_phase_id.is_empty() {
+					return Err(COBIAError::Message("Material Object connected to feed defines more than one vapor phase".into()));
+				}
+				self.vapor_phase_id.set(&feed.phase_ids[i]);
+			} else if state_of_aggregation.eq_ignore_case(&liquid) {
+				let size=self.liquid_phase_ids.size();
+				self.liquid_phase_ids.resize(size+1);
+				self.liquid_phase_ids[size].set(&feed.phase_ids[i]);
+			}
+		}
+		if self.vapor_phase_id.is_empty() {
+			return Err(COBIAError::Message("Material Object connected to feed does not define vapor phase".into()));
+		}
+		if self.liquid_phase_ids.is_empty() {
+			return Err(COBIAError::Message("Material Object connected to feed does not define any liquid phase".into()));
+		}
+		//check consistent compound and phase IDs of the products
+		for (product,product_name) in [(distillate,"top product"),(bottoms,"bottom product")] {
+			if product.compound_ids!=self.compound_ids {
+				return Err(COBIAError::Message(format!("Material objects connected to feed and {} do not have the same compounds",product_name)));
+			}
+			if product.phase_ids!=self.phase_ids {
+				return Err(COBIAError::Message(format!("Material objects connected to feed and {} do not have the same phases",product_name)));
+			}
+		}
+		Ok(())
+	}
+
 	/// Internal method for validation of the unit operation.
 	///
 	/// During validation, the unit operation checks that:
@@ -632,139 +931,50 @@ impl DistillationShortcutUnit {
 	/// * A vapor phase is defined; the vapor phase ID is determined as well,
 	/// * All parameters are valid.
 	///
+	/// The compound and phase lists are obtained on each validation, but only checked if a port
+	/// was connected or disconnected, or the lists changed, since the last successful port validation.
+	///
 	/// # Returns:
 	/// * A `Result` indicating success or failure of the validation process.
 
 	pub fn validate_internal(&mut self) -> Result<(),COBIAError> {
 		//check that the ports are connnected
-		// performance note: the following can be re-used between calls if stored as distillation_shortcut_unit class members
-		let mut product_compound_ids = CapeArrayStringVec::new();
-		let mut product_compound_names = CapeArrayStringVec::new();
-		let mut compound_formulae = CapeArrayStringVec::new();
-		let mut boil_temps = CapeArrayRealVec::new();
-		let mut molwts = CapeArrayRealVec::new();
-		let mut casnos = CapeArrayStringVec::new();
-		let mut states_of_aggregation = CapeArrayStringVec::new();
-		let mut key_compound_ids = CapeArrayStringVec::new();
-		let mut product_phase_ids = CapeArrayStringVec::new();
 		let mut port_error : Option<COBIAError> = None; //cache port errors until we have the compound list
-		let vapor = CapeStringImpl::from_string("vapor");
-        let liquid = CapeStringImpl::from_string("liquid");
-		//check feed
+		let mut materials=[None,None,None];
 		{
-			let fd=unsafe{MaterialPort::borrow(&self.feed)};
-			match fd.get_connected_material() {
-				None => {
-					port_error= Some(COBIAError::Message("Feed port is not connected".into()));
-				},
-				Some(mo) => {
-					let compounds=cape_open_1_2::CapeThermoCompounds::from_object(&mo)?;
-					compounds.get_compound_list(
-							&mut self.compound_ids,
-							&mut compound_formulae,
-							&mut self.compound_names,
-							&mut boil_temps,
-							&mut molwts,
-							&mut casnos)?;
-					if self.compound_ids.size()==0 && port_error.is_none() {
-						port_error= Some(COBIAError::Message("Material Object connected to feed does not contain any compounds".into()));
-					}
-					//determine which is the vapor phase ID
-					// we assume that the vapor phase ID is the same for the feed, distillate product, and bottom product material objects
-					let phases=cape_open_1_2::CapeThermoPhases::from_object(&mo)?;
-					phases.get_phase_list(&mut self.phase_ids,&mut states_of_aggregation,&mut key_compound_ids)?;
-					if self.phase_ids.size()!=states_of_aggregation.size() && port_error.is_none() {
-						if port_error.is_none() {
-							port_error= Some(COBIAError::Message("Material Object connected to feed returns inconsistent number of phases and states of aggregation".into()));
-						}
-					} else {
-						//find vapor phase
-						self.vapor_phase_id.set_string("");
-						self.liquid_phase_ids.resize(0);
-						for (i, state_of_aggregation) in states_of_aggregation.iter().enumerate() {
-							if state_of_aggregation.eq_ignore_case(&vapor) {
-								if !self.vapor_phase_id.is_empty() && port_error.is_none() {
-									port_error= Some(COBIAError::Message("Material Object connected to feed defines more than one vapor phase".into()));
-                                } else {
-                                    self.vapor_phase_id.set(&self.phase_ids[i]);
-                                }
-                            } else if state_of_aggregation.eq_ignore_case(&liquid) {
-								let size=self.liquid_phase_ids.size();
-                                self.liquid_phase_ids.resize(size+1);
-                                self.liquid_phase_ids[size].set(&self.phase_ids[i]);
-                            }
-                        }
-						if self.vapor_phase_id.is_empty() && port_error.is_none() {
-							port_error= Some(COBIAError::Message("Material Object connected to feed does not define vapor phase".into()));
-						}
-						if self.liquid_phase_ids.is_empty() && port_error.is_none() {
-                            port_error= Some(COBIAError::Message("Material Object connected to feed does not define any liquid phase".into()));
-						}
-					}
-				}
-			};
-		}
-		//check distillate product
-		if port_error.is_none() {
-			let tp=unsafe{MaterialPort::borrow(&self.distillate_product)};
-			match tp.get_connected_material() {
-				None => {
-					port_error=Some(COBIAError::Message("Distillate product port is not connected".into()));
-				},
-				Some(mo) => {
-					//get compounds
-					let compounds=cape_open_1_2::CapeThermoCompounds::from_object(&mo)?;
-					compounds.get_compound_list(
-							&mut product_compound_ids,
-							&mut compound_formulae,
-							&mut product_compound_names,
-							&mut boil_temps,
-							&mut molwts,
-							&mut casnos)?;
-					//check consistent compound IDs
-					if product_compound_ids!=self.compound_ids {
-						port_error=Some(COBIAError::Message("Material objects connected to feed and top product do not have the same compounds".into()));
-					}
-					//get phases
-					let phases=cape_open_1_2::CapeThermoPhases::from_object(&mo)?;
-					phases.get_phase_list(&mut product_phase_ids,&mut states_of_aggregation,&mut key_compound_ids)?;
-					//check consistent phase IDs
-					if product_phase_ids!=self.phase_ids && port_error.is_none() {
-						port_error=Some(COBIAError::Message("Material objects connected to feed and top product do not have the same phases".into()));
+			let ports=[
+				(&self.feed,"Feed port is not connected"),
+				(&self.distillate_product,"Distillate product port is not connected"),
+				(&self.bottom_product,"Bottom product port is not connected"),
+			];
+			for (i,(port,not_connected_message)) in ports.into_iter().enumerate() {
+				match unsafe{MaterialPort::borrow(port)}.get_connected_material() {
+					None => {
+						port_error=Some(COBIAError::Message(not_connected_message.into()));
+						break;
+					},
+					Some(mo) => {
+						materials[i]=Some(mo);
 					}
 				}
-			};
+			}
 		}
-		//check bottom product
-		if port_error.is_none() {
-			let bp=unsafe{MaterialPort::borrow(&self.bottom_product)};
-			match bp.get_connected_material() {
-				None => {
-					port_error=Some(COBIAError::Message("Bottom product port is not connected".into()));
-				},
-				Some(mo) => {
-					//get compounds
-					let compounds=cape_open_1_2::CapeThermoCompounds::from_object(&mo)?;
-					compounds.get_compound_list(
-							&mut product_compound_ids,
-							&mut compound_formulae,
-							&mut product_compound_names,
-							&mut boil_temps,
-							&mut molwts,
-							&mut casnos)?;
-					//check consistent compound IDs
-					if product_compound_ids!=self.compound_ids {
-						port_error=Some(COBIAError::Message("Material objects connected to feed and bottom product do not have the same compounds".into()));
-					}
-					//get phases
-					let phases=cape_open_1_2::CapeThermoPhases::from_object(&mo)?;
-					phases.get_phase_list(&mut product_phase_ids,&mut states_of_aggregation,&mut key_compound_ids)?;
-					//check consistent phase IDs
-					if product_phase_ids!=self.phase_ids && port_error.is_none() {
-						port_error=Some(COBIAError::Message("Material objects connected to feed and bottom product do not have the same phases".into()));
-					}
+		//obtain the compound and phase lists, and check them unless the ports are unchanged since the last successful check
+		if let [Some(feed),Some(distillate),Some(bottoms)]=&materials {
+			let port_connections=self.shared_unit_data.borrow().port_connections;
+			let [feed_lists,distillate_lists,bottoms_lists]=&mut self.validation_cache.ports;
+			let tokens=[
+				feed_lists.query(feed,&self.performance)?,
+				distillate_lists.query(distillate,&self.performance)?,
+				bottoms_lists.query(bottoms,&self.performance)?,
+			];
+			if !self.validation_cache.matches(port_connections,&tokens) {
+				self.validation_cache.invalidate();
+				port_error=self.validate_ports().err();
+				if port_error.is_none() {
+					self.validation_cache.store(port_connections,tokens);
 				}
-			};
+			}
 		}
 		//add choice list to the light and heavy key compound parameters
 		unsafe { StringParameter::borrow_mut(&mut self.light_key_compound).set_possible_values(Some(&self.compound_names)) };
@@ -825,112 +1035,6 @@ impl DistillationShortcutUnit {
 		return Ok(());
 	}
 
-	/// Calculate dew or bubble point, and the K values
-	///
-	/// #Arguments:
-	/// * `stream_name` - The name of the stream for which the dew or bubble point is calculated.
-	/// * `material_object` - The material object for which the dew or bubble point is calculated.
-	/// * `material_equilibrium_routine` - The material equilibrium routine to be used for the calculation.
-	/// * `flow_rates` - The flow rates for the material object.
-	/// * `pressure_value` - The pressure value for the material object.
-	/// * `phase_fraction_value` - The vapor phase fraction for the material object (0 for bubble point, 1 for dew point).
-	/// * `pressure` - The string literal 'pressure'
-	/// * `phase_fraction` - The string literal 'phase_fraction'
-	/// * `fraction` - The string literal 'fraction'
-	/// * `flow` - The string literal 'flow'
-	/// * `mole` - The string literal 'mole'
-	/// * `no_basis` - Empty string literal, used to indicate that no basis applies to a property
-	/// * `vapor_composition` - The vapor composition buffer, re-used
-	/// * `liquid_composition` - The liquid composition buffer, re-used
-	/// * `present_phases` - The present phases buffer, re-used
-	/// * `present_phase_status` - The present phase status buffer, re-used
-	/// * `pressure_condition` - The flash condition that identifies overall pressure,
-	/// * `vapor_fraction_condition` - The flash condition that identifies vapor phase fraction,
-	/// * `solution_type` - The solution type to be used for the calculation, the string literal Unspecified
-	/// * `phase_status_unspecified` - The phase status buffer, re-used, used to indicate that the phase status is unspecified
-	/// * `k_values` - Receives the K values at the phase boundary
-	///
-	/// # Returns:
-	/// * A `Result` indicating success or failure of the calculation process.
-	fn calculate_dew_or_bubble_point(
-		&mut self,
-		stream_name:&str,
-        material_object : &cape_open_1_2::CapeThermoMaterial,
-		material_equilibrium_routine : &cape_open_1_2::CapeThermoEquilibriumRoutine,
-		flow_rates:&CapeArrayRealVec,
-		pressure_value:&CapeArrayRealScalar,
-        phase_fraction_value:&CapeArrayRealScalar,
-        pressure:&CapeStringImpl,
-		phase_fraction:&CapeStringImpl,
-        fraction:&CapeStringImpl,
-		flow:&CapeStringImpl,
-		mole:&CapeStringImpl,
-		no_basis:&CapeStringImpl,
-		vapor_composition:&mut CapeArrayRealVec,
-		liquid_composition:&mut CapeArrayRealVec,
-        present_phases:&mut CapeArrayStringVec,
-		present_phase_status: &mut CapeArrayEnumerationVec<cape_open_1_2::CapePhaseStatus >,
-		pressure_condition:&CapeArrayStringVec,
-		vapor_fraction_condition:&CapeArrayStringVec,
-		solution_type:&CapeStringImpl,
-        phase_status_unspecified:&CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>,
-        k_values:&mut Vec<f64>,
-	) -> Result<(),COBIAError> {
-        //set current rate, pressure and vapor fraction, and flash to obtain the dew or bubble point
-        material_object.set_overall_prop(flow, mole, flow_rates)?;
-        material_object.set_overall_prop(pressure, no_basis, pressure_value)?;
-        material_object.set_single_phase_prop(phase_fraction,&self.vapor_phase_id,mole,phase_fraction_value)?;
-        material_object.set_present_phases(&self.phase_ids,phase_status_unspecified)?;
-        match material_equilibrium_routine.calc_equilibrium(pressure_condition,vapor_fraction_condition,solution_type) {
-            Ok (_) => { },
-            Err (e) =>
-            {
-                return Err(COBIAError::Message(format!("Error calculating dew or bubble point for {}: {}", stream_name,e)));
-            }
-        }
-		//validate that there is a liquid and a vapor phase, and get phase compositions
-        material_object.get_present_phases(present_phases,present_phase_status)?;
-        let mut has_vapor_phase = false;
-		let mut has_liquid_phase = false;
-		for phase_id in present_phases.iter() {
-			if phase_id.eq_ignore_case(&self.vapor_phase_id) {
-				has_vapor_phase = true;
-                material_object.get_single_phase_prop(fraction, phase_id, mole,vapor_composition)?;
-				if vapor_composition.size()!= self.compound_names.size() {
-					return Err(COBIAError::Message("Vapor composition has invalid number of elements".into()));
-				}
-            } else {
-				for liquid_phase_id in self.liquid_phase_ids.iter() {
-					if phase_id.eq_ignore_case(liquid_phase_id) {
-						has_liquid_phase = true;
-						material_object.get_single_phase_prop(fraction, phase_id, mole,liquid_composition)?;
-                        if liquid_composition.size()!= self.compound_names.size() {
-                            return Err(COBIAError::Message("Liquid composition has invalid number of elements".into()));
-                        }
-						break; //no need to check further
-					}
-				}
-			}
-			if has_liquid_phase && has_vapor_phase {
-				break; //no need to check further
-			}
-		}
-		if !has_vapor_phase {
-			return Err(COBIAError::Message(format!{"No vapor phase present at dew or bubble point for stream '{}'", stream_name}));
-		}
-		if !has_liquid_phase {
-            return Err(COBIAError::Message(format!{"No liquid phase present at dew or bubble point for stream '{}'", stream_name}));
-		}
-		//get the K values for the distillate product
-		k_values.clear();
-        for (y,x) in vapor_composition.as_vec().iter().zip(liquid_composition.as_vec().iter()) {
-			//avoid numerical errors by assuming a lower limit of 1e-15 mol/mol on composition
-            k_values.push(f64::max(*y, 1e-15) / f64::max(*x, 1e-15)); // k = y/x
-		}
-		//ok
-		Ok(())
-	}
-
 	/// Calculate overall enthalpy at the current phase equilibrium
 	///
 	/// # Arguments:
@@ -962,21 +1066,22 @@ impl DistillationShortcutUnit {
         enthalpy_list.resize(1);
         enthalpy_list[0].set(&enthalpy);
 		//obtain the present phases
-        material_object.get_present_phases(present_phases,present_phase_status)?;
+        let performance=&self.performance;
+        performance.call(ExternalCall::GetPresentPhases,|| material_object.get_present_phases(present_phases,present_phase_status))?;
 		//iterate over the present phases and calculate the overall enthalpy
 		for phase_id in present_phases.iter() {
 			//get phase fraction
 			let mut phase_fraction_value = CapeArrayRealScalar::new();
-			material_object.get_single_phase_prop(phase_fraction, phase_id, mole, &mut phase_fraction_value)?;
+			performance.call(ExternalCall::GetSinglePhaseProp,|| material_object.get_single_phase_prop(phase_fraction, phase_id, mole, &mut phase_fraction_value))?;
 			if phase_fraction_value.value()<=0.0 {
 				//no need for enthalpy, phase is incipient
 				continue;
 			}
 			//calculate enthalpy
-            material_calculation_routine.calc_single_phase_prop(&enthalpy_list,phase_id)?;
+            performance.call(ExternalCall::CalcSinglePhaseProp,|| material_calculation_routine.calc_single_phase_prop(&enthalpy_list,phase_id))?;
 			//get enthalpy value
             let mut enthalpy_value=CapeArrayRealScalar::new();
-			material_object.get_single_phase_prop(&enthalpy, phase_id, mole, &mut enthalpy_value)?;
+			performance.call(ExternalCall::GetSinglePhaseProp,|| material_object.get_single_phase_prop(&enthalpy, phase_id, mole, &mut enthalpy_value))?;
 			//add to the overall enthalpy
             overall_enthalpy+=enthalpy_value.value()*phase_fraction_value.value();
 		}
@@ -986,18 +1091,180 @@ impl DistillationShortcutUnit {
 	/// Warning
 	///
 	/// This function adds a warning message to the diagnostics interface, if available,
-	/// and adds it to the calculation log.
+	/// and adds it to the calculation log. Warnings are recorded even if the calculation
+	/// report is disabled; the parameter only controls the other events of the report.
 	///
 	/// # Arguments:
-	/// * `message` - A string slice containing the warning message to be logged.
+	/// * `event` - The warning event to be logged.
 	/// 
-	fn warning(&mut self, message: &str) {
+	fn warning(&mut self, event: RunEvent) {
 		if let Some(diag) = &self.diagnostics {
-			let _ = diag.log_message(&CapeStringImpl::from_string(format!{"warning {}: {}",self.shared_unit_data.borrow().name,message}));
+			let mut message=format!{"warning {}: ",self.shared_unit_data.borrow().name}.into_bytes();
+			let _ = event.write_text(&self.compound_names,&mut message);
+			let _ = diag.log_message(&CapeStringImpl::from_string(String::from_utf8_lossy(&message)));
+		}
+		self.run_log.log(event);
+	}
+
+	/// The persisted real parameters, in order of the binary state record.
+	///
+	/// The list must not change; parameters that are added later follow the last run report in a new version of the state record.
+
+	fn persisted_real_parameters(&mut self) -> [&mut cape_open_1_2::CapeRealParameter;7] {
+		[
+			&mut self.light_key_compound_recovery,
+			&mut self.heavy_key_compound_recovery,
+			&mut self.reflux_ratio_factor,
+			&mut self.convergence_tolerance,
+			&mut self.number_of_stages,
+			&mut self.reflux_ratio,
+			&mut self.feed_stage_location,
+		]
+	}
+
+	/// The persisted integer parameters, in order of the binary state record.
+	///
+	/// The list must not change; parameters that are added later follow the last run report in a new version of the state record.
+
+	fn persisted_integer_parameters(&mut self) -> [&mut cape_open_1_2::CapeIntegerParameter;2] {
+		[
+			&mut self.maximum_iterations,
+			&mut self.incremental_calculation,
+		]
+	}
+
+	/// The persisted string parameters, in order of the binary state record.
+	///
+	/// The list must not change; parameters that are added later follow the last run report in a new version of the state record.
+
+	fn persisted_string_parameters(&mut self) -> [&mut cape_open_1_2::CapeStringParameter;2] {
+		[
+			&mut self.light_key_compound,
+			&mut self.heavy_key_compound,
+		]
+	}
+
+	/// Encode the state of the unit operation in a binary state record.
+	///
+	/// Version 1 of the record holds the name, the description, the persisted parameters
+	/// and the last run report. Version 2 adds the calculation report parameter, version 3
+	/// the concurrent flashes parameter.
+	///
+	/// # Returns:
+	/// * The state record
+
+	fn encode_state(&mut self) -> CapeArrayByteVec {
+		let mut encoder=StateEncoder::new(Self::STATE_RECORD_VERSION);
+		encoder.put_string(&self.shared_unit_data.borrow().name.as_string());
+		encoder.put_string(&self.description.as_string());
+		for parameter in self.persisted_real_parameters() {
+			encoder.put_real(unsafe{RealParameter::borrow(parameter)}.value);
+		}
+		for parameter in self.persisted_integer_parameters() {
+			encoder.put_integer(unsafe{IntegerParameter::borrow(parameter)}.value);
+		}
+		for parameter in self.persisted_string_parameters() {
+			encoder.put_string(&unsafe{StringParameter::borrow(parameter)}.value.as_string());
+		}
+		encoder.put_string(&self.run_log.to_text(&self.compound_names));
+		//version 2
+		encoder.put_integer(unsafe{IntegerParameter::borrow(&self.calculation_report)}.value);
+		//version 3
+		encoder.put_integer(unsafe{IntegerParameter::borrow(&self.concurrent_flashes)}.value);
+		encoder.finish()
+	}
+
+	/// Restore the state of the unit operation from a binary state record.
+	///
+	/// # Arguments:
+	/// * `state` - The state record
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	fn decode_state(&mut self, state: &[u8]) -> Result<(),COBIAError> {
+		let mut decoder=StateDecoder::new(state)?;
+		if decoder.version>Self::STATE_RECORD_VERSION {
+			return Err(COBIAError::Message(format!("Unit operation state was saved by a newer version (state version {})",decoder.version)));
+		}
+		//decode the complete record before changing the state, so that a damaged record leaves the unit unchanged
+		let name=decoder.get_string()?;
+		let description=decoder.get_string()?;
+		let real_values=(0..self.persisted_real_parameters().len()).map(|_| decoder.get_real()).collect::<Result<Vec<f64>,COBIAError>>()?;
+		let integer_values=(0..self.persisted_integer_parameters().len()).map(|_| decoder.get_integer()).collect::<Result<Vec<i32>,COBIAError>>()?;
+		let string_values=(0..self.persisted_string_parameters().len()).map(|_| decoder.get_string()).collect::<Result<Vec<&str>,COBIAError>>()?;
+		let last_run_report=decoder.get_string()?;
+		let calculation_report=if decoder.version>=2 {Some(decoder.get_integer()?)} else {None};
+		let concurrent_flashes=if decoder.version>=3 {Some(decoder.get_integer()?)} else {None};
+		decoder.end()?;
+		self.shared_unit_data.borrow_mut().name.set_string(name);
+		self.description.set_string(description);
+		for (parameter,value) in self.persisted_real_parameters().into_iter().zip(real_values) {
+			unsafe{RealParameter::borrow_mut(parameter)}.value=value;
+		}
+		for (parameter,value) in self.persisted_integer_parameters().into_iter().zip(integer_values) {
+			unsafe{IntegerParameter::borrow_mut(parameter)}.value=value;
+		}
+		for (parameter,value) in self.persisted_string_parameters().into_iter().zip(string_values) {
+			unsafe{StringParameter::borrow_mut(parameter)}.value.set_string(value);
+		}
+		if let Some(value)=calculation_report {
+			unsafe{IntegerParameter::borrow_mut(&mut self.calculation_report)}.value=value;
+		}
+		if let Some(value)=concurrent_flashes {
+			unsafe{IntegerParameter::borrow_mut(&mut self.concurrent_flashes)}.value=value;
+		}
+		self.run_log.set_enabled(unsafe{IntegerParameter::borrow(&self.calculation_report)}.value!=0);
+		self.run_log.clear();
+		self.run_log.log(RunEvent::Restored(last_run_report.to_string()));
+		Ok(())
+	}
+
+	/// Check whether the material objects connected to the ports are unchanged since the last successful port validation.
+	///
+	/// The compound and phase lists are obtained again: the PME may have swapped or reconfigured
+	/// the property package behind a material object that stays connected.
+	///
+	/// # Returns:
+	/// * Whether the identity tokens of all ports match those of the last successful port validation
+
+	fn ports_unchanged(&mut self) -> Result<bool,COBIAError> {
+		let materials=[&self.feed,&self.distillate_product,&self.bottom_product].map(|port| unsafe{MaterialPort::borrow(port)}.get_connected_material());
+		let [Some(feed),Some(distillate),Some(bottoms)]=&materials else {
+			return Ok(false);
+		};
+		let [feed_lists,distillate_lists,bottoms_lists]=&mut self.validation_cache.ports;
+		let tokens=[
+			feed_lists.query(feed,&self.performance)?,
+			distillate_lists.query(distillate,&self.performance)?,
+			bottoms_lists.query(bottoms,&self.performance)?,
+		];
+		Ok(self.validation_cache.tokens()==Some(&tokens))
+	}
+
+	/// Collect all calculation inputs.
+	///
+	/// # Arguments:
+	/// * `feed` - The state of the feed material object
+	/// * `ports` - The identity tokens of the material objects connected to the feed, distillate and bottoms ports
+	///
+	/// # Returns:
+	/// * The calculation inputs
+
+	fn calculation_inputs<'a>(&'a self,feed:&'a MaterialState,ports:[PortToken;3]) -> CalculationInputs<'a> {
+		CalculationInputs {
+			feed,
+			ports,
+			compound_ids : &self.compound_ids,
+			vapor_phase_id : &self.vapor_phase_id,
+			light_key_compound : &unsafe{StringParameter::borrow(&self.light_key_compound)}.value,
+			heavy_key_compound : &unsafe{StringParameter::borrow(&self.heavy_key_compound)}.value,
+			light_key_compound_recovery : unsafe{RealParameter::borrow(&self.light_key_compound_recovery).value},
+			heavy_key_compound_recovery : unsafe{RealParameter::borrow(&self.heavy_key_compound_recovery).value},
+			reflux_ratio_factor : unsafe{RealParameter::borrow(&self.reflux_ratio_factor).value},
+			maximum_iterations : unsafe{IntegerParameter::borrow(&self.maximum_iterations).value},
+			convergence_tolerance : unsafe{RealParameter::borrow(&self.convergence_tolerance).value},
 		}
-		self.last_run_report.push_str("Warning: ");
-        self.last_run_report.push_str(message);
-        self.last_run_report.push('\n');
 	}
 
 	/// Calculate the unit operation.
@@ -1017,34 +1284,33 @@ impl DistillationShortcutUnit {
 
     fn calculate_model(&mut self) -> Result<(),COBIAError> {
         //the PME may only call this method if the unit operation in a valid state.
-        // however, we make sure
-        if self.shared_unit_data.borrow().validation_status != cape_open_1_2::CapeValidationStatus::CapeValid {
+        // however, we make sure; the PME may also have swapped or reconfigured the property
+        // package behind a connected material object since validation
+        let validated=self.shared_unit_data.borrow().validation_status == cape_open_1_2::CapeValidationStatus::CapeValid;
+        if !validated || !self.ports_unchanged()? {
             //validate
+            let validate_span=self.performance.begin(Phase::Validate);
             self.validate_internal()?;
+            validate_span.end();
         }
+        let ports=*self.validation_cache.tokens().ok_or_else(|| COBIAError::Message("Ports are not validated".into()))?;
         //set up some string constants
         // a production application could cache these strings for efficiency;
         // see the salt-water package for an example on how to do this
-        let flow = CapeStringImpl::from("flow");
         let mole = CapeStringImpl::from("mole");
-        let no_basis = CapeStringImpl::new();
-        let pressure = CapeStringImpl::from("pressure");
         let phase_fraction = CapeStringImpl::from("phaseFraction");
-		let fraction = CapeStringImpl::from("fraction"); //mole or mass fraction, aka composition
-        //get the required information from the feed port
-        let mut feed_rates = CapeArrayRealVec::new();
         //get the material connected to the feed port
         let feed_material = unsafe{MaterialPort::borrow(&self.feed)}.get_connected_material().ok_or_else( || COBIAError::Message("Feed port is not connected".into()))?;
         //get material object interface
         let feed_material_object = cape_open_1_2::CapeThermoMaterial::from_object(&feed_material)?;
-        //get component flow rates
-        feed_material_object.get_overall_prop(&flow, &mole, &mut feed_rates)?;
+        //get the state of the feed: temperature, pressure, compound flow rates and the phase equilibrium
+        let mut feed_state = MaterialState::new();
+        feed_state.capture(&feed_material_object,&MaterialStateLiterals::new(),&self.performance)?;
+        let feed_rates = feed_state.flows(); //mol/s
         if feed_rates.size() != self.compound_names.size() {
             return Err(COBIAError::Message("Number of compound flows returned by material object does not match number of compounds".into()))
         }
-        //get the pressure from the feed material object
-        let mut feed_pressure=CapeArrayRealScalar::new(); //Pa
-        feed_material_object.get_overall_prop(&pressure, &no_basis, &mut feed_pressure)?;
+        let feed_pressure = feed_state.pressure().value(); //Pa
         //Property calculations at the feed material object are not allowed;
         // we do our calculations directly on the product material objects.
 		//Obtain the necessary interfaces to the product streams
@@ -1056,27 +1322,38 @@ impl DistillationShortcutUnit {
         let bottoms_material_object = cape_open_1_2::CapeThermoMaterial::from_object(&bottoms_material)?;
         let bottoms_material_calculation_routine = cape_open_1_2::CapeThermoPropertyRoutine::from_object(&bottoms_material)?;
         let bottoms_material_equilibrium_routine = cape_open_1_2::CapeThermoEquilibriumRoutine::from_object(&bottoms_material)?;
-        //products are flashed at pressure and vapor fraction
-        let pressure_condition = CapeArrayStringVec::from_slice(& [pressure.as_string(), no_basis.as_string(), "overall".into()]);
-        let vapor_fraction_condition = CapeArrayStringVec::from_slice(&[phase_fraction.as_string(), mole.as_string(), self.vapor_phase_id.as_string()]);
-        let solution_type = CapeStringImpl::from_string("Unspecified");
-        let distillate_vapor_fraction = CapeArrayRealScalar::from(1.0);
-        let bottoms_vapor_fraction = CapeArrayRealScalar::from(0.0);
-        //for all flashes we allow all phases, and do not specify an initial guess
-        let mut phase_status_unspecified = CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>::new();
-        phase_status_unspecified.resize(self.phase_ids.size(), cape_open_1_2::CapePhaseStatus::CapeUnknownphasestatus);
+        //skip the calculation if the inputs have not changed since the last successful calculation
+        let fingerprint=self.calculation_inputs(&feed_state,ports).fingerprint();
+        if unsafe{IntegerParameter::borrow(&self.incremental_calculation).value}!=0 && self.calculation_cache.lookup(fingerprint) {
+            let replay_span=self.performance.begin(Phase::ProductStates);
+            self.calculation_cache.replay(&distillate_material_object,&bottoms_material_object,&self.performance)?;
+            replay_span.end();
+            self.run_log.log(RunEvent::CacheHit(self.calculation_cache.hits));
+            return Ok(());
+        }
+        self.calculation_cache.invalidate();
+        self.case_study.set_data(None);
+        //products are flashed at pressure and vapor fraction: the dew point for the distillate, the bubble point for the bottoms
+        let flash_settings = FlashSettings {
+            vapor_phase_id : self.vapor_phase_id.as_string(),
+            liquid_phase_ids : self.liquid_phase_ids.iter().map(|phase_id| phase_id.as_string()).collect(),
+            phase_ids : self.phase_ids.iter().map(|phase_id| phase_id.as_string()).collect(),
+            compound_count : self.compound_names.size(),
+        };
+        let mut saturation_flash = SaturationFlash::new(&flash_settings);
+        let distillate_flash_material = FlashMaterial{material_object:&distillate_material_object,equilibrium_routine:&distillate_material_equilibrium_routine};
+        let bottoms_flash_material = FlashMaterial{material_object:&bottoms_material_object,equilibrium_routine:&bottoms_material_equilibrium_routine};
         //allocate some variables to be re-used during calculations
         let mut present_phases = CapeArrayStringVec::new();
         let mut present_phase_status = CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>::new();
-        let mut vapor_composition = CapeArrayRealVec::new(); 
-        let mut liquid_composition = CapeArrayRealVec::new();
         let mut distillate_k_values=Vec::with_capacity(self.compound_names.size());
         let mut bottoms_k_values=Vec::with_capacity(self.compound_names.size());
         let mut effective_k_values= Vec::with_capacity(self.compound_names.size());
         let mut alpha = Vec::with_capacity(self.compound_names.size());
 		//calculate the enthalpy of the feed, to determine quality
         // note: CAPE-OPEN does not allow calculations on a feed material; we perform the calculation on the distillate material object
-        distillate_material_object.copy_from_material(&feed_material_object)?;
+        let feed_enthalpy_span=self.performance.begin(Phase::FeedEnthalpy);
+        self.performance.call(ExternalCall::CopyFromMaterial,|| distillate_material_object.copy_from_material(&feed_material_object))?;
         let feed_enthalpy=self.calculate_overall_enthalpy(
             &distillate_material_object,
             &distillate_material_calculation_routine,
@@ -1087,31 +1364,11 @@ impl DistillationShortcutUnit {
         ).or_else( |e| {
             Err(COBIAError::Message(format!("Error calculating enthalpy for feed: {}", e)))
         })?;
+        feed_enthalpy_span.end();
+        let feed_saturation_span=self.performance.begin(Phase::FeedSaturation);
 		//do a dew point calculation at feed composition, to determine K values and overall enthalpy
 		// note: CAPE-OPEN does not allow calculations on a feed material; we perform the calculation on the distillate material object
-        self.calculate_dew_or_bubble_point(
-            &"Feed",
-            &distillate_material_object,
-            &distillate_material_equilibrium_routine,
-            &feed_rates,
-            &feed_pressure,
-            &distillate_vapor_fraction,
-            &pressure,
-            &phase_fraction,
-            &fraction,
-            &flow,
-            &mole,
-            &no_basis,
-            &mut vapor_composition,
-            &mut liquid_composition,
-            &mut present_phases,
-            &mut present_phase_status,
-            &pressure_condition,
-            &vapor_fraction_condition,
-            &solution_type,
-			&phase_status_unspecified,
-            &mut distillate_k_values,
-        )?;
+        saturation_flash.flash("Feed",distillate_flash_material,feed_rates.as_vec(),feed_pressure,1.0,&self.performance,&mut distillate_k_values)?;
 		//calculate enthalpy at saturation point
 		let dew_point_feed_enthalpy=self.calculate_overall_enthalpy(
 			&distillate_material_object,
@@ -1125,29 +1382,7 @@ impl DistillationShortcutUnit {
 		})?;
         //do a bubble point calculation at feed composition, to determine K values and overall enthalpy
         // note: CAPE-OPEN does not allow calculations on a feed material; we perform the calculation on the bottoms material object
-        self.calculate_dew_or_bubble_point(
-            &"Feed",
-            &bottoms_material_object,
-            &bottoms_material_equilibrium_routine,
-            &feed_rates,
-            &feed_pressure,
-            &bottoms_vapor_fraction,
-            &pressure,
-            &phase_fraction,
-            &fraction,
-            &flow,
-            &mole,
-            &no_basis,
-            &mut vapor_composition,
-            &mut liquid_composition,
-            &mut present_phases,
-            &mut present_phase_status,
-            &pressure_condition,
-            &vapor_fraction_condition,
-            &solution_type,
-            &phase_status_unspecified,
-            &mut bottoms_k_values,
-        )?;
+        saturation_flash.flash("Feed",bottoms_flash_material,feed_rates.as_vec(),feed_pressure,0.0,&self.performance,&mut bottoms_k_values)?;
         //calculate enthalpy at saturation point
         let bubble_point_feed_enthalpy=self.calculate_overall_enthalpy(
             &bottoms_material_object,
@@ -1159,15 +1394,16 @@ impl DistillationShortcutUnit {
         ).or_else( |e| {
             Err(COBIAError::Message(format!("Error calculating dew point enthalpy for feed: {}", e)))
         })?;
+        feed_saturation_span.end();
 		//calculate the quality of the feed
 		let feed_quality=(dew_point_feed_enthalpy-feed_enthalpy)/(dew_point_feed_enthalpy-bubble_point_feed_enthalpy);
 		//report feed quality
-		self.last_run_report.push_str(&format!("Feed quality: {:.4}\n", feed_quality));
+		self.run_log.log(RunEvent::FeedQuality(feed_quality));
 		if feed_quality< -f64::EPSILON {
-			self.last_run_report.push_str("Feed stream is super-heated");
+			self.run_log.log(RunEvent::FeedSuperHeated);
 		} else if feed_quality>1.0+f64::EPSILON {
 			//log
-			self.last_run_report.push_str("Feed stream is sub-cooled");
+			self.run_log.log(RunEvent::FeedSubCooled);
 		}
 		//get effective K values for feed for initial guess
         effective_k_values.clear();
@@ -1175,6 +1411,7 @@ impl DistillationShortcutUnit {
             effective_k_values.push(f64::sqrt(distillate_k*bottoms_k)); // k_eff = sqrt(k_distillate * k_bottoms)
         }
 		//Part 1: Fenske calculation
+		let fenske_span=self.performance.begin(Phase::Fenske);
         // estimate top and bottom flow
         //  for this example we assume heavy and light key split as specified; all other compounds split 50/50
         let mut distillate_rates = feed_rates.clone();
@@ -1224,62 +1461,40 @@ impl DistillationShortcutUnit {
 		//the numerator in the minimum stages equation is constant
 		let numerator_min_stage=f64::ln((rate_light_key_compound_distillate*rate_heavy_key_compound_bottoms)/(rate_light_key_compound_bottoms*rate_heavy_key_compound_distillate));
         //loop over the maximum number of iterations
-        let mut min_number_of_stages : f64;
         let mut number_of_iterations = 0;
-        loop {
+		self.solver_telemetry.fenske.reset();
+		//the product flashes run concurrently if the material objects may be used from any thread, and there is more than one core
+		let concurrent_flashes=unsafe{IntegerParameter::borrow(&self.concurrent_flashes).value}!=0 && std::thread::available_parallelism().map_or(false,|n| n.get()>1);
+		let mut product_flash_time=std::time::Duration::ZERO;
+        let fenske_result=loop {
             //increate iteration count
             number_of_iterations += 1;
             if number_of_iterations > maximum_iterations {
-                return Err(COBIAError::Message(format!("Maximum number of iterations ({}) exceeded", maximum_iterations)));
+                break Err(COBIAError::Message(format!("Maximum number of iterations ({}) exceeded", maximum_iterations)));
             }
-			//calculate distillate product 
-            self.calculate_dew_or_bubble_point(
-                &"Distillate",
-                &distillate_material_object,
-                &distillate_material_equilibrium_routine,
-                &distillate_rates,
-                &feed_pressure,
-                &distillate_vapor_fraction,
-                &pressure,
-                &phase_fraction,
-                &fraction,
-                &flow,
-                &mole,
-                &no_basis,
-                &mut vapor_composition,
-                &mut liquid_composition,
-                &mut present_phases,
-                &mut present_phase_status,
-                &pressure_condition,
-                &vapor_fraction_condition,
-                &solution_type,
-                &phase_status_unspecified,
-                &mut distillate_k_values,
-            )?;
-			//calculate bottoms product
-            self.calculate_dew_or_bubble_point(
-                &"Bottoms",
-                &bottoms_material_object,
-                &bottoms_material_equilibrium_routine,
-                &bottoms_rates,
-                &feed_pressure,
-                &bottoms_vapor_fraction,
-                &pressure,
-                &phase_fraction,
-                &fraction,
-                &flow,
-                &mole,
-                &no_basis,
-                &mut vapor_composition,
-                &mut liquid_composition,
-                &mut present_phases,
-                &mut present_phase_status,
-                &pressure_condition,
-                &vapor_fraction_condition,
-                &solution_type,
-                &phase_status_unspecified,
-                &mut bottoms_k_values,
-            )?;
+			self.solver_telemetry.fenske.iterations=number_of_iterations as u32;
+			//calculate distillate and bottoms products; the flashes are independent
+			let flash_span=self.performance.begin(Phase::ProductFlashes);
+			let (distillate_result,bottoms_result)=if concurrent_flashes {
+				//the worker thread receives the phase settings and the bottoms rates, and creates its own
+				// CAPE-OPEN buffers and constants; only the bottoms material object crosses the thread boundary
+				let bottoms_material=unsafe{FreeThreadedMaterial::new(bottoms_flash_material)}; //the user declared the material objects free-threaded
+				let (flash_settings,performance,bottoms_rates,bottoms_k_values)=(&flash_settings,&*self.performance,bottoms_rates.as_vec().as_slice(),&mut bottoms_k_values);
+				let (distillate_result,bottoms_result)=saturation_flash::join(
+					|| saturation_flash.flash("Distillate",distillate_flash_material,distillate_rates.as_vec(),feed_pressure,1.0,&self.performance,&mut distillate_k_values),
+					move || SaturationFlash::new(flash_settings).flash("Bottoms",bottoms_material.material(),bottoms_rates,feed_pressure,0.0,performance,bottoms_k_values).map_err(|e| e.to_string()),
+				);
+				(distillate_result,bottoms_result.map_err(COBIAError::Message))
+			} else {
+				let distillate_result=saturation_flash.flash("Distillate",distillate_flash_material,distillate_rates.as_vec(),feed_pressure,1.0,&self.performance,&mut distillate_k_values);
+				let bottoms_result=if distillate_result.is_ok() {saturation_flash.flash("Bottoms",bottoms_flash_material,bottoms_rates.as_vec(),feed_pressure,0.0,&self.performance,&mut bottoms_k_values)} else {Ok(())};
+				(distillate_result,bottoms_result)
+			};
+			if let Err(e)=distillate_result.and(bottoms_result) {
+				break Err(e);
+			}
+			product_flash_time+=flash_span.end();
+			self.solver_telemetry.fenske.function_evaluations+=1;
 			//get the effecive k values
 			effective_k_values.clear();
 			for (distillate_k, bottoms_k) in distillate_k_values.iter().zip(bottoms_k_values.iter()) {
@@ -1292,7 +1507,7 @@ impl DistillationShortcutUnit {
 				alpha.push(effective_k/k_heavy_component); // alpha_i = k_eff_i / k_eff_heavy
 			}
 			//calculate the minimum number of theoretical stages
-			min_number_of_stages=numerator_min_stage/f64::ln(alpha[self.light_key_compound_index as usize]);
+			let min_number_of_stages=numerator_min_stage/f64::ln(alpha[self.light_key_compound_index as usize]);
 			//while updating the rates, keep track of maximum flow rate error
 			let mut max_component_flow_rate_error = 0.0;
             //calculate the updated bottoms rates
@@ -1314,16 +1529,23 @@ impl DistillationShortcutUnit {
 				*distillate_rate = new_distillate_rate;
 			}
 			//check convergence
+			self.solver_telemetry.fenske.residual=max_component_flow_rate_error;
 			if max_component_flow_rate_error <= max_compound_flow_rate_deviation {
 				//converged, break the loop
-				break;
+				self.solver_telemetry.fenske.converged=true;
+				break Ok(min_number_of_stages);
 			}
-        }
+        };
+		fenske_span.end();
+		self.solver_telemetry.record_fenske();
+		let min_number_of_stages=fenske_result?;
 		//report the number of iterations
-		self.last_run_report.push_str(&format!{"Fenske calculation took {} iterations.\n",number_of_iterations});
+		self.run_log.log(RunEvent::FenskeIterations(number_of_iterations));
+		self.run_log.log(RunEvent::ProductFlashes{concurrent:concurrent_flashes,seconds:product_flash_time.as_secs_f64()});
 		//report the minimum number of stages
-        self.last_run_report.push_str(&format!{"Minimum number of stages: {}.\n",min_number_of_stages});
+        self.run_log.log(RunEvent::MinimumNumberOfStages(min_number_of_stages));
         //Part 2: Underwood calculation
+		let underwood_span=self.performance.begin(Phase::Underwood);
 		let mut feed_x_times_alpha= Vec::with_capacity(self.compound_names.size());
 		for (i,feed_rate) in feed_rates.as_vec().iter().enumerate() {
 			//calculate the feed composition times alpha
@@ -1342,66 +1564,61 @@ impl DistillationShortcutUnit {
 			}
 		}
 		if limiting_compound>=0 {
-			self.warning(&format!("Underwood calculation uses relative volatility of compound {} as light compound limit",self.compound_names[limiting_compound as usize]));
+			self.warning(RunEvent::UnderwoodLimitingCompound(limiting_compound as usize));
 		}
-		let mut theta_min=1.0;
-		//solution is bracketed, bisect to find theta
-		let mut theta=(theta_max+theta_min)*0.5;
-		let mut iteration=0;
-		loop {
-            //increment iteration count
-            iteration += 1;
-            if iteration > maximum_iterations {
-                return Err(COBIAError::Message(format!("Underwood calculation did not converge within {} iterations",maximum_iterations)));
-            }
-			//calculate f = sum(feed_x_times_alpha/(alpha-theta))-feed_vapor_fraction
+		let theta_min=1.0;
+		//solution is bracketed; the Underwood function increases monotonically between the bracketing poles,
+		// so we can apply Newton's method with the analytical derivative, safeguarded by bisection
+		let underwood=|theta:f64| {
+			//f = sum(feed_x_times_alpha/(alpha-theta))-feed_vapor_fraction
 			let mut residual=feed_quality-1.0;
-			for i in 0..self.compound_names.size() {
-                residual+=feed_x_times_alpha[i]/(alpha[i]-theta);
-			}
-			if f64::abs(residual) <= convergence_tolerance {
-				//converged
-				break;
+			let mut derivative=0.0;
+			for (x_times_alpha,alpha) in feed_x_times_alpha.iter().zip(alpha.iter()) {
+				let inverse=1.0/(alpha-theta);
+				residual+=x_times_alpha*inverse;
+				derivative+=x_times_alpha*inverse*inverse;
 			}
-			if residual>0.0 {
-				//residual is positive, theta is too high
-				theta_max=theta;
-				theta=0.5*(theta_min+theta_max);
-			} else {
-				//residual is negative, theta is too low
-				theta_min=theta;
-				theta=0.5*(theta_min+theta_max);
-			}
-			//check convergence on step size
-			if theta_max-theta_min <= convergence_tolerance {
-				//converged
-				break;
-			}
-		}
+			Ok((residual,derivative))
+		};
+		let settings=root_finding::SolverSettings {
+			x_tolerance:convergence_tolerance,
+			f_tolerance:convergence_tolerance,
+			maximum_iterations:maximum_iterations as u32,
+		};
+		let theta=root_finding::newton_bracketed(underwood,theta_min,theta_max,0.5*(theta_min+theta_max),&settings,&mut self.solver_telemetry.underwood);
+		self.solver_telemetry.record_underwood();
+		let theta=theta.or_else(|e| {
+			Err(COBIAError::Message(format!("Underwood calculation failed: {}",e)))
+		})?;
 		//report convergence
-        self.last_run_report.push_str(&format!{"Underwood calculation took {} iterations.\n",number_of_iterations});
+        self.run_log.log(RunEvent::UnderwoodIterations(self.solver_telemetry.underwood.iterations));
 		//calculate Rmin from theta
-		let mut r_min=-1.0;
-		let total_distillate_rate=distillate_rates.as_vec().iter().sum::<f64>();
-        for i in 0..self.compound_names.size() {
-            r_min+=(alpha[i]*distillate_rates[i])/(total_distillate_rate*(alpha[i]-theta));
-        }
+		let r_min=underwood_min_reflux_ratio(theta,&alpha,distillate_rates.as_vec());
+		underwood_span.end();
 		//report minimum reflux ratio
-		self.last_run_report.push_str(&format!{"Minimum reflux ratio: {:.4}\n",r_min});
+		self.run_log.log(RunEvent::MinimumRefluxRatio(r_min));
         let r= unsafe{RealParameter::borrow(&self.reflux_ratio_factor).value}*r_min; //actual reflux ratio
 		unsafe{RealParameter::borrow_mut(&mut self.reflux_ratio).value=r}; //update the reflux ratio
 		//Part 3: Gilliland calculation
-		let gilliland_x=(r-r_min)/(r+1.0);
-		let gilliland_y=1.0-f64::exp((1.0-54.4*gilliland_x)*(gilliland_x-1.0)/((11.0+117.2*gilliland_x)*f64::sqrt(gilliland_x)));
-		let number_of_stages=(gilliland_y+min_number_of_stages)/(1.0-gilliland_y);
+		let correlations_span=self.performance.begin(Phase::GillilandKirkbride);
+		let number_of_stages=gilliland_number_of_stages(r,r_min,min_number_of_stages);
         unsafe{RealParameter::borrow_mut(&mut self.number_of_stages).value=number_of_stages}; //update the number of stages
 		//Part 4: Kirkbride calculation
-        let total_bottoms_rate=bottoms_rates.as_vec().iter().sum::<f64>();
-		let ratio=(total_distillate_rate*feed_rates[self.heavy_key_compound_index as usize]*bottoms_rates[self.light_key_compound_index as usize]*bottoms_rates[self.light_key_compound_index as usize])/
-                  (total_bottoms_rate*feed_rates[self.light_key_compound_index as usize]*distillate_rates[self.heavy_key_compound_index as usize]*distillate_rates[self.heavy_key_compound_index as usize]);
-        let ratio=f64::powf(ratio,0.206);
-		let n_feed=number_of_stages/(ratio+1.0);
+		let n_feed=kirkbride_feed_stage(number_of_stages,feed_rates.as_vec(),distillate_rates.as_vec(),bottoms_rates.as_vec(),self.light_key_compound_index as usize,self.heavy_key_compound_index as usize);
         unsafe{RealParameter::borrow_mut(&mut self.feed_stage_location).value=n_feed}; //update feed stage location
+		correlations_span.end();
+		//keep the converged relative volatilities for case studies
+		self.case_study.set_data(Some(ColumnData {
+			feed_rates: feed_rates.as_vec().clone(),
+			alpha,
+			theta,
+			light_key_compound_index: self.light_key_compound_index as usize,
+			heavy_key_compound_index: self.heavy_key_compound_index as usize,
+		}));
+		//store the product states for the next calculation with the same inputs
+		let store_span=self.performance.begin(Phase::ProductStates);
+		self.calculation_cache.store(fingerprint,&distillate_material_object,&bottoms_material_object,&self.performance)?;
+		store_span.end();
 		//all ok
 		Ok(())
     }
@@ -1437,22 +1654,23 @@ impl cape_open_1_2::ICapeUnit for DistillationShortcutUnit {
 	/// The wrapper is in place just to catch the error generated by the `calculate_model` method and add it the report.
 
     fn calculate(&mut self) -> Result<(),COBIAError> {
-		//report the start of the calculation, log date and time
-		let calculation_start_time=chrono::Local::now();
-		self.last_run_report= "Calculation started at ".to_string();
-        self.last_run_report.push_str(&calculation_start_time.format("%Y-%m-%d %H:%M:%S").to_string());
-        self.last_run_report.push('\n');
-		match self.calculate_model() {
+		//report the start of the calculation, log date and time; formatting is deferred until the report is generated
+		let calculation_span=self.performance.begin(Phase::Calculate);
+		self.run_log.set_enabled(unsafe{IntegerParameter::borrow(&self.calculation_report)}.value!=0);
+		self.run_log.clear();
+		self.run_log.log(RunEvent::Started(std::time::SystemTime::now()));
+		let result=self.calculate_model();
+		let calculation_time=calculation_span.end();
+		match result {
 			Ok(_) => {
 				//report the end of the calculation, duration
-				let seconds=((chrono::Local::now()-calculation_start_time).num_milliseconds() as f64)*1e-3;
-                self.last_run_report.push_str(&format!("Calculation finished in {:.3} seconds.\n",seconds));
+				self.run_log.log(RunEvent::Finished(calculation_time.as_secs_f64()));
 				Ok(())
 			},
 			Err(e) => {
-                self.last_run_report.push_str("Calculation failed: ");
-                self.last_run_report.push_str(&e.to_string());
-				self.last_run_report.push('\n');
+				if self.run_log.is_enabled() {
+					self.run_log.log(RunEvent::Failed(e.to_string()));
+				}
 				Err(e)
 			}
 		}
@@ -1496,8 +1714,11 @@ impl cape_open_1_2::ICapeReport for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the operation.
 
     fn get_report_names(&mut self,names:&mut CapeArrayStringOut) -> Result<(),COBIAError> {
-        names.resize(1)?;
+        names.resize(4)?;
 		names.at(0)?.set(&self.last_run_report_name)?;
+		names.at(1)?.set(&self.solver_report_name)?;
+		names.at(2)?.set(&self.case_study_report_name)?;
+		names.at(3)?.set(&self.performance_report_name)?;
 		Ok(())
     }
 
@@ -1515,12 +1736,15 @@ impl cape_open_1_2::ICapeReport for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the operation.
 
     fn report_types(&mut self,name:&CapeStringIn,types:&mut CapeArrayStringOut) -> Result<(),COBIAError> {
-		if name.eq_ignore_case(&self.last_run_report_name) {
-			types.resize(1)?;
-			types.at(0)?.set_string("text/plain")?;
-			Ok(())
-		} else {
-			Err(COBIAError::Code(COBIAERR_INVALIDARGUMENT))
+		match self.report_formats(name) {
+			Some((_,formats)) => {
+				types.resize(formats.len())?;
+				for (i,format) in formats.iter().enumerate() {
+					types.at(i)?.set_string(format.mime_type())?;
+				}
+				Ok(())
+			},
+			None => Err(COBIAError::Code(COBIAERR_INVALIDARGUMENT))
 		}
 	}
 
@@ -1538,7 +1762,7 @@ impl cape_open_1_2::ICapeReport for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the operation.
 
     fn report_locales(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locales:&mut CapeArrayStringOut) -> Result<(),COBIAError> {
-		if name.eq_ignore_case(&self.last_run_report_name) {
+		if self.report_formats(name).is_some() {
 			locales.resize(1)?;
 			locales.at(0)?.set_string("en")?;
 			Ok(())
@@ -1560,19 +1784,12 @@ impl cape_open_1_2::ICapeReport for DistillationShortcutUnit {
 	/// * A `Result` containing a `CapeBoolean` indicating whether the report specification is valid (`true`) or not (`false`).
 
     fn check_report_spec(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locale:&CapeStringIn) -> Result<CapeBoolean,COBIAError> {
-		if name.eq_ignore_case(&self.last_run_report_name) {
-			if _type.is_empty() || _type.to_string().to_lowercase()=="text/plain" {
-				if locale.is_empty() || locale.to_string().to_lowercase()=="en" {
-					return Ok(true as CapeBoolean);
-				}				
-			}
-		}
-		Ok(false as CapeBoolean)
+		Ok(self.report_spec(name,_type,locale).is_ok() as CapeBoolean)
     }
 
 	/// Generate a report based on the specified name, type, and locale.
 	///
-	/// This method generates a report based on the last run report name and returns its content.
+	/// This method generates the last run report, the solver statistics report or the case study report, and returns its content.
 	///
 	/// # Arguments:
 	/// * `name` - A reference to a `CapeStringIn` containing the name of the report to generate.
@@ -1584,25 +1801,15 @@ impl cape_open_1_2::ICapeReport for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the report generation process.
 
     fn generate_report(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locale:&CapeStringIn,report_content:&mut CapeStringOut) -> Result<(),COBIAError> {
-        if name.eq_ignore_case(&self.last_run_report_name) {
-			if _type.is_empty() || _type.to_string().to_lowercase()=="text/plain" {
-				if locale.is_empty() || locale.to_string().to_lowercase()=="en" {
-					return report_content.set_string(&self.last_run_report);
-				} else {
-					Err(COBIAError::Message("Invalid/unsupported report locale".into()))
-				}
-			} else {
-				Err(COBIAError::Message("Invalid/unsupported report mime type".into()))
-			}
-		} else {
-			Err(COBIAError::Message("Invalid report name".into()))
-		}
+		let (report,format)=self.report_spec(name,_type,locale)?;
+		let mut content=Vec::new();
+		self.write_report(report,format,&mut content)?;
+		report_content.set_string(String::from_utf8_lossy(&content))
 	}
 
 	/// Generate a report file based on the specified name, type, locale, and file name.
 	///
-	/// This method generates a report and writes it to a file. Implemented as a wrapper
-	/// around the `generate_report` method.
+	/// This method generates a report and streams it to a file.
 	///
 	/// # Arguments:
 	/// * `name` - A reference to a `CapeStringIn` containing the name of the report to generate.
@@ -1614,15 +1821,16 @@ impl cape_open_1_2::ICapeReport for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the file generation process.
 
     fn generate_report_file(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locale:&CapeStringIn,file_name:&CapeStringIn) -> Result<(),COBIAError> {
-		let mut report_text=CapeStringImpl::new();
-		self.generate_report(name,_type,locale,&mut CapeStringOutFromProvider::from(&mut report_text).as_cape_string_out())?;
-		let mut file = match std::fs::File::create(file_name.as_string()) {
+		let (report,format)=self.report_spec(name,_type,locale)?;
+		let file = match std::fs::File::create(file_name.as_string()) {
 			Ok(f) => f,
 			Err(e) => return Err(COBIAError::Message(format!("Error creating file: {}",e))),
 		};
-		match file.write_all(report_text.as_string().as_bytes()) {
+		let mut writer=std::io::BufWriter::new(file);
+		self.write_report(report,format,&mut writer)?;
+		match writer.flush() {
 			Ok(_) => Ok(()),
-			Err(e) => return Err(COBIAError::Message(format!("Error writing to file: {}",e))),
+			Err(e) => Err(COBIAError::Message(format!("Error writing to file: {}",e))),
 		}
     }
 
@@ -1633,7 +1841,7 @@ impl cape_open_1_2::ICapePersist for DistillationShortcutUnit {
     /// Save the state of the unit operation.
 	///
 	/// This method is called by the PME to save the state of the unit operation.
-	/// It saves all modifiable data to the `CapePersistWriter` and optionally clear the dirty flag.
+	/// It saves all modifiable data to the `CapePersistWriter` as a single binary state record, and optionally clears the dirty flag.
 	///
 	/// # Arguments:
 	/// * `writer` - A `CapePersistWriter` used to write the state of the unit operation.
@@ -1643,46 +1851,8 @@ impl cape_open_1_2::ICapePersist for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the save operation.
 
     fn save(&mut self,writer:cape_open_1_2::CapePersistWriter,clear_dirty:CapeBoolean) -> Result<(),COBIAError> {
-		//save the name
-		writer.add_string(&CapeStringImpl::from_string("Name"),&self.shared_unit_data.borrow().name)?;
-		//save the description
-		writer.add_string(&CapeStringImpl::from_string("Description"),&self.description)?;
-		//save all parameter values
-		{
-			let parameter_collection=unsafe{ParameterCollection::borrow_mut(&mut self.parameter_collection)};
-			for parameter in parameter_collection.iter_mut() {
-				//in this example for simplicity we access the parameters through their CAPE-OPEN interface;
-				// this is however not needed, as we can access the parameters directly, which would be more
-				// efficient but perhaps harder to read (and involves unsafe operations)
-				let mut parameter_name=CapeStringImpl::new();
-				let iden=cape_open_1_2::CapeIdentification::from_object(parameter)?;
-				iden.get_component_name(&mut parameter_name)?;
-				let data_type=parameter.get_type().unwrap();
-				match data_type {
-					cape_open_1_2::CapeParamType::CapeParameterReal => {
-						let real_parameter=cape_open_1_2::CapeRealParameter::from_object(parameter)?;
-						let value=real_parameter.get_value()?;
-						writer.add_real(&parameter_name,value)?;
-					},
-                    cape_open_1_2::CapeParamType::CapeParameterInteger => {
-                        let integer_parameter=cape_open_1_2::CapeIntegerParameter::from_object(parameter)?;
-                        let value=integer_parameter.get_value()?;
-                        writer.add_integer(&parameter_name,value)?;
-                    },
-					cape_open_1_2::CapeParamType::CapeParameterString => {
-						let string_parameter=cape_open_1_2::CapeStringParameter::from_object(parameter)?;
-						let mut value=CapeStringImpl::new();
-						string_parameter.get_value(&mut value)?;
-						writer.add_string(&parameter_name,&value)?;
-					},
-					_  => {
-						return Err(COBIAError::Message("Internal error: unexpected data type for parameter".into()));
-					}
-				}
-			}
-		}
-		//save the last run report content
-		writer.add_string(&CapeStringImpl::from_string("LastRunReport"),&CapeStringImpl::from_string(&self.last_run_report))?;
+		//the complete state in a single record
+		writer.add_array_byte(&CapeStringImpl::from_string(Self::STATE_RECORD_NAME),&self.encode_state())?;
 		//clear the dirty flag if requested
 		if clear_dirty != 0 {
 			self.shared_unit_data.borrow_mut().dirty=false;
@@ -1702,58 +1872,51 @@ impl cape_open_1_2::ICapePersist for DistillationShortcutUnit {
 	/// * A `Result` indicating success or failure of the load operation.
 
     fn load(&mut self,reader:cape_open_1_2::CapePersistReader) -> Result<(),COBIAError> {
-		//load the name
-		reader.get_string(&CapeStringImpl::from_string("Name"),&mut self.shared_unit_data.borrow_mut().name)?;
-		//load the description
-		reader.get_string(&CapeStringImpl::from_string("Description"),&mut self.description)?;
-		//make a dictionary of string values, case sensitive
 		let mut value_names=CapeArrayStringVec::new();
 		reader.get_value_names(&mut value_names)?;
-		let mut name_set=HashSet::new();
-		for value_name in value_names.iter() {
-			name_set.insert(value_name.to_string());
-		}
-		//read parameter values
-		// only values that were actually saved are restored, so that new parameter can be added over time
-		// which will (if not saved) retain their default values
-		{
-			let parameter_collection=unsafe{ParameterCollection::borrow_mut(&mut self.parameter_collection)};
-			for parameter in parameter_collection.iter_mut() {
-				//read the parameter values
-				//output parameters cannot be set through the CAPE-OPEN interface; 
-				// we access the parameters directly (through their interface pointer) to set the value
-				let data_type=parameter.get_type().unwrap();
-				match data_type {
-					cape_open_1_2::CapeParamType::CapeParameterReal => {
-						let real_parameter=unsafe { RealParameter::borrow_mut(parameter) };
-						if name_set.contains(&real_parameter.name.to_string()) {
-							//parameter not found in the saved values, skip it; it will keep its default value
-							real_parameter.value=reader.get_real(&real_parameter.name)?;
-						}
-					},
-                    cape_open_1_2::CapeParamType::CapeParameterInteger => {
-                        let integer_parameter=unsafe { IntegerParameter::borrow_mut(parameter) };
-                        if name_set.contains(&integer_parameter.name.to_string()) {
-                            //parameter not found in the saved values, skip it; it will keep its default value
-                            integer_parameter.value=reader.get_integer(&integer_parameter.name)?;
-                        }
-                    },
-					cape_open_1_2::CapeParamType::CapeParameterString => {
-						let string_parameter=unsafe { StringParameter::borrow_mut(parameter) };
-						if name_set.contains(&string_parameter.name.to_string()) {
-							reader.get_string(&string_parameter.name,&mut string_parameter.value)?;
-						}
-					},
-					_  => {
-						return Err(COBIAError::Message("Internal error: unexpected data type for parameter".into()));
-					}
+		let state_record_name=CapeStringImpl::from_string(Self::STATE_RECORD_NAME);
+		if value_names.iter().any(|value_name| *value_name==state_record_name) {
+			//the complete state in a single record
+			let mut state=CapeArrayByteVec::new();
+			reader.get_array_byte(&state_record_name,&mut state)?;
+			self.decode_state(state.as_vec())?;
+		} else {
+			//state saved by an earlier version of the unit operation, as individual values
+			//load the name
+			reader.get_string(&CapeStringImpl::from_string("Name"),&mut self.shared_unit_data.borrow_mut().name)?;
+			//load the description
+			reader.get_string(&CapeStringImpl::from_string("Description"),&mut self.description)?;
+			//make a set of the saved value names, case sensitive
+			let name_set:HashSet<&CapeStringImpl>=value_names.iter().collect();
+			//read parameter values
+			// only values that were actually saved are restored, so that new parameter can be added over time
+			// which will (if not saved) retain their default values
+			//output parameters cannot be set through the CAPE-OPEN interface; 
+			// we access the parameters directly to set the value
+			for parameter in self.persisted_real_parameters() {
+				let real_parameter=unsafe{RealParameter::borrow_mut(parameter)};
+				if name_set.contains(&real_parameter.name) {
+					real_parameter.value=reader.get_real(&real_parameter.name)?;
+				}
+			}
+			for parameter in self.persisted_integer_parameters() {
+				let integer_parameter=unsafe{IntegerParameter::borrow_mut(parameter)};
+				if name_set.contains(&integer_parameter.name) {
+					integer_parameter.value=reader.get_integer(&integer_parameter.name)?;
+				}
+			}
+			for parameter in self.persisted_string_parameters() {
+				let string_parameter=unsafe{StringParameter::borrow_mut(parameter)};
+				if name_set.contains(&string_parameter.name) {
+					reader.get_string(&string_parameter.name,&mut string_parameter.value)?;
 				}
 			}
+			//load the last run report content
+			let mut last_run_report=CapeStringImpl::new();
+			reader.get_string(&CapeStringImpl::from_string("LastRunReport"),&mut last_run_report)?;
+			self.run_log.clear();
+			self.run_log.log(RunEvent::Restored(last_run_report.as_string()));
 		}
-		//load the last run report content
-		let mut last_run_report=CapeStringImpl::new();
-		reader.get_string(&CapeStringImpl::from_string("LastRunReport"),&mut last_run_report)?;
-		self.last_run_report=last_run_report.as_string();
 		//clear the dirty flag if requested
 		self.shared_unit_data.borrow_mut().dirty=false;
 		//ok
@@ -1,4 +1,5 @@
 let statusTimeOutId = null;
+let events = null;
 
 function select_tab(tabName) {
     let tabcontent = document.getElementsByClassName("tabcontent");
@@ -43,31 +44,38 @@ function on_load() {
     update_content();
     update_streams();
     update_status();
+    connect_events();
+}
+
+function connect_events() {
+    //state changes are pushed by the unit; without WebSocket, state is requested after each data entry
+    if (!window.WebSocket) {
+        return;
+    }
+    let socket = new WebSocket("ws://" + window.location.host + "/events");
+    socket.onopen = () => {
+        events = socket;
+    };
+    socket.onmessage = (event) => {
+        const obj = JSON.parse(event.data);
+        if (obj.content) {
+            show_content(obj.content);
+        }
+        //do not overwrite a temporary message
+        if (obj.status && !statusTimeOutId) {
+            show_status(obj.status);
+        }
+    };
+    socket.onclose = () => {
+        events = null;
+    };
 }
 
 function update_content() {
     window.fetch(window.location.origin + "/content").then((response) => {
         if (response.ok) {
             response.text().then((text) => {
-                const obj = JSON.parse(text);
-                let listLightKey = document.getElementById('light_key_compound');
-                let listHeavyKey = document.getElementById('heavy_key_compound');
-                for (var i = 0; i < obj.compound_list.length; i++) {
-                    listLightKey.options[i] = new Option(obj.compound_list[i]);
-                    listHeavyKey.options[i] = new Option(obj.compound_list[i]);
-                }
-                listLightKey.value = obj.light_key_compound;
-                listHeavyKey.value = obj.heavy_key_compound;
-                document.getElementById('unit_name').value = obj.unit_name;
-                document.getElementById('unit_description').value = obj.unit_description;
-                document.getElementById('light_key_compound_recovery').value = obj.light_key_compound_recovery;
-                document.getElementById('heavy_key_compound_recovery').value = obj.heavy_key_compound_recovery;
-                document.getElementById('reflux_ratio_factor').value = obj.reflux_ratio_factor;
-                document.getElementById('maximum_iterations').value = obj.maximum_iterations;
-                document.getElementById('convergence_tolerance').value = obj.convergence_tolerance.toExponential();
-                document.getElementById('number_of_stages').value = obj.number_of_stages;
-                document.getElementById('reflux_ratio').value = obj.reflux_ratio;
-                document.getElementById('feed_stage_location').value = obj.feed_stage_location;
+                show_content(JSON.parse(text));
             });
         } else {
             //try again in 1 second
@@ -76,6 +84,27 @@ function update_content() {
     });
 }
 
+function show_content(obj) {
+    let listLightKey = document.getElementById('light_key_compound');
+    let listHeavyKey = document.getElementById('heavy_key_compound');
+    for (var i = 0; i < obj.compound_list.length; i++) {
+        listLightKey.options[i] = new Option(obj.compound_list[i]);
+        listHeavyKey.options[i] = new Option(obj.compound_list[i]);
+    }
+    listLightKey.value = obj.light_key_compound;
+    listHeavyKey.value = obj.heavy_key_compound;
+    document.getElementById('unit_name').value = obj.unit_name;
+    document.getElementById('unit_description').value = obj.unit_description;
+    document.getElementById('light_key_compound_recovery').value = obj.light_key_compound_recovery;
+    document.getElementById('heavy_key_compound_recovery').value = obj.heavy_key_compound_recovery;
+    document.getElementById('reflux_ratio_factor').value = obj.reflux_ratio_factor;
+    document.getElementById('maximum_iterations').value = obj.maximum_iterations;
+    document.getElementById('convergence_tolerance').value = obj.convergence_tolerance.toExponential();
+    document.getElementById('number_of_stages').value = obj.number_of_stages;
+    document.getElementById('reflux_ratio').value = obj.reflux_ratio;
+    document.getElementById('feed_stage_location').value = obj.feed_stage_location;
+}
+
 function update_streams() {
     window.fetch(window.location.origin + "/streams").then((response) => {
         if (response.ok) {
@@ -94,6 +123,61 @@ function update_streams() {
     });
 }
 
+function evaluate_case_study() {
+    let button = document.getElementById('evaluate_case_study');
+    let progress = document.getElementById('case_study_progress');
+    button.disabled = true;
+    progress.value = 0;
+    //the case study is evaluated on a worker thread, which reports progress as server-sent events
+    let source = window.EventSource ? new EventSource("/progress") : null;
+    if (source) {
+        source.addEventListener("case_study", (event) => {
+            progress.value = JSON.parse(event.data).value;
+        });
+    }
+    //comma separated values for each specification; empty for the default values around the current specification
+    const grid = {};
+    for (const key of ["light_key_compound_recoveries", "heavy_key_compound_recoveries", "reflux_ratio_factors"]) {
+        grid[key] = document.getElementById('case_study_' + key).value;
+    }
+    window.fetch(window.location.origin + "/case_study", {
+        method: 'POST',
+        headers: {
+            'Content-Type': 'application/json'
+        },
+        body: JSON.stringify(grid)
+    }).then((response) => {
+        if (response.ok) {
+            response.json().then(show_case_study,
+                (reason) => {
+                    temporary_message("Error parsing response: " + reason);
+                }
+            );
+        } else {
+            response.text().then(temporary_message);
+        }
+    }).finally(() => {
+        if (source) {
+            source.close();
+        }
+        button.disabled = false;
+    });
+}
+
+function show_case_study(points) {
+    const number = (value, digits) => (value === null ? "" : value.toFixed(digits));
+    let tableContent = "<tr><td class=\"streamheader\">LK recovery</td><td class=\"streamheader\">HK recovery</td><td class=\"streamheader\">Reflux ratio factor</td>"
+        + "<td class=\"streamheader\">Min. stages</td><td class=\"streamheader\">Min. reflux ratio</td><td class=\"streamheader\">Reflux ratio</td>"
+        + "<td class=\"streamheader\">Stages</td><td class=\"streamheader\">Feed stage</td><td class=\"streamheader\">Error</td></tr>\n";
+    for (const point of points) {
+        tableContent += `<tr><td>${number(point.lightKeyRecovery, 4)}</td><td>${number(point.heavyKeyRecovery, 4)}</td><td>${number(point.refluxRatioFactor, 3)}</td>`
+            + `<td>${number(point.minNumberOfStages, 2)}</td><td>${number(point.minRefluxRatio, 3)}</td><td>${number(point.refluxRatio, 3)}</td>`
+            + `<td>${number(point.numberOfStages, 2)}</td><td>${number(point.feedStageLocation, 2)}</td><td>${point.error ?? ""}</td></tr>\n`;
+    }
+    document.getElementById('casestudytable').innerHTML = tableContent;
+    document.getElementById('case_study_progress').value = 1;
+}
+
 function temporary_message(message) {
     if (statusTimeOutId) {
         window.clearTimeout(statusTimeOutId);
@@ -110,11 +194,7 @@ function update_status() {
     window.fetch(window.location.origin + "/status").then((response) => {
         if (response.ok) {
             response.text().then((text) => {
-                const obj = JSON.parse(text);
-                let status = document.getElementById('statusbar');
-                status.innerHTML = obj.text;
-                status.style.color = obj.error ? "red" : "green";
-                status.style.backgroundColor = "#f1f1f1";
+                show_status(JSON.parse(text));
             });
             statusTimeOutId = null;
         } else {
@@ -124,6 +204,13 @@ function update_status() {
     });
 }
 
+function show_status(obj) {
+    let status = document.getElementById('statusbar');
+    status.innerHTML = obj.text;
+    status.style.color = obj.error ? "red" : "green";
+    status.style.backgroundColor = "#f1f1f1";
+}
+
 function data_entry(controlId) {
     const obj = {};
     obj.value = document.getElementById(controlId).value;
@@ -149,7 +236,9 @@ function data_entry(controlId) {
         } else {
             temporary_message(response.error);
         }
-        update_content();
-        update_status();
+        if (!events) {
+            update_content();
+            update_status();
+        }
     });
 }
@@ -1,19 +1,51 @@
-﻿use html_dialog::{HtmlDialogHandler,HtmlDialogResourceType,HtmlDialog,Window};
+﻿use html_dialog::{HtmlDialogHandler,HtmlDialogResourceType,HtmlDialog,Window,DialogPushSender,DialogTask,JsonWriter,parse_borrowed};
+use html_dialog::{ProgressRecord,ProgressSender,progress_channel};
 use cobia::*;
 use cobia::prelude::*;
+use std::sync::{Arc,Mutex};
 use super::distillation_shortcut_unit::DistillationShortcutUnit;
+use super::case_study::{CaseStudy,CaseStudyGrid,CaseStudySnapshot,CaseStudyPoint};
+
+//number of progress records sent while the case study is evaluated
+const CASE_STUDY_PROGRESS_STEPS : usize = 20;
+
+//static assets, precompressed by the build script
+mod assets {
+    include!(concat!(env!("OUT_DIR"), "/gui_assets.rs"));
+}
+
+//the progress sender, lent to the case study task; it is returned to the dialog handler
+//when the task ends, also if the task fails, so that the next case study can report progress
+struct ProgressLease {
+    sender : Option<ProgressSender>,
+    returned : Arc<Mutex<Option<ProgressSender>>>,
+}
+
+impl Drop for ProgressLease {
+    fn drop(&mut self) {
+        *self.returned.lock().unwrap_or_else(|e| e.into_inner())=self.sender.take();
+    }
+}
 
 pub(crate) enum UnitDialogEvent {
     GetContent,
     GetStatus,
     DataEntry,
     Streams,
+    Events,
+    CaseStudy,
 }
 
 pub(crate) struct UnitDialogHandler<'a > {
-    data : json::JsonValue,
+    compound_list : Vec<String>,
 	unit: &'a mut DistillationShortcutUnit,
-    modified : bool
+    modified : bool,
+    push : Option<DialogPushSender>,
+    //case study progress; the sender is moved to the running case study task, and returned when it ends
+    progress : Option<ProgressSender>,
+    returned_progress : Arc<Mutex<Option<ProgressSender>>>,
+    //case study results of a task, to be kept by the unit
+    case_study_results : Arc<Mutex<Option<(CaseStudySnapshot,Vec<CaseStudyPoint>)>>>,
 }
 
 impl<'a> UnitDialogHandler<'a> {
@@ -29,35 +61,32 @@ impl<'a> UnitDialogHandler<'a> {
         if !heavy_key.is_empty() && !comps.contains(&heavy_key) {
             comps.push(heavy_key.clone());
         }
-        let data = json::object!{
-            unit_name: unit.get_name(),
-            compound_list: comps,
-            unit_description: unit.get_description(),
-            light_key_compound: light_key,
-            heavy_key_compound: heavy_key,
-            light_key_compound_recovery: unit.get_light_key_compound_recovery(),
-            heavy_key_compound_recovery: unit.get_heavy_key_compound_recovery(),
-            reflux_ratio_factor: unit.get_reflux_ratio_factor(),
-            maximum_iterations: unit.get_maximum_iterations(),
-            convergence_tolerance: unit.get_convergence_tolerance(),
-            number_of_stages: unit.get_number_of_stages(),
-            reflux_ratio: unit.get_reflux_ratio(),
-            feed_stage_location: unit.get_feed_stage_location(),
-        };
+        let (progress,progress_stream)=progress_channel(64);
         let handler=UnitDialogHandler {
-            data,
+            compound_list: comps,
             unit,
-            modified: false
+            modified: false,
+            push: None,
+            progress: Some(progress),
+            returned_progress: Arc::new(Mutex::new(None)),
+            case_study_results: Arc::new(Mutex::new(None)),
         };
         let mut dlg=HtmlDialog::<UnitDialogHandler,UnitDialogEvent>::new(handler);
-        dlg.add("/".into(),HtmlDialogResourceType::Content((include_bytes!("gui.html"),"text/html")));
-        dlg.add("/gui.css".into(),HtmlDialogResourceType::Content((include_bytes!("gui.css"),"text/css")));
-        dlg.add("/gui.js".into(),HtmlDialogResourceType::Content((include_bytes!("gui.js"),"text/javascript")));
-        dlg.add("/gui.png".into(),HtmlDialogResourceType::Content((include_bytes!("gui.png"),"image/png")));
+        dlg.add("/".into(),HtmlDialogResourceType::Asset(&assets::GUI_HTML));
+        dlg.add("/gui.css".into(),HtmlDialogResourceType::Asset(&assets::GUI_CSS));
+        dlg.add("/gui.js".into(),HtmlDialogResourceType::Asset(&assets::GUI_JS));
+        dlg.add("/gui.png".into(),HtmlDialogResourceType::Asset(&assets::GUI_PNG));
         dlg.add("/content".into(),HtmlDialogResourceType::Info(UnitDialogEvent::GetContent));
         dlg.add("/streams".into(),HtmlDialogResourceType::Info(UnitDialogEvent::Streams));
         dlg.add("/status".into(),HtmlDialogResourceType::Info(UnitDialogEvent::GetStatus));
         dlg.add("/data_entry".into(),HtmlDialogResourceType::Info(UnitDialogEvent::DataEntry));
+        dlg.add("/events".into(),HtmlDialogResourceType::WebSocket(UnitDialogEvent::Events));
+        //the case study runs on a worker thread, and reports its progress over the /progress event stream
+        dlg.add("/case_study".into(),HtmlDialogResourceType::Task(UnitDialogEvent::CaseStudy));
+        dlg.add("/progress".into(),HtmlDialogResourceType::EventStream(progress_stream));
+        //state changes are pushed to the page over the /events WebSocket
+        let push=dlg.push_sender();
+        dlg.get_handler().push=Some(push);
         #[cfg(target_os = "windows")] let parent= Some((parent as *mut core::ffi::c_void).into());
         dlg.set_parent(parent,true);
         dlg
@@ -67,6 +96,106 @@ impl<'a> UnitDialogHandler<'a> {
         self.modified
     }
 
+    //write the JSON content of a response
+    fn json_content(write: impl FnOnce(&mut JsonWriter)) -> (Vec<u8>,String) {
+        let mut content=Vec::new();
+        write(&mut JsonWriter::new(&mut content));
+        (content,"application/json".to_string())
+    }
+
+    fn write_content(&self, writer: &mut JsonWriter) {
+        writer.begin_object()
+            .key("unit_name").string(&self.unit.get_name())
+            .key("compound_list").begin_array();
+        for comp in &self.compound_list {
+            writer.string(comp);
+        }
+        writer.end_array()
+            .key("unit_description").string(&self.unit.get_description())
+            .key("light_key_compound").string(&self.unit.get_light_key_compound())
+            .key("heavy_key_compound").string(&self.unit.get_heavy_key_compound())
+            .key("light_key_compound_recovery").number(self.unit.get_light_key_compound_recovery())
+            .key("heavy_key_compound_recovery").number(self.unit.get_heavy_key_compound_recovery())
+            .key("reflux_ratio_factor").number(self.unit.get_reflux_ratio_factor())
+            .key("maximum_iterations").integer(self.unit.get_maximum_iterations() as i64)
+            .key("convergence_tolerance").number(self.unit.get_convergence_tolerance())
+            .key("number_of_stages").number(self.unit.get_number_of_stages())
+            .key("reflux_ratio").number(self.unit.get_reflux_ratio())
+            .key("feed_stage_location").number(self.unit.get_feed_stage_location())
+            .end_object();
+    }
+
+    fn write_status(&mut self, writer: &mut JsonWriter) {
+        match self.unit.validate_internal() {
+            Ok(()) => {
+                writer.begin_object()
+                    .key("text").string("Specification is complete")
+                    .key("error").boolean(false)
+                    .end_object();
+            },
+            Err(e) => {
+                writer.begin_object()
+                    .key("text").string(&Self::short_error(e))
+                    .key("error").boolean(true)
+                    .end_object();
+            }
+        }
+    }
+
+    fn write_state(&mut self, writer: &mut JsonWriter) {
+        writer.begin_object().key("content");
+        self.write_content(writer);
+        writer.key("status");
+        self.write_status(writer);
+        writer.end_object();
+    }
+
+    //keep the results of the last case study task on the unit, so that the case study report does not evaluate them again,
+    //and take back the progress sender from a case study task that has ended
+    pub fn store_case_study_results(&mut self) {
+        let results=self.case_study_results.lock().unwrap_or_else(|e| e.into_inner()).take();
+        if let Some((snapshot,points))=results {
+            self.unit.store_case_study_results(snapshot,points);
+        }
+        if self.progress.is_none() {
+            self.progress=self.returned_progress.lock().unwrap_or_else(|e| e.into_inner()).take();
+        }
+    }
+
+    //the case study grid posted by the page; an empty list of values selects the default values around the current specification
+    fn case_study_grid(&self, content: Option<&str>) -> Result<Option<CaseStudyGrid>, Box<dyn std::error::Error>> {
+        let content=match content {
+            Some(content) if !content.trim().is_empty() => content,
+            _ => return Ok(None),
+        };
+        let data=parse_borrowed(content)?;
+        let values=|key: &str| -> Result<Vec<f64>, Box<dyn std::error::Error>> {
+            let text=data.get(key).and_then(|v| v.as_str()).unwrap_or("");
+            let mut values=Vec::new();
+            for value in text.split(|c: char| c==',' || c==';' || c.is_whitespace()).filter(|v| !v.is_empty()) {
+                values.push(value.parse::<f64>().map_err(|_| format!("Invalid numeric value: {}", value))?);
+            }
+            Ok(values)
+        };
+        let light_key_compound_recoveries=values("light_key_compound_recoveries")?;
+        let heavy_key_compound_recoveries=values("heavy_key_compound_recoveries")?;
+        let reflux_ratio_factors=values("reflux_ratio_factors")?;
+        if light_key_compound_recoveries.is_empty() && heavy_key_compound_recoveries.is_empty() && reflux_ratio_factors.is_empty() {
+            return Ok(None);
+        }
+        let mut grid=self.unit.default_case_study_grid();
+        if !light_key_compound_recoveries.is_empty() {
+            grid.light_key_compound_recoveries=light_key_compound_recoveries;
+        }
+        if !heavy_key_compound_recoveries.is_empty() {
+            grid.heavy_key_compound_recoveries=heavy_key_compound_recoveries;
+        }
+        if !reflux_ratio_factors.is_empty() {
+            grid.reflux_ratio_factors=reflux_ratio_factors;
+        }
+        Ok(Some(grid))
+    }
+
     pub fn short_error(e: COBIAError) -> String {
         match e {
             COBIAError::Message(msg) => msg,
@@ -84,35 +213,28 @@ impl<'a> UnitDialogHandler<'a> {
 }
 
 impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
-    fn provide_content(&mut self, event: &UnitDialogEvent, content: Option<String>, _dialog_window : Option<Window>) -> Result<(Vec<u8>,String), Box<dyn std::error::Error>> {
+    fn provide_content(&mut self, event: &UnitDialogEvent, content: Option<&str>, _dialog_window : Option<Window>) -> Result<(Vec<u8>,String), Box<dyn std::error::Error>> {
+        self.store_case_study_results();
         match event {
             UnitDialogEvent::GetContent => {
-                Ok((json::stringify(self.data.clone()).into_bytes(),"application/json".to_string()))
+                Ok(Self::json_content(|writer| self.write_content(writer)))
             },
             UnitDialogEvent::GetStatus => {
                 //current status
-                let status=match self.unit.validate_internal() {
-                    Ok(()) => {
-                        json::object!{
-                            text: "Specification is complete",
-                            error: false,
-                        }
-                    },
-                    Err(e) => {
-                        json::object!{
-                            text: Self::short_error(e),
-                            error: true,
-                        }
-                    }
-                };
-                Ok((json::stringify(status).into_bytes(),"application/json".to_string()))
+                Ok(Self::json_content(|writer| self.write_status(writer)))
+            },
+            UnitDialogEvent::Events => {
+                //any message from the page requests the current state
+                Ok(Self::json_content(|writer| self.write_state(writer)))
+            },
+            UnitDialogEvent::CaseStudy => {
+                Err("The case study is evaluated by a task".into())
             },
             UnitDialogEvent::Streams => {
                 //fill the streams table
                 let ports=self.unit.get_ports();
                 //port name and connected objects
                 let mut streams=Vec::<Option<cape_open_1_2::CapeThermoMaterial>>::with_capacity(3);
-                let mut port_info=Vec::<Vec::<String>>::new();
                 for port in ports {
                     //get stream
                     if let Ok(stream)=port.get_connected_object() {
@@ -124,10 +246,12 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                         streams.push(None);
                     }
                 }
+                let mut content=Vec::new();
+                let mut writer=JsonWriter::new(&mut content);
+                writer.begin_object().key("table").begin_array();
                 //stream connections
-                let mut stream_names=Vec::<String>::with_capacity(4);
                 let mut any=false;
-                stream_names.push("Stream".into());
+                writer.begin_array().string("Stream");
                 for stream in &streams {
                     if let Some(stream) = stream {
                         //get stream name
@@ -139,62 +263,60 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                 name=stream_name.to_string();
                             }
                         }
-                        stream_names.push(name);
+                        writer.string(&name);
                     } else {
-                        stream_names.push("<Not connected>".into());
+                        writer.string("<Not connected>");
                     }
                 }
-                port_info.push(stream_names);
+                writer.end_array();
                 if any {
                     let mut values=cobia::CapeArrayRealVec::new();
                     let str_no_basis=cobia::CapeStringImpl::new();
                     let str_mass_basis=cobia::CapeStringImpl::from("mass");
                     //stream temperature
-                    let mut stream_temperature=Vec::<String>::with_capacity(4);
-                    stream_temperature.push("Temperature / [°C]".into());
+                    writer.begin_array().string("Temperature / [°C]");
                     let str_temperature=cobia::CapeStringImpl::from("temperature");
                     for stream in &streams {
                         if let Some(stream) = stream {
                             match stream.get_overall_prop(&str_temperature,&str_no_basis,&mut values) {
                                 Ok(()) => {
                                     if values.size()==1 {
-                                        stream_temperature.push(format!("{:.2}", values[0]-273.15));
+                                        writer.string_fmt(format_args!("{:.2}", values[0]-273.15));
                                     } else {
-                                        stream_temperature.push("N/A".into());
+                                        writer.string("N/A");
                                     }
                                 },
                                 Err(_) => {
-                                    stream_temperature.push("N/A".into());
+                                    writer.string("N/A");
                                 }
                             }
                         } else {
-                            stream_temperature.push(String::new());
+                            writer.string("");
                         }
                     }
-                    port_info.push(stream_temperature);
+                    writer.end_array();
                     //stream pressure
-                    let mut stream_pressure=Vec::<String>::with_capacity(4);
-                    stream_pressure.push("Pressure / [bar]".into());
+                    writer.begin_array().string("Pressure / [bar]");
                     let str_pressure=cobia::CapeStringImpl::from("pressure");
                     for stream in &streams {
                         if let Some(stream) = stream {
                             match stream.get_overall_prop(&str_pressure,&str_no_basis,&mut values) {
                                 Ok(()) => {
                                     if values.size()==1 {
-                                        stream_pressure.push(format!("{:.3}", values[0]*1e-5));
+                                        writer.string_fmt(format_args!("{:.3}", values[0]*1e-5));
                                     } else {
-                                        stream_pressure.push("N/A".into());
+                                        writer.string("N/A");
                                     }
                                 },
                                 Err(_) => {
-                                    stream_pressure.push("N/A".into());
+                                    writer.string("N/A");
                                 }
                             }
                         } else {
-                            stream_pressure.push(String::new());
+                            writer.string("");
                         }
                     }
-                    port_info.push(stream_pressure);
+                    writer.end_array();
                     //component flows and recoveries
                     let comp_list=self.unit.get_compound_list();
                     let str_flow=cobia::CapeStringImpl::from("flow");
@@ -213,73 +335,68 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                         }
                         //iterate over compounds by index
                         comp_list.iter().enumerate().for_each(|(i,comp)| {
-                            let mut stream_comp=Vec::<String>::with_capacity(4);
-                            stream_comp.push("F[".to_string()+comp+"] / [kg/s]");
-                            stream_comp.push(format!("{:.3}", feed_rates[i]));
+                            writer.begin_array();
+                            writer.string_fmt(format_args!("F[{}] / [kg/s]", comp));
+                            writer.string_fmt(format_args!("{:.3}", feed_rates[i]));
                             if distillate_rates.size()==comp_list.len() {
                                 if distillate_rates[i]<=0.0 {
-                                    stream_comp.push("0".into());
+                                    writer.string("0");
                                 } else {
-                                    stream_comp.push(format!("{:.3} ({:.2}%)", distillate_rates[i],100.0*distillate_rates[i]/feed_rates[i]));
+                                    writer.string_fmt(format_args!("{:.3} ({:.2}%)", distillate_rates[i],100.0*distillate_rates[i]/feed_rates[i]));
                                 }
                             } else {
-                                stream_comp.push(String::new());
+                                writer.string("");
                             }
                             if bottoms_rates.size()==comp_list.len() {
                                 if bottoms_rates[i]<=0.0 {
-                                    stream_comp.push("0".into());
+                                    writer.string("0");
                                 } else {
-                                    stream_comp.push(format!("{:.3} ({:.2}%)", bottoms_rates[i],100.0*bottoms_rates[i]/feed_rates[i]));
+                                    writer.string_fmt(format_args!("{:.3} ({:.2}%)", bottoms_rates[i],100.0*bottoms_rates[i]/feed_rates[i]));
                                 }
                             } else {
-                                stream_comp.push(String::new());
+                                writer.string("");
                             }
-                            port_info.push(stream_comp);
+                            writer.end_array();
                         });
                     }
                 }
-                let port_info=json::object!{
-                    table:port_info
-                };
-                Ok((json::stringify(port_info).into_bytes(),"application/json".to_string()))
+                writer.end_array().end_object();
+                Ok((content,"application/json".to_string()))
             },
             UnitDialogEvent::DataEntry => {
                 let mut error_text=String::new();
                 if let Some(content) = content {
-                    match json::parse(&content) {
+                    match parse_borrowed(content) {
                         Ok(data) => {
-                            let value=data["value"].as_str().unwrap_or("");
-                            let control_id=data["controlId"].as_str().unwrap_or("");
+                            let value=data.get("value").and_then(|v| v.as_str()).unwrap_or("");
+                            let control_id=data.get("controlId").and_then(|v| v.as_str()).unwrap_or("");
                             match control_id {
                                 "unit_name" => {
                                     let new_name:String=value.into();
                                     if new_name.is_empty() {
                                         error_text="Unit name cannot be empty".into();
                                     } else {
-                                        if new_name!=self.data["unit_name"] {
+                                        if new_name!=self.unit.get_name() {
                                             self.unit.set_name(&new_name);
-                                            self.data["unit_name"]=new_name.into();
                                             self.modified=true;
                                         }
                                     }
                                 },
                                 "unit_description" => {
                                     let new_desc:String=value.into();
-                                    if new_desc!=self.data["unit_description"] {
+                                    if new_desc!=self.unit.get_description() {
                                         self.unit.set_description(&new_desc);
-                                        self.data["unit_description"]=new_desc.into();
                                         self.modified=true;
                                     }
                                 },
                                 "light_key_compound" => {
                                     let new_comp:String=value.into();
-                                    if new_comp!=self.data["light_key_compound"] {
+                                    if new_comp!=self.unit.get_light_key_compound() {
                                         if !self.unit.get_compound_list().contains(&new_comp) {
                                             error_text=format!("Compound {} is not defined", new_comp);
                                         } else {
                                             match self.unit.set_light_key_compound(&new_comp) {
                                                 Ok(()) => {
-                                                    self.data["light_key_compound"]=new_comp.into();
                                                     self.modified=true;
                                                 },
                                                 Err(e) => {
@@ -291,13 +408,12 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                 },
                                  "heavy_key_compound" => {
                                     let new_comp:String=value.into();
-                                    if new_comp!=self.data["heavy_key_compound"] {
+                                    if new_comp!=self.unit.get_heavy_key_compound() {
                                         if !self.unit.get_compound_list().contains(&new_comp) {
                                             error_text=format!("Compound {} is not defined", new_comp);
                                         } else {
                                             match self.unit.set_heavy_key_compound(&new_comp) {
                                                 Ok(()) => {
-                                                    self.data["heavy_key_compound"]=new_comp.into();
                                                     self.modified=true;
                                                 },
                                                 Err(e) => {
@@ -313,7 +429,6 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                             if value!=self.unit.get_maximum_iterations() {
                                                 match self.unit.set_maximum_iterations(value) {
                                                     Ok(()) => {
-                                                        self.data["maximum_iterations"]=value.into();
                                                         self.modified=true;
                                                     },
                                                     Err(e) => {
@@ -336,7 +451,6 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                                     if value!=self.unit.get_light_key_compound_recovery() {
                                                         match self.unit.set_light_key_compound_recovery(value) {
                                                             Ok(()) => {
-                                                                    self.data["light_key_compound_recovery"]=value.into();
                                                                     self.modified=true;
                                                                 },
                                                             Err(e) => {
@@ -350,7 +464,6 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                                     if value!=self.unit.get_heavy_key_compound_recovery() {
                                                         match self.unit.set_heavy_key_compound_recovery(value) {
                                                             Ok(()) => {
-                                                                    self.data["heavy_key_compound_recovery"]=value.into();
                                                                     self.modified=true;
                                                                 },
                                                             Err(e) => {
@@ -363,7 +476,6 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                                     if value!=self.unit.get_reflux_ratio_factor() {
                                                         match self.unit.set_reflux_ratio_factor(value) {
                                                             Ok(()) => {
-                                                                    self.data["reflux_ratio_factor"]=value.into();
                                                                     self.modified=true;
                                                                 },
                                                             Err(e) => {
@@ -376,7 +488,6 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                                                     if value!=self.unit.get_convergence_tolerance() {
                                                         match self.unit.set_convergence_tolerance(value) {
                                                             Ok(()) => {
-                                                                    self.data["convergence_tolerance"]=value.into();
                                                                     self.modified=true;
                                                                 },
                                                             Err(e) => {
@@ -405,13 +516,57 @@ impl<'a> HtmlDialogHandler<UnitDialogEvent> for UnitDialogHandler<'a> {
                     error_text="Missing POST data".into();
                 }
                 let is_error=!error_text.is_empty();
-                let response_json=json::object!{
-                    error_text: error_text,
-                    error: is_error,
+                //push the new state to the page
+                if let Some(push)=self.push.clone() {
+                    let (state,_)=Self::json_content(|writer| self.write_state(writer));
+                    push.push(String::from_utf8(state)?);
+                }
+                Ok(Self::json_content(|writer| {
+                    writer.begin_object()
+                        .key("error_text").string(&error_text)
+                        .key("error").boolean(is_error)
+                        .end_object();
+                }))
+            },
+        }
+    }
+
+    fn start_task(&mut self, event: &UnitDialogEvent, content: Option<&str>) -> Result<DialogTask, Box<dyn std::error::Error>> {
+        self.store_case_study_results();
+        match event {
+            UnitDialogEvent::CaseStudy => {
+                if self.progress.is_none() {
+                    return Err("A case study is already being evaluated".into());
+                }
+                let grid=self.case_study_grid(content)?;
+                self.unit.set_case_study_grid(grid);
+                //the task evaluates a copy of the column data, so that it does not access the unit
+                let snapshot=self.unit.case_study_snapshot().map_err(Self::short_error)?;
+                let mut progress=ProgressLease {
+                    sender: self.progress.take(),
+                    returned: self.returned_progress.clone(),
                 };
-                Ok((json::stringify(response_json).into_bytes(),"application/json".to_string()))
+                let results=self.case_study_results.clone();
+                Ok(Box::new(move || -> Result<(Vec<u8>,String),Box<dyn std::error::Error+Send+Sync>> {
+                    let progress=progress.sender.as_mut().unwrap();
+                    let data=&snapshot.data;
+                    let mut points=snapshot.grid.points();
+                    let count=points.len();
+                    let mut evaluated=0;
+                    progress.send(ProgressRecord{event:"case_study",label:"Case study",iteration:0,value:0.0});
+                    for block in points.chunks_mut(usize::max(1,count.div_ceil(CASE_STUDY_PROGRESS_STEPS))) {
+                        data.evaluate_points(block);
+                        evaluated+=block.len();
+                        progress.send(ProgressRecord{event:"case_study",label:"Case study",iteration:evaluated as u32,value:evaluated as f64/count as f64});
+                    }
+                    let mut content=Vec::new();
+                    CaseStudy::write_json(&points,&mut content)?;
+                    //the unit keeps the results when the dialog handles its next request
+                    *results.lock().unwrap_or_else(|e| e.into_inner())=Some((snapshot,points));
+                    Ok((content,"application/json".to_string()))
+                }))
             },
+            _ => Err("Not a task".into()),
         }
     }
 }
-
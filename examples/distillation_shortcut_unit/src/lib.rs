@@ -192,6 +192,10 @@
 //! is the enthalpy of the liquid phase at the bubble point temperature
 //! of the feed.
 //!
+//! The root is found by Newton-Raphson iteration, using the analytical
+//! derivative of the Underwood equation; the iteration is safeguarded by
+//! bisection so that the root remains bracketed.
+//!
 //! There are multiple roots for <math><ms>&theta;</ms></math>, and the
 //! root that is used is between 1 and <math><msub><ms>&alpha;</ms><mtext>LK</mtext></msub></math>.
 //! In case there are &alpha; values that are in between 1 and
@@ -326,6 +330,9 @@
 //! * <math><ms>k</ms></math>, factor of reflux ratio <math><ms>R</ms></math> above minimum reflux ratio <math><msub><ms>R</ms><mtext>min</mtext></msub></math>.
 //! * the maximum number of iterations
 //! * the convergence tolerance for the component flow rates relative to the total feed rate; also used for convergence of the Underwood equation
+//! * whether to skip the calculation if none of the inputs have changed since the last successful calculation
+//! * whether the calculation is recorded for the calculation report
+//! * whether the product flashes may run concurrently
 //!
 //! The unit has the following output parameters:
 //! 
@@ -333,6 +340,72 @@
 //! * <math><ms>R</ms></math>, reflux ratio, mol/mol
 //! * <math><msub><ms>N</ms><mtext>feed</mtext></msub></math>, feed stage location.
 //!
+//! # Incremental calculation
+//!
+//! PMEs frequently calculate a unit operation of which the inputs have not changed, for
+//! example while sequencing a flowsheet. Upon a successful calculation, the unit stores
+//! a fingerprint of its inputs (feed flow rates, temperature and pressure, input parameter values
+//! and the identity tokens of the connected material objects) together with the resulting
+//! product states. If the fingerprint matches at the next calculation, the stored product
+//! states are put on the product material objects without repeating the calculation. The
+//! compound and phase lists in the tokens are obtained again at each calculation, so that a
+//! property package that the PME swapped or reconfigured behind a connected material object
+//! leads to re-validation and a new calculation.
+//!
+//! Similarly, the outcome of port validation is kept together with an identity token per port:
+//! the address of the connected material object and a hash of its compound and phase lists.
+//! The lists are obtained at each validation; the consistency checks of the ports are only
+//! repeated if a token changed, or if a port was connected or disconnected since.
+//!
+//! # Concurrent product flashes
+//!
+//! In each Fenske iteration, the distillate dew point and the bottoms bubble point are
+//! calculated on independent material objects. If the "Concurrent flashes" parameter is set,
+//! the bottoms flash runs on a worker thread while the distillate flash runs on the calling thread.
+//!
+//! CAPE-OPEN objects may in general only be used on the thread on which they were obtained,
+//! and neither CAPE-OPEN nor COBIA offers a means to detect whether the material objects of a
+//! PME are free-threaded. The parameter must therefore only be set if the simulation environment
+//! documents that its material objects, and the property package behind them, may be used from
+//! any thread. Only the bottoms material object is passed to the worker thread; the worker creates
+//! its own strings and arrays, and does not access the unit operation. The wall time spent in the
+//! product flashes is reported.
+//!
+//! # Case study
+//!
+//! The "Case Study" report evaluates the shortcut method over a grid of light key recovery,
+//! heavy key recovery and reflux ratio factor values, and lists the minimum number of stages,
+//! minimum reflux ratio, reflux ratio, number of stages and feed stage location for each point.
+//! The report is available as comma separated values (`text/csv`) and as JSON (`application/json`).
+//!
+//! The relative volatilities and the Underwood root of the last successful calculation are
+//! used for all points, so that no further property or equilibrium calculations are needed;
+//! at constant relative volatility the Fenske distribution is explicit. The points are
+//! distributed over all available cores. Unless set otherwise, the grid spans the
+//! recoveries from their current specification to 0.999, and the reflux ratio factor
+//! from 1.05 to twice its current specification.
+//!
+//! # Reports
+//!
+//! The "Calculation Report" is recorded as a log of typed events during calculation,
+//! and is only formatted when the report is requested, as text (`text/plain`),
+//! JSON (`application/json`) or CSV (`text/csv`). Reports are streamed directly when written
+//! to file. If the calculation report is disabled, only warnings are recorded.
+//!
+//! The "Performance" report shows the accumulated time per calculation phase, and the number
+//! of calls and time spent per CAPE-OPEN method of the connected material objects, so that time
+//! spent in the property package can be told apart from time spent in the unit operation itself.
+//! Calls that overlap in time, as with concurrent product flashes, are timed individually per
+//! method, but count once towards the wall time spent in CAPE-OPEN calls. The report is rendered
+//! from `performance_snapshot`, which is also available programmatically.
+//!
+//! # Persistence
+//!
+//! The unit saves its name, description, parameter values and last run report as a single
+//! versioned binary record, which requires a single call to the persistence writer and reader.
+//! The individual values, named after the parameters, that were saved by earlier versions are
+//! recognized upon load.
+//!
 //! # Installation and usage
 //!
 //! `cobiaRegister.exe distillation_shortcut_unit.dll`
@@ -353,6 +426,15 @@ mod parameter_collection;
 mod real_parameter;
 mod string_parameter;
 mod integer_parameter;
+mod solver_telemetry;
+mod calculation_cache;
+mod validation_cache;
+mod case_study;
+mod persisted_state;
+mod run_log;
+mod report_format;
+mod saturation_flash;
+mod performance;
 mod gui;
 
 /// This function is called by functions generated by the `pmc_entry_points`
@@ -181,7 +181,9 @@ impl cape_open_1_2::ICapeUnitPort for MaterialPort {
 		match material_object {
 			Ok(material_object) => {
 					self.connected_object=Some(material_object);
-					self.shared_unit_data.borrow_mut().validation_status = cape_open_1_2::CapeValidationStatus::CapeNotValidated;
+					let mut shared_unit_data=self.shared_unit_data.borrow_mut();
+					shared_unit_data.validation_status = cape_open_1_2::CapeValidationStatus::CapeNotValidated;
+					shared_unit_data.port_connections+=1;
 					Ok(())
 				},
 			Err(e) => Err(e),
@@ -195,7 +197,9 @@ impl cape_open_1_2::ICapeUnitPort for MaterialPort {
 
     fn disconnect(&mut self) -> Result<(),COBIAError> {
         self.connected_object=None;
-		self.shared_unit_data.borrow_mut().validation_status = cape_open_1_2::CapeValidationStatus::CapeNotValidated;
+		let mut shared_unit_data=self.shared_unit_data.borrow_mut();
+		shared_unit_data.validation_status = cape_open_1_2::CapeValidationStatus::CapeNotValidated;
+		shared_unit_data.port_connections+=1;
 		Ok(())
     }
 }
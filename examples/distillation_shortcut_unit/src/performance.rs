@@ -0,0 +1,513 @@
+use std::io::Write;
+use std::rc::Rc;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicU32,AtomicU64,Ordering};
+use std::time::{Duration,Instant};
+
+/// The phases of the calculation for which time is recorded.
+///
+/// Phases are hierarchical; the time of a phase includes the time of its child phases.
+/// A phase that is left by an error is accounted for up to the point of the error.
+
+#[derive(Clone,Copy,PartialEq)]
+pub(crate) enum Phase {
+	/// The complete calculation
+	Calculate,
+	/// Validation prior to calculation
+	Validate,
+	/// Enthalpy of the feed
+	FeedEnthalpy,
+	/// Dew and bubble point of the feed
+	FeedSaturation,
+	/// Fenske iterations
+	Fenske,
+	/// Product flashes in the Fenske iterations
+	ProductFlashes,
+	/// Underwood calculation
+	Underwood,
+	/// Gilliland and Kirkbride calculations
+	GillilandKirkbride,
+	/// Storing or applying cached product states
+	ProductStates,
+}
+
+impl Phase {
+
+	/// All phases, parents before children
+	pub const ALL : [Phase;9] = [Phase::Calculate,Phase::Validate,Phase::FeedEnthalpy,Phase::FeedSaturation,Phase::Fenske,Phase::ProductFlashes,Phase::Underwood,Phase::GillilandKirkbride,Phase::ProductStates];
+
+	/// The name of the phase
+	pub fn name(&self) -> &'static str {
+		match self {
+			Phase::Calculate => "Calculate",
+			Phase::Validate => "Validate",
+			Phase::FeedEnthalpy => "Feed enthalpy",
+			Phase::FeedSaturation => "Feed dew and bubble point",
+			Phase::Fenske => "Fenske",
+			Phase::ProductFlashes => "Product flashes",
+			Phase::Underwood => "Underwood",
+			Phase::GillilandKirkbride => "Gilliland and Kirkbride",
+			Phase::ProductStates => "Product states",
+		}
+	}
+
+	/// The parent of the phase
+	pub fn parent(&self) -> Option<Phase> {
+		match self {
+			Phase::Calculate => None,
+			Phase::ProductFlashes => Some(Phase::Fenske),
+			_ => Some(Phase::Calculate),
+		}
+	}
+}
+
+/// The CAPE-OPEN methods that are counted and timed.
+#[derive(Clone,Copy,PartialEq)]
+pub(crate) enum ExternalCall {
+	/// ICapeThermoMaterial::GetOverallProp
+	GetOverallProp,
+	/// ICapeThermoMaterial::SetOverallProp
+	SetOverallProp,
+	/// ICapeThermoMaterial::GetSinglePhaseProp
+	GetSinglePhaseProp,
+	/// ICapeThermoMaterial::SetSinglePhaseProp
+	SetSinglePhaseProp,
+	/// ICapeThermoMaterial::GetPresentPhases
+	GetPresentPhases,
+	/// ICapeThermoMaterial::SetPresentPhases
+	SetPresentPhases,
+	/// ICapeThermoMaterial::CopyFromMaterial
+	CopyFromMaterial,
+	/// ICapeThermoEquilibriumRoutine::CalcEquilibrium
+	CalcEquilibrium,
+	/// ICapeThermoPropertyRoutine::CalcSinglePhaseProp
+	CalcSinglePhaseProp,
+	/// ICapeThermoCompounds::GetCompoundList
+	GetCompoundList,
+	/// ICapeThermoPhases::GetPhaseList
+	GetPhaseList,
+}
+
+impl ExternalCall {
+
+	/// All methods
+	pub const ALL : [ExternalCall;11] = [ExternalCall::GetOverallProp,ExternalCall::SetOverallProp,ExternalCall::GetSinglePhaseProp,ExternalCall::SetSinglePhaseProp,ExternalCall::GetPresentPhases,ExternalCall::SetPresentPhases,ExternalCall::CopyFromMaterial,ExternalCall::CalcEquilibrium,ExternalCall::CalcSinglePhaseProp,ExternalCall::GetCompoundList,ExternalCall::GetPhaseList];
+
+	/// The name of the method, including interface
+	pub fn name(&self) -> &'static str {
+		match self {
+			ExternalCall::GetOverallProp => "ICapeThermoMaterial::GetOverallProp",
+			ExternalCall::SetOverallProp => "ICapeThermoMaterial::SetOverallProp",
+			ExternalCall::GetSinglePhaseProp => "ICapeThermoMaterial::GetSinglePhaseProp",
+			ExternalCall::SetSinglePhaseProp => "ICapeThermoMaterial::SetSinglePhaseProp",
+			ExternalCall::GetPresentPhases => "ICapeThermoMaterial::GetPresentPhases",
+			ExternalCall::SetPresentPhases => "ICapeThermoMaterial::SetPresentPhases",
+			ExternalCall::CopyFromMaterial => "ICapeThermoMaterial::CopyFromMaterial",
+			ExternalCall::CalcEquilibrium => "ICapeThermoEquilibriumRoutine::CalcEquilibrium",
+			ExternalCall::CalcSinglePhaseProp => "ICapeThermoPropertyRoutine::CalcSinglePhaseProp",
+			ExternalCall::GetCompoundList => "ICapeThermoCompounds::GetCompoundList",
+			ExternalCall::GetPhaseList => "ICapeThermoPhases::GetPhaseList",
+		}
+	}
+}
+
+/// Count and total time of a phase or call
+struct Accumulator {
+	/// Number of times the phase was entered or the method was called
+	count : AtomicU64,
+	/// Total time, ns
+	nanoseconds : AtomicU64,
+}
+
+impl Accumulator {
+
+	/// Creates an empty accumulator
+	const fn new() -> Self {
+		Self {
+			count : AtomicU64::new(0),
+			nanoseconds : AtomicU64::new(0),
+		}
+	}
+
+	/// Add a measurement
+	fn add(&self,elapsed:Duration) {
+		self.count.fetch_add(1,Ordering::Relaxed);
+		self.nanoseconds.fetch_add(elapsed.as_nanos() as u64,Ordering::Relaxed);
+	}
+
+	/// Obtain count and time in seconds
+	fn get(&self) -> (u64,f64) {
+		(self.count.load(Ordering::Relaxed),self.nanoseconds.load(Ordering::Relaxed) as f64*1e-9)
+	}
+}
+
+/// A phase that has been entered.
+///
+/// The time of the phase is recorded when the span is ended by [`Span::end`], or when
+/// it is dropped, so that a phase that is left by an error or an early return is closed as well.
+
+#[must_use]
+pub(crate) struct Span {
+	/// The statistics, None once the span is ended
+	performance : Option<Rc<Performance>>,
+	/// The phase
+	phase : Phase,
+	/// The time at which the phase was entered
+	start : Instant,
+}
+
+impl Span {
+
+	/// Leave the phase
+	///
+	/// # Returns:
+	/// * The time spent in the span
+
+	#[inline]
+	pub fn end(mut self) -> Duration {
+		self.close()
+	}
+
+	/// Record the time spent in the span, if not done so already
+	fn close(&mut self) -> Duration {
+		let elapsed=self.start.elapsed();
+		if let Some(performance)=self.performance.take() {
+			performance.phases[self.phase as usize].add(elapsed);
+			if self.phase==Phase::Calculate {
+				performance.external.lock().unwrap().calculating=false;
+			}
+		}
+		elapsed
+	}
+}
+
+impl Drop for Span {
+	fn drop(&mut self) {
+		self.close();
+	}
+}
+
+/// Wall time during which at least one CAPE-OPEN call is in progress.
+///
+/// Calls may overlap if product flashes run concurrently; the time of overlapping
+/// calls is counted once. The clock is only updated when a call ends: the calls that
+/// overlap form a busy period, which lasts from the earliest start of its calls until
+/// the end of its last call.
+
+struct ExternalClock {
+	/// The earliest start of the calls of the current busy period that have ended
+	since : Option<Instant>,
+	/// Whether a calculation is in progress
+	calculating : bool,
+	/// Total wall time of the calls
+	wall_time : Duration,
+	/// Wall time of the calls that were made during a calculation
+	wall_time_in_calculation : Duration,
+}
+
+/// Count and time for a phase or CAPE-OPEN method
+#[derive(Clone,Debug)]
+pub struct TimingStatistics {
+	/// The name of the phase or method
+	pub name : &'static str,
+	/// For phases, the name of the parent phase
+	pub parent : Option<&'static str>,
+	/// Number of times the phase was entered or the method was called
+	pub count : u64,
+	/// Total time, s
+	pub seconds : f64,
+}
+
+/// Machine readable snapshot of the performance statistics
+#[derive(Clone,Debug)]
+pub struct PerformanceSnapshot {
+	/// Statistics per phase, parents before children
+	pub phases : Vec<TimingStatistics>,
+	/// Statistics per CAPE-OPEN method; calls that overlap in time are timed individually
+	pub calls : Vec<TimingStatistics>,
+	/// Wall time during which CAPE-OPEN calls were in progress, s
+	pub external_seconds : f64,
+	/// Time spent in the unit operation during calculation, excluding the wall time of CAPE-OPEN calls, s
+	pub unit_operation_seconds : f64,
+}
+
+/// Performance statistics of the unit operation.
+///
+/// Time is measured with a monotonic clock, for each phase of the calculation, and for
+/// each call into the CAPE-OPEN interfaces of the connected material objects. This allows
+/// to separate time spent inside the property package from time spent in the unit
+/// operation itself. Statistics are accumulated since creation of the unit. Recording does
+/// not allocate, and CAPE-OPEN calls may be recorded from multiple threads.
+///
+/// Phases are entered on the thread that calculates the unit; the statistics are shared
+/// with the spans of the phases that are in progress.
+
+pub(crate) struct Performance {
+	/// Statistics per phase, indexed by Phase
+	phases : [Accumulator;Phase::ALL.len()],
+	/// Statistics per CAPE-OPEN method, indexed by ExternalCall
+	calls : [Accumulator;ExternalCall::ALL.len()],
+	/// Number of CAPE-OPEN calls in progress
+	active_calls : AtomicU32,
+	/// Wall time of the CAPE-OPEN calls
+	external : Mutex<ExternalClock>,
+}
+
+impl Performance {
+
+	/// Creates empty performance statistics
+	pub fn new() -> Self {
+		Self {
+			phases : [const {Accumulator::new()};Phase::ALL.len()],
+			calls : [const {Accumulator::new()};ExternalCall::ALL.len()],
+			active_calls : AtomicU32::new(0),
+			external : Mutex::new(ExternalClock {
+				since : None,
+				calculating : false,
+				wall_time : Duration::ZERO,
+				wall_time_in_calculation : Duration::ZERO,
+			}),
+		}
+	}
+
+	/// Enter a phase
+	///
+	/// # Arguments:
+	/// * `phase` - The phase that is entered
+	///
+	/// # Returns:
+	/// * The span, which records the time of the phase when it is ended or dropped
+
+	#[inline]
+	pub fn begin(self:&Rc<Self>,phase:Phase) -> Span {
+		if phase==Phase::Calculate {
+			self.external.lock().unwrap().calculating=true;
+		}
+		Span {
+			performance : Some(self.clone()),
+			phase,
+			start : Instant::now(),
+		}
+	}
+
+	/// Perform a CAPE-OPEN call, and record its count and time
+	///
+	/// The call is entered without taking the lock; the wall time is updated in a single
+	/// locked section after the call.
+	///
+	/// # Arguments:
+	/// * `method` - The method that is called
+	/// * `call` - Performs the call
+	///
+	/// # Returns:
+	/// * The result of the call
+
+	#[inline]
+	pub fn call<R,F:FnOnce() -> R>(&self,method:ExternalCall,call:F) -> R {
+		let start=Instant::now();
+		self.active_calls.fetch_add(1,Ordering::Relaxed);
+		let result=call();
+		let end=Instant::now();
+		self.calls[method as usize].add(end-start);
+		let mut external=self.external.lock().unwrap();
+		let since=external.since.map_or(start,|since| since.min(start));
+		if self.active_calls.fetch_sub(1,Ordering::Relaxed)==1 {
+			//last call of the busy period
+			external.since=None;
+			let elapsed=end-since;
+			external.wall_time+=elapsed;
+			if external.calculating {
+				external.wall_time_in_calculation+=elapsed;
+			}
+		} else {
+			external.since=Some(since);
+		}
+		result
+	}
+
+	/// Take a snapshot of the statistics
+	pub fn snapshot(&self) -> PerformanceSnapshot {
+		let (external_seconds,external_seconds_in_calculation)={
+			let external=self.external.lock().unwrap();
+			(external.wall_time.as_secs_f64(),external.wall_time_in_calculation.as_secs_f64())
+		};
+		let (_,calculate_seconds)=self.phases[Phase::Calculate as usize].get();
+		PerformanceSnapshot {
+			phases : Phase::ALL.iter().map(|phase| {
+				let (count,seconds)=self.phases[*phase as usize].get();
+				TimingStatistics {
+					name : phase.name(),
+					parent : phase.parent().map(|parent| parent.name()),
+					count,
+					seconds,
+				}
+			}).collect(),
+			calls : ExternalCall::ALL.iter().map(|method| {
+				let (count,seconds)=self.calls[*method as usize].get();
+				TimingStatistics {
+					name : method.name(),
+					parent : None,
+					count,
+					seconds,
+				}
+			}).collect(),
+			external_seconds,
+			unit_operation_seconds : f64::max(calculate_seconds-external_seconds_in_calculation,0.0),
+		}
+	}
+}
+
+impl PerformanceSnapshot {
+
+	/// Write the statistics as human readable text
+	///
+	/// # Arguments:
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_text<W:Write>(&self,writer:&mut W) -> std::io::Result<()> {
+		writeln!(writer,"{:<48}{:>10}{:>14}","Phase","Count","Time [s]")?;
+		for (phase,statistics) in Phase::ALL.iter().zip(self.phases.iter()) {
+			let mut depth=0;
+			let mut parent=phase.parent();
+			while let Some(p)=parent {
+				depth+=1;
+				parent=p.parent();
+			}
+			writeln!(writer,"{:indent$}{:<width$}{:>10}{:>14.6}","",statistics.name,statistics.count,statistics.seconds,indent=2*depth,width=48-2*depth)?;
+		}
+		writeln!(writer)?;
+		writeln!(writer,"{:<48}{:>10}{:>14}","CAPE-OPEN method","Calls","Time [s]")?;
+		for statistics in self.calls.iter() {
+			writeln!(writer,"{:<48}{:>10}{:>14.6}",statistics.name,statistics.count,statistics.seconds)?;
+		}
+		writeln!(writer)?;
+		writeln!(writer,"Time in CAPE-OPEN calls (wall time): {:.6} s",self.external_seconds)?;
+		writeln!(writer,"Time in unit operation: {:.6} s",self.unit_operation_seconds)?;
+		Ok(())
+	}
+
+	/// Write the statistics as JSON
+	///
+	/// # Arguments:
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_json<W:Write>(&self,writer:&mut W) -> std::io::Result<()> {
+		fn write_list<W:Write>(writer:&mut W,list:&[TimingStatistics]) -> std::io::Result<()> {
+			for (i,item) in list.iter().enumerate() {
+				write!(writer,"{{\"name\":\"{}\"",item.name)?;
+				if let Some(parent)=item.parent {
+					write!(writer,",\"parent\":\"{}\"",parent)?;
+				}
+				writeln!(writer,",\"count\":{},\"seconds\":{}}}{}",item.count,item.seconds,if i+1<list.len() {","} else {""})?;
+			}
+			Ok(())
+		}
+		writeln!(writer,"{{\"phases\":[")?;
+		write_list(writer,&self.phases)?;
+		writeln!(writer,"],\"calls\":[")?;
+		write_list(writer,&self.calls)?;
+		writeln!(writer,"],\"externalSeconds\":{},\"unitOperationSeconds\":{}}}",self.external_seconds,self.unit_operation_seconds)
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	fn phase_count(snapshot:&PerformanceSnapshot,phase:Phase) -> u64 {
+		snapshot.phases[phase as usize].count
+	}
+
+	#[test]
+	fn dropped_span_is_recorded() {
+		let performance=Rc::new(Performance::new());
+		let result:Result<(),()>=(|| {
+			let _span=performance.begin(Phase::Fenske);
+			Err(())
+		})();
+		assert!(result.is_err());
+		let span=performance.begin(Phase::Underwood);
+		span.end();
+		let snapshot=performance.snapshot();
+		assert_eq!(phase_count(&snapshot,Phase::Fenske),1);
+		assert_eq!(phase_count(&snapshot,Phase::Underwood),1);
+		assert_eq!(phase_count(&snapshot,Phase::Calculate),0);
+	}
+
+	#[test]
+	fn overlapping_calls_count_once() {
+		let performance=Rc::new(Performance::new());
+		let pause=Duration::from_millis(50);
+		let span=performance.begin(Phase::Calculate);
+		let shared:&Performance=&performance;
+		std::thread::scope(|scope| {
+			scope.spawn(|| shared.call(ExternalCall::CalcEquilibrium,|| std::thread::sleep(pause)));
+			shared.call(ExternalCall::CalcEquilibrium,|| std::thread::sleep(pause));
+		});
+		let calculate_time=span.end();
+		let snapshot=performance.snapshot();
+		let calls=&snapshot.calls[ExternalCall::CalcEquilibrium as usize];
+		assert_eq!(calls.count,2);
+		assert!(calls.seconds>=2.0*pause.as_secs_f64());
+		assert!(snapshot.external_seconds>=pause.as_secs_f64());
+		assert!(snapshot.external_seconds<=calculate_time.as_secs_f64());
+		assert!(snapshot.unit_operation_seconds>=0.0);
+		assert!(snapshot.unit_operation_seconds<=calculate_time.as_secs_f64()-snapshot.external_seconds+1e-9);
+	}
+
+	#[test]
+	fn call_inside_longer_call_counts_once() {
+		let performance=Rc::new(Performance::new());
+		let shared:&Performance=&performance;
+		let (entered,started)=std::sync::mpsc::channel();
+		std::thread::scope(|scope| {
+			scope.spawn(move || shared.call(ExternalCall::CalcEquilibrium,|| {
+				entered.send(()).unwrap();
+				std::thread::sleep(Duration::from_millis(100));
+			}));
+			//the short call starts after, and ends before, the long call
+			started.recv().unwrap();
+			shared.call(ExternalCall::GetOverallProp,|| std::thread::sleep(Duration::from_millis(20)));
+		});
+		let snapshot=performance.snapshot();
+		assert!(snapshot.external_seconds>=0.1);
+		assert!(snapshot.external_seconds<0.12);
+		performance.call(ExternalCall::GetOverallProp,|| std::thread::sleep(Duration::from_millis(20)));
+		assert!(performance.snapshot().external_seconds>=0.12);
+	}
+
+	#[test]
+	fn calls_outside_calculation_are_not_subtracted() {
+		let performance=Rc::new(Performance::new());
+		performance.call(ExternalCall::GetCompoundList,|| std::thread::sleep(Duration::from_millis(20)));
+		let span=performance.begin(Phase::Calculate);
+		let calculate_time=span.end();
+		let snapshot=performance.snapshot();
+		assert_eq!(snapshot.calls[ExternalCall::GetCompoundList as usize].count,1);
+		assert!(snapshot.external_seconds>=0.02);
+		assert!((snapshot.unit_operation_seconds-calculate_time.as_secs_f64()).abs()<1e-6);
+	}
+
+	#[test]
+	fn renders_wall_time() {
+		let performance=Rc::new(Performance::new());
+		performance.begin(Phase::Calculate).end();
+		let snapshot=performance.snapshot();
+		let mut text=Vec::new();
+		snapshot.write_text(&mut text).unwrap();
+		let text=String::from_utf8(text).unwrap();
+		assert!(text.contains("ICapeThermoPhases::GetPhaseList"));
+		assert!(text.contains("Time in CAPE-OPEN calls (wall time)"));
+		let mut json=Vec::new();
+		snapshot.write_json(&mut json).unwrap();
+		let json=String::from_utf8(json).unwrap();
+		assert!(json.contains("\"externalSeconds\":"));
+		assert!(json.trim_end().ends_with('}'));
+	}
+}
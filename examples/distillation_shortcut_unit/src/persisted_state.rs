@@ -0,0 +1,204 @@
+use cobia::*;
+
+/// Encoder for the binary state record of the unit operation.
+///
+/// The binary state record allows the unit to save and load its complete
+/// state with a single call to the persistence writer or reader. The record starts
+/// with a signature and a version number, followed by the values in a fixed order
+/// that is defined by the unit operation. Numbers are stored little-endian, strings
+/// are stored as UTF-8 preceded by their length in bytes.
+
+pub(crate) struct StateEncoder {
+	/// The encoded bytes
+	bytes : Vec<u8>,
+}
+
+impl StateEncoder {
+
+	/// The signature at the start of a state record
+	pub const SIGNATURE: &'static [u8;4] = b"DSCU";
+
+	/// Creates an encoder for a state record of the given version
+	///
+	/// # Arguments:
+	/// * `version` - The version of the layout of the state record
+
+	pub fn new(version:u16) -> Self {
+		let mut bytes=Vec::with_capacity(256);
+		bytes.extend_from_slice(Self::SIGNATURE);
+		bytes.extend_from_slice(&version.to_le_bytes());
+		Self { bytes }
+	}
+
+	/// Add a real value
+	pub fn put_real(&mut self,value:f64) {
+		self.bytes.extend_from_slice(&value.to_le_bytes());
+	}
+
+	/// Add an integer value
+	pub fn put_integer(&mut self,value:i32) {
+		self.bytes.extend_from_slice(&value.to_le_bytes());
+	}
+
+	/// Add a string value
+	pub fn put_string(&mut self,value:&str) {
+		self.bytes.extend_from_slice(&(value.len() as u32).to_le_bytes());
+		self.bytes.extend_from_slice(value.as_bytes());
+	}
+
+	/// Obtain the encoded record
+	pub fn finish(self) -> CapeArrayByteVec {
+		CapeArrayByteVec::from_vec(self.bytes)
+	}
+}
+
+/// Decoder for the binary state record of the unit operation.
+///
+/// See [`StateEncoder`] for the layout of the record.
+
+pub(crate) struct StateDecoder<'a> {
+	/// The remaining bytes
+	bytes : &'a [u8],
+	/// The version of the layout of the state record
+	pub version : u16,
+}
+
+impl<'a> StateDecoder<'a> {
+
+	/// Creates a decoder and reads the record header
+	///
+	/// # Arguments:
+	/// * `bytes` - The state record
+	///
+	/// # Returns:
+	/// * The decoder, or an error if the record does not start with a valid header
+
+	pub fn new(bytes:&'a [u8]) -> Result<Self,COBIAError> {
+		if bytes.len()<6 || &bytes[0..4]!=StateEncoder::SIGNATURE {
+			return Err(COBIAError::Message("Invalid unit operation state record".into()));
+		}
+		let version=u16::from_le_bytes([bytes[4],bytes[5]]);
+		Ok(Self {
+			bytes : &bytes[6..],
+			version,
+		})
+	}
+
+	/// Take the next bytes from the record
+	fn take(&mut self,count:usize) -> Result<&'a [u8],COBIAError> {
+		if self.bytes.len()<count {
+			return Err(COBIAError::Message("Unit operation state record is truncated".into()));
+		}
+		let (value,remainder)=self.bytes.split_at(count);
+		self.bytes=remainder;
+		Ok(value)
+	}
+
+	/// Read a real value
+	pub fn get_real(&mut self) -> Result<f64,COBIAError> {
+		Ok(f64::from_le_bytes(self.take(8)?.try_into().unwrap()))
+	}
+
+	/// Read an integer value
+	pub fn get_integer(&mut self) -> Result<i32,COBIAError> {
+		Ok(i32::from_le_bytes(self.take(4)?.try_into().unwrap()))
+	}
+
+	/// Read a string value
+	pub fn get_string(&mut self) -> Result<&'a str,COBIAError> {
+		let length=u32::from_le_bytes(self.take(4)?.try_into().unwrap()) as usize;
+		std::str::from_utf8(self.take(length)?).or_else(|_| Err(COBIAError::Message("Unit operation state record contains an invalid string".into())))
+	}
+
+	/// Check that the complete record has been read
+	pub fn end(&self) -> Result<(),COBIAError> {
+		if self.bytes.is_empty() {
+			Ok(())
+		} else {
+			Err(COBIAError::Message("Unit operation state record contains unexpected data".into()))
+		}
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	fn record() -> Vec<u8> {
+		let mut encoder=StateEncoder::new(1);
+		encoder.put_string("Column");
+		encoder.put_string("");
+		encoder.put_real(0.99);
+		encoder.put_real(f64::NAN);
+		encoder.put_integer(-100);
+		encoder.put_string("n-hexane/κ");
+		encoder.finish().as_vec().clone()
+	}
+
+	#[test]
+	fn round_trip() {
+		let bytes=record();
+		let mut decoder=StateDecoder::new(&bytes).unwrap();
+		assert_eq!(decoder.version,1);
+		assert_eq!(decoder.get_string().unwrap(),"Column");
+		assert_eq!(decoder.get_string().unwrap(),"");
+		assert_eq!(decoder.get_real().unwrap(),0.99);
+		assert!(decoder.get_real().unwrap().is_nan());
+		assert_eq!(decoder.get_integer().unwrap(),-100);
+		assert_eq!(decoder.get_string().unwrap(),"n-hexane/κ");
+		assert!(decoder.end().is_ok());
+		assert!(decoder.get_integer().is_err());
+	}
+
+	#[test]
+	fn invalid_header() {
+		assert!(StateDecoder::new(&[]).is_err());
+		assert!(StateDecoder::new(b"DSCU\x01").is_err());
+		assert!(StateDecoder::new(b"DSCV\x01\x00").is_err());
+		assert_eq!(StateDecoder::new(b"DSCU\x02\x00").unwrap().version,2);
+	}
+
+	#[test]
+	fn truncated() {
+		let bytes=record();
+		//every prefix of the record fails to decode
+		for length in 0..bytes.len() {
+			let decoded=StateDecoder::new(&bytes[..length]).and_then(|mut decoder| {
+				decoder.get_string()?;
+				decoder.get_string()?;
+				decoder.get_real()?;
+				decoder.get_real()?;
+				decoder.get_integer()?;
+				decoder.get_string()?;
+				decoder.end()
+			});
+			assert!(decoded.is_err(),"prefix of {} bytes decodes",length);
+		}
+	}
+
+	#[test]
+	fn corrupted() {
+		//string length beyond the end of the record
+		let mut encoder=StateEncoder::new(1);
+		encoder.put_integer(1000);
+		encoder.put_real(1.0);
+		let bytes=encoder.finish().as_vec().clone();
+		assert!(StateDecoder::new(&bytes).unwrap().get_string().is_err());
+		//string that is not UTF-8
+		let mut bytes=StateEncoder::new(1).finish().as_vec().clone();
+		bytes.extend_from_slice(&2u32.to_le_bytes());
+		bytes.extend_from_slice(&[0xc3,0x28]);
+		assert!(StateDecoder::new(&bytes).unwrap().get_string().is_err());
+		//trailing data
+		let mut bytes=record();
+		bytes.push(0);
+		let mut decoder=StateDecoder::new(&bytes).unwrap();
+		decoder.get_string().unwrap();
+		decoder.get_string().unwrap();
+		decoder.get_real().unwrap();
+		decoder.get_real().unwrap();
+		decoder.get_integer().unwrap();
+		decoder.get_string().unwrap();
+		assert!(decoder.end().is_err());
+	}
+}
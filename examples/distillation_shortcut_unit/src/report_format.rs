@@ -0,0 +1,100 @@
+use cobia::*;
+
+/// The reports of the unit operation
+#[derive(Clone,Copy,PartialEq)]
+pub(crate) enum UnitReport {
+	/// Report of the last calculation
+	LastRun,
+	/// Convergence statistics of the iterative solves
+	SolverStatistics,
+	/// Parametric case study
+	CaseStudy,
+	/// Time spent per calculation phase and per CAPE-OPEN method
+	Performance,
+}
+
+/// The formats in which a report can be rendered
+#[derive(Clone,Copy,PartialEq)]
+pub(crate) enum ReportFormat {
+	/// Human readable text
+	Text,
+	/// Comma separated values
+	Csv,
+	/// JSON
+	Json,
+}
+
+impl ReportFormat {
+
+	/// The MIME type of the format
+	pub fn mime_type(&self) -> &'static str {
+		match self {
+			ReportFormat::Text => "text/plain",
+			ReportFormat::Csv => "text/csv",
+			ReportFormat::Json => "application/json",
+		}
+	}
+}
+
+/// Case insensitive string constants for matching report specifications.
+///
+/// The constants are created once, so that checking a report specification
+/// does not involve string allocations.
+
+pub(crate) struct ReportLiterals {
+	/// MIME type text/plain
+	text_plain : CapeStringConstNoCase,
+	/// MIME type text/csv
+	text_csv : CapeStringConstNoCase,
+	/// MIME type application/json
+	application_json : CapeStringConstNoCase,
+	/// The supported locale
+	en : CapeStringConstNoCase,
+}
+
+impl ReportLiterals {
+
+	/// Creates the string constants
+	pub fn new() -> Self {
+		Self {
+			text_plain : CapeStringConstNoCase::from_string(ReportFormat::Text.mime_type()),
+			text_csv : CapeStringConstNoCase::from_string(ReportFormat::Csv.mime_type()),
+			application_json : CapeStringConstNoCase::from_string(ReportFormat::Json.mime_type()),
+			en : CapeStringConstNoCase::from_string("en"),
+		}
+	}
+
+	/// Find the report format for a MIME type
+	///
+	/// # Arguments:
+	/// * `mime_type` - The MIME type; if empty, the first of the available formats is selected
+	/// * `formats` - The formats that are available for the report
+	///
+	/// # Returns:
+	/// * The format, or None if the MIME type does not match any available format
+
+	pub fn format(&self,mime_type:&CapeStringIn,formats:&[ReportFormat]) -> Option<ReportFormat> {
+		if mime_type.is_empty() {
+			return formats.first().copied();
+		}
+		formats.iter().copied().find(|format| {
+			match format {
+				ReportFormat::Text => self.text_plain==*mime_type,
+				ReportFormat::Csv => self.text_csv==*mime_type,
+				ReportFormat::Json => self.application_json==*mime_type,
+			}
+		})
+	}
+
+	/// Check whether a locale is supported
+	///
+	/// # Arguments:
+	/// * `locale` - The locale; an empty locale selects the default locale
+	///
+	/// # Returns:
+	/// * Whether the locale is supported
+
+	pub fn is_supported_locale(&self,locale:&CapeStringIn) -> bool {
+		locale.is_empty() || self.en==*locale
+	}
+}
@@ -0,0 +1,380 @@
+use cobia::*;
+use std::collections::VecDeque;
+use std::io::Write;
+
+/// An event during calculation of the unit operation.
+///
+/// Events carry their numeric payload only; they are rendered to text,
+/// JSON or CSV when a report is requested.
+
+pub(crate) enum RunEvent {
+	/// Calculation started at the given time
+	Started(std::time::SystemTime),
+	/// Report text restored from a saved unit operation
+	Restored(String),
+	/// Inputs unchanged; cached product states applied; total number of cache hits
+	CacheHit(u64),
+	/// Feed quality, mol/mol
+	FeedQuality(f64),
+	/// Feed stream is super-heated
+	FeedSuperHeated,
+	/// Feed stream is sub-cooled
+	FeedSubCooled,
+	/// Number of Fenske iterations
+	FenskeIterations(i32),
+	/// Total wall time of the product flashes in the Fenske iterations, and whether they ran concurrently
+	ProductFlashes{concurrent:bool,seconds:f64},
+	/// Minimum number of stages
+	MinimumNumberOfStages(f64),
+	/// Warning: Underwood calculation uses the relative volatility of the compound with given index as limit
+	UnderwoodLimitingCompound(usize),
+	/// Number of Underwood iterations
+	UnderwoodIterations(u32),
+	/// Minimum reflux ratio
+	MinimumRefluxRatio(f64),
+	/// Calculation finished after the given number of seconds
+	Finished(f64),
+	/// Calculation failed with the given error
+	Failed(String),
+}
+
+/// The payload of an event, for rendering
+enum EventValue<'a> {
+	/// No payload
+	None,
+	/// Real payload
+	Real(f64),
+	/// Integer payload
+	Integer(i64),
+	/// Text payload
+	Text(std::borrow::Cow<'a,str>),
+}
+
+impl RunEvent {
+
+	/// Whether the event is a warning
+	pub fn is_warning(&self) -> bool {
+		matches!(self,RunEvent::UnderwoodLimitingCompound(_))
+	}
+
+	/// The machine readable name and payload of the event
+	///
+	/// # Arguments:
+	/// * `compound_names` - The compound names, used to resolve compound indices
+	///
+	/// # Returns:
+	/// * The event name and value
+
+	fn name_and_value<'a>(&'a self,compound_names:&CapeArrayStringVec) -> (&'static str,EventValue<'a>) {
+		match self {
+			RunEvent::Started(time) => ("started",EventValue::Text(chrono::DateTime::<chrono::Local>::from(*time).format("%Y-%m-%d %H:%M:%S").to_string().into())),
+			RunEvent::Restored(text) => ("restored",EventValue::Text(text.as_str().into())),
+			RunEvent::CacheHit(hits) => ("cacheHit",EventValue::Integer(*hits as i64)),
+			RunEvent::FeedQuality(quality) => ("feedQuality",EventValue::Real(*quality)),
+			RunEvent::FeedSuperHeated => ("feedSuperHeated",EventValue::None),
+			RunEvent::FeedSubCooled => ("feedSubCooled",EventValue::None),
+			RunEvent::FenskeIterations(iterations) => ("fenskeIterations",EventValue::Integer(*iterations as i64)),
+			RunEvent::ProductFlashes{concurrent,seconds} => (if *concurrent {"concurrentProductFlashes"} else {"sequentialProductFlashes"},EventValue::Real(*seconds)),
+			RunEvent::MinimumNumberOfStages(stages) => ("minimumNumberOfStages",EventValue::Real(*stages)),
+			RunEvent::UnderwoodLimitingCompound(index) => ("underwoodLimitingCompound",EventValue::Text(Self::compound_name(compound_names,*index))),
+			RunEvent::UnderwoodIterations(iterations) => ("underwoodIterations",EventValue::Integer(*iterations as i64)),
+			RunEvent::MinimumRefluxRatio(ratio) => ("minimumRefluxRatio",EventValue::Real(*ratio)),
+			RunEvent::Finished(seconds) => ("finished",EventValue::Real(*seconds)),
+			RunEvent::Failed(message) => ("failed",EventValue::Text(message.as_str().into())),
+		}
+	}
+
+	/// Resolve a compound index to a compound name
+	fn compound_name<'a>(compound_names:&CapeArrayStringVec,index:usize) -> std::borrow::Cow<'a,str> {
+		if index<compound_names.size() {
+			compound_names[index].as_string().into()
+		} else {
+			format!("#{}",index+1).into()
+		}
+	}
+
+	/// Write the event as human readable text, without line termination
+	///
+	/// # Arguments:
+	/// * `compound_names` - The compound names, used to resolve compound indices
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_text<W:Write>(&self,compound_names:&CapeArrayStringVec,writer:&mut W) -> std::io::Result<()> {
+		match self {
+			RunEvent::Started(time) => write!(writer,"Calculation started at {}",chrono::DateTime::<chrono::Local>::from(*time).format("%Y-%m-%d %H:%M:%S")),
+			RunEvent::Restored(text) => write!(writer,"{}",text.trim_end()),
+			RunEvent::CacheHit(hits) => write!(writer,"Inputs unchanged since last successful calculation; cached product states applied (cache hit {}).",hits),
+			RunEvent::FeedQuality(quality) => write!(writer,"Feed quality: {:.4}",quality),
+			RunEvent::FeedSuperHeated => write!(writer,"Feed stream is super-heated"),
+			RunEvent::FeedSubCooled => write!(writer,"Feed stream is sub-cooled"),
+			RunEvent::FenskeIterations(iterations) => write!(writer,"Fenske calculation took {} iterations.",iterations),
+			RunEvent::ProductFlashes{concurrent,seconds} => write!(writer,"Product flashes ({}) took {:.3} seconds.",if *concurrent {"concurrent"} else {"sequential"},seconds),
+			RunEvent::MinimumNumberOfStages(stages) => write!(writer,"Minimum number of stages: {}.",stages),
+			RunEvent::UnderwoodLimitingCompound(index) => write!(writer,"Underwood calculation uses relative volatility of compound {} as light compound limit",Self::compound_name(compound_names,*index)),
+			RunEvent::UnderwoodIterations(iterations) => write!(writer,"Underwood calculation took {} iterations.",iterations),
+			RunEvent::MinimumRefluxRatio(ratio) => write!(writer,"Minimum reflux ratio: {:.4}",ratio),
+			RunEvent::Finished(seconds) => write!(writer,"Calculation finished in {:.3} seconds.",seconds),
+			RunEvent::Failed(message) => write!(writer,"Calculation failed: {}",message),
+		}
+	}
+}
+
+/// Log of the events of the last calculation.
+///
+/// Events are stored in a ring of fixed capacity that is allocated once; if the
+/// ring is full, the oldest events are dropped. Formatting only takes place when
+/// the log is rendered. If the log is disabled, only warnings are recorded; logging
+/// any other event is a no-op.
+
+pub(crate) struct RunLog {
+	/// The events
+	events : VecDeque<RunEvent>,
+	/// The number of events that were dropped because the ring was full
+	dropped : usize,
+	/// Whether events other than warnings are recorded
+	enabled : bool,
+}
+
+impl RunLog {
+
+	/// The maximum number of events that is kept
+	const CAPACITY : usize = 64;
+
+	/// Creates an empty, enabled log
+	pub fn new() -> Self {
+		Self {
+			events : VecDeque::with_capacity(Self::CAPACITY),
+			dropped : 0,
+			enabled : true,
+		}
+	}
+
+	/// Whether events other than warnings are recorded
+	pub fn is_enabled(&self) -> bool {
+		self.enabled
+	}
+
+	/// Enable or disable recording of events other than warnings; disabling clears the log
+	pub fn set_enabled(&mut self,enabled:bool) {
+		self.enabled=enabled;
+		if !enabled {
+			self.clear();
+		}
+	}
+
+	/// Remove all events
+	pub fn clear(&mut self) {
+		self.events.clear();
+		self.dropped=0;
+	}
+
+	/// Record an event; warnings are recorded even if the log is disabled
+	#[inline]
+	pub fn log(&mut self,event:RunEvent) {
+		if !self.enabled && !event.is_warning() {
+			return;
+		}
+		if self.events.len()==Self::CAPACITY {
+			self.events.pop_front();
+			self.dropped+=1;
+		}
+		self.events.push_back(event);
+	}
+
+	/// Write the log as human readable text
+	///
+	/// # Arguments:
+	/// * `compound_names` - The compound names, used to resolve compound indices
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_text<W:Write>(&self,compound_names:&CapeArrayStringVec,writer:&mut W) -> std::io::Result<()> {
+		if self.events.is_empty() {
+			return writeln!(writer,"Report not available");
+		}
+		if self.dropped>0 {
+			writeln!(writer,"({} earlier events omitted)",self.dropped)?;
+		}
+		for event in self.events.iter() {
+			if event.is_warning() {
+				write!(writer,"Warning: ")?;
+			}
+			event.write_text(compound_names,writer)?;
+			writeln!(writer)?;
+		}
+		Ok(())
+	}
+
+	/// Write the log as comma separated values, one event per line
+	///
+	/// # Arguments:
+	/// * `compound_names` - The compound names, used to resolve compound indices
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_csv<W:Write>(&self,compound_names:&CapeArrayStringVec,writer:&mut W) -> std::io::Result<()> {
+		writeln!(writer,"Event,Value")?;
+		for event in self.events.iter() {
+			let (name,value)=event.name_and_value(compound_names);
+			match value {
+				EventValue::None => writeln!(writer,"{},",name)?,
+				EventValue::Real(value) => writeln!(writer,"{},{}",name,value)?,
+				EventValue::Integer(value) => writeln!(writer,"{},{}",name,value)?,
+				EventValue::Text(value) => writeln!(writer,"{},\"{}\"",name,value.replace('"',"\"\""))?,
+			}
+		}
+		Ok(())
+	}
+
+	/// Write the log as JSON
+	///
+	/// The log is written as an object with the number of dropped events, and an array of
+	/// events, each of which has an event name and an optional value.
+	///
+	/// # Arguments:
+	/// * `compound_names` - The compound names, used to resolve compound indices
+	/// * `writer` - The destination
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure.
+
+	pub fn write_json<W:Write>(&self,compound_names:&CapeArrayStringVec,writer:&mut W) -> std::io::Result<()> {
+		writeln!(writer,"{{\"dropped\":{},\"events\":[",self.dropped)?;
+		for (i,event) in self.events.iter().enumerate() {
+			let (name,value)=event.name_and_value(compound_names);
+			write!(writer,"{{\"event\":\"{}\"",name)?;
+			match value {
+				EventValue::None => {},
+				EventValue::Real(value) => {
+					if value.is_finite() {
+						write!(writer,",\"value\":{}",value)?;
+					} else {
+						write!(writer,",\"value\":null")?;
+					}
+				},
+				EventValue::Integer(value) => write!(writer,",\"value\":{}",value)?,
+				EventValue::Text(value) => write!(writer,",\"value\":{}",json::stringify(value.as_ref()))?,
+			}
+			writeln!(writer,"}}{}",if i+1<self.events.len() {","} else {""})?;
+		}
+		writeln!(writer,"]}}")
+	}
+
+	/// Render the log as human readable text
+	///
+	/// # Arguments:
+	/// * `compound_names` - The compound names, used to resolve compound indices
+	///
+	/// # Returns:
+	/// * The text
+
+	pub fn to_text(&self,compound_names:&CapeArrayStringVec) -> String {
+		let mut text=Vec::new();
+		let _=self.write_text(compound_names,&mut text);
+		String::from_utf8_lossy(&text).into_owned()
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	fn compound_names() -> CapeArrayStringVec {
+		CapeArrayStringVec::from(&["methane","ethane"])
+	}
+
+	fn log() -> RunLog {
+		let mut log=RunLog::new();
+		log.log(RunEvent::FeedQuality(0.25));
+		log.log(RunEvent::FeedSubCooled);
+		log.log(RunEvent::FenskeIterations(3));
+		log.log(RunEvent::UnderwoodLimitingCompound(1));
+		log.log(RunEvent::UnderwoodLimitingCompound(5));
+		log.log(RunEvent::MinimumRefluxRatio(f64::NAN));
+		log.log(RunEvent::Failed("bad \"value\"".into()));
+		log
+	}
+
+	#[test]
+	fn text() {
+		assert_eq!(RunLog::new().to_text(&compound_names()),"Report not available\n");
+		assert_eq!(log().to_text(&compound_names()),
+			"Feed quality: 0.2500\n\
+			 Feed stream is sub-cooled\n\
+			 Fenske calculation took 3 iterations.\n\
+			 Warning: Underwood calculation uses relative volatility of compound ethane as light compound limit\n\
+			 Warning: Underwood calculation uses relative volatility of compound #6 as light compound limit\n\
+			 Minimum reflux ratio: NaN\n\
+			 Calculation failed: bad \"value\"\n");
+	}
+
+	#[test]
+	fn csv() {
+		let mut csv=Vec::new();
+		log().write_csv(&compound_names(),&mut csv).unwrap();
+		assert_eq!(String::from_utf8(csv).unwrap(),
+			"Event,Value\n\
+			 feedQuality,0.25\n\
+			 feedSubCooled,\n\
+			 fenskeIterations,3\n\
+			 underwoodLimitingCompound,\"ethane\"\n\
+			 underwoodLimitingCompound,\"#6\"\n\
+			 minimumRefluxRatio,NaN\n\
+			 failed,\"bad \"\"value\"\"\"\n");
+	}
+
+	#[test]
+	fn json() {
+		let mut json=Vec::new();
+		log().write_json(&compound_names(),&mut json).unwrap();
+		assert_eq!(String::from_utf8(json).unwrap(),
+			"{\"dropped\":0,\"events\":[\n\
+			 {\"event\":\"feedQuality\",\"value\":0.25},\n\
+			 {\"event\":\"feedSubCooled\"},\n\
+			 {\"event\":\"fenskeIterations\",\"value\":3},\n\
+			 {\"event\":\"underwoodLimitingCompound\",\"value\":\"ethane\"},\n\
+			 {\"event\":\"underwoodLimitingCompound\",\"value\":\"#6\"},\n\
+			 {\"event\":\"minimumRefluxRatio\",\"value\":null},\n\
+			 {\"event\":\"failed\",\"value\":\"bad \\\"value\\\"\"}\n\
+			 ]}\n");
+	}
+
+	#[test]
+	fn ring() {
+		let mut log=RunLog::new();
+		for i in 0..RunLog::CAPACITY+2 {
+			log.log(RunEvent::FenskeIterations(i as i32));
+		}
+		let text=log.to_text(&compound_names());
+		assert!(text.starts_with("(2 earlier events omitted)\nFenske calculation took 2 iterations.\n"));
+		assert_eq!(text.lines().count(),RunLog::CAPACITY+1);
+		let mut json=Vec::new();
+		log.write_json(&compound_names(),&mut json).unwrap();
+		assert!(String::from_utf8(json).unwrap().starts_with("{\"dropped\":2,"));
+		log.clear();
+		assert_eq!(log.to_text(&compound_names()),"Report not available\n");
+	}
+
+	#[test]
+	fn disabled() {
+		let mut log=log();
+		log.set_enabled(false);
+		assert!(!log.is_enabled());
+		log.log(RunEvent::FeedSuperHeated);
+		assert_eq!(log.to_text(&compound_names()),"Report not available\n");
+		//warnings are kept
+		log.log(RunEvent::UnderwoodLimitingCompound(0));
+		assert_eq!(log.to_text(&compound_names()),"Warning: Underwood calculation uses relative volatility of compound methane as light compound limit\n");
+		log.clear();
+		log.set_enabled(true);
+		log.log(RunEvent::FeedSuperHeated);
+		assert_eq!(log.to_text(&compound_names()),"Feed stream is super-heated\n");
+	}
+}
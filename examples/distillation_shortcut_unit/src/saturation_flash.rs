@@ -0,0 +1,289 @@
+use cobia::*;
+use crate::performance::{Performance,ExternalCall};
+
+/// The phase information needed for a dew or bubble point flash.
+///
+/// The settings consist of plain strings, so that they can be shared with a worker
+/// thread; each thread creates its own [`SaturationFlash`] from them.
+
+pub(crate) struct FlashSettings {
+	/// The vapor phase ID
+	pub vapor_phase_id : String,
+	/// The liquid phase IDs
+	pub liquid_phase_ids : Vec<String>,
+	/// The IDs of all phases
+	pub phase_ids : Vec<String>,
+	/// The number of compounds
+	pub compound_count : usize,
+}
+
+/// The interfaces of a material object that are used by a flash.
+#[derive(Clone,Copy)]
+pub(crate) struct FlashMaterial<'a> {
+	/// The material object
+	pub material_object : &'a cape_open_1_2::CapeThermoMaterial,
+	/// The equilibrium routine of the material object
+	pub equilibrium_routine : &'a cape_open_1_2::CapeThermoEquilibriumRoutine,
+}
+
+/// A material object that is flashed on a worker thread.
+///
+/// CAPE-OPEN objects may in general only be used on the thread on which they were
+/// obtained, and neither CAPE-OPEN nor COBIA provides a means to find out whether a
+/// material object may be used from another thread. This wrapper is therefore only
+/// created if the user declared, through the "Concurrent flashes" parameter, that the
+/// PME provides material objects that can be used from any thread.
+
+pub(crate) struct FreeThreadedMaterial<'a>(FlashMaterial<'a>);
+
+//only the material object crosses the thread boundary; see FreeThreadedMaterial::new
+unsafe impl Send for FreeThreadedMaterial<'_> {}
+
+impl<'a> FreeThreadedMaterial<'a> {
+
+	/// Declare a material object to be free-threaded.
+	///
+	/// # Safety
+	///
+	/// The material object and its equilibrium routine must be usable from any thread, and
+	/// must not be used on the calling thread while the worker thread uses them.
+	///
+	/// # Arguments:
+	/// * `material` - The material object
+	///
+	/// # Returns:
+	/// * The material object, which can be moved to a worker thread
+
+	pub unsafe fn new(material:FlashMaterial<'a>) -> Self {
+		Self(material)
+	}
+
+	/// Obtain the material object.
+	///
+	/// Closures must call this method rather than access the field, so that they
+	/// capture the wrapper and not just its content.
+	///
+	/// # Returns:
+	/// * The material object
+
+	pub fn material(&self) -> FlashMaterial<'a> {
+		self.0
+	}
+}
+
+/// Dew and bubble point flash at given pressure and composition.
+///
+/// Holds the string constants, flash specifications and buffers that are re-used
+/// over all flashes of a calculation. As these contain CAPE-OPEN data types, a
+/// `SaturationFlash` must be used on the thread that created it.
+
+pub(crate) struct SaturationFlash {
+	/// The string literal 'flow'
+	flow : CapeStringImpl,
+	/// The string literal 'mole'
+	mole : CapeStringImpl,
+	/// Empty string literal, used to indicate that no basis applies to a property
+	no_basis : CapeStringImpl,
+	/// The string literal 'pressure'
+	pressure : CapeStringImpl,
+	/// The string literal 'phaseFraction'
+	phase_fraction : CapeStringImpl,
+	/// The string literal 'fraction'
+	fraction : CapeStringImpl,
+	/// The solution type, the string literal 'Unspecified'
+	solution_type : CapeStringImpl,
+	/// The flash condition that identifies overall pressure
+	pressure_condition : CapeArrayStringVec,
+	/// The flash condition that identifies vapor phase fraction
+	vapor_fraction_condition : CapeArrayStringVec,
+	/// Phase status of all phases, unspecified: all phases are allowed, without initial guess
+	phase_status_unspecified : CapeArrayEnumerationVec<cape_open_1_2::CapePhaseStatus>,
+	/// The vapor phase ID
+	vapor_phase_id : CapeStringImpl,
+	/// The liquid phase IDs
+	liquid_phase_ids : CapeArrayStringVec,
+	/// The IDs of all phases
+	phase_ids : CapeArrayStringVec,
+	/// The number of compounds
+	compound_count : usize,
+	/// The compound flow rates, mol/s
+	flow_rates : CapeArrayRealVec,
+	/// The pressure, Pa
+	pressure_value : CapeArrayRealScalar,
+	/// The vapor phase fraction
+	vapor_fraction : CapeArrayRealScalar,
+	/// The vapor composition buffer
+	vapor_composition : CapeArrayRealVec,
+	/// The liquid composition buffer
+	liquid_composition : CapeArrayRealVec,
+	/// The present phases buffer
+	present_phases : CapeArrayStringVec,
+	/// The present phase status buffer
+	present_phase_status : CapeArrayEnumerationVec<cape_open_1_2::CapePhaseStatus>,
+}
+
+impl SaturationFlash {
+
+	/// Creates the constants and buffers for the flashes of a calculation
+	///
+	/// # Arguments:
+	/// * `settings` - The phase information
+	///
+	/// # Returns:
+	/// * The flash
+
+	pub fn new(settings:&FlashSettings) -> Self {
+		let mut phase_status_unspecified=CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>::new();
+		phase_status_unspecified.resize(settings.phase_ids.len(),cape_open_1_2::CapePhaseStatus::CapeUnknownphasestatus);
+		Self {
+			flow : CapeStringImpl::from("flow"),
+			mole : CapeStringImpl::from("mole"),
+			no_basis : CapeStringImpl::new(),
+			pressure : CapeStringImpl::from("pressure"),
+			phase_fraction : CapeStringImpl::from("phaseFraction"),
+			fraction : CapeStringImpl::from("fraction"),
+			solution_type : CapeStringImpl::from("Unspecified"),
+			pressure_condition : CapeArrayStringVec::from_slice(&["pressure","","overall"]),
+			vapor_fraction_condition : CapeArrayStringVec::from_slice(&["phaseFraction","mole",settings.vapor_phase_id.as_str()]),
+			phase_status_unspecified,
+			vapor_phase_id : CapeStringImpl::from(settings.vapor_phase_id.as_str()),
+			liquid_phase_ids : CapeArrayStringVec::from_slice(settings.liquid_phase_ids.as_slice()),
+			phase_ids : CapeArrayStringVec::from_slice(settings.phase_ids.as_slice()),
+			compound_count : settings.compound_count,
+			flow_rates : CapeArrayRealVec::new(),
+			pressure_value : CapeArrayRealScalar::new(),
+			vapor_fraction : CapeArrayRealScalar::new(),
+			vapor_composition : CapeArrayRealVec::new(),
+			liquid_composition : CapeArrayRealVec::new(),
+			present_phases : CapeArrayStringVec::new(),
+			present_phase_status : CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>::new(),
+		}
+	}
+
+	/// Calculate the dew or bubble point and K values at given pressure and composition
+	///
+	/// # Arguments:
+	/// * `stream_name` - The name of the stream, for error messages
+	/// * `material` - The material object on which the flash is performed
+	/// * `flow_rates` - The compound flow rates, mol/s
+	/// * `pressure` - The pressure, Pa
+	/// * `vapor_fraction` - The vapor phase fraction (0 for bubble point, 1 for dew point)
+	/// * `performance` - Records the CAPE-OPEN calls
+	/// * `k_values` - Receives the K values at the phase boundary
+	///
+	/// # Returns:
+	/// * A `Result` indicating success or failure of the calculation process.
+
+	pub fn flash(&mut self,stream_name:&str,material:FlashMaterial,flow_rates:&[f64],pressure:f64,vapor_fraction:f64,performance:&Performance,k_values:&mut Vec<f64>) -> Result<(),COBIAError> {
+		let material_object=material.material_object;
+		let rates=self.flow_rates.as_mut_vec();
+		rates.clear();
+		rates.extend_from_slice(flow_rates);
+		self.pressure_value.set(pressure);
+		self.vapor_fraction.set(vapor_fraction);
+		//set current rate, pressure and vapor fraction, and flash to obtain the dew or bubble point
+		performance.call(ExternalCall::SetOverallProp,|| material_object.set_overall_prop(&self.flow,&self.mole,&self.flow_rates))?;
+		performance.call(ExternalCall::SetOverallProp,|| material_object.set_overall_prop(&self.pressure,&self.no_basis,&self.pressure_value))?;
+		performance.call(ExternalCall::SetSinglePhaseProp,|| material_object.set_single_phase_prop(&self.phase_fraction,&self.vapor_phase_id,&self.mole,&self.vapor_fraction))?;
+		performance.call(ExternalCall::SetPresentPhases,|| material_object.set_present_phases(&self.phase_ids,&self.phase_status_unspecified))?;
+		if let Err(e)=performance.call(ExternalCall::CalcEquilibrium,|| material.equilibrium_routine.calc_equilibrium(&self.pressure_condition,&self.vapor_fraction_condition,&self.solution_type)) {
+			return Err(COBIAError::Message(format!("Error calculating dew or bubble point for {}: {}",stream_name,e)));
+		}
+		//validate that there is a liquid and a vapor phase, and get phase compositions
+		performance.call(ExternalCall::GetPresentPhases,|| material_object.get_present_phases(&mut self.present_phases,&mut self.present_phase_status))?;
+		let mut has_vapor_phase=false;
+		let mut has_liquid_phase=false;
+		for phase_id in self.present_phases.iter() {
+			if phase_id.eq_ignore_case(&self.vapor_phase_id) {
+				has_vapor_phase=true;
+				performance.call(ExternalCall::GetSinglePhaseProp,|| material_object.get_single_phase_prop(&self.fraction,phase_id,&self.mole,&mut self.vapor_composition))?;
+				if self.vapor_composition.size()!=self.compound_count {
+					return Err(COBIAError::Message("Vapor composition has invalid number of elements".into()));
+				}
+			} else if self.liquid_phase_ids.iter().any(|liquid_phase_id| phase_id.eq_ignore_case(liquid_phase_id)) {
+				has_liquid_phase=true;
+				performance.call(ExternalCall::GetSinglePhaseProp,|| material_object.get_single_phase_prop(&self.fraction,phase_id,&self.mole,&mut self.liquid_composition))?;
+				if self.liquid_composition.size()!=self.compound_count {
+					return Err(COBIAError::Message("Liquid composition has invalid number of elements".into()));
+				}
+			}
+			if has_liquid_phase && has_vapor_phase {
+				break; //no need to check further
+			}
+		}
+		if !has_vapor_phase {
+			return Err(COBIAError::Message(format!("No vapor phase present at dew or bubble point for stream '{}'",stream_name)));
+		}
+		if !has_liquid_phase {
+			return Err(COBIAError::Message(format!("No liquid phase present at dew or bubble point for stream '{}'",stream_name)));
+		}
+		//get the K values
+		k_values.clear();
+		for (y,x) in self.vapor_composition.as_vec().iter().zip(self.liquid_composition.as_vec().iter()) {
+			//avoid numerical errors by assuming a lower limit of 1e-15 mol/mol on composition
+			k_values.push(f64::max(*y,1e-15)/f64::max(*x,1e-15)); // k = y/x
+		}
+		Ok(())
+	}
+}
+
+/// Run two tasks concurrently and return both results.
+///
+/// The first task runs on the calling thread, the second task runs on a scoped
+/// thread. A panic in either task is propagated to the caller.
+///
+/// # Arguments:
+/// * `first` - The task that runs on the calling thread
+/// * `second` - The task that runs on another thread
+///
+/// # Returns:
+/// * The results of both tasks
+
+pub(crate) fn join<A,B,RA,RB>(first:A,second:B) -> (RA,RB)
+	where A: FnOnce() -> RA, B: FnOnce() -> RB + Send, RB: Send {
+	std::thread::scope(|scope| {
+		let handle=scope.spawn(second);
+		let first_result=first();
+		let second_result=match handle.join() {
+			Ok(result) => result,
+			Err(panic) => std::panic::resume_unwind(panic),
+		};
+		(first_result,second_result)
+	})
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	fn assert_send_sync<T:Send+Sync>() {}
+
+	#[test]
+	fn settings_can_be_shared() {
+		assert_send_sync::<FlashSettings>();
+		assert_send_sync::<Performance>();
+	}
+
+	#[test]
+	fn join_runs_second_task_on_other_thread() {
+		let caller=std::thread::current().id();
+		let (first,second)=join(|| std::thread::current().id(),|| std::thread::current().id());
+		assert_eq!(first,caller);
+		assert_ne!(second,caller);
+	}
+
+	#[test]
+	fn join_returns_both_results() {
+		let mut values=vec![1.0,2.0];
+		let (first,second)=join(|| 3,|| {values.push(4.0);values.len()});
+		assert_eq!(first,3);
+		assert_eq!(second,3);
+		assert_eq!(values,[1.0,2.0,4.0]);
+	}
+
+	#[test]
+	#[should_panic(expected="second task")]
+	fn join_propagates_panic() {
+		join(|| (),|| panic!("second task"));
+	}
+}
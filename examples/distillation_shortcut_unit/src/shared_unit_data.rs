@@ -13,6 +13,8 @@ pub(crate) struct SharedUnitData {
 	pub validation_status : cobia::cape_open_1_2::CapeValidationStatus,
 	// The dirty flag for the unit operation. If the unit is dirty, it need saving
 	pub dirty: bool,
+	/// The number of times a port was connected or disconnected; identifies the current port connections
+	pub port_connections: u64,
 }
 
 /// All objects that need access to SharedUnitData are outlived by its owner, which 
@@ -34,6 +36,7 @@ impl std::default::Default for SharedUnitData {
 			name: std::default::Default::default(),
 			validation_status: cobia::cape_open_1_2::CapeValidationStatus::CapeNotValidated,
 			dirty:false,
+			port_connections:0,
 		}
 	}
 }
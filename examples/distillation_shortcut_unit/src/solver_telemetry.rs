@@ -0,0 +1,96 @@
+use root_finding::{SolverStatistics,SolverTotals};
+use std::fmt::Write;
+
+/// The `SolverTelemetry` struct collects convergence information of the iterative
+/// solves that are performed by the distillation shortcut unit.
+///
+/// The unit performs two iterative solves per calculation: the Fenske product
+/// distribution, which is converged by successive substitution on the product
+/// flashes, and the Underwood root. For the Fenske iteration, a function
+/// evaluation is a pair of product flashes, and the residual is the largest
+/// change in a compound flow rate in the last iteration.
+///
+/// The statistics of the most recent calculation are kept, as well as totals over all
+/// calculations since the unit was created, so that the convergence behaviour of the
+/// unit can be monitored over a flowsheet run. The telemetry is exposed as a report
+/// through the ICapeReport interface.
+
+#[derive(Default)]
+pub(crate) struct SolverTelemetry {
+	/// Statistics of the Fenske iteration in the last calculation
+	pub fenske : SolverStatistics,
+	/// Fenske statistics since creation of the unit
+	pub fenske_totals : SolverTotals,
+	/// Statistics of the Underwood solve in the last calculation
+	pub underwood : SolverStatistics,
+	/// Underwood statistics since creation of the unit
+	pub underwood_totals : SolverTotals,
+}
+
+impl SolverTelemetry {
+
+	/// Add the statistics of the last Fenske iteration to the totals.
+	///
+	/// Must be called after each Fenske iteration, regardless of its success.
+
+	pub fn record_fenske(&mut self) {
+		self.fenske_totals.record(&self.fenske);
+	}
+
+	/// Add the statistics of the last Underwood solve to the totals.
+	///
+	/// Must be called after each Underwood solve, regardless of its success.
+
+	pub fn record_underwood(&mut self) {
+		self.underwood_totals.record(&self.underwood);
+	}
+
+	/// Render the telemetry as plain text.
+	///
+	/// # Returns:
+	/// * The telemetry report
+
+	pub fn report(&self) -> String {
+		let mut report=String::new();
+		let _=writeln!(report,"Last calculation:");
+		Self::write_last(&mut report,"Fenske",&self.fenske);
+		Self::write_last(&mut report,"Underwood",&self.underwood);
+		let _=writeln!(report,"All calculations:");
+		Self::write_totals(&mut report,"Fenske",&self.fenske_totals);
+		Self::write_totals(&mut report,"Underwood",&self.underwood_totals);
+		report
+	}
+
+	/// Render the statistics of a single solve.
+	///
+	/// # Arguments:
+	/// * `report` - The report to append to
+	/// * `solver` - The name of the solve
+	/// * `statistics` - The statistics of the solve
+
+	fn write_last(report:&mut String,solver:&str,statistics:&SolverStatistics) {
+		let _=writeln!(report,"  {} iterations: {}",solver,statistics.iterations);
+		let _=writeln!(report,"  {} function evaluations: {}",solver,statistics.function_evaluations);
+		let _=writeln!(report,"  {} bisection steps: {}",solver,statistics.bisection_steps);
+		let _=writeln!(report,"  {} residual: {:e}",solver,statistics.residual);
+		let _=writeln!(report,"  {} converged: {}",solver,statistics.converged);
+	}
+
+	/// Render the statistics accumulated over all solves.
+	///
+	/// # Arguments:
+	/// * `report` - The report to append to
+	/// * `solver` - The name of the solve
+	/// * `totals` - The accumulated statistics
+
+	fn write_totals(report:&mut String,solver:&str,totals:&SolverTotals) {
+		let _=writeln!(report,"  {} solves: {}",solver,totals.solves);
+		let _=writeln!(report,"  {} failed solves: {}",solver,totals.failures);
+		let _=writeln!(report,"  {} iterations: {}",solver,totals.iterations);
+		let _=writeln!(report,"  {} function evaluations: {}",solver,totals.function_evaluations);
+		let _=writeln!(report,"  {} maximum iterations per solve: {}",solver,totals.maximum_iterations);
+		if let Some(average)=totals.average_iterations() {
+			let _=writeln!(report,"  {} average iterations per solve: {:.2}",solver,average);
+		}
+	}
+}
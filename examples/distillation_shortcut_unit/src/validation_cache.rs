@@ -0,0 +1,266 @@
+use cobia::*;
+use cobia::prelude::CapeSmartPointer;
+use std::hash::{Hash,Hasher};
+use crate::performance::{Performance,ExternalCall};
+
+/// Identity of the material object connected to a port.
+///
+/// The token consists of the address of the connected object, and a hash of its
+/// compound list and phase list. If the port is reconnected, or the compounds
+/// or phases of the material object change, the token changes.
+
+#[derive(Clone,Copy,PartialEq,Debug)]
+pub(crate) struct PortToken {
+	/// Address of the connected material object
+	pub object : usize,
+	/// Hash of the compound list and phase list
+	pub lists : u64,
+}
+
+/// The compound list and phase list of a material object.
+///
+/// The buffers are re-used between validations.
+
+pub(crate) struct MaterialLists {
+	/// The compound IDs
+	pub compound_ids : CapeArrayStringVec,
+	/// The compound formulae
+	pub compound_formulae : CapeArrayStringVec,
+	/// The compound names
+	pub compound_names : CapeArrayStringVec,
+	/// The compound normal boiling points
+	pub boil_temps : CapeArrayRealVec,
+	/// The compound molecular weights
+	pub molwts : CapeArrayRealVec,
+	/// The compound CAS registry numbers
+	pub casnos : CapeArrayStringVec,
+	/// The phase IDs
+	pub phase_ids : CapeArrayStringVec,
+	/// The states of aggregation of the phases
+	pub states_of_aggregation : CapeArrayStringVec,
+	/// The key compounds of the phases
+	pub key_compound_ids : CapeArrayStringVec,
+}
+
+impl MaterialLists {
+
+	/// Creates empty lists
+	pub fn new() -> Self {
+		Self {
+			compound_ids : CapeArrayStringVec::new(),
+			compound_formulae : CapeArrayStringVec::new(),
+			compound_names : CapeArrayStringVec::new(),
+			boil_temps : CapeArrayRealVec::new(),
+			molwts : CapeArrayRealVec::new(),
+			casnos : CapeArrayStringVec::new(),
+			phase_ids : CapeArrayStringVec::new(),
+			states_of_aggregation : CapeArrayStringVec::new(),
+			key_compound_ids : CapeArrayStringVec::new(),
+		}
+	}
+
+	/// Obtain the compound list and phase list of a material object
+	///
+	/// # Arguments:
+	/// * `material_object` - The material object connected to a port
+	/// * `performance` - Records the CAPE-OPEN calls
+	///
+	/// # Returns:
+	/// * The identity token of the material object, or an error if the lists cannot be obtained
+
+	pub fn query(&mut self,material_object:&cape_open_1_2::CapeThermoMaterial,performance:&Performance) -> Result<PortToken,COBIAError> {
+		let compounds=cape_open_1_2::CapeThermoCompounds::from_object(material_object)?;
+		performance.call(ExternalCall::GetCompoundList,|| compounds.get_compound_list(
+				&mut self.compound_ids,
+				&mut self.compound_formulae,
+				&mut self.compound_names,
+				&mut self.boil_temps,
+				&mut self.molwts,
+				&mut self.casnos))?;
+		let phases=cape_open_1_2::CapeThermoPhases::from_object(material_object)?;
+		performance.call(ExternalCall::GetPhaseList,|| phases.get_phase_list(&mut self.phase_ids,&mut self.states_of_aggregation,&mut self.key_compound_ids))?;
+		Ok(PortToken {
+			object : material_object.as_interface_pointer() as usize,
+			lists : self.hash(),
+		})
+	}
+
+	/// Hash of the lists
+	///
+	/// All lists are included: besides the compounds and phases, the compound constants
+	/// reflect the configuration of the property package behind the material object.
+	///
+	/// # Returns:
+	/// * The hash
+
+	pub fn hash(&self) -> u64 {
+		let mut hasher=std::hash::DefaultHasher::new();
+		for list in [&self.compound_ids,&self.compound_formulae,&self.compound_names,&self.casnos,&self.phase_ids,&self.states_of_aggregation,&self.key_compound_ids] {
+			hasher.write_usize(list.size());
+			for item in list.iter() {
+				item.hash(&mut hasher);
+			}
+		}
+		for list in [&self.boil_temps,&self.molwts] {
+			hasher.write_usize(list.size());
+			for value in list.as_vec().iter() {
+				hasher.write_u64(value.to_bits());
+			}
+		}
+		hasher.finish()
+	}
+}
+
+/// Cache of the outcome of port validation.
+///
+/// Validation of the ports checks the consistency of the compound and phase lists of the
+/// connected material objects, and determines the vapor and liquid phase IDs. The lists are
+/// obtained on each validation; the outcome is kept together with the identity tokens of the
+/// feed, distillate and bottoms ports, and the checks are skipped as long as the tokens
+/// do not change.
+///
+/// The port connection count of the unit, which changes whenever a port is connected or
+/// disconnected, is stored as well. A changed count is a miss without looking at the tokens;
+/// this also catches a material object that is reconnected at the address of a previous one.
+/// Only successful port validation is cached.
+
+pub(crate) struct ValidationCache {
+	/// Lists of the material objects connected to feed, distillate and bottoms
+	pub ports : [MaterialLists;3],
+	/// Port connection count and tokens of the ports at the last successful port validation
+	validated : Option<(u64,[PortToken;3])>,
+	/// Number of port validations that were skipped, since creation of the unit
+	pub hits : u64,
+}
+
+impl std::default::Default for ValidationCache {
+	/// Creates an empty cache
+	fn default() -> Self {
+		Self {
+			ports : [MaterialLists::new(),MaterialLists::new(),MaterialLists::new()],
+			validated : None,
+			hits : 0,
+		}
+	}
+}
+
+impl ValidationCache {
+
+	/// Check whether the ports are unchanged since the last successful port validation
+	///
+	/// # Arguments:
+	/// * `port_connections` - The current port connection count of the unit
+	/// * `tokens` - The current tokens of feed, distillate and bottoms
+	///
+	/// # Returns:
+	/// * Whether port validation can be skipped
+
+	pub fn matches(&mut self,port_connections:u64,tokens:&[PortToken;3]) -> bool {
+		match &self.validated {
+			Some((validated_connections,validated_tokens)) if *validated_connections==port_connections && validated_tokens==tokens => {
+				self.hits+=1;
+				true
+			},
+			_ => false
+		}
+	}
+
+	/// The tokens of the ports at the last successful port validation
+	///
+	/// # Returns:
+	/// * The tokens of feed, distillate and bottoms, or None if the ports are not validated
+
+	pub fn tokens(&self) -> Option<&[PortToken;3]> {
+		self.validated.as_ref().map(|(_,tokens)| tokens)
+	}
+
+	/// Record successful port validation
+	///
+	/// # Arguments:
+	/// * `port_connections` - The port connection count of the unit at validation
+	/// * `tokens` - The tokens of feed, distillate and bottoms
+
+	pub fn store(&mut self,port_connections:u64,tokens:[PortToken;3]) {
+		self.validated=Some((port_connections,tokens));
+	}
+
+	/// Drop the cached outcome
+	pub fn invalidate(&mut self) {
+		self.validated=None;
+	}
+}
+
+#[cfg(test)]
+mod tests {
+	use super::*;
+
+	/// Tokens of three material objects with the given list hash
+	fn tokens(lists:u64) -> [PortToken;3] {
+		[1,2,3].map(|object| PortToken{object,lists})
+	}
+
+	#[test]
+	fn empty_cache_does_not_match() {
+		let mut cache=ValidationCache::default();
+		assert!(!cache.matches(0,&tokens(7)));
+		assert_eq!(cache.hits,0);
+		assert!(cache.tokens().is_none());
+	}
+
+	#[test]
+	fn matches_stored_tokens() {
+		let mut cache=ValidationCache::default();
+		cache.store(3,tokens(7));
+		assert!(cache.matches(3,&tokens(7)));
+		assert!(cache.matches(3,&tokens(7)));
+		assert_eq!(cache.hits,2);
+		assert_eq!(cache.tokens(),Some(&tokens(7)));
+	}
+
+	#[test]
+	fn reconnection_does_not_match() {
+		let mut cache=ValidationCache::default();
+		cache.store(3,tokens(7));
+		//same objects and lists, but a port was reconnected in between
+		assert!(!cache.matches(4,&tokens(7)));
+		assert_eq!(cache.hits,0);
+		cache.store(4,tokens(7));
+		assert!(!cache.matches(3,&tokens(7)));
+		assert!(cache.matches(4,&tokens(7)));
+		//other object at the distillate port
+		let mut other=tokens(7);
+		other[1].object=4;
+		assert!(!cache.matches(4,&other));
+	}
+
+	#[test]
+	fn compound_change_does_not_match() {
+		let mut feed=MaterialLists::new();
+		feed.compound_ids=CapeArrayStringVec::from(&["benzene","toluene"]);
+		feed.phase_ids=CapeArrayStringVec::from(&["Vapor","Liquid"]);
+		feed.states_of_aggregation=CapeArrayStringVec::from(&["Vapor","Liquid"]);
+		let before=feed.hash();
+		let mut cache=ValidationCache::default();
+		cache.store(3,tokens(before));
+		//the compound list changes while the port stays connected to the same object
+		feed.compound_ids=CapeArrayStringVec::from(&["benzene","toluene","xylene"]);
+		let after=feed.hash();
+		assert_ne!(before,after);
+		assert!(!cache.matches(3,&tokens(after)));
+		assert_eq!(cache.hits,0);
+		//so does the phase list
+		feed.compound_ids=CapeArrayStringVec::from(&["benzene","toluene"]);
+		assert_eq!(feed.hash(),before);
+		feed.states_of_aggregation=CapeArrayStringVec::from(&["Vapor","Solid"]);
+		assert!(!cache.matches(3,&tokens(feed.hash())));
+	}
+
+	#[test]
+	fn invalidate_drops_outcome() {
+		let mut cache=ValidationCache::default();
+		cache.store(3,tokens(7));
+		cache.invalidate();
+		assert!(!cache.matches(3,&tokens(7)));
+		assert!(cache.tokens().is_none());
+	}
+}
@@ -512,67 +512,44 @@ pub fn enthalpy_d_x_nacl(temperature: f64,pressure: f64, x_nacl: f64) -> Result<
 ///
 /// This calculation underlies the pressure-enthalpy flash
 ///
-/// Enthalpy is a monotonic function of temperature; a simple 
-/// bracketing and bisection approach is used where the amount
-/// that is bisected is estimated from a limited Newton step,
-/// with the derivative estimated from the bracket; a step
-/// size limiter of 95% if the bracketed domain is imposed.
+/// Enthalpy is a monotonic function of temperature; Newton's
+/// method is applied with the analytical derivative, safeguarded
+/// by bisection so that the solution remains within the bracket
+/// of the valid temperature range.
 ///
 /// # Arguments:
 /// * `enthalpy_value` - enthalpy, J/mol
 /// * `pressure` - pressure, Pa
 /// * `x_nacl` - NaCl mole fraction, mol/mol
+/// * `statistics` - receives the convergence statistics of the solve
 ///
 /// # Returns
 /// Temperature, K, or an error
-pub fn solve_temperature_from_enthalpy(enthalpy_value: f64,pressure: f64, x_nacl: f64) -> Result<f64,String> {
+pub fn solve_temperature_from_enthalpy(enthalpy_value: f64,pressure: f64, x_nacl: f64,statistics: &mut root_finding::SolverStatistics) -> Result<f64,String> {
+	statistics.reset();
 	//get enthalpy at lower limit
-	let mut t_min=273.15;
+	let t_min=273.15;
 	let h_min=enthalpy(t_min,pressure,x_nacl)?;
 	//get enthalpy at upper limit
-	let mut t_max=393.15;
+	let t_max=393.15;
 	let h_max=enthalpy(t_max,pressure,x_nacl)?;
 	//check if bracketed
 	if (h_min-enthalpy_value)*(h_max-enthalpy_value)>0.0 {
 		return Err(format!("no solution for enthalpy of {} J/mol, pressure of {} Pa, NaCl mole fraction of {} mol/mol within valid temperature range of [273.15,393.15] K",enthalpy_value,pressure,x_nacl));
 	}
 	//initial guess: linear interpolation
-	let mut temperature=t_min+(enthalpy_value-h_min)/(h_max-h_min)*(t_max-t_min);
-	let max_iterations=100;
-	let mut iteration=0;
-	while iteration<max_iterations {
-		//get enthalpty at current T
-		let h=enthalpy(temperature,pressure,x_nacl)?;
-		//check for convergence
-		if f64::abs(h-enthalpy_value)<1e-10*f64::abs(enthalpy_value) {
-			return Ok(temperature);
-		}
-		//get derivative
-		let dh_dt=enthalpy_d_temperature(temperature,pressure,x_nacl)?;
-		//determine newton step
-		let mut delta_t=(enthalpy_value-h)/dh_dt;
-		//check against brackets
-		if delta_t>0.0 {
-			let lim=temperature+0.95*(t_max-temperature);
-			if temperature+delta_t>lim {
-				delta_t=lim-temperature;
-			}
-		} else {
-			let lim=temperature-0.95*(temperature-t_min);
-			if temperature+delta_t<lim {
-				delta_t=lim-temperature;
-			}
-		}
-		//update bracket, temperature and iteration
-		if delta_t>0.0 {
-			t_min=temperature;
-		} else {
-			t_max=temperature;
-		}
-		temperature+=delta_t;
-		iteration+=1;
-	}
-	Err(format!("could not converge to temperature for enthalpy of {} J/mol, pressure of {} Pa, NaCl mole fraction of {} mol/mol",enthalpy_value,pressure,x_nacl))
+	let temperature=t_min+(enthalpy_value-h_min)/(h_max-h_min)*(t_max-t_min);
+	let settings=root_finding::SolverSettings {
+		x_tolerance:1e-10,
+		f_tolerance:1e-10*f64::abs(enthalpy_value),
+		maximum_iterations:100,
+	};
+	root_finding::newton_bracketed(|temperature| {
+			let h=enthalpy(temperature,pressure,x_nacl)?;
+			let dh_dt=enthalpy_d_temperature(temperature,pressure,x_nacl)?;
+			Ok((h-enthalpy_value,dh_dt))
+		},t_min,t_max,temperature,&settings,statistics)
+		.or_else(|e| Err(format!("could not converge to temperature for enthalpy of {} J/mol, pressure of {} Pa, NaCl mole fraction of {} mol/mol: {}",enthalpy_value,pressure,x_nacl,e)))
 }
 
 /// Entropy
@@ -729,67 +706,44 @@ pub fn entropy_d_x_nacl(temperature: f64,pressure: f64, x_nacl: f64) -> Result<f
 /// This calculation underlies the pressure-enthalpy flash
 ///
 /// Within the validity of this equation, entropy 
-/// is a monotonic function of temperature; a simple 
-/// bracketing and bisection approach is used where the amount
-/// that is bisected is estimated from a limited Newton step,
-/// with the derivative estimated from the bracket; a step
-/// size limiter of 95% if the bracketed domain is imposed.
+/// is a monotonic function of temperature; Newton's
+/// method is applied with the analytical derivative, safeguarded
+/// by bisection so that the solution remains within the bracket
+/// of the valid temperature range.
 ///
 /// # Arguments:
 /// * `entropy_value` - entropy, J/mol/K
 /// * `pressure` - pressure, Pa
 /// * `x_nacl` - NaCl mole fraction, mol/mol
+/// * `statistics` - receives the convergence statistics of the solve
 ///
 /// # Returns
 /// Temperature, K, or an error
-pub fn solve_temperature_from_entropy(entropy_value: f64,pressure: f64, x_nacl: f64) -> Result<f64,String> {
+pub fn solve_temperature_from_entropy(entropy_value: f64,pressure: f64, x_nacl: f64,statistics: &mut root_finding::SolverStatistics) -> Result<f64,String> {
+	statistics.reset();
 	//get entropy at lower limit
-	let mut t_min=273.15;
+	let t_min=273.15;
 	let h_min=entropy(t_min,pressure,x_nacl)?;
 	//get entropy at upper limit
-	let mut t_max=393.15;
+	let t_max=393.15;
 	let h_max=entropy(t_max,pressure,x_nacl)?;
 	//check if bracketed
 	if (h_min-entropy_value)*(h_max-entropy_value)>0.0 {
 		return Err(format!("no solution for entropy of {} J/mol, pressure of {} Pa, NaCl mole fraction of {} mol/mol within valid temperature range of [273.15,393.15] K",entropy_value,pressure,x_nacl));
 	}
 	//initial guess: linear interpolation
-	let mut temperature=t_min+(entropy_value-h_min)/(h_max-h_min)*(t_max-t_min);
-	let max_iterations=100;
-	let mut iteration=0;
-	while iteration<max_iterations {
-		//get enthalpty at current T
-		let s=entropy(temperature,pressure,x_nacl)?;
-		//check for convergence
-		if f64::abs(s-entropy_value)<1e-10*f64::abs(entropy_value) {
-			return Ok(temperature);
-		}
-		//get derivative
-		let ds_dt=entropy_d_temperature(temperature,pressure,x_nacl)?;
-		//determine newton step
-		let mut delta_t=(entropy_value-s)/ds_dt;
-		//check against brackets
-		if delta_t>0.0 {
-			let lim=temperature+0.95*(t_max-temperature);
-			if temperature+delta_t>lim {
-				delta_t=lim-temperature;
-			}
-		} else {
-			let lim=temperature-0.95*(temperature-t_min);
-			if temperature+delta_t<lim {
-				delta_t=lim-temperature;
-			}
-		}
-		//update bracket, temperature and iteration
-		if delta_t>0.0 {
-			t_min=temperature;
-		} else {
-			t_max=temperature;
-		}
-		temperature+=delta_t;
-		iteration+=1;
-	}
-	Err(format!("could not converge to temperature for entropy of {} J/mol, pressure of {} Pa, NaCl mole fraction of {} mol/mol",entropy_value,pressure,x_nacl))
+	let temperature=t_min+(entropy_value-h_min)/(h_max-h_min)*(t_max-t_min);
+	let settings=root_finding::SolverSettings {
+		x_tolerance:1e-10,
+		f_tolerance:1e-10*f64::abs(entropy_value),
+		maximum_iterations:100,
+	};
+	root_finding::newton_bracketed(|temperature| {
+			let s=entropy(temperature,pressure,x_nacl)?;
+			let ds_dt=entropy_d_temperature(temperature,pressure,x_nacl)?;
+			Ok((s-entropy_value,ds_dt))
+		},t_min,t_max,temperature,&settings,statistics)
+		.or_else(|e| Err(format!("could not converge to temperature for entropy of {} J/mol/K, pressure of {} Pa, NaCl mole fraction of {} mol/mol: {}",entropy_value,pressure,x_nacl,e)))
 }
 
 /// Density
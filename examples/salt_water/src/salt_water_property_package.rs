@@ -3,6 +3,8 @@ use crate::salt_water_calculator;
 use crate::property_tables;
 use crate::phase_equilibrium_type::PhaseEquilibriumType;
 use strum::{EnumCount, IntoEnumIterator};
+use root_finding::{SolverStatistics,SolverTotals};
+use std::fmt::Write;
 
 ///The SaltWaterPropertyPackage is an example of a property package that implements the 
 /// CAPE-OPEN 1.2 standard.
@@ -21,6 +23,9 @@ use strum::{EnumCount, IntoEnumIterator};
 /// - ICapeThermoEquilibriumRoutine
 /// - ICapeThermoUniversalConstant (optional)
 ///
+/// The package also implements ICapeReport, to report the convergence of the
+/// temperature solves of the pressure-enthalpy and pressure-entropy flashes.
+///
 /// The package is creatable; the public CAPE-OPEN class factory is implemented in lib.rs;
 /// to facilitate the registration of this object into the COBIA registry, the object implements
 /// the PMCRegisterationInfo trait.
@@ -36,7 +41,8 @@ use strum::{EnumCount, IntoEnumIterator};
 			cape_open_1_2::ICapeThermoPhases,
 			cape_open_1_2::ICapeThermoPropertyRoutine,
 			cape_open_1_2::ICapeThermoEquilibriumRoutine,
-			cape_open_1_2::ICapeThermoUniversalConstant
+			cape_open_1_2::ICapeThermoUniversalConstant,
+			cape_open_1_2::ICapeReport
 		}
   )]
 pub(crate) struct SaltWaterPropertyPackage {
@@ -75,6 +81,15 @@ pub(crate) struct SaltWaterPropertyPackage {
 	property_value : CapeArrayRealVec,
 	/// Buffer for scalar properties for obtaining property values from the active material object
 	scalar_property_value : CapeArrayRealScalar,
+	//*****************
+	//solver statistics
+	//*****************
+	/// Convergence statistics of the last temperature solve
+	solver_statistics : SolverStatistics,
+	/// Statistics of the temperature solves of pressure-enthalpy flashes since creation of the package
+	enthalpy_solver_totals : SolverTotals,
+	/// Statistics of the temperature solves of pressure-entropy flashes since creation of the package
+	entropy_solver_totals : SolverTotals,
 	//****************
 	//constant strings
 	//****************
@@ -100,6 +115,12 @@ pub(crate) struct SaltWaterPropertyPackage {
 	nacl : CapeStringConstNoCase,
 	/// The string "Liquid" used to check against the specified phase in property calculations
 	liquid: CapeStringConstNoCase,
+	/// The name of the solver statistics report
+	solver_report_name: CapeStringConstNoCase,
+	/// The MIME type of the solver statistics report
+	text_plain: CapeStringConstNoCase,
+	/// The locale of the solver statistics report
+	en: CapeStringConstNoCase,
 }
 
 /// Implementation of the Default trait is required for creatable CAPE-OPEN objects
@@ -124,6 +145,9 @@ impl std::default::Default for SaltWaterPropertyPackage {
 			phase_status : CapeArrayEnumerationVec::<cape_open_1_2::CapePhaseStatus>::new(),
 			property_value : CapeArrayRealVec::new(),
 			scalar_property_value: CapeArrayRealScalar::new(),
+			solver_statistics : SolverStatistics::default(),
+			enthalpy_solver_totals : SolverTotals::default(),
+			entropy_solver_totals : SolverTotals::default(),
 			fraction : CapeStringImpl::from_string("fraction"),
 			temperature: CapeStringImpl::from_string("temperature"),
 			pressure : CapeStringImpl::from_string("pressure"),
@@ -135,6 +159,9 @@ impl std::default::Default for SaltWaterPropertyPackage {
 			h2o : CapeStringConstNoCase::from_string("H2O"),
 			nacl : CapeStringConstNoCase::from_string("NaCl"),
 			liquid: CapeStringConstNoCase::from_string("Liquid"),
+			solver_report_name: CapeStringConstNoCase::from_string(Self::SOLVER_REPORT_NAME),
+			text_plain: CapeStringConstNoCase::from_string("text/plain"),
+			en: CapeStringConstNoCase::from_string("en"),
 		}
 	}
 }
@@ -163,6 +190,8 @@ impl SaltWaterPropertyPackage {
 	const COMP_SMILES: [&'static str;2]=["O","[Na+].[Cl-]"];
 	/// The list of compound IUPAC names for the two compounds in the package
 	const COMP_IUPAC_NAMES: [&'static str;2]=["oxidane","sodium;chloride"];
+	/// The name of the solver statistics report
+	const SOLVER_REPORT_NAME: &'static str = "Solver Statistics";
 
 
 	/// This function is called at the start of any function that requires the context 
@@ -232,6 +261,57 @@ impl SaltWaterPropertyPackage {
 			Ok(())
 		}
 	}
+
+	/// Check a report specification
+	///
+	/// # Arguments
+	/// * `name` - The name of the report
+	/// * `mime_type` - The MIME type of the report; empty selects plain text
+	/// * `locale` - The locale of the report; empty selects English
+	///
+	/// # Returns
+	/// * `Result` - Ok if the report specification is supported
+
+	fn check_report(&self,name:&CapeStringIn,mime_type:&CapeStringIn,locale:&CapeStringIn) -> Result<(),COBIAError> {
+		if self.solver_report_name!=*name {
+			return Err(COBIAError::Message("Invalid report name".to_string()));
+		}
+		if !mime_type.is_empty() && self.text_plain!=*mime_type {
+			return Err(COBIAError::Message("Invalid/unsupported report mime type".to_string()));
+		}
+		if !locale.is_empty() && self.en!=*locale {
+			return Err(COBIAError::Message("Invalid/unsupported report locale".to_string()));
+		}
+		Ok(())
+	}
+
+	/// Render the solver statistics report
+	///
+	/// # Returns
+	/// * The convergence statistics of the last temperature solve, and totals per flash type
+
+	fn solver_report(&self) -> String {
+		let mut report=String::new();
+		let statistics=&self.solver_statistics;
+		let _=writeln!(report,"Last temperature solve:");
+		let _=writeln!(report,"  Iterations: {}",statistics.iterations);
+		let _=writeln!(report,"  Function evaluations: {}",statistics.function_evaluations);
+		let _=writeln!(report,"  Bisection steps: {}",statistics.bisection_steps);
+		let _=writeln!(report,"  Residual: {:e}",statistics.residual);
+		let _=writeln!(report,"  Converged: {}",statistics.converged);
+		for (flash,totals) in [("Pressure-enthalpy",&self.enthalpy_solver_totals),("Pressure-entropy",&self.entropy_solver_totals)] {
+			let _=writeln!(report,"{} flashes:",flash);
+			let _=writeln!(report,"  Temperature solves: {}",totals.solves);
+			let _=writeln!(report,"  Failed solves: {}",totals.failures);
+			let _=writeln!(report,"  Iterations: {}",totals.iterations);
+			let _=writeln!(report,"  Function evaluations: {}",totals.function_evaluations);
+			let _=writeln!(report,"  Maximum iterations per solve: {}",totals.maximum_iterations);
+			if let Some(average)=totals.average_iterations() {
+				let _=writeln!(report,"  Average iterations per solve: {:.2}",average);
+			}
+		}
+		report
+	}
 }
 
 /// The Display trait is required; it is used by the COBIA package to format the 
@@ -1218,7 +1298,9 @@ impl cape_open_1_2::ICapeThermoEquilibriumRoutine for SaltWaterPropertyPackage {
 				material.get_overall_prop(&self.enthalpy,&self.mole,&mut self.scalar_property_value)?;
 				let enthalpy=self.scalar_property_value.value();
 				//calculate temperature to match enthaply
-				match salt_water_calculator::solve_temperature_from_enthalpy(enthalpy,pressure,x_nacl) {
+				let solution=salt_water_calculator::solve_temperature_from_enthalpy(enthalpy,pressure,x_nacl,&mut self.solver_statistics);
+				self.enthalpy_solver_totals.record(&self.solver_statistics);
+				match solution {
 					Ok(value) => temperature=value,
 					Err(e) => return Err(COBIAError::Message(e))
 				}
@@ -1240,7 +1322,9 @@ impl cape_open_1_2::ICapeThermoEquilibriumRoutine for SaltWaterPropertyPackage {
 					}
 				};
 				//calculate temperature to match enthaply
-				match salt_water_calculator::solve_temperature_from_entropy(entropy,pressure,x_nacl) {
+				let solution=salt_water_calculator::solve_temperature_from_entropy(entropy,pressure,x_nacl,&mut self.solver_statistics);
+				self.entropy_solver_totals.record(&self.solver_statistics);
+				match solution {
 					Ok(value) => temperature=value,
 					Err(e) => return Err(COBIAError::Message(e))
 				}
@@ -1361,3 +1445,104 @@ impl cape_open_1_2::ICapeThermoUniversalConstant for SaltWaterPropertyPackage {
     }
 }
 
+/// The ICapeReport interface is optional; it is implemented to report the convergence
+/// of the temperature solves of the pressure-enthalpy and pressure-entropy flashes.
+
+impl cape_open_1_2::ICapeReport for SaltWaterPropertyPackage {
+
+	/// Get the names of the available reports
+	///
+	/// # Arguments
+	/// * `names` - Receives the report names
+	///
+	/// # Returns
+	/// * `Result` - A result object that indicates whether the operation was successful or not
+
+	fn get_report_names(&mut self,names:&mut CapeArrayStringOut) -> Result<(),COBIAError> {
+		names.resize(1)?;
+		names.at(0)?.set(&self.solver_report_name)?;
+		Ok(())
+	}
+
+	/// Get the MIME types available for a report
+	///
+	/// # Arguments
+	/// * `name` - The name of the report
+	/// * `types` - Receives the MIME types
+	///
+	/// # Returns
+	/// * `Result` - A result object that indicates whether the operation was successful or not
+
+	fn report_types(&mut self,name:&CapeStringIn,types:&mut CapeArrayStringOut) -> Result<(),COBIAError> {
+		if self.solver_report_name!=*name {
+			return Err(COBIAError::Code(COBIAERR_INVALIDARGUMENT));
+		}
+		types.put_array(&["text/plain"])
+	}
+
+	/// Get the locales available for a report
+	///
+	/// # Arguments
+	/// * `name` - The name of the report
+	/// * `_type` - The MIME type of the report
+	/// * `locales` - Receives the locales
+	///
+	/// # Returns
+	/// * `Result` - A result object that indicates whether the operation was successful or not
+
+	fn report_locales(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locales:&mut CapeArrayStringOut) -> Result<(),COBIAError> {
+		if self.solver_report_name!=*name {
+			return Err(COBIAError::Code(COBIAERR_INVALIDARGUMENT));
+		}
+		locales.put_array(&["en"])
+	}
+
+	/// Check whether a report specification is supported
+	///
+	/// # Arguments
+	/// * `name` - The name of the report
+	/// * `_type` - The MIME type of the report
+	/// * `locale` - The locale of the report
+	///
+	/// # Returns
+	/// * `Result` - Whether the report specification is supported
+
+	fn check_report_spec(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locale:&CapeStringIn) -> Result<CapeBoolean,COBIAError> {
+		Ok(self.check_report(name,_type,locale).is_ok() as CapeBoolean)
+	}
+
+	/// Generate a report
+	///
+	/// # Arguments
+	/// * `name` - The name of the report
+	/// * `_type` - The MIME type of the report
+	/// * `locale` - The locale of the report
+	/// * `report_content` - Receives the report
+	///
+	/// # Returns
+	/// * `Result` - A result object that indicates whether the operation was successful or not
+
+	fn generate_report(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locale:&CapeStringIn,report_content:&mut CapeStringOut) -> Result<(),COBIAError> {
+		self.check_report(name,_type,locale)?;
+		report_content.set_string(self.solver_report())
+	}
+
+	/// Generate a report to a file
+	///
+	/// # Arguments
+	/// * `name` - The name of the report
+	/// * `_type` - The MIME type of the report
+	/// * `locale` - The locale of the report
+	/// * `file_name` - The name of the file to write the report to
+	///
+	/// # Returns
+	/// * `Result` - A result object that indicates whether the operation was successful or not
+
+	fn generate_report_file(&mut self,name:&CapeStringIn,_type:&CapeStringIn,locale:&CapeStringIn,file_name:&CapeStringIn) -> Result<(),COBIAError> {
+		self.check_report(name,_type,locale)?;
+		match std::fs::write(file_name.as_string(),self.solver_report()) {
+			Ok(_) => Ok(()),
+			Err(e) => Err(COBIAError::Message(format!("Error writing to file: {}",e))),
+		}
+	}
+}
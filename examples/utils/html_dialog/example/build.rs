@@ -0,0 +1,14 @@
+fn main() {
+    //embed the dialog assets, precompressed
+    html_dialog_build::embed_assets("assets.rs", &[
+        ("USER_INFO_HTML", "src/user_info/user_info.html", "text/html"),
+        ("USER_INFO_CSS", "src/user_info/user_info.css", "text/css"),
+        ("USER_INFO_JS", "src/user_info/user_info.js", "text/javascript"),
+        ("USER_INFO_PNG", "src/user_info/user_info.png", "image/png"),
+        ("USER_PHOTO_HTML", "src/user_photo/user_photo.html", "text/html"),
+        ("USER_PHOTO_CSS", "src/user_photo/user_photo.css", "text/css"),
+        ("USER_PHOTO_JS", "src/user_photo/user_photo.js", "text/javascript"),
+        ("USER_PHOTO_PNG", "src/user_photo/user_photo.png", "image/png"),
+        ("PASSFOTO_JPG", "src/user_photo/passfoto.jpg", "image/jpg"),
+    ]).unwrap();
+}
@@ -11,6 +11,11 @@ use log;
 mod user_info;
 mod user_photo;
 
+//static assets, precompressed by the build script
+mod assets {
+    include!(concat!(env!("OUT_DIR"), "/assets.rs"));
+}
+
 fn main() {
     //server log to debug console (windows, debug mode only)
     #[cfg(target_os = "windows")]
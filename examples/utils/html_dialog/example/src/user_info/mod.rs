@@ -1,4 +1,5 @@
 use html_dialog::{HtmlDialogHandler,HtmlDialogResourceType,HtmlDialog,Window};
+use crate::assets;
 use chrono::Local;
 use super::user_photo;
 
@@ -45,12 +46,12 @@ impl UserInfoDialogHandler {
         //create a dialog instance, specifying the data handler
         let mut dlg=HtmlDialog::<UserInfoDialogHandler,UserInfoDialogEvent>::new(dialog_data_handler);
         //add resources to the dialog
-        // - note that static content is linked directly into the binary using include_bytes!
+        // - note that static content is compressed by the build script, and linked directly into the binary
         // - nonstatic content is obtained through the  `provide_content` method, given the enumeration value
-        dlg.add("/".into(),HtmlDialogResourceType::Content((include_bytes!("user_info.html"),"text/html")));
-        dlg.add("/user_info.css".into(),HtmlDialogResourceType::Content((include_bytes!("user_info.css"),"text/css")));
-        dlg.add("/user_info.js".into(),HtmlDialogResourceType::Content((include_bytes!("user_info.js"),"text/javascript")));
-        dlg.add("/user_info.png".into(),HtmlDialogResourceType::Content((include_bytes!("user_info.png"),"image/png")));
+        dlg.add("/".into(),HtmlDialogResourceType::Asset(&assets::USER_INFO_HTML));
+        dlg.add("/user_info.css".into(),HtmlDialogResourceType::Asset(&assets::USER_INFO_CSS));
+        dlg.add("/user_info.js".into(),HtmlDialogResourceType::Asset(&assets::USER_INFO_JS));
+        dlg.add("/user_info.png".into(),HtmlDialogResourceType::Asset(&assets::USER_INFO_PNG));
         dlg.add("/get_user_info".into(),HtmlDialogResourceType::Info(UserInfoDialogEvent::GetUserInfo));
         dlg.add("/show_user_photo".into(),HtmlDialogResourceType::Info(UserInfoDialogEvent::ShowUserPhoto));
         dlg
@@ -69,7 +70,7 @@ impl HtmlDialogHandler<UserInfoDialogEvent> for UserInfoDialogHandler {
     ///
     /// # Returns
     /// A tuple containing the content as a vector of bytes and the MIME type as a string.
-    fn provide_content(&mut self, event: &UserInfoDialogEvent, _content: Option<String>,parent:Option<Window>) -> Result<(Vec<u8>,String), Box<dyn std::error::Error>> {
+    fn provide_content(&mut self, event: &UserInfoDialogEvent, _content: Option<&str>,parent:Option<Window>) -> Result<(Vec<u8>,String), Box<dyn std::error::Error>> {
         match event {
             UserInfoDialogEvent::GetUserInfo => {
                 self.number_of_request+=1;
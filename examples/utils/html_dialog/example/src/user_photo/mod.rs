@@ -1,4 +1,5 @@
 use html_dialog::{HtmlDialogHandler,HtmlDialogResourceType,HtmlDialog,Window};
+use crate::assets;
 
 /// Define an enumeration with representing all possible variations
 /// that require non-static content to be evaluated. 
@@ -38,13 +39,13 @@ impl UserPhotoDialogHandler {
         //create a dialog instance, specifying the data handler
         let mut dlg=HtmlDialog::<UserPhotoDialogHandler,UserPhotoDialogEvent>::new(dialog_data_handler);
         //add resources to the dialog
-        // - note that static content is linked directly into the binary using include_bytes!
+        // - note that static content is compressed by the build script, and linked directly into the binary
         // - nonstatic content is obtained through the  `provide_content` method, given the enumeration value
-        dlg.add("/".into(),HtmlDialogResourceType::Content((include_bytes!("user_photo.html"),"text/html")));
-        dlg.add("/user_photo.css".into(),HtmlDialogResourceType::Content((include_bytes!("user_photo.css"),"text/css")));
-        dlg.add("/user_photo.js".into(),HtmlDialogResourceType::Content((include_bytes!("user_photo.js"),"text/javascript")));
-        dlg.add("/user_photo.png".into(),HtmlDialogResourceType::Content((include_bytes!("user_photo.png"),"image/png")));
-        dlg.add("/passfoto.jpg".into(),HtmlDialogResourceType::Content((include_bytes!("passfoto.jpg"),"image/jpg")));
+        dlg.add("/".into(),HtmlDialogResourceType::Asset(&assets::USER_PHOTO_HTML));
+        dlg.add("/user_photo.css".into(),HtmlDialogResourceType::Asset(&assets::USER_PHOTO_CSS));
+        dlg.add("/user_photo.js".into(),HtmlDialogResourceType::Asset(&assets::USER_PHOTO_JS));
+        dlg.add("/user_photo.png".into(),HtmlDialogResourceType::Asset(&assets::USER_PHOTO_PNG));
+        dlg.add("/passfoto.jpg".into(),HtmlDialogResourceType::Asset(&assets::PASSFOTO_JPG));
         dlg
     }
 }
@@ -61,7 +62,7 @@ impl HtmlDialogHandler<UserPhotoDialogEvent> for UserPhotoDialogHandler {
     ///
     /// # Returns
     /// A tuple containing the content as a vector of bytes and the MIME type as a string.
-    fn provide_content(&mut self, event: &UserPhotoDialogEvent, _content: Option<String>, _parent:Option<Window>) -> Result<(Vec<u8>,String), Box<dyn std::error::Error>> {
+    fn provide_content(&mut self, event: &UserPhotoDialogEvent, _content: Option<&str>, _parent:Option<Window>) -> Result<(Vec<u8>,String), Box<dyn std::error::Error>> {
         match event {
             //match the enumeration value and provide the corresponding content
             _ => Err("Invalid dynamic content request".into())
@@ -0,0 +1,80 @@
+//! Round trip of a 200-compound stream table, as shown by unit operation dialogs.
+//!
+//! Compares the `json` crate document (build, stringify, parse into a document)
+//! with `JsonWriter` and `parse_borrowed`. Run with `cargo bench`.
+
+use std::{hint::black_box, time::Instant};
+use html_dialog::{BorrowedJson, JsonWriter, parse_borrowed};
+
+/// Number of compounds in the table
+const COMPOUNDS: usize = 200;
+/// Number of round trips per measurement
+const ROUND_TRIPS: usize = 2000;
+
+/// Builds the rows of the table: a label, and the feed, distillate and bottoms flows.
+fn table() -> Vec<[String; 4]> {
+    (0..COMPOUNDS)
+        .map(|i| {
+            let feed = 0.01 * (i + 1) as f64;
+            let distillate = feed * (i % 7) as f64 / 7.0;
+            [
+                format!("F[compound \"{}\"] / [kg/s]", i),
+                format!("{:.3}", feed),
+                format!("{:.3} ({:.2}%)", distillate, 100.0 * distillate / feed),
+                format!("{:.3} ({:.2}%)", feed - distillate, 100.0 * (feed - distillate) / feed),
+            ]
+        })
+        .collect()
+}
+
+/// Round trip through the json crate document.
+///
+/// The document is built from the borrowed cells; converting a cell into a document
+/// value is part of building the document, so that it is timed.
+fn document_round_trip(rows: &[[String; 4]]) -> usize {
+    let table: Vec<json::JsonValue> = rows.iter()
+        .map(|row| json::JsonValue::Array(row.iter().map(|cell| cell.as_str().into()).collect()))
+        .collect();
+    let text = json::stringify(json::object! { table: table });
+    let content = text.into_bytes();
+    let decoded = json::parse(&String::from_utf8(content).unwrap()).unwrap();
+    decoded["table"].len()
+}
+
+/// Round trip through the streaming writer and the borrowing decoder.
+fn streaming_round_trip(rows: &[[String; 4]], content: &mut Vec<u8>) -> usize {
+    content.clear();
+    let mut writer = JsonWriter::new(content);
+    writer.begin_object().key("table").begin_array();
+    for row in rows {
+        writer.begin_array();
+        for cell in row {
+            writer.string(cell);
+        }
+        writer.end_array();
+    }
+    writer.end_array().end_object();
+    let text = std::str::from_utf8(content).unwrap();
+    let decoded = parse_borrowed(text).unwrap();
+    decoded.get("table").and_then(BorrowedJson::as_array).map_or(0, |rows| rows.len())
+}
+
+/// Times a round trip function.
+fn measure(name: &str, mut round_trip: impl FnMut() -> usize) {
+    assert_eq!(round_trip(), COMPOUNDS);
+    let start = Instant::now();
+    for _ in 0..ROUND_TRIPS {
+        black_box(round_trip());
+    }
+    let elapsed = start.elapsed();
+    println!("{:<10} {:>10.1} µs per round trip", name, elapsed.as_secs_f64() * 1e6 / ROUND_TRIPS as f64);
+}
+
+fn main() {
+    let rows = table();
+    let mut content = Vec::new();
+    streaming_round_trip(&rows, &mut content);
+    println!("{} compounds, {} bytes", COMPOUNDS, content.len());
+    measure("document", || document_round_trip(black_box(&rows)));
+    measure("streaming", || streaming_round_trip(black_box(&rows), &mut content));
+}
@@ -0,0 +1,88 @@
+//! Throughput of the request parser, for the requests that a dialog page sends.
+//!
+//! Parses a batch of pipelined requests from one buffer, as received on a persistent
+//! connection, and reports bytes and requests per second. Run with `cargo bench`.
+
+use std::{hint::black_box, time::Instant};
+use html_dialog::bench_internals::{ParseStatus, Request};
+
+/// Number of requests in a batch
+const BATCH: usize = 1000;
+/// Number of batches per measurement
+const BATCHES: usize = 200;
+
+/// A static resource request with the headers that a browser sends.
+fn get_request() -> Vec<u8> {
+    b"GET /scripts/dialog.js HTTP/1.1\r\n\
+Host: 127.0.0.1:52114\r\n\
+Connection: keep-alive\r\n\
+User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36 Edg/120.0.0.0\r\n\
+Accept: */*\r\n\
+Referer: http://127.0.0.1:52114/\r\n\
+Accept-Encoding: gzip, deflate, br\r\n\
+Accept-Language: en-US,en;q=0.9\r\n\
+If-None-Match: \"5f1c2a7e9b3d4c60\"\r\n\r\n".to_vec()
+}
+
+/// An update request that posts a JSON document of about 2 KB.
+fn post_request() -> Vec<u8> {
+    let mut content = String::from("{\"table\":[");
+    for i in 0..64 {
+        if i > 0 {
+            content.push(',');
+        }
+        content.push_str(&format!("[\"compound {}\",{:.6}]", i, 0.015625 * i as f64));
+    }
+    content.push_str("]}");
+    let mut request = format!("POST /update HTTP/1.1\r\n\
+Host: 127.0.0.1:52114\r\n\
+Connection: keep-alive\r\n\
+Content-Type: application/json\r\n\
+Content-Length: {}\r\n\
+Accept: */*\r\n\
+Accept-Encoding: gzip, deflate, br\r\n\r\n", content.len()).into_bytes();
+    request.extend_from_slice(content.as_bytes());
+    request
+}
+
+/// Parses all requests of a batch; returns the total content length.
+fn parse_batch(request: &mut Request, batch: &[u8]) -> usize {
+    let mut reader = batch;
+    let mut content = 0;
+    let mut parsed = 0;
+    loop {
+        match request.parse() {
+            ParseStatus::Complete => {
+                content += request.get_content().len();
+                parsed += 1;
+                request.next();
+            },
+            ParseStatus::Incomplete if !reader.is_empty() => {
+                request.read_from(&mut reader).unwrap();
+            },
+            _ => break,
+        }
+    }
+    assert_eq!(parsed, BATCH);
+    content
+}
+
+/// Times the parsing of a batch of copies of a request.
+fn measure(name: &str, single: &[u8]) {
+    let batch = single.repeat(BATCH);
+    let mut request = Request::new();
+    parse_batch(&mut request, &batch);
+    let start = Instant::now();
+    for _ in 0..BATCHES {
+        black_box(parse_batch(&mut request, black_box(&batch)));
+    }
+    let seconds = start.elapsed().as_secs_f64();
+    let requests = (BATCH * BATCHES) as f64;
+    println!("{:<6} {:>5} bytes {:>8.1} MB/s {:>8.0} ns per request",
+        name, single.len(), requests * single.len() as f64 / seconds / 1e6, seconds * 1e9 / requests);
+}
+
+fn main() {
+    measure("GET", &get_request());
+    measure("POST", &post_request());
+}
@@ -0,0 +1,265 @@
+//! Precompressed static assets for the HTML dialog system.
+//!
+//! Assets are prepared at build time by the `html_dialog_build` crate, which embeds
+//! the raw content together with gzip and brotli compressed variants, and a strong
+//! entity tag derived from the content. The server picks the variant that the
+//! browser accepts, and answers conditional requests for an unchanged asset with
+//! `304 Not Modified`, so that a browser that opens the same dialog again uses its
+//! cache.
+
+/// A static asset with precompressed variants.
+///
+/// Instances are normally generated by `html_dialog_build::embed_assets`, and
+/// registered with `HtmlDialogResourceType::Asset`.
+pub struct StaticAsset {
+    /// The raw content bytes
+    pub content: &'static [u8],
+    /// The gzip compressed content, if smaller than the raw content
+    pub gzip: Option<&'static [u8]>,
+    /// The brotli compressed content, if smaller than the raw content
+    pub brotli: Option<&'static [u8]>,
+    /// The MIME type (e.g., "text/html", "application/javascript")
+    pub content_type: &'static str,
+    /// Entity tag of the raw content, without quotes
+    pub etag: &'static str,
+}
+
+/// Content coding of a response.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub(crate) enum Encoding {
+    /// No encoding
+    Identity,
+    /// gzip
+    Gzip,
+    /// brotli
+    Brotli,
+}
+
+impl Encoding {
+    /// The name of the coding in the Content-Encoding header, and the suffix of the entity tag.
+    pub fn name(&self) -> Option<&'static str> {
+        match self {
+            Encoding::Identity => None,
+            Encoding::Gzip => Some("gzip"),
+            Encoding::Brotli => Some("br"),
+        }
+    }
+}
+
+/// Finds the quality value with which a content coding is accepted.
+///
+/// # Parameters
+/// * `accept_encoding` - The value of the Accept-Encoding header
+/// * `coding` - The name of the content coding
+///
+/// # Returns
+/// * The quality value, if the coding or `*` is listed
+fn quality(accept_encoding: &[u8], coding: &str) -> Option<f32> {
+    let mut wildcard = None;
+    for item in accept_encoding.split(|b| *b == b',') {
+        let mut parameters = item.split(|b| *b == b';');
+        let name = parameters.next().unwrap_or_default().trim_ascii();
+        let mut q = 1.0;
+        for parameter in parameters {
+            let parameter = parameter.trim_ascii();
+            if parameter.len() > 2 && parameter[..2].eq_ignore_ascii_case(b"q=") {
+                q = std::str::from_utf8(&parameter[2..]).ok()
+                    .and_then(|v| v.parse::<f32>().ok())
+                    .unwrap_or(0.0);
+            }
+        }
+        if name.eq_ignore_ascii_case(coding.as_bytes()) {
+            return Some(q);
+        }
+        if name == b"*" {
+            wildcard = Some(q);
+        }
+    }
+    wildcard
+}
+
+impl StaticAsset {
+    /// Selects the variant to send.
+    ///
+    /// The compressed variant with the highest quality value is sent; brotli is
+    /// preferred over gzip if both are accepted with the same quality. The raw
+    /// content is sent if no compressed variant is accepted.
+    ///
+    /// # Parameters
+    /// * `accept_encoding` - The value of the Accept-Encoding header, if present
+    ///
+    /// # Returns
+    /// * The content coding and the content to send
+    pub(crate) fn select(&self, accept_encoding: Option<&[u8]>) -> (Encoding, &'static [u8]) {
+        let mut selected = (Encoding::Identity, self.content);
+        if let Some(accept_encoding) = accept_encoding {
+            let mut best = 0.0;
+            let variants = [(Encoding::Brotli, self.brotli), (Encoding::Gzip, self.gzip)];
+            for (encoding, content) in variants {
+                if let Some(content) = content {
+                    let q = quality(accept_encoding, encoding.name().unwrap()).unwrap_or(0.0);
+                    if q > best {
+                        best = q;
+                        selected = (encoding, content);
+                    }
+                }
+            }
+        }
+        selected
+    }
+
+    /// Checks whether the browser has a current copy of the selected variant.
+    ///
+    /// Only the tag of the selected variant matches, so that the entity tag of a
+    /// 304 response is the tag that the browser holds. A browser that holds another
+    /// variant, for example after its Accept-Encoding changed, receives the content.
+    ///
+    /// # Parameters
+    /// * `encoding` - The content coding of the selected variant
+    /// * `if_none_match` - The value of the If-None-Match header, if present
+    ///
+    /// # Returns
+    /// * `true` - If the request can be answered with 304 Not Modified
+    /// * `false` - If the content must be sent
+    pub(crate) fn is_not_modified(&self, encoding: Encoding, if_none_match: Option<&[u8]>) -> bool {
+        let if_none_match = match if_none_match {
+            Some(v) => v,
+            None => return false,
+        };
+        if_none_match.split(|b| *b == b',').any(|tag| {
+            let tag = tag.trim_ascii();
+            if tag == b"*" {
+                return true;
+            }
+            // If-None-Match uses weak comparison
+            let tag = tag.strip_prefix(b"W/").unwrap_or(tag);
+            let tag = match tag.strip_prefix(b"\"").and_then(|t| t.strip_suffix(b"\"")) {
+                Some(t) => t,
+                None => return false,
+            };
+            match (tag.strip_prefix(self.etag.as_bytes()), encoding.name()) {
+                (Some(b""), None) => true,
+                (Some(suffix), Some(coding)) => suffix.strip_prefix(b"-") == Some(coding.as_bytes()),
+                _ => false,
+            }
+        })
+    }
+
+    /// Formats the entity tag of a variant, including quotes.
+    ///
+    /// # Parameters
+    /// * `encoding` - The content coding of the variant
+    pub(crate) fn entity_tag(&self, encoding: Encoding) -> String {
+        match encoding.name() {
+            Some(coding) => format!("\"{}-{}\"", self.etag, coding),
+            None => format!("\"{}\"", self.etag),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const ASSET: StaticAsset = StaticAsset {
+        content: b"raw",
+        gzip: Some(b"gz"),
+        brotli: Some(b"br"),
+        content_type: "text/html",
+        etag: "5f1c2a7e",
+    };
+
+    #[test]
+    fn quality_values() {
+        assert_eq!(quality(b"gzip", "gzip"), Some(1.0));
+        assert_eq!(quality(b"deflate, GZIP;q=0.5", "gzip"), Some(0.5));
+        assert_eq!(quality(b"gzip ; Q=0.25 ", "gzip"), Some(0.25));
+        assert_eq!(quality(b"gzip;q=0", "gzip"), Some(0.0));
+        assert_eq!(quality(b"gzip;q=invalid", "gzip"), Some(0.0));
+        assert_eq!(quality(b"deflate", "gzip"), None);
+        assert_eq!(quality(b"", "gzip"), None);
+        // a listed coding takes precedence over the wildcard, in any order
+        assert_eq!(quality(b"*;q=0.1", "br"), Some(0.1));
+        assert_eq!(quality(b"*;q=0.1, br;q=0.8", "br"), Some(0.8));
+        assert_eq!(quality(b"br;q=0, *", "br"), Some(0.0));
+    }
+
+    #[test]
+    fn select_variant() {
+        let select = |accept_encoding: Option<&[u8]>| ASSET.select(accept_encoding).0;
+        assert_eq!(select(None), Encoding::Identity);
+        assert_eq!(select(Some(b"")), Encoding::Identity);
+        assert_eq!(select(Some(b"identity")), Encoding::Identity);
+        assert_eq!(select(Some(b"gzip, deflate")), Encoding::Gzip);
+        assert_eq!(select(Some(b"gzip, deflate, br")), Encoding::Brotli);
+        // ties prefer brotli, otherwise the highest quality is selected
+        assert_eq!(select(Some(b"gzip;q=0.5, br;q=0.5")), Encoding::Brotli);
+        assert_eq!(select(Some(b"gzip;q=0.9, br;q=0.5")), Encoding::Gzip);
+        assert_eq!(select(Some(b"gzip;q=0.5, br;q=0.9")), Encoding::Brotli);
+        // q=0 rejects a coding
+        assert_eq!(select(Some(b"gzip, br;q=0")), Encoding::Gzip);
+        assert_eq!(select(Some(b"gzip;q=0, br;q=0")), Encoding::Identity);
+        // wildcards
+        assert_eq!(select(Some(b"*")), Encoding::Brotli);
+        assert_eq!(select(Some(b"*, br;q=0")), Encoding::Gzip);
+        assert_eq!(select(Some(b"*;q=0")), Encoding::Identity);
+        assert_eq!(select(Some(b"*;q=0, gzip")), Encoding::Gzip);
+        // variants that are absent are not selected
+        let asset = StaticAsset { brotli: None, ..ASSET };
+        assert_eq!(asset.select(Some(b"br, gzip")), (Encoding::Gzip, &b"gz"[..]));
+        let asset = StaticAsset { brotli: None, gzip: None, ..ASSET };
+        assert_eq!(asset.select(Some(b"br, gzip")), (Encoding::Identity, &b"raw"[..]));
+    }
+
+    #[test]
+    fn not_modified() {
+        let is_not_modified = |if_none_match: &[u8]| ASSET.is_not_modified(Encoding::Identity, Some(if_none_match));
+        assert!(!ASSET.is_not_modified(Encoding::Identity, None));
+        assert!(is_not_modified(b"\"5f1c2a7e\""));
+        assert!(is_not_modified(b"*"));
+        assert!(!is_not_modified(b"\"5f1c2a7e-\""));
+        assert!(!is_not_modified(b"\"5f1c2a7\""));
+        assert!(!is_not_modified(b"\"5f1c2a7e0\""));
+        // weak comparison: a weak tag matches the strong tag
+        assert!(is_not_modified(b"W/\"5f1c2a7e\""));
+        assert!(!is_not_modified(b"w/\"5f1c2a7e\""));
+        // tags must be quoted
+        assert!(!is_not_modified(b"5f1c2a7e"));
+        assert!(!is_not_modified(b"\"5f1c2a7e"));
+        // lists
+        assert!(is_not_modified(b"\"0000\", W/\"1111\" ,\"5f1c2a7e\""));
+        assert!(!is_not_modified(b"\"0000\", W/\"1111\""));
+        assert!(!is_not_modified(b""));
+    }
+
+    #[test]
+    fn not_modified_only_for_selected_variant() {
+        let is_not_modified = |encoding: Encoding, if_none_match: &[u8]| ASSET.is_not_modified(encoding, Some(if_none_match));
+        assert!(is_not_modified(Encoding::Gzip, b"\"5f1c2a7e-gzip\""));
+        assert!(is_not_modified(Encoding::Brotli, b"W/\"5f1c2a7e-br\""));
+        assert!(is_not_modified(Encoding::Gzip, b"*"));
+        // the browser holds another variant than the one selected
+        assert!(!is_not_modified(Encoding::Gzip, b"\"5f1c2a7e-br\""));
+        assert!(!is_not_modified(Encoding::Brotli, b"\"5f1c2a7e\""));
+        assert!(!is_not_modified(Encoding::Identity, b"\"5f1c2a7e-gzip\""));
+        assert!(!is_not_modified(Encoding::Gzip, b"\"5f1c2a7e-deflate\""));
+        // a list with the selected variant's tag among others
+        assert!(is_not_modified(Encoding::Brotli, b"\"5f1c2a7e-gzip\", \"5f1c2a7e-br\""));
+        // a browser that holds the gzip variant and now accepts brotli receives the brotli
+        // content, rather than a 304 response with the brotli tag
+        let selected = ASSET.select(Some(b"gzip, br")).0;
+        let if_none_match = ASSET.entity_tag(Encoding::Gzip);
+        assert!(!ASSET.is_not_modified(selected, Some(if_none_match.as_bytes())));
+    }
+
+    #[test]
+    fn entity_tags() {
+        assert_eq!(ASSET.entity_tag(Encoding::Identity), "\"5f1c2a7e\"");
+        assert_eq!(ASSET.entity_tag(Encoding::Gzip), "\"5f1c2a7e-gzip\"");
+        assert_eq!(ASSET.entity_tag(Encoding::Brotli), "\"5f1c2a7e-br\"");
+        // the tag of each variant is recognized for that variant
+        for encoding in [Encoding::Identity, Encoding::Gzip, Encoding::Brotli] {
+            assert!(ASSET.is_not_modified(encoding, Some(ASSET.entity_tag(encoding).as_bytes())));
+        }
+    }
+}
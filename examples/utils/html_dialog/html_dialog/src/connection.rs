@@ -1,70 +1,131 @@
 //! HTTP connection handler for the HTML dialog system.
 //!
 //! This module provides functionality to process HTTP requests and responses
-//! for the embedded web server used by the HTML dialog system. It implements
-//! a simple HTTP/1.1 parser for GET and POST requests and manages the state
-//! of each connection, as multiple connections share the same thread.
+//! for the embedded web server used by the HTML dialog system. Requests are
+//! parsed by [`Request`], which supports GET and POST requests over HTTP/1.1;
+//! this module manages the state of each connection, as multiple connections
+//! share the same thread. A connection can be upgraded to a WebSocket, after
+//! which it exchanges messages rather than requests and responses, or turned
+//! into an event stream, after which it only carries server-sent events.
 
 use std::{
-    io::{BufReader, ErrorKind, prelude::*},
+    collections::VecDeque,
+    io::{ErrorKind, IoSlice, prelude::*},
     net::TcpStream,
+    sync::mpsc::{Receiver, TryRecvError},
+    time::{Duration, Instant},
 };
-use log::{info, error};
+use log::error;
+use crate::reactor;
+use crate::request::{ParseStatus, Request};
+use crate::websocket::{self, FrameReader, Message};
 
-/// Represents the current state of the HTTP request parsing.
-///
-/// The connection progresses through these states sequentially as it
-/// parses an incoming HTTP request byte by byte.
+/// Represents the current state of the connection.
 #[derive(Debug, Clone, PartialEq)]
 enum ConnectionStatus {
-    /// Reading the HTTP verb (GET or POST)
-    Verb,
-    /// Reading whitespace after the verb
-    Whitespace1,
-    /// Reading the request location (URL path)
-    Location,
-    /// Reading whitespace after the location
-    Whitespace2,
-    /// Reading the HTTP protocol version
-    Protocol,
-    /// Reading the HTTP headers
-    Header,
-    /// Reading the request content/body
-    Content,
+    /// Receiving a request
+    Reading,
     /// Request is completely parsed
     Complete,
-    /// An error occurred during parsing
+    /// An error occurred
     Error,
 }
 
+/// The protocol that a connection carries.
+enum Protocol {
+    /// HTTP requests and responses
+    Http,
+    /// WebSocket messages, after the handshake
+    WebSocket(FrameReader),
+    /// Server-sent events, after the response header of the event stream
+    EventStream,
+}
+
+/// The maximum number of buffers that is passed to a single vectored write
+const MAX_WRITE_BUFFERS: usize = 16;
+
+/// The time for which output that remains when a connection is dropped may block
+const DROP_WRITE_TIMEOUT: Duration = Duration::from_secs(2);
+
+/// The body of an HTTP response.
+pub(crate) enum Body {
+    /// Content that lives as long as the program, such as embedded assets; it is written without copying
+    Static(&'static [u8]),
+    /// Generated content
+    Owned(Vec<u8>),
+}
+
+impl Body {
+    /// Gets the content of the body.
+    pub fn as_slice(&self) -> &[u8] {
+        match self {
+            Body::Static(content) => content,
+            Body::Owned(content) => content.as_slice(),
+        }
+    }
+}
+
+impl From<Vec<u8>> for Body {
+    fn from(content: Vec<u8>) -> Self {
+        Body::Owned(content)
+    }
+}
+
+/// The content, MIME type and HTTP status of a response, before the header is formatted.
+pub(crate) type ResponseContent = (Body, String, i32);
+
+/// An HTTP response that is queued for writing.
+struct Response {
+    /// The status line and headers
+    header: Vec<u8>,
+    /// The content
+    body: Body,
+}
+
+impl Response {
+    /// Gets the header and the content, in the order in which they are written.
+    fn parts(&self) -> [&[u8]; 2] {
+        [self.header.as_slice(), self.body.as_slice()]
+    }
+}
+
 /// Manages an HTTP connection over a TCP stream.
 ///
-/// This struct handles the parsing of HTTP requests and writing of responses
-/// in a non-blocking manner. It processes the request byte-by-byte and
-/// maintains the state of the parsing process.
+/// This struct handles the reading of HTTP requests and writing of responses
+/// in a non-blocking manner. Data is read in chunks into the buffer of the
+/// request, which is parsed incrementally.
 pub(crate) struct Connection {
     /// The underlying TCP stream for the connection
     stream: TcpStream,
-    /// Buffered reader for the TCP stream
-    reader: BufReader<TcpStream>,
-    /// Current state of the HTTP request parsing
+    /// The request that is being received
+    request: Request,
+    /// Current state of the connection
     status: ConnectionStatus,
-    /// Buffer for accumulating parsed string data
-    read_buffer: String,
-    /// Indicates if the request is a GET (true) or POST (false)
-    is_get: bool,
+    /// Indicates that a complete or partial next request was received along
+    /// with the previous request, and has not been parsed yet
+    parse_pending: bool,
     /// Error message if an error occurs
     error: String,
-    /// The requested URL path
-    location: String,
-    /// Content length from the Content-Length header
-    content_length: usize,
-    /// Accumulated content body for POST requests
-    content: Vec<u8>,
     /// HTTP error code if an error occurs
     error_code: i32,
-    /// Buffer for outgoing response data
-    output: Vec<u8>,
+    /// Responses that have not been written completely
+    output: VecDeque<Response>,
+    /// Number of bytes of the first response in `output` that have been written
+    output_written: usize,
+    /// The protocol of the connection, after an upgrade
+    protocol: Protocol,
+    /// The location of the WebSocket or event stream resource
+    upgrade_location: String,
+    /// Text messages received over the WebSocket, that have not been processed
+    incoming: VecDeque<String>,
+    /// Receives the response to the current request, while it is processed on a worker thread
+    task: Option<Receiver<ResponseContent>>,
+    /// Number of requests that have been answered
+    requests_answered: u32,
+    /// Time at which data was last read or written
+    last_activity: Instant,
+    /// No further requests are processed; the connection is kept until its output is written
+    closing: bool,
 }
 
 impl Connection {
@@ -79,22 +140,22 @@ impl Connection {
     /// * `Ok(Self)` - A new Connection instance
     /// * `Err(String)` - Error message if initialization fails
     pub fn new(stream: TcpStream) -> Result<Self, String> {
-        let stream_clone = match stream.try_clone() {
-            Ok(s) => s,
-            Err(e) => {return Err(format!("Failed to clone tcp stream: {}", e));}
-        };
         let res = Connection {
             stream,
-            reader: BufReader::new(stream_clone),
-            read_buffer: String::with_capacity(128),
-            status: ConnectionStatus::Verb,
-            is_get: false,
-            location: String::new(),
+            request: Request::new(),
+            status: ConnectionStatus::Reading,
+            parse_pending: false,
             error: String::new(),
-            content_length: 0,
-            content: Vec::new(),
             error_code: 500, // Default error, if none more suitable
-            output: Vec::new(),
+            output: VecDeque::new(),
+            output_written: 0,
+            protocol: Protocol::Http,
+            upgrade_location: String::new(),
+            incoming: VecDeque::new(),
+            task: None,
+            requests_answered: 0,
+            last_activity: Instant::now(),
+            closing: false,
         };
         match res.stream.set_nonblocking(true) {
             Ok(_) => {},
@@ -150,186 +211,145 @@ impl Connection {
     /// # Returns
     /// * The URL path as a string slice
     pub fn get_location(&self) -> &str {
-        self.location.as_str()
+        self.request.get_location()
+    }
+
+    /// Gets the value of a request header.
+    ///
+    /// # Parameters
+    /// * `name` - The header name, matched case-insensitively
+    ///
+    /// # Returns
+    /// * The header value, if present
+    pub fn get_header(&self, name: &str) -> Option<&[u8]> {
+        self.request.get_header(name)
     }
 
     /// Gets the request content (POST).
     ///
     /// # Returns
-    /// * A copy of the request content as a byte vector
-    pub fn get_content(&self) -> Vec<u8> {
-        self.content.clone()
+    /// * The request content, borrowed from the receive buffer
+    pub fn get_content(&self) -> &[u8] {
+        self.request.get_content()
+    }
+
+    /// Gets the underlying TCP stream, for readiness notification.
+    ///
+    /// # Returns
+    /// * The TCP stream of the connection
+    pub fn get_stream(&self) -> &TcpStream {
+        &self.stream
+    }
+
+    /// Checks if response data is waiting to be written.
+    ///
+    /// # Returns
+    /// * `true` - If the connection must be advanced once the stream is writable
+    /// * `false` - If all output has been written
+    pub fn wants_write(&self) -> bool {
+        !self.output.is_empty()
+    }
+
+    /// Stops processing requests on the connection.
+    ///
+    /// Output that has not been written yet, because the stream would block, is
+    /// written by `drain`; the connection is dropped once `drain` returns `false`.
+    pub fn close(&mut self) {
+        self.closing = true;
+    }
+
+    /// Checks if the connection is closing.
+    ///
+    /// # Returns
+    /// * `true` - If the connection is only kept to write its output
+    /// * `false` - If requests are processed
+    pub fn is_closing(&self) -> bool {
+        self.closing
+    }
+
+    /// Writes the remaining output of a closing connection, without blocking.
+    ///
+    /// # Parameters
+    /// * `timeout` - The time without progress after which the output is abandoned
+    ///
+    /// # Returns
+    /// * `true` - If output remains, and the connection must be kept
+    /// * `false` - If the connection can be dropped
+    pub fn drain(&mut self, timeout: Duration) -> bool {
+        if self.try_write() {
+            self.last_activity = Instant::now();
+        }
+        if !self.output.is_empty() && self.last_activity.elapsed() >= timeout {
+            error!("Abandoning output of closing connection, client does not read");
+            self.output.clear();
+            self.output_written = 0;
+        }
+        !self.output.is_empty()
+    }
+
+    /// Checks if received data is buffered that has not been parsed yet.
+    ///
+    /// Such data does not cause a readiness notification of the stream,
+    /// so the connection must be advanced without waiting.
+    ///
+    /// # Returns
+    /// * `true` - If buffered data is available
+    /// * `false` - If the buffer is empty
+    pub fn has_buffered_input(&self) -> bool {
+        self.parse_pending
     }
 
     /// Advances the parsing of the HTTP request.
     ///
-    /// This method reads and processes data from the TCP stream in a non-blocking
-    /// manner, updating the connection state as it progresses through the HTTP request.
-    /// It also attempts to write any pending response data.
+    /// This method parses the data that has been received so far, and reads
+    /// from the TCP stream in a non-blocking manner until the request is
+    /// complete or no more data is available. It also attempts to write any
+    /// pending response data.
     ///
     /// # Returns
     /// * `true` - If any data was read or written
     /// * `false` - If no data was processed
     pub fn advance(&mut self) -> bool {
+        match self.protocol {
+            Protocol::Http => {},
+            Protocol::WebSocket(_) => return self.advance_websocket(),
+            Protocol::EventStream => return self.advance_event_stream(),
+        }
         let mut any_action = false;
-        loop {
-            let mut char_buf = [0u8; 1];
-            match self.reader.read_exact(&mut char_buf) {
+        self.parse_pending = false;
+        while self.status == ConnectionStatus::Reading {
+            match self.request.parse() {
+                ParseStatus::Complete => {
+                    self.status = ConnectionStatus::Complete;
+                    break;
+                },
+                ParseStatus::Error => {
+                    self.status = ConnectionStatus::Error;
+                    self.error = self.request.get_error().to_string();
+                    self.error_code = self.request.get_error_code();
+                    break;
+                },
+                ParseStatus::Incomplete => {},
+            }
+            match self.request.read_from(&mut self.stream) {
+                Ok(0) => {
+                    if self.request.is_empty() {
+                        self.error_code = 0; // Not an error, connection was closed before any data was read
+                    } else {
+                        self.error = "Read error: connection closed".into();
+                    }
+                    self.status = ConnectionStatus::Error;
+                    return true;
+                },
                 Ok(_) => {
-                    let byte = char_buf[0];
-                    match self.status {
-                        ConnectionStatus::Verb => {
-                            if byte == b' ' || byte == b'\t' {
-                                self.read_buffer = self.read_buffer.to_lowercase();
-                                match self.read_buffer.as_str() {
-                                    "get" => {
-                                        self.is_get = true;
-                                    },
-                                    "post" => {
-                                        self.is_get = false;
-                                    },
-                                    _ => {
-                                        self.status = ConnectionStatus::Error;
-                                        self.error = format!("Invalid verb: {}", self.read_buffer);
-                                        break;
-                                    }
-                                }
-                                self.status = ConnectionStatus::Whitespace1;
-                            } else if (byte as char).is_whitespace() {
-                                self.status = ConnectionStatus::Error;
-                                self.error = format!("Invalid request");
-                                break;
-                            } else {
-                                self.read_buffer.push(byte as char);
-                            }
-                        },
-                        ConnectionStatus::Whitespace1 => {
-                            if byte == b'\r' || byte == b'\n' {
-                                self.status = ConnectionStatus::Error;
-                                self.error = format!("Invalid request");
-                                break;
-                            }
-                            if !(byte as char).is_whitespace() {
-                                self.status = ConnectionStatus::Location;
-                                self.read_buffer.clear();
-                                self.location.clear();
-                                self.location.push(byte as char);
-                            }
-                        },
-                        ConnectionStatus::Location => {
-                            if byte == b' ' || byte == b'\t' {
-                                let _ = info!("==> Location: {}", self.location);
-                                self.status = ConnectionStatus::Whitespace2;
-                            } else if byte == b'\r' || byte == b'\n' {
-                                self.status = ConnectionStatus::Error;
-                                self.error = format!("Invalid request");
-                                break;
-                            } else {
-                                self.location.push(byte as char);
-                            }
-                        },
-                        ConnectionStatus::Whitespace2 => {
-                            if byte == b'\r' || byte == b'\n' {
-                                self.status = ConnectionStatus::Error;
-                                self.error = format!("Invalid request");
-                                break;
-                            }
-                            if !(byte as char).is_whitespace() {
-                                self.status = ConnectionStatus::Protocol;
-                                self.read_buffer.push(byte as char);
-                            }
-                        },
-                        ConnectionStatus::Protocol => {
-                            if byte == b'\n' {
-                                if self.read_buffer.to_lowercase() == "http/1.1" {
-                                    self.status = ConnectionStatus::Header;
-                                    self.read_buffer.clear();
-                                    continue;
-                                }
-                                self.status = ConnectionStatus::Error;
-                                self.error = format!("Invalid protocol: {}", self.read_buffer);
-                                self.error_code = 505; // Unsupported protocol
-                                break;
-                            }
-                            if !(byte as char).is_whitespace() {
-                                self.read_buffer.push(byte as char);
-                            }
-                        },
-                        ConnectionStatus::Header => {
-                            if byte == b'\r' {
-                                continue; // Ignore carriage return
-                            }
-                            if byte == b'\n' {
-                                if self.read_buffer.is_empty() {
-                                    // End of headers
-                                    if self.content_length == 0 {
-                                        self.status = ConnectionStatus::Complete;
-                                        break;
-                                    }
-                                    self.status = ConnectionStatus::Content;
-                                    break;
-                                }
-                                // Process header
-                                let header_line = self.read_buffer.trim_end().to_lowercase();
-                                let _ = info!("==> Header: {}", header_line);
-                                let mut header_words = header_line.split_whitespace();
-                                match header_words.next() {
-                                    Some(val) => match val {
-                                        "content-length:" => {
-                                            match header_words.next() {
-                                                Some(length) => {
-                                                    match length.parse::<usize>() {
-                                                        Ok(l) => {self.content_length = l;},
-                                                        Err(e) => {
-                                                            self.status = ConnectionStatus::Error;
-                                                            self.error = format!("Invalid content length: {}", e);
-                                                            break;
-                                                        }
-                                                    }
-                                                },
-                                                None => {
-                                                    self.status = ConnectionStatus::Error;
-                                                    self.error = "Invalid content length".into();
-                                                    break;
-                                                }
-                                            }
-                                        },
-                                        _ => {}, // Ignore other headers
-                                    },
-                                    _ => {},
-                                };
-                                self.read_buffer.clear(); // Prep for next header
-                                continue;
-                            }
-                            self.read_buffer.push(byte as char);
-                        },
-                        ConnectionStatus::Content => {
-                            self.content.push(byte);
-                            self.content_length -= 1;
-                            if self.content_length == 0 {
-                                self.status = ConnectionStatus::Complete;
-                                break;
-                            }
-                        },
-                        ConnectionStatus::Complete => {
-                            // We should not reach here, as the connection should be closed after processing
-                            assert!(false, "Unexpected state: Complete");
-                            self.status = ConnectionStatus::Error;
-                            self.error = "Unexpected state: Complete".to_string();
-                            break;
-                        },
-                        ConnectionStatus::Error => {
-                            // We should not reach here, as the connection should be closed after processing
-                            assert!(false, "Unexpected state: Complete");
-                            break;
-                        },
-                    };
+                    any_action = true;
                 },
                 Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
                     break; // No more data available without blocking
-                }
+                },
+                Err(ref e) if e.kind() == ErrorKind::Interrupted => {},
                 Err(e) => {
-                    if self.status == ConnectionStatus::Verb {
+                    if self.request.is_empty() {
                         self.error_code = 0; // Not an error, connection was closed before any data was read
                     } else {
                         self.error = format!("Read error: {}", e);
@@ -342,94 +362,411 @@ impl Connection {
         if self.try_write() {
             any_action = true;
         }
+        if any_action {
+            self.last_activity = Instant::now();
+        }
+        any_action
+    }
+
+    /// Checks the request for a WebSocket handshake.
+    ///
+    /// # Returns
+    /// * `Some(accept)` - The value of the Sec-WebSocket-Accept header, if the request is a valid handshake
+    /// * `None` - If the request is not a valid handshake
+    pub fn websocket_accept(&self) -> Option<String> {
+        if !self.request.is_get() || !self.has_header_token("upgrade", "websocket")
+            || !self.has_header_token("connection", "upgrade")
+            || self.request.get_header("sec-websocket-version") != Some(b"13") {
+            return None;
+        }
+        self.request.get_header("sec-websocket-key").map(websocket::accept_key)
+    }
+
+    /// Checks whether a comma separated request header contains a token.
+    ///
+    /// # Parameters
+    /// * `name` - The header name, in lowercase
+    /// * `token` - The token, compared case-insensitively
+    ///
+    /// # Returns
+    /// * `true` - If the header is present and contains the token
+    /// * `false` - Otherwise
+    fn has_header_token(&self, name: &str, token: &str) -> bool {
+        self.request.get_header(name).is_some_and(|v| {
+            v.split(|b| *b == b',').any(|t| t.trim_ascii().eq_ignore_ascii_case(token.as_bytes()))
+        })
+    }
+
+    /// Checks whether the client asks to close the connection after the current request.
+    ///
+    /// # Returns
+    /// * `true` - If the request has a `Connection: close` header
+    /// * `false` - If the connection may persist
+    pub fn wants_close(&self) -> bool {
+        self.has_header_token("connection", "close")
+    }
+
+    /// Gets the number of requests that have been answered on this connection.
+    ///
+    /// # Returns
+    /// * The number of requests
+    pub fn get_requests_answered(&self) -> u32 {
+        self.requests_answered
+    }
+
+    /// Checks whether a persistent connection has been idle for the given time.
+    ///
+    /// Only HTTP connections that wait for a next request can be idle; a
+    /// connection with a response or a task outstanding is not.
+    ///
+    /// # Parameters
+    /// * `timeout` - The idle time after which the connection may be closed
+    ///
+    /// # Returns
+    /// * `true` - If the connection is idle
+    /// * `false` - If the connection is in use
+    pub fn is_idle(&self, timeout: Duration) -> bool {
+        matches!(self.protocol, Protocol::Http) && self.task.is_none() && self.output.is_empty()
+            && !self.parse_pending && self.last_activity.elapsed() >= timeout
+    }
+
+    /// Switches the connection to the WebSocket protocol.
+    ///
+    /// Called after the handshake response has been sent.
+    ///
+    /// # Parameters
+    /// * `location` - The location of the WebSocket resource
+    pub fn upgrade(&mut self, location: String) {
+        self.protocol = Protocol::WebSocket(FrameReader::new(self.request.take_remaining()));
+        self.upgrade_location = location;
+        self.status = ConnectionStatus::Reading;
+        self.parse_pending = false;
+    }
+
+    /// Turns the connection into an event stream.
+    ///
+    /// Called after the response header of the event stream has been sent; the
+    /// response content is then written by `send_events`, for as long as the
+    /// page keeps the connection open.
+    ///
+    /// # Parameters
+    /// * `location` - The location of the event stream resource
+    pub fn start_event_stream(&mut self, location: String) {
+        self.protocol = Protocol::EventStream;
+        self.upgrade_location = location;
+        self.status = ConnectionStatus::Reading;
+        self.parse_pending = false;
+    }
+
+    /// Checks if the connection has been upgraded to a WebSocket.
+    pub fn is_websocket(&self) -> bool {
+        matches!(self.protocol, Protocol::WebSocket(_))
+    }
+
+    /// Checks if the connection is an event stream.
+    pub fn is_event_stream(&self) -> bool {
+        matches!(self.protocol, Protocol::EventStream)
+    }
+
+    /// Gets the location of the WebSocket or event stream resource.
+    pub fn get_upgrade_location(&self) -> &str {
+        &self.upgrade_location
+    }
+
+    /// Takes the next text message that was received over the WebSocket.
+    ///
+    /// # Returns
+    /// * The message, if any
+    pub fn next_message(&mut self) -> Option<String> {
+        self.incoming.pop_front()
+    }
+
+    /// Sends a text message over the WebSocket.
+    ///
+    /// # Parameters
+    /// * `text` - The message, which must be valid UTF-8
+    pub fn send_message(&mut self, text: Vec<u8>) {
+        self.send(websocket::frame_header(websocket::OPCODE_TEXT, text.len()), Body::Owned(text));
+    }
+
+    /// Sends server-sent events over the event stream.
+    ///
+    /// # Parameters
+    /// * `events` - One or more formatted events
+    pub fn send_events(&mut self, events: Vec<u8>) {
+        self.send(Vec::new(), Body::Owned(events));
+    }
+
+    /// Sends a close frame, and puts the connection in a state in which it is dropped.
+    ///
+    /// # Parameters
+    /// * `status` - The close status code
+    fn close_websocket(&mut self, status: u16) {
+        self.send(websocket::frame_header(websocket::OPCODE_CLOSE, 2), Body::Owned(status.to_be_bytes().to_vec()));
+        self.status = ConnectionStatus::Error;
+        self.error_code = 0; // Closed, no HTTP response
+    }
+
+    /// Advances a connection that has been upgraded to a WebSocket.
+    ///
+    /// Received text messages are queued, pings are answered, and close frames
+    /// and protocol errors close the connection.
+    ///
+    /// # Returns
+    /// * `true` - If any data was read or written
+    /// * `false` - If no data was processed
+    fn advance_websocket(&mut self) -> bool {
+        let mut any_action = false;
+        while self.status == ConnectionStatus::Reading {
+            let Protocol::WebSocket(ref mut reader) = self.protocol else {
+                unreachable!()
+            };
+            match reader.next() {
+                Ok(Some(Message::Text(text))) => {
+                    self.incoming.push_back(text);
+                    continue;
+                },
+                Ok(Some(Message::Binary(_))) => {
+                    error!("Ignoring binary WebSocket message");
+                    continue;
+                },
+                Ok(Some(Message::Ping(payload))) => {
+                    self.send(websocket::frame_header(websocket::OPCODE_PONG, payload.len()), Body::Owned(payload));
+                    continue;
+                },
+                Ok(Some(Message::Pong)) => {
+                    continue;
+                },
+                Ok(Some(Message::Close)) => {
+                    self.close_websocket(websocket::CLOSE_NORMAL);
+                    return true;
+                },
+                Err(status) => {
+                    error!("WebSocket protocol error, closing with status {}", status);
+                    self.close_websocket(status);
+                    return true;
+                },
+                Ok(None) => {},
+            }
+            match reader.read_from(&mut self.stream) {
+                Ok(0) => {
+                    self.status = ConnectionStatus::Error;
+                    self.error_code = 0; // Closed by the browser
+                    return true;
+                },
+                Ok(_) => {
+                    any_action = true;
+                },
+                Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
+                    break;
+                },
+                Err(ref e) if e.kind() == ErrorKind::Interrupted => {},
+                Err(_) => {
+                    self.status = ConnectionStatus::Error;
+                    self.error_code = 0; // Connection lost
+                    return true;
+                },
+            }
+        }
+        if self.try_write() {
+            any_action = true;
+        }
         any_action
     }
 
+    /// Advances a connection that is an event stream.
+    ///
+    /// The page does not send anything over an event stream; received data is
+    /// discarded, and the connection is dropped once the page closes it.
+    ///
+    /// # Returns
+    /// * `true` - If any data was read or written
+    /// * `false` - If no data was processed
+    fn advance_event_stream(&mut self) -> bool {
+        let mut any_action = false;
+        let mut buffer = [0u8; 512];
+        while self.status == ConnectionStatus::Reading {
+            match self.stream.read(&mut buffer) {
+                Ok(0) => {
+                    self.status = ConnectionStatus::Error;
+                    self.error_code = 0; // Closed by the browser
+                    return true;
+                },
+                Ok(_) => {
+                    any_action = true;
+                },
+                Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
+                    break;
+                },
+                Err(ref e) if e.kind() == ErrorKind::Interrupted => {},
+                Err(_) => {
+                    self.status = ConnectionStatus::Error;
+                    self.error_code = 0; // Connection lost
+                    return true;
+                },
+            }
+        }
+        if self.try_write() {
+            any_action = true;
+        }
+        any_action
+    }
+
+    /// Waits for the response to the current request, which is processed on a worker thread.
+    ///
+    /// The next request is not processed until the response is available, so
+    /// that responses are sent in order.
+    ///
+    /// # Parameters
+    /// * `receiver` - Receives the response when the task has finished
+    pub fn await_task(&mut self, receiver: Receiver<ResponseContent>) {
+        self.task = Some(receiver);
+    }
+
+    /// Checks if the connection is waiting for a response from a worker thread.
+    pub fn is_awaiting_task(&self) -> bool {
+        self.task.is_some()
+    }
+
+    /// Takes the response from the worker thread, if it has finished.
+    ///
+    /// # Returns
+    /// * `Some(response)` - The response; an error response if the task panicked
+    /// * `None` - If the task is still running
+    pub fn poll_task(&mut self) -> Option<ResponseContent> {
+        let response = match self.task.as_ref()?.try_recv() {
+            Ok(response) => response,
+            Err(TryRecvError::Empty) => return None,
+            Err(TryRecvError::Disconnected) => (Body::Static(b"Task failed"), "text/plain".into(), 500),
+        };
+        self.task = None;
+        Some(response)
+    }
+
     /// Resets the connection state to prepare for a new request.
     ///
     /// Clears all buffers and resets state variables to their initial values.
+    /// Data of a next request that was already received is retained.
     pub fn reset(&mut self) {
-        self.status = ConnectionStatus::Verb;
-        self.read_buffer.clear();
-        self.is_get = false;
-        self.location.clear();
+        self.status = ConnectionStatus::Reading;
+        self.parse_pending = self.request.next();
         self.error.clear();
-        self.content_length = 0;
-        self.content.clear();
         self.error_code = 500;
+        self.requests_answered = self.requests_answered.saturating_add(1);
+        self.last_activity = Instant::now();
     }
 
-    /// Writes data to the response buffer.
+    /// Queues a response for writing.
     ///
-    /// Adds the provided data to the output buffer and attempts to write it
-    /// to the TCP stream immediately.
+    /// The response is written to the TCP stream as far as possible without blocking;
+    /// the remainder is written by subsequent calls to `advance`.
     ///
     /// # Parameters
-    /// * `data` - The byte slice to write to the response
-    pub fn write(&mut self, data: &[u8]) {
-        self.output.extend_from_slice(data);
+    /// * `header` - The status line and headers of the response
+    /// * `body` - The content of the response
+    pub fn send(&mut self, header: Vec<u8>, body: Body) {
+        self.output.push_back(Response { header, body });
         self.try_write();
     }
 
-    /// Attempts to write pending output data to the TCP stream.
+    /// Attempts to write pending responses to the TCP stream.
     ///
-    /// This method writes data in chunks (up to 256 bytes) to avoid blocking
-    /// for too long. It removes written data from the output buffer.
+    /// The unwritten parts of the queued responses are passed to a single vectored
+    /// write, repeatedly, until all is written or the stream would block.
     ///
     /// # Returns
     /// * `true` - If any data was written
     /// * `false` - If no data was written
     fn try_write(&mut self) -> bool {
-        let mut written = 0;
-        loop {
-            let try_size = std::cmp::min(256, self.output.len() - written);
-            match self.stream.write(&self.output[written..written + try_size]) {
-                Ok(size) => {
-                    if size == 0 {
-                        break;
+        let mut any_written = false;
+        while !self.output.is_empty() {
+            let res = {
+                let mut buffers = [IoSlice::new(&[]); MAX_WRITE_BUFFERS];
+                let mut count = 0;
+                let mut skip = self.output_written;
+                'gather: for response in self.output.iter() {
+                    for part in response.parts() {
+                        if skip >= part.len() {
+                            skip -= part.len();
+                            continue;
+                        }
+                        if count == MAX_WRITE_BUFFERS {
+                            break 'gather;
+                        }
+                        buffers[count] = IoSlice::new(&part[skip..]);
+                        skip = 0;
+                        count += 1;
                     }
-                    written += size;
-                    if written >= self.output.len() {
-                        break; // All data written
+                }
+                self.stream.write_vectored(&buffers[..count])
+            };
+            match res {
+                Ok(0) => {
+                    break;
+                },
+                Ok(size) => {
+                    any_written = true;
+                    self.output_written += size;
+                    // Remove completely written responses
+                    while let Some(response) = self.output.front() {
+                        let length = response.header.len() + response.body.as_slice().len();
+                        if self.output_written < length {
+                            break;
+                        }
+                        self.output_written -= length;
+                        self.output.pop_front();
                     }
                 },
                 Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
                     // No more data can be written, wait for next call
                     break;
                 },
+                Err(ref e) if e.kind() == ErrorKind::Interrupted => {},
                 Err(e) => {
                     let _ = error!("Failed to write data: {}", e);
                     self.status = ConnectionStatus::Error;
                     self.error = format!("Failed to write data: {}", e);
+                    // the output cannot be delivered anymore
+                    self.output.clear();
+                    self.output_written = 0;
                     return true;
                 },
             }
         }
-        // Remove written data
-        if written > 0 {
-            self.output.drain(0..written);
-            true
-        } else {
-            false
-        }
+        any_written
     }
 }
 
 impl Drop for Connection {
     /// Ensures any remaining output data is written when the connection is dropped.
     ///
-    /// This attempts to flush the output buffer before the connection is closed.
+    /// A closing connection is normally kept by the server loop until its output is
+    /// written. Output only remains if the server loop ends; it is then written in
+    /// blocking mode, as a non-blocking write would stop at a full send buffer, for
+    /// a limited time.
     fn drop(&mut self) {
+        if self.output.is_empty() {
+            return;
+        }
+        if let Err(e) = reactor::set_blocking(&self.stream)
+                .and_then(|_| self.stream.set_write_timeout(Some(DROP_WRITE_TIMEOUT))) {
+            error!("Failed to switch stream to blocking mode: {}", e);
+            return;
+        }
         // Finish writing output
-        if !self.output.is_empty() {
-            match self.stream.write_all(&self.output) {
-                Ok(_) => {
-                    self.output.clear();
-                },
-                Err(e) => {
+        let mut skip = self.output_written;
+        for response in self.output.drain(..) {
+            for part in response.parts() {
+                if skip >= part.len() {
+                    skip -= part.len();
+                    continue;
+                }
+                if let Err(e) = self.stream.write_all(&part[skip..]) {
                     error!("Failed to write output: {}", e);
+                    return;
                 }
-            };
+                skip = 0;
+            }
         }
     }
 }
\ No newline at end of file
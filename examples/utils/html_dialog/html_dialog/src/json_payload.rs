@@ -0,0 +1,600 @@
+//! Streaming JSON for dialog payloads.
+//!
+//! Responses are written by a [`JsonWriter`] straight into the buffer that becomes
+//! the response content, without building a document first. Requests are decoded
+//! by [`parse_borrowed`] into a [`BorrowedJson`] value that refers to the request
+//! content; strings are only copied if they contain escape sequences.
+
+use std::{
+    borrow::Cow,
+    fmt,
+    io::Write,
+};
+
+/// Maximum nesting depth of arrays and objects that is decoded
+const MAX_DEPTH: usize = 128;
+
+/// Checks if a byte must be escaped in a JSON string, or ends a string.
+#[inline]
+fn is_special(byte: u8) -> bool {
+    byte < 0x20 || byte == b'"' || byte == b'\\'
+}
+
+/// Appends a string to the output, with JSON escapes, without quotes.
+///
+/// Runs of characters that need no escaping are copied at once.
+///
+/// # Parameters
+/// * `out` - The output buffer
+/// * `value` - The string
+fn escape_into(out: &mut Vec<u8>, value: &str) {
+    let mut bytes = value.as_bytes();
+    out.reserve(bytes.len());
+    while let Some(i) = bytes.iter().position(|b| is_special(*b)) {
+        out.extend_from_slice(&bytes[..i]);
+        match bytes[i] {
+            b'"' => out.extend_from_slice(b"\\\""),
+            b'\\' => out.extend_from_slice(b"\\\\"),
+            b'\n' => out.extend_from_slice(b"\\n"),
+            b'\r' => out.extend_from_slice(b"\\r"),
+            b'\t' => out.extend_from_slice(b"\\t"),
+            byte => {
+                let _ = write!(out, "\\u{:04x}", byte);
+            },
+        }
+        bytes = &bytes[i + 1..];
+    }
+    out.extend_from_slice(bytes);
+}
+
+/// Adapter that escapes formatted text into the output.
+struct Escaper<'a>(&'a mut Vec<u8>);
+
+impl fmt::Write for Escaper<'_> {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        escape_into(self.0, s);
+        Ok(())
+    }
+}
+
+/// Writes JSON directly into a byte buffer.
+///
+/// Separators are inserted automatically; the caller is responsible for
+/// balancing `begin_...` and `end_...` calls, and for writing a key before
+/// each value inside an object. Methods return the writer, so that calls
+/// can be chained.
+///
+/// ```
+/// let mut content = Vec::new();
+/// html_dialog::JsonWriter::new(&mut content)
+///     .begin_object()
+///     .key("error").boolean(false)
+///     .key("text").string("Specification is complete")
+///     .end_object();
+/// assert_eq!(content, br#"{"error":false,"text":"Specification is complete"}"#);
+/// ```
+pub struct JsonWriter<'a> {
+    /// The output buffer
+    out: &'a mut Vec<u8>,
+    /// Whether a separator precedes the next value or key
+    comma: bool,
+}
+
+impl<'a> JsonWriter<'a> {
+    /// Creates a writer that appends to a buffer.
+    ///
+    /// # Parameters
+    /// * `out` - The output buffer, typically the content of the response
+    pub fn new(out: &'a mut Vec<u8>) -> Self {
+        JsonWriter { out, comma: false }
+    }
+
+    /// Writes the separator before a value, if needed.
+    fn separate(&mut self) {
+        if self.comma {
+            self.out.push(b',');
+        }
+        self.comma = true;
+    }
+
+    /// Starts an object.
+    pub fn begin_object(&mut self) -> &mut Self {
+        self.separate();
+        self.out.push(b'{');
+        self.comma = false;
+        self
+    }
+
+    /// Ends an object.
+    pub fn end_object(&mut self) -> &mut Self {
+        self.out.push(b'}');
+        self.comma = true;
+        self
+    }
+
+    /// Starts an array.
+    pub fn begin_array(&mut self) -> &mut Self {
+        self.separate();
+        self.out.push(b'[');
+        self.comma = false;
+        self
+    }
+
+    /// Ends an array.
+    pub fn end_array(&mut self) -> &mut Self {
+        self.out.push(b']');
+        self.comma = true;
+        self
+    }
+
+    /// Writes the key of the next object member.
+    ///
+    /// # Parameters
+    /// * `key` - The member name
+    pub fn key(&mut self, key: &str) -> &mut Self {
+        self.separate();
+        self.out.push(b'"');
+        escape_into(self.out, key);
+        self.out.extend_from_slice(b"\":");
+        self.comma = false;
+        self
+    }
+
+    /// Writes a string value.
+    ///
+    /// # Parameters
+    /// * `value` - The string
+    pub fn string(&mut self, value: &str) -> &mut Self {
+        self.separate();
+        self.out.push(b'"');
+        escape_into(self.out, value);
+        self.out.push(b'"');
+        self
+    }
+
+    /// Writes a string value from formatting arguments, without an intermediate string.
+    ///
+    /// # Parameters
+    /// * `args` - The formatted text, as obtained from `format_args!`
+    pub fn string_fmt(&mut self, args: fmt::Arguments) -> &mut Self {
+        self.separate();
+        self.out.push(b'"');
+        let _ = fmt::write(&mut Escaper(self.out), args);
+        self.out.push(b'"');
+        self
+    }
+
+    /// Writes a number; values that are not finite are written as null.
+    ///
+    /// # Parameters
+    /// * `value` - The number
+    pub fn number(&mut self, value: f64) -> &mut Self {
+        self.separate();
+        if value.is_finite() {
+            let _ = write!(self.out, "{}", value);
+        } else {
+            self.out.extend_from_slice(b"null");
+        }
+        self
+    }
+
+    /// Writes an integer.
+    ///
+    /// # Parameters
+    /// * `value` - The integer
+    pub fn integer(&mut self, value: i64) -> &mut Self {
+        self.separate();
+        let _ = write!(self.out, "{}", value);
+        self
+    }
+
+    /// Writes a boolean.
+    ///
+    /// # Parameters
+    /// * `value` - The boolean
+    pub fn boolean(&mut self, value: bool) -> &mut Self {
+        self.separate();
+        self.out.extend_from_slice(if value { b"true" } else { b"false" });
+        self
+    }
+
+    /// Writes null.
+    pub fn null(&mut self) -> &mut Self {
+        self.separate();
+        self.out.extend_from_slice(b"null");
+        self
+    }
+}
+
+/// A decoded JSON value that borrows its strings from the decoded text.
+#[derive(Debug, Clone, PartialEq)]
+pub enum BorrowedJson<'a> {
+    /// null
+    Null,
+    /// true or false
+    Bool(bool),
+    /// A number
+    Number(f64),
+    /// A string; borrowed unless it contains escape sequences
+    String(Cow<'a, str>),
+    /// An array
+    Array(Vec<BorrowedJson<'a>>),
+    /// An object, with its members in order of appearance
+    Object(Vec<(Cow<'a, str>, BorrowedJson<'a>)>),
+}
+
+impl<'a> BorrowedJson<'a> {
+    /// Gets a member of an object.
+    ///
+    /// # Parameters
+    /// * `key` - The member name
+    ///
+    /// # Returns
+    /// * The value of the first member with this name, if this is an object that has it
+    pub fn get(&self, key: &str) -> Option<&BorrowedJson<'a>> {
+        match self {
+            BorrowedJson::Object(members) => members.iter().find(|(k, _)| k == key).map(|(_, v)| v),
+            _ => None,
+        }
+    }
+
+    /// Gets the string, if this is a string.
+    pub fn as_str(&self) -> Option<&str> {
+        match self {
+            BorrowedJson::String(s) => Some(s),
+            _ => None,
+        }
+    }
+
+    /// Gets the number, if this is a number.
+    pub fn as_f64(&self) -> Option<f64> {
+        match self {
+            BorrowedJson::Number(n) => Some(*n),
+            _ => None,
+        }
+    }
+
+    /// Gets the number, if this is a non-negative integral number that fits in 32 bits.
+    pub fn as_u32(&self) -> Option<u32> {
+        match self {
+            BorrowedJson::Number(n) if n.fract() == 0.0 && *n >= 0.0 && *n <= u32::MAX as f64 => Some(*n as u32),
+            _ => None,
+        }
+    }
+
+    /// Gets the elements, if this is an array.
+    pub fn as_array(&self) -> Option<&[BorrowedJson<'a>]> {
+        match self {
+            BorrowedJson::Array(elements) => Some(elements),
+            _ => None,
+        }
+    }
+}
+
+/// Decodes JSON text, borrowing strings from it.
+///
+/// # Parameters
+/// * `input` - The JSON text, such as the content of a request
+///
+/// # Returns
+/// * `Ok(BorrowedJson)` - The decoded value
+/// * `Err(String)` - Description and position of the syntax error
+pub fn parse_borrowed(input: &str) -> Result<BorrowedJson<'_>, String> {
+    let mut parser = Parser { input, position: 0, depth: 0 };
+    let value = parser.value()?;
+    parser.skip_whitespace();
+    if parser.position != input.len() {
+        return Err(parser.error("unexpected data after value"));
+    }
+    Ok(value)
+}
+
+/// Recursive descent decoder state.
+struct Parser<'a> {
+    /// The text
+    input: &'a str,
+    /// Current byte offset
+    position: usize,
+    /// Current nesting depth
+    depth: usize,
+}
+
+impl<'a> Parser<'a> {
+    /// Formats an error at the current position.
+    fn error(&self, message: &str) -> String {
+        format!("{} at offset {}", message, self.position)
+    }
+
+    /// Gets the byte at the current position.
+    fn peek(&self) -> Option<u8> {
+        self.input.as_bytes().get(self.position).copied()
+    }
+
+    /// Skips whitespace.
+    fn skip_whitespace(&mut self) {
+        while let Some(b' ' | b'\t' | b'\n' | b'\r') = self.peek() {
+            self.position += 1;
+        }
+    }
+
+    /// Consumes an expected literal.
+    fn literal(&mut self, literal: &str, value: BorrowedJson<'a>) -> Result<BorrowedJson<'a>, String> {
+        if self.input[self.position..].starts_with(literal) {
+            self.position += literal.len();
+            Ok(value)
+        } else {
+            Err(self.error("invalid literal"))
+        }
+    }
+
+    /// Decodes a value, after optional whitespace.
+    fn value(&mut self) -> Result<BorrowedJson<'a>, String> {
+        self.skip_whitespace();
+        match self.peek() {
+            Some(b'{') => self.object(),
+            Some(b'[') => self.array(),
+            Some(b'"') => Ok(BorrowedJson::String(self.string()?)),
+            Some(b't') => self.literal("true", BorrowedJson::Bool(true)),
+            Some(b'f') => self.literal("false", BorrowedJson::Bool(false)),
+            Some(b'n') => self.literal("null", BorrowedJson::Null),
+            Some(b'-' | b'0'..=b'9') => self.number(),
+            Some(_) => Err(self.error("unexpected character")),
+            None => Err(self.error("unexpected end of data")),
+        }
+    }
+
+    /// Skips decimal digits.
+    ///
+    /// # Returns
+    /// * The number of digits skipped
+    fn digits(&mut self) -> usize {
+        let start = self.position;
+        while let Some(b'0'..=b'9') = self.peek() {
+            self.position += 1;
+        }
+        self.position - start
+    }
+
+    /// Decodes a number.
+    ///
+    /// The number must follow the JSON grammar: an optional minus sign, an integer
+    /// part without leading zeros, and optional fraction and exponent parts that
+    /// each have at least one digit.
+    fn number(&mut self) -> Result<BorrowedJson<'a>, String> {
+        let start = self.position;
+        let invalid = || format!("invalid number at offset {}", start);
+        if self.peek() == Some(b'-') {
+            self.position += 1;
+        }
+        match self.peek() {
+            Some(b'0') => self.position += 1,
+            Some(b'1'..=b'9') => { self.digits(); },
+            _ => return Err(invalid()),
+        }
+        if self.peek() == Some(b'.') {
+            self.position += 1;
+            if self.digits() == 0 {
+                return Err(invalid());
+            }
+        }
+        if let Some(b'e' | b'E') = self.peek() {
+            self.position += 1;
+            if let Some(b'+' | b'-') = self.peek() {
+                self.position += 1;
+            }
+            if self.digits() == 0 {
+                return Err(invalid());
+            }
+        }
+        if let Some(b'-' | b'+' | b'.' | b'e' | b'E' | b'0'..=b'9') = self.peek() {
+            return Err(invalid());
+        }
+        self.input[start..self.position]
+            .parse::<f64>()
+            .map(BorrowedJson::Number)
+            .map_err(|_| invalid())
+    }
+
+    /// Reads the four hexadecimal digits of a \u escape.
+    fn hex4(&mut self) -> Result<u32, String> {
+        let digits = self.input.get(self.position..self.position + 4)
+            .ok_or_else(|| self.error("incomplete escape sequence"))?;
+        // from_str_radix would accept a sign
+        if !digits.bytes().all(|b| b.is_ascii_hexdigit()) {
+            return Err(self.error("invalid escape sequence"));
+        }
+        let code = u32::from_str_radix(digits, 16).map_err(|_| self.error("invalid escape sequence"))?;
+        self.position += 4;
+        Ok(code)
+    }
+
+    /// Decodes a string; the current position is at the opening quote.
+    ///
+    /// The string is borrowed if it has no escape sequences.
+    fn string(&mut self) -> Result<Cow<'a, str>, String> {
+        self.position += 1;
+        let bytes = self.input.as_bytes();
+        let mut start = self.position;
+        let mut owned: Option<String> = None;
+        loop {
+            // skip to the next quote, escape or control character
+            self.position += bytes[self.position..].iter().position(|b| is_special(*b)).unwrap_or(bytes.len() - self.position);
+            match bytes.get(self.position) {
+                None => return Err(self.error("unterminated string")),
+                Some(b'"') => {
+                    let tail = &self.input[start..self.position];
+                    self.position += 1;
+                    return Ok(match owned {
+                        None => Cow::Borrowed(tail),
+                        Some(mut s) => {
+                            s.push_str(tail);
+                            Cow::Owned(s)
+                        },
+                    });
+                },
+                Some(b'\\') => {
+                    let s = owned.get_or_insert_with(|| String::with_capacity(2 * (self.position - start) + 16));
+                    s.push_str(&self.input[start..self.position]);
+                    self.position += 1;
+                    let escape = bytes.get(self.position).copied();
+                    self.position += 1;
+                    match escape {
+                        Some(b'"') => s.push('"'),
+                        Some(b'\\') => s.push('\\'),
+                        Some(b'/') => s.push('/'),
+                        Some(b'b') => s.push('\u{8}'),
+                        Some(b'f') => s.push('\u{c}'),
+                        Some(b'n') => s.push('\n'),
+                        Some(b'r') => s.push('\r'),
+                        Some(b't') => s.push('\t'),
+                        Some(b'u') => {
+                            let mut code = self.hex4()?;
+                            if (0xd800..0xdc00).contains(&code) && self.input[self.position..].starts_with("\\u") {
+                                self.position += 2;
+                                let low = self.hex4()?;
+                                if !(0xdc00..0xe000).contains(&low) {
+                                    return Err(self.error("invalid surrogate pair"));
+                                }
+                                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                            }
+                            let c = char::from_u32(code).ok_or_else(|| self.error("invalid code point"))?;
+                            owned.as_mut().unwrap().push(c);
+                        },
+                        _ => return Err(self.error("invalid escape sequence")),
+                    }
+                    start = self.position;
+                },
+                Some(_) => return Err(self.error("control character in string")),
+            }
+        }
+    }
+
+    /// Enters a nested array or object.
+    fn enter(&mut self) -> Result<(), String> {
+        self.depth += 1;
+        if self.depth > MAX_DEPTH {
+            return Err(self.error("nesting too deep"));
+        }
+        self.position += 1;
+        Ok(())
+    }
+
+    /// Decodes an array; the current position is at the opening bracket.
+    fn array(&mut self) -> Result<BorrowedJson<'a>, String> {
+        self.enter()?;
+        let mut elements = Vec::new();
+        self.skip_whitespace();
+        if self.peek() == Some(b']') {
+            self.position += 1;
+        } else {
+            loop {
+                elements.push(self.value()?);
+                self.skip_whitespace();
+                match self.peek() {
+                    Some(b',') => self.position += 1,
+                    Some(b']') => {
+                        self.position += 1;
+                        break;
+                    },
+                    _ => return Err(self.error("expected ',' or ']'")),
+                }
+            }
+        }
+        self.depth -= 1;
+        Ok(BorrowedJson::Array(elements))
+    }
+
+    /// Decodes an object; the current position is at the opening brace.
+    fn object(&mut self) -> Result<BorrowedJson<'a>, String> {
+        self.enter()?;
+        let mut members = Vec::new();
+        self.skip_whitespace();
+        if self.peek() == Some(b'}') {
+            self.position += 1;
+        } else {
+            loop {
+                self.skip_whitespace();
+                if self.peek() != Some(b'"') {
+                    return Err(self.error("expected member name"));
+                }
+                let key = self.string()?;
+                self.skip_whitespace();
+                if self.peek() != Some(b':') {
+                    return Err(self.error("expected ':'"));
+                }
+                self.position += 1;
+                members.push((key, self.value()?));
+                self.skip_whitespace();
+                match self.peek() {
+                    Some(b',') => self.position += 1,
+                    Some(b'}') => {
+                        self.position += 1;
+                        break;
+                    },
+                    _ => return Err(self.error("expected ',' or '}'")),
+                }
+            }
+        }
+        self.depth -= 1;
+        Ok(BorrowedJson::Object(members))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn round_trip() {
+        let mut content = Vec::new();
+        JsonWriter::new(&mut content)
+            .begin_object()
+            .key("text").string("a \"quoted\"\n\u{1} \\ µ")
+            .key("value").string_fmt(format_args!("{:.2} ({}%)", 1.005, "x\"y"))
+            .key("numbers").begin_array().number(1.5).number(f64::NAN).integer(-3).end_array()
+            .key("empty").begin_object().end_object()
+            .key("flags").begin_array().boolean(true).null().end_array()
+            .end_object();
+        let text = std::str::from_utf8(&content).unwrap();
+        assert_eq!(text, r#"{"text":"a \"quoted\"\n\u0001 \\ µ","value":"1.00 (x\"y%)","numbers":[1.5,null,-3],"empty":{},"flags":[true,null]}"#);
+        let value = parse_borrowed(text).unwrap();
+        assert_eq!(value.get("text").unwrap().as_str(), Some("a \"quoted\"\n\u{1} \\ µ"));
+        assert_eq!(value.get("value").unwrap().as_str(), Some("1.00 (x\"y%)"));
+        let numbers = value.get("numbers").unwrap().as_array().unwrap();
+        assert_eq!(numbers, &[BorrowedJson::Number(1.5), BorrowedJson::Null, BorrowedJson::Number(-3.0)]);
+        assert_eq!(value.get("empty"), Some(&BorrowedJson::Object(Vec::new())));
+    }
+
+    #[test]
+    fn decode() {
+        let value = parse_borrowed(r#" {"controlId" : "unit_name", "value":"\ud83d\ude00\u00e9", "width":800} "#).unwrap();
+        assert!(matches!(value.get("controlId"), Some(BorrowedJson::String(Cow::Borrowed("unit_name")))));
+        assert_eq!(value.get("value").unwrap().as_str(), Some("😀é"));
+        assert_eq!(value.get("width").unwrap().as_u32(), Some(800));
+        for invalid in ["", "{", "[1,]", "{\"a\" 1}", "\"\u{1}\"", "tru", "1 2", "\"\\x\"", "-"] {
+            assert!(parse_borrowed(invalid).is_err(), "{:?}", invalid);
+        }
+        assert!(parse_borrowed(&"[".repeat(MAX_DEPTH + 1)).is_err());
+    }
+
+    #[test]
+    fn numbers() {
+        for (text, value) in [("0", 0.0), ("-0", 0.0), ("12", 12.0), ("-1.5", -1.5), ("0.25", 0.25),
+                ("1e3", 1000.0), ("1E+3", 1000.0), ("2.5e-1", 0.25), ("[7]", 7.0)] {
+            let decoded = parse_borrowed(text).unwrap();
+            let decoded = decoded.as_array().map_or(&decoded, |a| &a[0]);
+            assert_eq!(decoded, &BorrowedJson::Number(value), "{:?}", text);
+        }
+        for invalid in ["1.", "+1", ".5", "-.5", "01", "-01", "1e", "1e+", "1.e3", "1..2", "1-2", "1e3.5", "--1", "[1.]", "Infinity", "NaN"] {
+            assert!(parse_borrowed(invalid).is_err(), "{:?}", invalid);
+        }
+    }
+
+    #[test]
+    fn unicode_escapes() {
+        assert_eq!(parse_borrowed(r#""\u00E9\u00e9""#).unwrap().as_str(), Some("éé"));
+        for invalid in [r#""\u+0e9""#, r#""\u-0e9""#, r#""\u 0e9""#, r#""\u00e""#, r#""\ud83d\u+e00""#, r#""\ud83d\u0041""#] {
+            assert!(parse_borrowed(invalid).is_err(), "{:?}", invalid);
+        }
+    }
+}
@@ -10,13 +10,40 @@
 //! This crate aims to provide such a dialog by using a local web server.
 //!
 //! The web server features multiple stay-alive connections, and the dialog messages are processed, all
-//! in the same, main thread. This enables the dialog itself to be running in the GUI thread, and it 
+//! in the same, main thread. The server waits for socket readiness and window messages through the
+//! operating system, so requests are served without delay while an idle dialog uses no CPU. This enables the dialog itself to be running in the GUI thread, and it 
 //! enables interaction with foreigh components, such as the add-in component that is being edited,
 //! to all be constrained to the same thread.
 //!
 //! The current implementation only works for Windows. Extension to linux and MacOS 
 //! is planned using Webkit or CEF functionality.
 //!
+//! Static assets can be registered as raw bytes, or as a [`StaticAsset`] prepared at build time
+//! by the `html_dialog_build` crate. The latter are sent gzip or brotli compressed, as accepted by
+//! the browser, and carry an entity tag, so that the browser revalidates its cached copy rather
+//! than downloading the asset each time a dialog is opened. To allow for this, the server listens
+//! on the same port as the previous dialog, if that port is available.
+//!
+//! Besides request and response, a page can connect to a WebSocket resource. Messages from the
+//! page are passed to the handler as events, and the application pushes messages to the page
+//! through a [`DialogPushSender`], from any thread, so that state changes reach the page without
+//! polling.
+//!
+//! Handlers run on the thread that shows the dialog, as required for COBIA objects, unless a
+//! resource is mapped to a task: the handler then prepares a [`DialogTask`] that runs on a worker
+//! thread, while the server continues to serve other requests, and the result is sent as the
+//! response once the task has finished. Static content and control requests are always served
+//! without waiting for handlers.
+//!
+//! JSON payloads are written by a [`JsonWriter`] directly into the response content, and request
+//! content is passed to the handler as a borrowed string, to be decoded by [`parse_borrowed`]
+//! without copying.
+//!
+//! Long-running calculations report progress through a [`ProgressSender`], which writes into a
+//! lock-free queue without blocking the calculation, and wakes the server loop when it has records
+//! to take. The records are sent as server-sent events to the pages that are connected to the
+//! corresponding event stream resource.
+//!
 //! The web server logs to the log crate, so for diagnostic purposes, the host application
 //! may set up logging to see the requests and responses. For example:
 //! ```
@@ -31,14 +58,31 @@
 
 
 mod connection;
+mod request;
 mod browser;
 mod browser_process;
 mod window;
+mod reactor;
+mod asset;
+mod websocket;
+mod push;
+mod progress;
+mod json_payload;
 
 #[cfg(target_os = "windows")]
 mod message_loop;
 
 pub use window::Window;
+pub use asset::StaticAsset;
+pub use push::DialogPushSender;
+pub use progress::{ProgressRecord, ProgressSender, ProgressStream, progress_channel};
+pub use json_payload::{BorrowedJson, JsonWriter, parse_borrowed};
+
+/// The request parser, for the benchmarks; not part of the API.
+#[doc(hidden)]
+pub mod bench_internals {
+    pub use crate::request::{ParseStatus, Request};
+}
 
 #[cfg(target_os = "windows")]
 mod browser_edgeview2;
@@ -47,10 +91,61 @@ use std::{
     io::ErrorKind,
     net::TcpListener,
     cell::RefCell,
+    fmt::Write,
+    sync::{
+        atomic::{AtomicU16, Ordering},
+        mpsc,
+    },
+    time::Duration,
 };
-use connection::{Connection};
+use connection::{Body, Connection, ResponseContent};
+use reactor::Reactor;
+use push::PushReceiver;
 use log::{info, error};
 
+/// Interval at which the browser is checked for termination while no other events occur.
+const BROWSER_MONITOR_INTERVAL: Duration = Duration::from_millis(100);
+
+/// Time after which a persistent connection that waits for a next request is closed.
+const IDLE_TIMEOUT: Duration = Duration::from_secs(30);
+
+/// Maximum number of requests that is answered on a single connection.
+const MAX_REQUESTS_PER_CONNECTION: u32 = 1000;
+
+/// Maximum number of pipelined requests of a connection that is answered before other connections are served.
+const MAX_REQUESTS_PER_PASS: usize = 16;
+
+/// The port of the most recently shown dialog; the browser cache is specific to the port.
+static LAST_PORT: AtomicU16 = AtomicU16::new(0);
+
+/// Work that a handler prepares to run on a worker thread.
+///
+/// The task owns everything it needs; on success it returns the content and its MIME type.
+pub type DialogTask = Box<dyn FnOnce() -> Result<(Vec<u8>, String), Box<dyn std::error::Error + Send + Sync>> + Send>;
+
+/// Runs a task on a worker thread.
+///
+/// # Parameters
+/// * `task` - The task
+/// * `waker` - Wakes the server loop when the task has finished
+///
+/// # Returns
+/// * `Ok(receiver)` - Receives the response when the task has finished
+/// * `Err(...)` - If the thread cannot be started
+fn spawn_task(task: DialogTask, waker: DialogPushSender) -> std::io::Result<mpsc::Receiver<ResponseContent>> {
+    let (sender, receiver) = mpsc::channel();
+    std::thread::Builder::new().name("html_dialog task".into()).spawn(move || {
+        let response: ResponseContent = match task() {
+            Ok((content, content_type)) => (content.into(), content_type, 200),
+            Err(e) => (format!("{}", e).into_bytes().into(), "text/plain".into(), 500),
+        };
+        // The connection may have been closed in the meantime
+        let _ = sender.send(response);
+        waker.wake();
+    })?;
+    Ok(receiver)
+}
+
 /// Handler trait for providing dynamic content in HTML dialogs.
 ///
 /// Implementors of this trait can provide content in response to specific events,
@@ -66,14 +161,33 @@ pub trait HtmlDialogHandler<E> {
     ///
     /// # Parameters
     /// * `event` - Reference to the event that triggered the content request
-    /// * `content` - Optional content sent with the request (e.g., from a POST request)
+    /// * `content` - Optional content sent with the request (e.g., from a POST request), borrowed from the receive buffer
     /// * `window` - Optional handle to the browser window, if available
     ///
     /// # Returns
     /// * `Ok((Vec<u8>, String))` - Content as bytes and its MIME type (e.g., "text/html")
     /// * `Err(...)` - If content generation fails
-    fn provide_content(&mut self, event: &E, content: Option<String>, window: Option<Window>) 
+    fn provide_content(&mut self, event: &E, content: Option<&str>, window: Option<Window>) 
         -> Result<(Vec<u8>, String), Box<dyn std::error::Error>>;
+
+    /// Prepares the processing of a request on a worker thread.
+    ///
+    /// Called on the thread that shows the dialog, for a path that is mapped to a Task
+    /// event. The handler captures what the task needs, such as a copy of its data; objects
+    /// that are bound to the thread that shows the dialog, such as COBIA objects, cannot be
+    /// captured. The dialog serves other requests while the task runs.
+    ///
+    /// # Parameters
+    /// * `event` - Reference to the event that triggered the request
+    /// * `content` - Optional content sent with the request (e.g., from a POST request)
+    ///
+    /// # Returns
+    /// * `Ok(DialogTask)` - The task, of which the result is sent as the response
+    /// * `Err(...)` - If the request cannot be processed; the default for handlers without tasks
+    fn start_task(&mut self, event: &E, content: Option<&str>) -> Result<DialogTask, Box<dyn std::error::Error>> {
+        let _ = (event, content);
+        Err("The handler does not process requests on a worker thread".into())
+    }
 }
 
 /// Types of resources that can be served by an HTML dialog.
@@ -90,8 +204,19 @@ pub enum HtmlDialogResourceType<E> {
     /// * `&'static [u8]` - The raw content bytes
     /// * `&'static str` - The MIME type (e.g., "text/html", "application/javascript")
     Content((&'static [u8], &'static str)),
-    /// Custom event information to be processed by the HtmlDialogHandler
+    /// Static content with precompressed variants and an entity tag
+    Asset(&'static StaticAsset),
+    /// WebSocket endpoint; text messages from the page are passed to the HtmlDialogHandler
+    /// with this event, and non-empty content that it returns is sent back to the page.
+    /// Messages pushed through the DialogPushSender are sent to all connected pages.
+    WebSocket(E),
+    /// Event stream endpoint; progress records sent through the ProgressSender of the
+    /// channel are sent to all connected pages as server-sent events.
+    EventStream(ProgressStream),
+    /// Custom event information to be processed by the HtmlDialogHandler, on the thread that shows the dialog
     Info(E),
+    /// Custom event that is processed by a task that the HtmlDialogHandler prepares, on a worker thread
+    Task(E),
     /// Request to resize the browser window
     ResizeRequest,
     /// Request to terminate the dialog
@@ -118,6 +243,8 @@ pub struct HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
     parent: Option<Window>,
     /// Whether the dialog should be modal (block the parent window)
     as_modal: bool,
+    /// Messages to push to the pages
+    push: DialogPushSender,
 }
 
 impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
@@ -138,6 +265,7 @@ impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
             browser_monitor: None,
             parent: None,
             as_modal: true, // Unused if no parent is set
+            push: DialogPushSender::new(),
         };
         // Register standard endpoints
         html_dialog.add("/resize_window".into(), HtmlDialogResourceType::ResizeRequest);
@@ -183,6 +311,10 @@ impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
     /// * `location` - The URL path to map (e.g., "/index.html")
     /// * `resource` - The resource to serve at this location
     pub fn add(&mut self, location: String, resource: HtmlDialogResourceType<E>) {
+        if let HtmlDialogResourceType::EventStream(ref stream) = resource {
+            // progress records wake the server loop
+            stream.set_waker(self.push.clone());
+        }
         self.resource_map.insert(location, resource);
     }
 
@@ -196,9 +328,16 @@ impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
     /// * `Ok(())` - If the dialog was shown and closed successfully
     /// * `Err(...)` - If an error occurred during setup or execution
     pub fn show(&mut self) -> Result<(), Box<dyn std::error::Error>> {
-        // Start HTTP server on a random available port
-        let listener = TcpListener::bind("127.0.0.1:0")?;
+        // Start HTTP server on the port of the previous dialog, or else on a random available port
+        let listener = match LAST_PORT.load(Ordering::Relaxed) {
+            0 => TcpListener::bind("127.0.0.1:0")?,
+            port => match TcpListener::bind(("127.0.0.1", port)) {
+                Ok(l) => l,
+                Err(_) => TcpListener::bind("127.0.0.1:0")?,
+            },
+        };
         let port = listener.local_addr()?.port();
+        LAST_PORT.store(port, Ordering::Relaxed);
         info!("Listening on port: {}", port);
         // Set up parent window reference if provided
         let parent: Option<Window> = match self.parent {
@@ -212,6 +351,18 @@ impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
             &format!("http://127.0.0.1:{}/", port)
         )?;
         self.browser_monitor = Some(RefCell::new(browser_monitor));
+        self.serve(listener)
+    }
+
+    /// Serves requests until the browser is closed or an error occurs.
+    ///
+    /// # Parameters
+    /// * `listener` - The listening socket of the web server
+    ///
+    /// # Returns
+    /// * `Ok(())` - If the browser was closed
+    /// * `Err(...)` - If an error occurred
+    fn serve(&mut self, listener: TcpListener) -> Result<(), Box<dyn std::error::Error>> {
         // Set the listener to non-blocking mode
         match listener.set_nonblocking(true) {
             Ok(_) => {},
@@ -221,211 +372,417 @@ impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
                 return Err(e.into());
             }
         };        
+        // Set up readiness notification
+        let mut reactor = match Reactor::new() {
+            Ok(r) => r,
+            Err(e) => {
+                error!("Failed to create reactor: {}", e);
+                self.browser_monitor = None;
+                return Err(e.into());
+            }
+        };
+        // Set up the push channel
+        let push_receiver = match PushReceiver::new(&self.push) {
+            Ok(r) => r,
+            Err(e) => {
+                error!("Failed to create push channel: {}", e);
+                self.browser_monitor = None;
+                return Err(e.into());
+            }
+        };
         // Main connection processing loop
         let mut connections = Vec::<Connection>::new();
-        for stream in listener.incoming() {
-            let mut any_action: bool = false;            
-            // Handle new connections
-            match stream {
-                Ok(s) => {
-                    info!("Accepted connection");
-                    any_action = true;
-                    // Create and add a new connection
-                    match Connection::new(s) {
-                        Ok(connection) => {
-                            connections.push(connection);
-                        },
-                        Err(e) => {
-                            assert!(false, "Failed to create connection: {}", e);
-                            continue;
-                        }
-                    }
-                },
-                // Handle non-blocking check for browser termination
-                Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
-                    let mut return_code: Option<Result<(), Box<dyn std::error::Error>>> = None;
-                    // Check if browser has terminated
-                    if let Some(ref b) = self.browser_monitor {
-                        match b.borrow_mut().is_terminated() {
-                            Ok(terminated) => {
-                                if terminated {
-                                    info!("Browser process terminated, exiting.");
-                                    return_code = Some(Ok(()));
-                                }
+        loop {
+            // Consume the wake-up before checking what it was for
+            push_receiver.acknowledge();
+            // Accept all pending connections
+            loop {
+                match listener.accept() {
+                    Ok((s, _)) => {
+                        info!("Accepted connection");
+                        // Create and add a new connection
+                        match Connection::new(s) {
+                            Ok(connection) => {
+                                connections.push(connection);
                             },
                             Err(e) => {
-                                error!("Browser error: {}", e);
-                                return_code = Some(Err(e));
+                                assert!(false, "Failed to create connection: {}", e);
                             }
                         }
+                    },
+                    Err(ref e) if e.kind() == ErrorKind::WouldBlock => {
+                        break;
+                    },
+                    Err(e) => {
+                        error!("Failed to accept connection: {}", e);
+                        break;
                     }
-                    // Return if browser has terminated or errored
-                    if let Some(returncode) = return_code {
-                        self.browser_monitor = None;
-                        return returncode;
-                    }
-                },
-                Err(e) => {
-                    error!("Failed to accept connection: {}", e);
                 }
-            };
-            // Process all active connections
+            }
+            // Process all active connections; a closed connection is kept until its output is written
             connections.retain_mut(|connection| {
-                let mut keep = true;
-                // Advance connection state
-                if connection.advance() {
-                    any_action = true;
+                if connection.is_closing() {
+                    return connection.drain(IDLE_TIMEOUT);
+                }
+                // Requests that are already buffered are answered in order, up to a limit for fairness
+                for _ in 0..MAX_REQUESTS_PER_PASS {
+                    if !self.process_connection(connection) {
+                        connection.close();
+                        return connection.drain(IDLE_TIMEOUT);
+                    }
+                    if !connection.has_buffered_input() || connection.is_awaiting_task() {
+                        break;
+                    }
+                }
+                true
+            });
+            // Send pushed messages to the pages that are connected through WebSocket
+            let any_websocket = connections.iter().any(|c| c.is_websocket());
+            for message in push_receiver.take(any_websocket) {
+                for connection in connections.iter_mut().filter(|c| c.is_websocket()) {
+                    connection.send_message(message.clone().into_bytes());
                 }
-                // Handle completed or errored connections
-                if connection.is_error() || connection.is_complete() {
-                    let (content, content_type, response) = if connection.is_error() {
-                        // Handle connection errors
-                        keep = false;
-                        let code = connection.get_error_code();
-                        if code != 0 {
-                            print!("==> Error: {}\n", connection.get_error());
+            }
+            // Send progress records to the pages that are connected to an event stream;
+            // records are kept in the queue until a page connects
+            let any_event_stream = connections.iter().any(|c| c.is_event_stream());
+            if any_event_stream {
+                for (location, resource) in self.resource_map.iter_mut() {
+                    if let HtmlDialogResourceType::EventStream(stream) = resource {
+                        let events = stream.take_events();
+                        if !events.is_empty() {
+                            for connection in connections.iter_mut()
+                                    .filter(|c| c.is_event_stream() && c.get_upgrade_location() == location) {
+                                connection.send_events(events.clone());
+                            }
                         }
-                        (connection.get_error().as_bytes().to_vec(), "text/plain".into(), code)
-                    } else {
-                        // Handle completed requests
-                        let parent = self.get_window();
-                        let res = match self.resource_map.get(connection.get_location()) {
-                            Some(e) => match e {
-                                // Serve static content
-                                HtmlDialogResourceType::Content((content, content_type)) => 
-                                    (content.to_vec(), content_type.to_string(), 200),
-                                // Process custom events through handler
-                                HtmlDialogResourceType::Info(info) => {
-                                    let response_from_content = |content: Vec<u8>| {
-                                        // Parse content as UTF-8 if available
-                                        let content = if content.is_empty() {
-                                            None
-                                        } else {
-                                            match String::from_utf8(content) {
-                                                Ok(c) => Some(c),
-                                                Err(_) => {
-                                                    return ("invalid post content: invalid UTF-8"
-                                                        .as_bytes().to_vec(), "text/plain".into(), 500);
-                                                }
-                                            }
-                                        };
-                                        // Call handler to generate response
-                                        match self.handler.provide_content(info, content, parent) {
-                                            Ok((content, content_type)) => (content, content_type, 200),
-                                            Err(e) => (format!("{}", e).as_bytes().to_vec(), 
-                                                      "text/plain".into(), 500),
+                    }
+                }
+            }
+            // Process browser messages if needed
+            if let Some(ref browser_monitor) = self.browser_monitor {
+                browser_monitor.borrow_mut().pump_messages();
+            }
+            // Check if browser has terminated
+            let mut return_code: Option<Result<(), Box<dyn std::error::Error>>> = None;
+            if let Some(ref b) = self.browser_monitor {
+                match b.borrow_mut().is_terminated() {
+                    Ok(terminated) => {
+                        if terminated {
+                            info!("Browser process terminated, exiting.");
+                            return_code = Some(Ok(()));
+                        }
+                    },
+                    Err(e) => {
+                        error!("Browser error: {}", e);
+                        return_code = Some(Err(e));
+                    }
+                }
+            }
+            // Return if browser has terminated or errored
+            if let Some(returncode) = return_code {
+                self.browser_monitor = None;
+                return returncode;
+            }
+            // Wait until a socket is ready, a message arrives, or the browser must be checked again
+            let mut timeout = BROWSER_MONITOR_INTERVAL;
+            reactor.clear();
+            let mut registered = reactor.register(&listener, true, false)
+                .and_then(|_| reactor.register(push_receiver.get_socket(), true, false));
+            for connection in connections.iter() {
+                if connection.is_awaiting_task() && !connection.wants_write() {
+                    // a next request is not read until the task has finished, which wakes the loop
+                    continue;
+                }
+                if registered.is_ok() {
+                    // a closing connection does not read, so it only waits to write
+                    registered = reactor.register(connection.get_stream(), !connection.is_closing(), connection.wants_write());
+                }
+                if connection.has_buffered_input() && !connection.is_closing() {
+                    // buffered data does not signal readiness
+                    timeout = Duration::ZERO;
+                }
+            }
+            if let Err(e) = registered.and_then(|_| reactor.wait(timeout)) {
+                error!("Failed to wait for connections: {}", e);
+                self.browser_monitor = None;
+                return Err(e.into());
+            }
+        }
+    }
+
+
+    /// Advances a connection, and answers its request once complete.
+    ///
+    /// # Parameters
+    /// * `connection` - The connection
+    ///
+    /// # Returns
+    /// * `true` - If the connection is kept
+    /// * `false` - If the connection is to be closed
+    fn process_connection(&mut self, connection: &mut Connection) -> bool {
+        let mut keep = true;
+        // Additional response headers
+        let mut extra_headers = String::new();
+        // Location of a WebSocket resource, if the connection is upgraded
+        let mut upgrade_location = None;
+        // Location of an event stream resource, if the connection becomes an event stream
+        let mut event_stream_location = None;
+        // Advance connection state, and close a persistent connection that is no longer used
+        if !connection.advance() && connection.is_idle(IDLE_TIMEOUT) {
+            info!("Closing idle connection");
+            return false;
+        }
+        // Take the response to a request that is processed on a worker thread
+        let mut task_response = None;
+        if connection.is_awaiting_task() && !connection.is_error() {
+            match connection.poll_task() {
+                Some(response) => task_response = Some(response),
+                None => return true, // Still running
+            }
+        }
+        // Pass WebSocket messages to the handler
+        if connection.is_websocket() {
+            while let Some(message) = connection.next_message() {
+                let parent = self.get_window();
+                let info = match self.resource_map.get(connection.get_upgrade_location()) {
+                    Some(HtmlDialogResourceType::WebSocket(info)) => info,
+                    _ => break,
+                };
+                match self.handler.provide_content(info, Some(&message), parent) {
+                    Ok((content, _)) => {
+                        if !content.is_empty() {
+                            connection.send_message(content);
+                        }
+                    },
+                    Err(e) => error!("Failed to process WebSocket message: {}", e),
+                }
+            }
+        }
+        // Handle completed or errored connections
+        if connection.is_error() || connection.is_complete() {
+            let (content, content_type, response): (Body, String, i32) = if connection.is_error() {
+                // Handle connection errors
+                keep = false;
+                let code = connection.get_error_code();
+                if code != 0 {
+                    print!("==> Error: {}\n", connection.get_error());
+                }
+                (connection.get_error().into_bytes().into(), "text/plain".into(), code)
+            } else {
+                // Handle completed requests
+                let parent = self.get_window();
+                let res: ResponseContent = match task_response {
+                    Some(response) => response,
+                    None => match self.resource_map.get(connection.get_location()) {
+                    Some(e) => match e {
+                        // Serve static content
+                        HtmlDialogResourceType::Content((content, content_type)) => 
+                            (Body::Static(content), content_type.to_string(), 200),
+                        // Serve precompressed static content, unless the browser has it
+                        HtmlDialogResourceType::Asset(asset) => {
+                            let (encoding, content) = asset.select(connection.get_header("accept-encoding"));
+                            let _ = write!(extra_headers, "ETag: {}\r\nCache-Control: no-cache\r\nVary: Accept-Encoding\r\n",
+                                asset.entity_tag(encoding));
+                            if asset.is_not_modified(encoding, connection.get_header("if-none-match")) {
+                                (Body::Static(b""), asset.content_type.to_string(), 304)
+                            } else {
+                                if let Some(coding) = encoding.name() {
+                                    let _ = write!(extra_headers, "Content-Encoding: {}\r\n", coding);
+                                }
+                                (Body::Static(content), asset.content_type.to_string(), 200)
+                            }
+                        },
+                        // Upgrade to WebSocket
+                        HtmlDialogResourceType::WebSocket(_) => {
+                            match connection.websocket_accept() {
+                                Some(accept) => {
+                                    let _ = write!(extra_headers, "Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: {}\r\n", accept);
+                                    upgrade_location = Some(connection.get_location().to_string());
+                                    (Body::Static(b""), String::new(), 101)
+                                },
+                                None => (Body::Static(b"Invalid WebSocket handshake"), "text/plain".into(), 400),
+                            }
+                        },
+                        // Start an event stream; the events are sent as they occur
+                        HtmlDialogResourceType::EventStream(_) => {
+                            extra_headers.push_str("Content-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n");
+                            event_stream_location = Some(connection.get_location().to_string());
+                            (Body::Static(b""), String::new(), 200)
+                        },
+                        // Process custom events through handler
+                        HtmlDialogResourceType::Info(info) => {
+                            let response_from_content = |content: &[u8]| -> (Body, String, i32) {
+                                // Parse content as UTF-8 if available
+                                let content = if content.is_empty() {
+                                    None
+                                } else {
+                                    match std::str::from_utf8(content) {
+                                        Ok(c) => Some(c),
+                                        Err(_) => {
+                                            return (Body::Static(b"invalid post content: invalid UTF-8"), "text/plain".into(), 500);
                                         }
-                                    };
-                                    response_from_content(connection.get_content())
+                                    }
+                                };
+                                // Call handler to generate response
+                                match self.handler.provide_content(info, content, parent) {
+                                    Ok((content, content_type)) => (content.into(), content_type, 200),
+                                    Err(e) => (format!("{}", e).into_bytes().into(), 
+                                              "text/plain".into(), 500),
+                                }
+                            };
+                            response_from_content(connection.get_content())
+                        },
+                        // Start a task, and serve other requests while it runs
+                        HtmlDialogResourceType::Task(info) => {
+                            let content = match connection.get_content() {
+                                [] => Ok(None),
+                                content => std::str::from_utf8(content).map(Some),
+                            };
+                            match content {
+                                Ok(content) => match self.handler.start_task(info, content) {
+                                    Ok(task) => match spawn_task(task, self.push.clone()) {
+                                        Ok(receiver) => {
+                                            // The response is sent when the task has finished
+                                            connection.await_task(receiver);
+                                            return true;
+                                        },
+                                        Err(e) => (format!("Failed to start task: {}", e).into_bytes().into(),
+                                                  "text/plain".into(), 500),
+                                    },
+                                    Err(e) => (format!("{}", e).into_bytes().into(), "text/plain".into(), 500),
                                 },
-                                // Handle window resize requests
-                                HtmlDialogResourceType::ResizeRequest => {
-                                    let content = connection.get_content();
-                                    if content.is_empty() {
-                                        // No content, error
-                                        ("Invalid resize request".as_bytes().to_vec(), 
-                                         "text/plain".into(), 500)
-                                    } else {
-                                        // Parse JSON for width and height
-                                        match String::from_utf8(content) {
-                                            Ok(c) => {
-                                                match json::parse(&c) {
-                                                    Ok(j) => {
-                                                        let width = j["width"].as_u32().unwrap_or(800);
-                                                        let height = j["height"].as_u32().unwrap_or(600);
-                                                        // Attempt to resize browser window
-                                                        match self.browser_monitor {
-                                                            Some(ref b) => {
-                                                                match b.borrow_mut().resize_request(width, height) {
-                                                                    Ok(_) => ("".as_bytes().to_vec(), 
-                                                                             "text/plain".into(), 200),
-                                                                    Err(e) => (format!("Failed to resize window: {}", e)
-                                                                              .as_bytes().to_vec(), 
-                                                                             "text/plain".into(), 500),
-                                                                }
-                                                            },
-                                                            None => {
-                                                                ("No browser".as_bytes().to_vec(), 
-                                                                 "text/plain".into(), 500)
-                                                            }
+                                Err(_) => (Body::Static(b"invalid post content: invalid UTF-8"), "text/plain".into(), 500),
+                            }
+                        },
+                        // Handle window resize requests
+                        HtmlDialogResourceType::ResizeRequest => {
+                            let content = connection.get_content();
+                            if content.is_empty() {
+                                // No content, error
+                                (Body::Static(b"Invalid resize request"), 
+                                 "text/plain".into(), 500)
+                            } else {
+                                // Parse JSON for width and height
+                                match std::str::from_utf8(content) {
+                                    Ok(c) => {
+                                        match parse_borrowed(c) {
+                                            Ok(j) => {
+                                                let width = j.get("width").and_then(|v| v.as_u32()).unwrap_or(800);
+                                                let height = j.get("height").and_then(|v| v.as_u32()).unwrap_or(600);
+                                                // Attempt to resize browser window
+                                                match self.browser_monitor {
+                                                    Some(ref b) => {
+                                                        match b.borrow_mut().resize_request(width, height) {
+                                                            Ok(_) => (Body::Static(b""), 
+                                                                     "text/plain".into(), 200),
+                                                            Err(e) => (format!("Failed to resize window: {}", e)
+                                                                      .into_bytes().into(), 
+                                                                     "text/plain".into(), 500),
                                                         }
                                                     },
-                                                    Err(e) => (format!("Invalid JSON in resize request: {}", e)
-                                                              .as_bytes().to_vec(), 
-                                                             "text/plain".into(), 500),
+                                                    None => {
+                                                        (Body::Static(b"No browser"), 
+                                                         "text/plain".into(), 500)
+                                                    }
                                                 }
                                             },
-                                            Err(_) => {
-                                                ("invalid post content: invalid UTF-8".as_bytes().to_vec(), 
-                                                 "text/plain".into(), 500)
-                                            }
+                                            Err(e) => (format!("Invalid JSON in resize request: {}", e)
+                                                      .into_bytes().into(), 
+                                                     "text/plain".into(), 500),
                                         }
+                                    },
+                                    Err(_) => {
+                                        (Body::Static(b"invalid post content: invalid UTF-8"), 
+                                         "text/plain".into(), 500)
                                     }
-                                },
-                                // Handle dialog termination requests
-                                HtmlDialogResourceType::TerminateRequest => {
-                                    if let Some(ref b) = self.browser_monitor {
-                                        b.borrow_mut().terminate();
-                                    }
-                                    info!("Terminated, exiting.");
-                                    ("OK".as_bytes().to_vec(), "text/plain".into(), 200)
-                                },
-                            },
-                            // Handle resource not found
-                            None => (format!("Resource not found: {}", connection.get_location())
-                                    .as_bytes().to_vec(), "text/plain".into(), 404)
-                        };
-                        connection.reset();
-                        res
-                    };
-                    // Generate and send HTTP response
-                    let length = content.len();
-                    let response = match response {
-                        200 => "HTTP/1.1 200 OK".into(),
-                        404 => "HTTP/1.1 404 Not Found".into(),
-                        500 => "HTTP/1.1 500 Internal Server Error".into(),
-                        505 => "HTTP/1.1 505 HTTP Version Not Supported".into(),
-                        0 => {
-                            // Connection closed, don't reply
-                            info!("Connection closed");
-                            return false;
-                        }
-                        _ => format!("HTTP/1.1 {} Error", response)
-                    };
-                    // Create full HTTP response with headers
-                    let response = format!(
-                        "{}\r\nContent-Length: {}\r\nConnection: {}\r\nContent-Type: {}\r\n\r\n", 
-                        response, length, 
-                        if keep { "keep-alive" } else { "close" }, 
-                        content_type
-                    );
-                    info!("==> {}", response);
-                    // Write response and content
-                    connection.write(response.as_bytes());
-                    connection.write(&content);
+                                }
+                            }
+                        },
+                        // Handle dialog termination requests
+                        HtmlDialogResourceType::TerminateRequest => {
+                            if let Some(ref b) = self.browser_monitor {
+                                b.borrow_mut().terminate();
+                            }
+                            info!("Terminated, exiting.");
+                            (Body::Static(b"OK"), "text/plain".into(), 200)
+                        },
+                    },
+                    // Handle resource not found
+                    None => (format!("Resource not found: {}", connection.get_location())
+                            .into_bytes().into(), "text/plain".into(), 404)
+                    },
                 };
-                if !keep {
-                    info!("Closing connection");
+                // The connection is closed after the response if the client asks so, or if the request limit is reached
+                if upgrade_location.is_none() && event_stream_location.is_none() && (connection.wants_close()
+                        || connection.get_requests_answered() + 1 >= MAX_REQUESTS_PER_CONNECTION) {
+                    keep = false;
                 }
-                // Return whether to keep the connection
-                keep
-            });            
-            // Process browser messages if needed
-            if let Some(ref browser_monitor) = self.browser_monitor {
-                if browser_monitor.borrow_mut().pump_messages() {
-                    any_action = true;
+                connection.reset();
+                res
+            };
+            // Generate and send HTTP response
+            let length = content.as_slice().len();
+            let not_modified = response == 304;
+            let response = match response {
+                101 => "HTTP/1.1 101 Switching Protocols".into(),
+                200 => "HTTP/1.1 200 OK".into(),
+                304 => "HTTP/1.1 304 Not Modified".into(),
+                400 => "HTTP/1.1 400 Bad Request".into(),
+                404 => "HTTP/1.1 404 Not Found".into(),
+                500 => "HTTP/1.1 500 Internal Server Error".into(),
+                505 => "HTTP/1.1 505 HTTP Version Not Supported".into(),
+                0 => {
+                    // Connection closed, don't reply
+                    info!("Connection closed");
+                    return false;
                 }
-            }            
-            // Sleep if no activity to avoid busy-waiting
-            if !any_action {
-                std::thread::sleep(std::time::Duration::from_millis(50));
+                _ => format!("HTTP/1.1 {} Error", response)
+            };
+            // Tell the client how long, and for how many requests, the connection persists
+            let connection_header = if keep {
+                format!("Connection: keep-alive\r\nKeep-Alive: timeout={}, max={}\r\n",
+                    IDLE_TIMEOUT.as_secs(), MAX_REQUESTS_PER_CONNECTION.saturating_sub(connection.get_requests_answered()))
+            } else {
+                "Connection: close\r\n".into()
+            };
+            // Create HTTP response headers; a 304 response describes the content without including it
+            let header = if upgrade_location.is_some() || event_stream_location.is_some() {
+                format!("{}\r\n{}\r\n", response, extra_headers)
+            } else if not_modified {
+                format!("{}\r\n{}{}\r\n", response, connection_header, extra_headers)
+            } else {
+                format!(
+                    "{}\r\nContent-Length: {}\r\n{}Content-Type: {}\r\n{}\r\n", 
+                    response, length, connection_header, content_type, extra_headers
+                )
+            };
+            info!("==> {}", header);
+            // Write response headers and content
+            connection.send(header.into_bytes(), content);
+            if let Some(location) = upgrade_location {
+                info!("WebSocket connected: {}", location);
+                connection.upgrade(location);
+            }
+            if let Some(location) = event_stream_location {
+                info!("Event stream connected: {}", location);
+                connection.start_event_stream(location);
             }
-        }        
-        // Clean up browser monitor before returning
-        self.browser_monitor = None;
-        Ok(())
+        };
+        if !keep {
+            info!("Closing connection");
+        }
+        // Return whether to keep the connection
+        keep
     }
 
+    /// Gets a handle to push messages to the pages of the dialog.
+    ///
+    /// # Returns
+    /// * A sender that can be cloned, and used from any thread
+    pub fn push_sender(&self) -> DialogPushSender {
+        self.push.clone()
+    }
 
     /// Get the handler for direct access.
     ///
@@ -433,4 +790,209 @@ impl<T, E> HtmlDialog<T, E> where T: HtmlDialogHandler<E> {
     pub fn get_handler(&mut self) -> &mut T {
         &mut self.handler
     }
-}
\ No newline at end of file
+}
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::{
+        io::{Read, Write as _},
+        net::TcpStream,
+        sync::{Arc, atomic::AtomicBool},
+        time::Instant,
+    };
+
+    /// Stands in for the browser; terminates when the page requests to close the window,
+    /// or when the client has stopped.
+    struct ReplayBrowser {
+        terminated: Arc<AtomicBool>,
+    }
+
+    impl browser::BrowserMonitor for ReplayBrowser {
+        fn is_terminated(&mut self) -> Result<bool, Box<dyn std::error::Error>> {
+            Ok(self.terminated.load(Ordering::Relaxed))
+        }
+        fn resize_request(&mut self, _width: u32, _height: u32) -> Result<(), Box<dyn std::error::Error>> {
+            Ok(())
+        }
+        fn terminate(&mut self) {
+            self.terminated.store(true, Ordering::Relaxed);
+        }
+        fn get_window(&mut self) -> Option<Window> {
+            None
+        }
+        fn pump_messages(&mut self) -> bool {
+            false
+        }
+    }
+
+    /// Answers handler requests with the length of the posted content.
+    struct ReplayHandler;
+
+    impl HtmlDialogHandler<()> for ReplayHandler {
+        fn provide_content(&mut self, _event: &(), content: Option<&str>, _window: Option<Window>)
+            -> Result<(Vec<u8>, String), Box<dyn std::error::Error>> {
+            Ok((format!("{{\"length\":{}}}", content.map_or(0, str::len)).into_bytes(), "application/json".into()))
+        }
+    }
+
+    /// Client that replays requests on a persistent connection, and reconnects when the server closes it.
+    struct ReplayClient {
+        port: u16,
+        stream: Option<TcpStream>,
+        buffer: Vec<u8>,
+        /// Terminates the dialog when the client is dropped, also if the client panics
+        terminated: Arc<AtomicBool>,
+    }
+
+    impl ReplayClient {
+        /// Sends a request and reads the response.
+        ///
+        /// # Parameters
+        /// * `request` - The request
+        ///
+        /// # Returns
+        /// * The status code and the content of the response
+        fn exchange(&mut self, request: &[u8]) -> (u32, Vec<u8>) {
+            let port = self.port;
+            let stream = self.stream.get_or_insert_with(|| {
+                let stream = TcpStream::connect(("127.0.0.1", port)).unwrap();
+                stream.set_nodelay(true).unwrap();
+                stream
+            });
+            stream.write_all(request).unwrap();
+            self.buffer.clear();
+            let mut chunk = [0u8; 4096];
+            loop {
+                if let Some(end) = self.buffer.windows(4).position(|w| w == b"\r\n\r\n") {
+                    let head = std::str::from_utf8(&self.buffer[..end]).unwrap().to_ascii_lowercase();
+                    let status = head[9..12].parse().unwrap();
+                    let length: usize = head.lines()
+                        .find_map(|line| line.strip_prefix("content-length:"))
+                        .map_or(0, |value| value.trim().parse().unwrap());
+                    if self.buffer.len() >= end + 4 + length {
+                        if head.lines().any(|line| line == "connection: close") {
+                            self.stream = None;
+                        }
+                        return (status, self.buffer[end + 4..end + 4 + length].to_vec());
+                    }
+                }
+                let n = stream.read(&mut chunk).unwrap();
+                assert!(n > 0, "connection closed");
+                self.buffer.extend_from_slice(&chunk[..n]);
+            }
+        }
+
+        /// Requests to close the window, and waits for the dialog to close the connection.
+        fn close_window(&mut self) {
+            self.stream = None;
+            let mut stream = TcpStream::connect(("127.0.0.1", self.port)).unwrap();
+            stream.write_all(b"GET /close_window HTTP/1.1\r\n\r\n").unwrap();
+            // the dialog exits once the window is closed, possibly before the response is sent
+            while matches!(stream.read(&mut [0u8; 4096]), Ok(n) if n > 0) {}
+        }
+    }
+
+    impl Drop for ReplayClient {
+        fn drop(&mut self) {
+            self.terminated.store(true, Ordering::Relaxed);
+        }
+    }
+
+    /// Latency statistics of a replayed request.
+    fn report(name: &str, latencies: &mut [Duration]) {
+        latencies.sort();
+        let percentile = |p: usize| latencies[(latencies.len() - 1) * p / 100].as_secs_f64() * 1e6;
+        println!("{:<10} median {:>8.1} µs   p99 {:>8.1} µs   max {:>8.1} µs",
+            name, percentile(50), percentile(99), latencies[latencies.len() - 1].as_secs_f64() * 1e6);
+    }
+
+    /// Runs a dialog without browser, replays requests from a client thread, and closes the dialog.
+    ///
+    /// # Parameters
+    /// * `requests` - The number of times each request is replayed
+    ///
+    /// # Returns
+    /// * The latencies of the static and the handler request
+    fn replay(requests: usize) -> (Vec<Duration>, Vec<Duration>) {
+        let terminated = Arc::new(AtomicBool::new(false));
+        let mut dialog = HtmlDialog::new(ReplayHandler);
+        dialog.add("/".into(), HtmlDialogResourceType::Content((b"<html></html>", "text/html")));
+        dialog.add("/update".into(), HtmlDialogResourceType::Info(()));
+        dialog.browser_monitor = Some(RefCell::new(Box::new(ReplayBrowser { terminated: terminated.clone() })));
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let mut client = ReplayClient {
+            port: listener.local_addr().unwrap().port(),
+            stream: None,
+            buffer: Vec::new(),
+            terminated,
+        };
+        let client = std::thread::spawn(move || {
+            let static_request = b"GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+            let post_request = b"POST /update HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 11\r\n\r\nhello world";
+            let mut static_latencies = Vec::with_capacity(requests);
+            let mut handler_latencies = Vec::with_capacity(requests);
+            for _ in 0..requests {
+                let start = Instant::now();
+                assert_eq!(client.exchange(static_request), (200, b"<html></html>".to_vec()));
+                static_latencies.push(start.elapsed());
+                let start = Instant::now();
+                assert_eq!(client.exchange(post_request), (200, b"{\"length\":11}".to_vec()));
+                handler_latencies.push(start.elapsed());
+            }
+            client.close_window();
+            (static_latencies, handler_latencies)
+        });
+        dialog.serve(listener).unwrap();
+        client.join().unwrap()
+    }
+
+    #[test]
+    fn serve_replayed_requests() {
+        let (static_latencies, handler_latencies) = replay(10);
+        assert_eq!(static_latencies.len(), 10);
+        assert_eq!(handler_latencies.len(), 10);
+    }
+
+    #[test]
+    fn large_response_on_closing_connection() {
+        // larger than the send buffer of the socket, so that writing the response would block
+        let content: &'static [u8] = Box::leak(vec![b'x'; 16 << 20].into_boxed_slice());
+        let terminated = Arc::new(AtomicBool::new(false));
+        let mut dialog = HtmlDialog::new(ReplayHandler);
+        dialog.add("/large".into(), HtmlDialogResourceType::Content((content, "application/octet-stream")));
+        dialog.browser_monitor = Some(RefCell::new(Box::new(ReplayBrowser { terminated: terminated.clone() })));
+        let listener = TcpListener::bind("127.0.0.1:0").unwrap();
+        let mut client = ReplayClient {
+            port: listener.local_addr().unwrap().port(),
+            stream: None,
+            buffer: Vec::new(),
+            terminated,
+        };
+        let client = std::thread::spawn(move || {
+            let mut stream = TcpStream::connect(("127.0.0.1", client.port)).unwrap();
+            stream.write_all(b"GET /large HTTP/1.1\r\nConnection: close\r\n\r\n").unwrap();
+            // the server closes the connection after the response; let it fill the send buffer first
+            std::thread::sleep(Duration::from_millis(200));
+            let mut response = Vec::new();
+            stream.read_to_end(&mut response).unwrap();
+            let end = response.windows(4).position(|w| w == b"\r\n\r\n").unwrap() + 4;
+            assert!(response.starts_with(b"HTTP/1.1 200 OK\r\n"));
+            assert_eq!(response.len() - end, content.len());
+            client.close_window();
+        });
+        dialog.serve(listener).unwrap();
+        client.join().unwrap();
+    }
+
+    /// Request-replay benchmark; run with `cargo test --release -- --ignored --nocapture request_replay`.
+    ///
+    /// The requests span several persistent connections, as the server closes a connection
+    /// after MAX_REQUESTS_PER_CONNECTION requests.
+    #[test]
+    #[ignore]
+    fn request_replay_benchmark() {
+        let (mut static_latencies, mut handler_latencies) = replay(5000);
+        report("static", &mut static_latencies);
+        report("handler", &mut handler_latencies);
+    }
+}
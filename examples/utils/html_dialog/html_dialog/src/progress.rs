@@ -0,0 +1,297 @@
+//! Progress reporting from calculations to dialog pages.
+//!
+//! A calculation thread writes progress records into a bounded, lock-free,
+//! single-producer single-consumer queue. Writing a record involves no
+//! allocation; if the queue is full, the record is dropped rather than blocking
+//! the calculation. The first record after the server loop has taken the queued
+//! records wakes the loop through the push channel of the dialog; further records
+//! are written without locks or system calls until the loop has taken them. The
+//! server loop sends the records as server-sent events (`text/event-stream`) to
+//! the pages that are connected to the resource.
+
+use std::{
+    cell::UnsafeCell,
+    io::Write,
+    mem::MaybeUninit,
+    ops::Deref,
+    sync::{
+        Arc, OnceLock,
+        atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering, fence},
+    },
+};
+use crate::{json_payload::JsonWriter, push::DialogPushSender};
+
+/// A progress record.
+///
+/// The record is sent to the page as an event with the given name, and data
+/// `{"label":...,"iteration":...,"value":...}`.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct ProgressRecord {
+    /// The event name, such as "iteration" or "phase"; must not contain line breaks
+    pub event: &'static str,
+    /// What the record pertains to, such as the name of a solver or a calculation phase
+    pub label: &'static str,
+    /// Iteration count, or zero if not applicable
+    pub iteration: u32,
+    /// Value, such as a residual or a time in seconds
+    pub value: f64,
+}
+
+/// A value on a cache line of its own, so that writes by one thread do not
+/// invalidate the cache line of values that another thread writes.
+#[repr(align(64))]
+struct CacheLine<T>(T);
+
+impl<T> Deref for CacheLine<T> {
+    type Target = T;
+
+    fn deref(&self) -> &T {
+        &self.0
+    }
+}
+
+/// The queue shared between sender and stream.
+struct Ring {
+    /// Storage for the records; the length is a power of two
+    slots: Box<[UnsafeCell<MaybeUninit<ProgressRecord>>]>,
+    /// Position of the next record to read, written by the consumer only
+    head: CacheLine<AtomicUsize>,
+    /// Position of the next record to write, written by the producer only
+    tail: CacheLine<AtomicUsize>,
+    /// Number of records dropped because the queue was full
+    dropped: AtomicU64,
+    /// Whether the server loop has been woken since it last took the records
+    woken: AtomicBool,
+    /// Wakes the server loop; set when the stream is added to a dialog
+    waker: OnceLock<DialogPushSender>,
+}
+
+// The producer only writes slots between tail and head + capacity, and the
+// consumer only reads slots between head and tail; positions are published
+// with release and observed with acquire ordering.
+unsafe impl Sync for Ring {}
+
+/// Creates a progress channel.
+///
+/// # Parameters
+/// * `capacity` - The maximum number of records that are queued; rounded up to a power of two
+///
+/// # Returns
+/// * The sender, for the calculation thread, and the stream, to be registered with
+///   `HtmlDialogResourceType::EventStream`
+pub fn progress_channel(capacity: usize) -> (ProgressSender, ProgressStream) {
+    let capacity = capacity.max(2).next_power_of_two();
+    let ring = Arc::new(Ring {
+        slots: (0..capacity).map(|_| UnsafeCell::new(MaybeUninit::uninit())).collect(),
+        head: CacheLine(AtomicUsize::new(0)),
+        tail: CacheLine(AtomicUsize::new(0)),
+        dropped: AtomicU64::new(0),
+        woken: AtomicBool::new(false),
+        waker: OnceLock::new(),
+    });
+    (
+        ProgressSender { ring: ring.clone(), tail: 0, head: 0 },
+        ProgressStream { ring, head: 0, dropped: 0 },
+    )
+}
+
+/// The writing end of a progress channel.
+///
+/// There is a single sender per channel; it is moved to the calculation thread,
+/// and used there without further synchronization.
+pub struct ProgressSender {
+    /// The queue
+    ring: Arc<Ring>,
+    /// Position of the next record to write
+    tail: usize,
+    /// Last observed read position of the consumer
+    head: usize,
+}
+
+impl ProgressSender {
+    /// Queues a progress record, without blocking.
+    ///
+    /// # Parameters
+    /// * `record` - The record
+    ///
+    /// # Returns
+    /// * `true` - If the record was queued
+    /// * `false` - If the queue is full; the record is dropped and counted
+    pub fn send(&mut self, record: ProgressRecord) -> bool {
+        let capacity = self.ring.slots.len();
+        if self.tail.wrapping_sub(self.head) == capacity {
+            self.head = self.ring.head.load(Ordering::Acquire);
+            if self.tail.wrapping_sub(self.head) == capacity {
+                self.ring.dropped.fetch_add(1, Ordering::Relaxed);
+                return false;
+            }
+        }
+        unsafe {
+            (*self.ring.slots[self.tail & (capacity - 1)].get()).write(record);
+        }
+        self.tail = self.tail.wrapping_add(1);
+        self.ring.tail.store(self.tail, Ordering::Release);
+        self.wake();
+        true
+    }
+
+    /// Wakes the server loop, unless it has been woken since it last took the records.
+    fn wake(&self) {
+        // pairs with the fence in take_events: either the loop sees the record, or
+        // this thread sees that the loop has taken the records and wakes it
+        fence(Ordering::SeqCst);
+        if !self.ring.woken.load(Ordering::Relaxed) && !self.ring.woken.swap(true, Ordering::Relaxed) {
+            if let Some(waker) = self.ring.waker.get() {
+                waker.wake();
+            }
+        }
+    }
+}
+
+/// The reading end of a progress channel, served as server-sent events.
+pub struct ProgressStream {
+    /// The queue
+    ring: Arc<Ring>,
+    /// Position of the next record to read
+    head: usize,
+    /// Number of dropped records that has been reported
+    dropped: u64,
+}
+
+impl ProgressStream {
+    /// Lets the stream wake the server loop of a dialog when records are sent.
+    ///
+    /// # Parameters
+    /// * `waker` - The push channel of the dialog
+    pub(crate) fn set_waker(&self, waker: DialogPushSender) {
+        let _ = self.ring.waker.set(waker);
+    }
+
+    /// Takes the next record.
+    ///
+    /// # Returns
+    /// * The record, if any
+    pub fn receive(&mut self) -> Option<ProgressRecord> {
+        let tail = self.ring.tail.load(Ordering::Acquire);
+        if self.head == tail {
+            return None;
+        }
+        let capacity = self.ring.slots.len();
+        let record = unsafe { (*self.ring.slots[self.head & (capacity - 1)].get()).assume_init() };
+        self.head = self.head.wrapping_add(1);
+        self.ring.head.store(self.head, Ordering::Release);
+        Some(record)
+    }
+
+    /// Takes all queued records, and formats them as server-sent events.
+    ///
+    /// If records were dropped since the last call, a `dropped` event with the
+    /// number of dropped records is included.
+    ///
+    /// # Returns
+    /// * The events; empty if no records are queued
+    pub(crate) fn take_events(&mut self) -> Vec<u8> {
+        // a record that is sent from now on wakes the server loop again
+        self.ring.woken.store(false, Ordering::Relaxed);
+        fence(Ordering::SeqCst);
+        let mut events = Vec::new();
+        let dropped = self.ring.dropped.load(Ordering::Relaxed);
+        if dropped != self.dropped {
+            let _ = write!(events, "event: dropped\ndata: {{\"count\":{}}}\n\n", dropped - self.dropped);
+            self.dropped = dropped;
+        }
+        while let Some(record) = self.receive() {
+            let _ = write!(events, "event: {}\ndata: ", record.event);
+            JsonWriter::new(&mut events)
+                .begin_object()
+                .key("label").string(record.label)
+                .key("iteration").integer(record.iteration as i64)
+                .key("value").number(record.value)
+                .end_object();
+            events.extend_from_slice(b"\n\n");
+        }
+        events
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn concurrent_order_and_drops() {
+        let (mut sender, mut stream) = progress_channel(64);
+        const COUNT: u32 = 200_000;
+        let producer = std::thread::spawn(move || {
+            let mut sent = 0u64;
+            for i in 0..COUNT {
+                if sender.send(ProgressRecord { event: "iteration", label: "test", iteration: i, value: i as f64 }) {
+                    sent += 1;
+                }
+            }
+            sent
+        });
+        let mut received = 0u64;
+        let mut last = None;
+        loop {
+            let finished = producer.is_finished();
+            while let Some(record) = stream.receive() {
+                // records arrive in order, intact
+                assert!(last.is_none_or(|l| record.iteration > l));
+                assert_eq!(record.value, record.iteration as f64);
+                last = Some(record.iteration);
+                received += 1;
+            }
+            if finished {
+                break;
+            }
+        }
+        let sent = producer.join().unwrap();
+        assert_eq!(received, sent);
+        assert_eq!(stream.ring.dropped.load(Ordering::Relaxed), COUNT as u64 - sent);
+    }
+
+    #[test]
+    fn head_and_tail_on_separate_cache_lines() {
+        let (sender, _stream) = progress_channel(2);
+        let head = &*sender.ring.head as *const AtomicUsize as usize;
+        let tail = &*sender.ring.tail as *const AtomicUsize as usize;
+        assert!(head.abs_diff(tail) >= 64);
+    }
+
+    #[test]
+    fn first_record_wakes() {
+        let push = DialogPushSender::new();
+        let receiver = crate::push::PushReceiver::new(&push).unwrap();
+        let (mut sender, mut stream) = progress_channel(8);
+        stream.set_waker(push);
+        let record = ProgressRecord { event: "iteration", label: "test", iteration: 0, value: 0.0 };
+        let notified = || {
+            std::thread::sleep(std::time::Duration::from_millis(20));
+            receiver.get_socket().peek(&mut [0u8; 16]).is_ok()
+        };
+        assert!(!notified());
+        sender.send(record);
+        assert!(notified());
+        receiver.acknowledge();
+        // until the records are taken, further records do not wake the loop
+        sender.send(record);
+        assert!(!notified());
+        assert!(!stream.take_events().is_empty());
+        sender.send(record);
+        assert!(notified());
+    }
+
+    #[test]
+    fn events() {
+        let (mut sender, mut stream) = progress_channel(2);
+        assert!(stream.take_events().is_empty());
+        sender.send(ProgressRecord { event: "iteration", label: "Fenske", iteration: 3, value: 0.5 });
+        sender.send(ProgressRecord { event: "phase", label: "Under\"wood", iteration: 0, value: f64::NAN });
+        assert!(!sender.send(ProgressRecord { event: "phase", label: "x", iteration: 0, value: 0.0 }));
+        assert_eq!(String::from_utf8(stream.take_events()).unwrap(),
+            "event: dropped\ndata: {\"count\":1}\n\n\
+             event: iteration\ndata: {\"label\":\"Fenske\",\"iteration\":3,\"value\":0.5}\n\n\
+             event: phase\ndata: {\"label\":\"Under\\\"wood\",\"iteration\":0,\"value\":null}\n\n");
+    }
+}
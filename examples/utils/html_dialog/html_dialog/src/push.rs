@@ -0,0 +1,241 @@
+//! Push channel from the application to the browser.
+//!
+//! Messages that are pushed through a [`DialogPushSender`] are queued, and the
+//! server loop is woken to send them to all pages that are connected to a
+//! WebSocket resource of the dialog. The server loop is woken through a loopback
+//! UDP socket, which is waited for along with the other sockets, so that pushing
+//! works from any thread.
+//!
+//! The server loop acknowledges the wake-up at the start of each pass, before it
+//! checks for messages and finished tasks; a wake-up that arrives after the
+//! acknowledgement sends a new notification, so that none is lost.
+
+use std::{
+    collections::VecDeque,
+    net::UdpSocket,
+    sync::{Arc, Mutex},
+};
+
+/// State shared between the senders and the server loop.
+struct PushState {
+    /// Messages that have not been sent
+    messages: VecDeque<String>,
+    /// Socket to wake the server loop, while the dialog is shown
+    waker: Option<UdpSocket>,
+    /// Whether the server loop has been woken since it last acknowledged the wake-up
+    woken: bool,
+    /// Whether a page was connected when the server loop last took the messages
+    connected: bool,
+}
+
+/// Maximum number of messages that is kept while no page is connected; older messages are dropped.
+const MAX_PENDING_MESSAGES: usize = 256;
+
+/// Handle to push messages to the pages of a dialog.
+///
+/// The handle is obtained from `HtmlDialog::push_sender`, and can be cloned and
+/// sent to other threads. Each message, typically JSON, is sent as a text message
+/// to all pages that are connected to a WebSocket resource of the dialog.
+/// Messages that are pushed while no page is connected are kept until a page
+/// connects, up to the most recent 256 messages.
+#[derive(Clone)]
+pub struct DialogPushSender {
+    /// The shared state
+    state: Arc<Mutex<PushState>>,
+}
+
+impl DialogPushSender {
+    /// Creates a push channel without pending messages.
+    pub(crate) fn new() -> Self {
+        DialogPushSender {
+            state: Arc::new(Mutex::new(PushState {
+                messages: VecDeque::new(),
+                waker: None,
+                woken: false,
+                connected: false,
+            })),
+        }
+    }
+
+    /// Pushes a message to the connected pages.
+    ///
+    /// # Parameters
+    /// * `message` - The message text, typically JSON
+    pub fn push(&self, message: String) {
+        let mut state = self.state.lock().unwrap_or_else(|e| e.into_inner());
+        if !state.connected && state.messages.len() >= MAX_PENDING_MESSAGES {
+            state.messages.pop_front();
+        }
+        state.messages.push_back(message);
+        Self::wake_locked(&mut state);
+    }
+
+    /// Wakes the server loop without pushing a message, such as when a task has finished.
+    pub(crate) fn wake(&self) {
+        let mut state = self.state.lock().unwrap_or_else(|e| e.into_inner());
+        Self::wake_locked(&mut state);
+    }
+
+    /// Wakes the server loop, unless it has been woken already or the dialog is not shown.
+    fn wake_locked(state: &mut PushState) {
+        if !state.woken {
+            if let Some(ref waker) = state.waker {
+                let _ = waker.send(&[0]);
+                state.woken = true;
+            }
+        }
+    }
+}
+
+/// The receiving end of the push channel, while the dialog is shown.
+///
+/// Dropping the receiver stops waking the server loop.
+pub(crate) struct PushReceiver {
+    /// The shared state
+    state: Arc<Mutex<PushState>>,
+    /// Socket that becomes readable when messages are pushed
+    socket: UdpSocket,
+}
+
+impl PushReceiver {
+    /// Connects to a push channel.
+    ///
+    /// # Parameters
+    /// * `sender` - The push channel of the dialog
+    ///
+    /// # Returns
+    /// * `Ok(Self)` - The receiver
+    /// * `Err(...)` - If the loopback sockets cannot be created
+    pub fn new(sender: &DialogPushSender) -> std::io::Result<Self> {
+        let socket = UdpSocket::bind("127.0.0.1:0")?;
+        socket.set_nonblocking(true)?;
+        let waker = UdpSocket::bind("127.0.0.1:0")?;
+        waker.connect(socket.local_addr()?)?;
+        waker.set_nonblocking(true)?;
+        let mut state = sender.state.lock().unwrap_or_else(|e| e.into_inner());
+        if !state.messages.is_empty() {
+            let _ = waker.send(&[0]);
+        }
+        state.woken = !state.messages.is_empty();
+        state.waker = Some(waker);
+        drop(state);
+        Ok(PushReceiver { state: sender.state.clone(), socket })
+    }
+
+    /// Gets the socket to wait for.
+    pub fn get_socket(&self) -> &UdpSocket {
+        &self.socket
+    }
+
+    /// Consumes the wake-up notifications.
+    ///
+    /// Must be called before checking for the events that wake the server loop;
+    /// a wake-up after this call sends a new notification.
+    pub fn acknowledge(&self) {
+        self.state.lock().unwrap_or_else(|e| e.into_inner()).woken = false;
+        let mut buffer = [0u8; 16];
+        loop {
+            if self.socket.recv(&mut buffer).is_err() {
+                break; // WouldBlock: all notifications are consumed
+            }
+        }
+    }
+
+    /// Takes the pending messages.
+    ///
+    /// # Parameters
+    /// * `connected` - Whether a page is connected to take the messages; if false, they are kept for later
+    ///
+    /// # Returns
+    /// * The pending messages, if taken
+    pub fn take(&self, connected: bool) -> VecDeque<String> {
+        let mut state = self.state.lock().unwrap_or_else(|e| e.into_inner());
+        state.connected = connected;
+        if connected {
+            std::mem::take(&mut state.messages)
+        } else {
+            let excess = state.messages.len().saturating_sub(MAX_PENDING_MESSAGES);
+            state.messages.drain(..excess);
+            VecDeque::new()
+        }
+    }
+}
+
+impl Drop for PushReceiver {
+    /// Stops waking the server loop.
+    fn drop(&mut self) {
+        let mut state = self.state.lock().unwrap_or_else(|e| e.into_inner());
+        state.waker = None;
+        state.woken = false;
+        state.connected = false;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::{Duration, Instant};
+
+    /// Checks whether a notification arrives within a second.
+    fn is_notified(receiver: &PushReceiver) -> bool {
+        let mut buffer = [0u8; 16];
+        let start = Instant::now();
+        while start.elapsed() < Duration::from_secs(1) {
+            if receiver.get_socket().peek(&mut buffer).is_ok() {
+                return true;
+            }
+            std::thread::sleep(Duration::from_millis(1));
+        }
+        false
+    }
+
+    #[test]
+    fn wake_after_acknowledge_is_not_lost() {
+        let sender = DialogPushSender::new();
+        let receiver = PushReceiver::new(&sender).unwrap();
+        sender.wake();
+        sender.wake();
+        assert!(is_notified(&receiver));
+        receiver.acknowledge();
+        assert!(!is_notified(&receiver));
+        // a task that finishes after the acknowledgement wakes the loop again
+        sender.wake();
+        assert!(is_notified(&receiver));
+    }
+
+    #[test]
+    fn pending_messages_are_kept_until_taken() {
+        let sender = DialogPushSender::new();
+        sender.push("before".into());
+        let receiver = PushReceiver::new(&sender).unwrap();
+        assert!(is_notified(&receiver));
+        receiver.acknowledge();
+        assert!(receiver.take(false).is_empty());
+        sender.push("after".into());
+        assert_eq!(receiver.take(true), ["before", "after"]);
+        assert!(receiver.take(true).is_empty());
+    }
+
+    #[test]
+    fn pending_messages_are_capped_while_disconnected() {
+        let sender = DialogPushSender::new();
+        for i in 0..MAX_PENDING_MESSAGES + 10 {
+            sender.push(i.to_string());
+        }
+        let receiver = PushReceiver::new(&sender).unwrap();
+        let messages = receiver.take(true);
+        assert_eq!(messages.len(), MAX_PENDING_MESSAGES);
+        assert_eq!(messages[0], "10");
+        // while a page is connected, messages are not dropped
+        for i in 0..MAX_PENDING_MESSAGES + 10 {
+            sender.push(i.to_string());
+        }
+        assert_eq!(receiver.take(true).len(), MAX_PENDING_MESSAGES + 10);
+        // once disconnected, the kept messages are capped
+        for i in 0..MAX_PENDING_MESSAGES + 10 {
+            sender.push(i.to_string());
+        }
+        assert!(receiver.take(false).is_empty());
+        assert_eq!(receiver.take(true).len(), MAX_PENDING_MESSAGES);
+    }
+}
@@ -0,0 +1,235 @@
+//! Readiness notification for the embedded web server.
+//!
+//! The server loop of the HTML dialog waits on the listening socket, all open
+//! connections and - on Windows - the message queue of the GUI thread. Rather than
+//! polling these at a fixed interval, the loop blocks in the operating system until
+//! any of them is ready, or until a timeout expires. The timeout serves as a timer
+//! for checks that have no readiness notification, such as monitoring the browser
+//! process.
+//!
+//! - On Windows, all sockets signal a single event object through `WSAEventSelect`,
+//!   and the loop waits for that event and for window messages with
+//!   `MsgWaitForMultipleObjectsEx`. Writability is signalled (`FD_WRITE`) once a send
+//!   that would have blocked can proceed; the caller writes until a send would block,
+//!   so that the signal is re-armed. The event resets automatically when a wait returns
+//!   for it, rather than before the next wait, so that a signal that arrives while the
+//!   loop serves the sockets wakes the next wait.
+//! - On other platforms, the loop waits with `poll`.
+
+use std::{
+    io,
+    net::TcpStream,
+    time::Duration,
+};
+
+#[cfg(not(target_os = "windows"))]
+pub(crate) use std::os::fd::AsRawFd as AsSource;
+#[cfg(target_os = "windows")]
+pub(crate) use std::os::windows::io::AsRawSocket as AsSource;
+
+#[cfg(target_os = "windows")]
+use windows::Win32::{
+    Foundation::{CloseHandle, HANDLE, WAIT_OBJECT_0, WAIT_TIMEOUT},
+    Networking::WinSock::{WSAEventSelect, SOCKET, FD_ACCEPT, FD_CLOSE, FD_READ, FD_WRITE},
+    System::Threading::CreateEventW,
+    UI::WindowsAndMessaging::{MsgWaitForMultipleObjectsEx, MWMO_INPUTAVAILABLE, QS_ALLINPUT},
+};
+
+/// Minimal binding to `poll(2)`.
+#[cfg(not(target_os = "windows"))]
+mod sys {
+    use std::os::raw::{c_int, c_short};
+
+    /// Equivalent of `struct pollfd`
+    #[repr(C)]
+    pub struct PollFd {
+        pub fd: c_int,
+        pub events: c_short,
+        pub revents: c_short,
+    }
+
+    /// Data may be read without blocking
+    pub const POLLIN: c_short = 0x1;
+    /// Data may be written without blocking
+    pub const POLLOUT: c_short = 0x4;
+
+    #[cfg(target_os = "linux")]
+    pub type NFds = std::os::raw::c_ulong;
+    #[cfg(not(target_os = "linux"))]
+    pub type NFds = std::os::raw::c_uint;
+
+    unsafe extern "C" {
+        pub fn poll(fds: *mut PollFd, nfds: NFds, timeout: c_int) -> c_int;
+    }
+}
+
+/// The reason the reactor returned from a wait.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub(crate) enum Wake {
+    /// One or more sockets are ready
+    Io,
+    /// Window messages are available for the GUI thread
+    #[cfg_attr(not(target_os = "windows"), allow(dead_code))]
+    Messages,
+    /// The timeout expired
+    Timeout,
+}
+
+/// Waits for readiness of a set of sockets, and for window messages on Windows.
+///
+/// Sockets are registered before each wait, using `clear` and `register`. The reactor
+/// only reports that something is ready; the caller then serves all sockets in
+/// non-blocking mode until they would block.
+pub(crate) struct Reactor {
+    /// The registered sockets and their interest
+    #[cfg(not(target_os = "windows"))]
+    fds: Vec<sys::PollFd>,
+    /// The auto-reset event object signalled by all registered sockets
+    #[cfg(target_os = "windows")]
+    event: HANDLE,
+}
+
+impl Reactor {
+    /// Creates a new reactor without registered sockets.
+    ///
+    /// # Returns
+    /// * `Ok(Self)` - The reactor
+    /// * `Err(...)` - If the operating system resources could not be allocated
+    pub fn new() -> io::Result<Self> {
+        #[cfg(target_os = "windows")]
+        {
+            let event = unsafe { CreateEventW(None, false, false, None) }
+                .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+            Ok(Reactor { event })
+        }
+        #[cfg(not(target_os = "windows"))]
+        {
+            Ok(Reactor { fds: Vec::new() })
+        }
+    }
+
+    /// Removes all registered sockets, in preparation of the next wait.
+    ///
+    /// On Windows, registering a socket again replaces its previous selection, and
+    /// the event is left signalled if a socket became ready since the last wait.
+    pub fn clear(&mut self) {
+        #[cfg(not(target_os = "windows"))]
+        {
+            self.fds.clear();
+        }
+    }
+
+    /// Registers a socket for the next wait.
+    ///
+    /// The socket is waited for to become readable (which includes incoming
+    /// connections) and writable, as requested, and for errors and closure by the peer.
+    ///
+    /// # Parameters
+    /// * `source` - The listener or stream
+    /// * `readable` - Whether to wait for the socket to become readable
+    /// * `writable` - Whether to wait for the socket to become writable
+    ///
+    /// # Returns
+    /// * `Ok(())` - If the socket was registered
+    /// * `Err(...)` - If registration failed
+    pub fn register<S: AsSource>(&mut self, source: &S, readable: bool, writable: bool) -> io::Result<()> {
+        #[cfg(target_os = "windows")]
+        {
+            let mut events = FD_CLOSE;
+            if readable {
+                events |= FD_ACCEPT | FD_READ;
+            }
+            if writable {
+                events |= FD_WRITE;
+            }
+            // also switches the socket to non-blocking mode
+            if unsafe { WSAEventSelect(SOCKET(source.as_raw_socket() as usize), self.event, events as i32) } != 0 {
+                return Err(io::Error::last_os_error());
+            }
+        }
+        #[cfg(not(target_os = "windows"))]
+        {
+            self.fds.push(sys::PollFd {
+                fd: source.as_raw_fd(),
+                events: (if readable { sys::POLLIN } else { 0 }) | (if writable { sys::POLLOUT } else { 0 }),
+                revents: 0,
+            });
+        }
+        Ok(())
+    }
+
+    /// Waits until a registered socket is ready, window messages arrive, or the timeout expires.
+    ///
+    /// # Parameters
+    /// * `timeout` - The maximum time to wait; zero to only check readiness
+    ///
+    /// # Returns
+    /// * `Ok(Wake)` - The reason for returning
+    /// * `Err(...)` - If waiting failed
+    pub fn wait(&mut self, timeout: Duration) -> io::Result<Wake> {
+        #[cfg(target_os = "windows")]
+        {
+            let milliseconds = timeout.as_millis().min(u32::MAX as u128 - 1) as u32;
+            let res = unsafe {
+                MsgWaitForMultipleObjectsEx(Some(&[self.event]), milliseconds, QS_ALLINPUT, MWMO_INPUTAVAILABLE)
+            };
+            if res == WAIT_OBJECT_0 {
+                Ok(Wake::Io)
+            } else if res.0 == WAIT_OBJECT_0.0 + 1 {
+                Ok(Wake::Messages)
+            } else if res == WAIT_TIMEOUT {
+                Ok(Wake::Timeout)
+            } else {
+                Err(io::Error::last_os_error())
+            }
+        }
+        #[cfg(not(target_os = "windows"))]
+        {
+            // round up, so that a short timeout does not become a busy loop
+            let milliseconds = (timeout.as_micros().div_ceil(1000)).min(i32::MAX as u128) as i32;
+            let res = unsafe { sys::poll(self.fds.as_mut_ptr(), self.fds.len() as sys::NFds, milliseconds) };
+            if res > 0 {
+                Ok(Wake::Io)
+            } else if res == 0 {
+                Ok(Wake::Timeout)
+            } else {
+                let e = io::Error::last_os_error();
+                if e.kind() == io::ErrorKind::Interrupted {
+                    // signal received; let the caller re-examine its state
+                    Ok(Wake::Io)
+                } else {
+                    Err(e)
+                }
+            }
+        }
+    }
+}
+
+/// Switches a socket back to blocking mode.
+///
+/// On Windows, the socket stops signalling the event object of the reactor first, as
+/// a socket cannot be switched to blocking mode while it signals an event object.
+///
+/// # Parameters
+/// * `stream` - The stream
+///
+/// # Returns
+/// * `Ok(())` - If the stream is in blocking mode
+/// * `Err(...)` - If the mode could not be changed
+pub(crate) fn set_blocking(stream: &TcpStream) -> io::Result<()> {
+    #[cfg(target_os = "windows")]
+    {
+        if unsafe { WSAEventSelect(SOCKET(stream.as_raw_socket() as usize), HANDLE::default(), 0) } != 0 {
+            return Err(io::Error::last_os_error());
+        }
+    }
+    stream.set_nonblocking(false)
+}
+
+#[cfg(target_os = "windows")]
+impl Drop for Reactor {
+    /// Releases the event object.
+    fn drop(&mut self) {
+        let _ = unsafe { CloseHandle(self.event) };
+    }
+}
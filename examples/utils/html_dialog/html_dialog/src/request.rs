@@ -0,0 +1,545 @@
+//! Incremental HTTP request parser for the HTML dialog system.
+//!
+//! Received data is collected in a single buffer that is re-used for all requests
+//! on a connection. The parser works on slices of that buffer: lines are located
+//! a word at a time, the request location, header names and header values are kept
+//! as ranges into the buffer, and the request body is received in bulk. Parsing
+//! resumes where it left off when a request arrives in multiple reads.
+
+use std::{
+    io::Read,
+    ops::Range,
+};
+use log::info;
+
+/// The number of bytes that is requested from the stream at a time
+const READ_CHUNK: usize = 8192;
+/// The maximum size of the request line and headers, including line terminations and preceding empty lines
+const MAX_HEAD_SIZE: usize = 64 * 1024;
+/// The maximum size of the request body
+const MAX_CONTENT_SIZE: usize = 64 * 1024 * 1024;
+
+/// Outcome of a parse step.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum ParseStatus {
+    /// More data is needed
+    Incomplete,
+    /// The request is complete
+    Complete,
+    /// The request is invalid
+    Error,
+}
+
+/// The part of the request that is being parsed.
+#[derive(Debug, Clone, Copy, PartialEq)]
+enum State {
+    /// Reading the request line (verb, location, protocol)
+    RequestLine,
+    /// Reading the HTTP headers
+    Header,
+    /// Reading the request content/body
+    Content,
+    /// Request is completely parsed
+    Complete,
+    /// An error occurred during parsing
+    Error,
+}
+
+/// Finds the first occurrence of a byte.
+///
+/// The haystack is examined eight bytes at a time.
+///
+/// # Parameters
+/// * `needle` - The byte to look for
+/// * `haystack` - The data to search
+///
+/// # Returns
+/// * The position of the byte, if found
+fn find_byte(needle: u8, haystack: &[u8]) -> Option<usize> {
+    const LO: u64 = 0x0101_0101_0101_0101;
+    const HI: u64 = 0x8080_8080_8080_8080;
+    let pattern = LO * needle as u64;
+    let mut chunks = haystack.chunks_exact(8);
+    let mut offset = 0;
+    for chunk in &mut chunks {
+        // bytes equal to the needle become zero; the lowest flagged byte is the first zero byte
+        let word = u64::from_le_bytes(chunk.try_into().unwrap()) ^ pattern;
+        let found = word.wrapping_sub(LO) & !word & HI;
+        if found != 0 {
+            return Some(offset + (found.trailing_zeros() / 8) as usize);
+        }
+        offset += 8;
+    }
+    chunks.remainder().iter().position(|b| *b == needle).map(|i| offset + i)
+}
+
+/// Removes leading and trailing spaces and tabs from a range of the buffer.
+fn trim(buffer: &[u8], mut range: Range<usize>) -> Range<usize> {
+    while range.start < range.end && (buffer[range.start] == b' ' || buffer[range.start] == b'\t') {
+        range.start += 1;
+    }
+    while range.end > range.start && (buffer[range.end - 1] == b' ' || buffer[range.end - 1] == b'\t') {
+        range.end -= 1;
+    }
+    range
+}
+
+/// An HTTP request that is received incrementally.
+///
+/// The request owns the receive buffer of the connection. Data that follows the
+/// current request (pipelining) is retained for the next request.
+pub struct Request {
+    /// Received data, starting at the current request
+    buffer: Vec<u8>,
+    /// Offset of the first byte that has not been parsed
+    parsed: usize,
+    /// The part of the request that is being parsed
+    state: State,
+    /// Indicates if the request is a GET (true) or POST (false)
+    is_get: bool,
+    /// The requested URL path
+    location: Range<usize>,
+    /// Header names and values
+    headers: Vec<(Range<usize>, Range<usize>)>,
+    /// Content length from the Content-Length header
+    content_length: usize,
+    /// The request body
+    content: Range<usize>,
+    /// Error message if an error occurs
+    error: String,
+    /// HTTP error code if an error occurs
+    error_code: i32,
+}
+
+impl Request {
+    /// Creates an empty request.
+    pub fn new() -> Self {
+        Request {
+            buffer: Vec::with_capacity(READ_CHUNK),
+            parsed: 0,
+            state: State::RequestLine,
+            is_get: false,
+            location: 0..0,
+            headers: Vec::new(),
+            content_length: 0,
+            content: 0..0,
+            error: String::new(),
+            error_code: 500,
+        }
+    }
+
+    /// Reads available data into the buffer.
+    ///
+    /// # Parameters
+    /// * `reader` - The source, typically a non-blocking stream
+    ///
+    /// # Returns
+    /// * `Ok(n)` - The number of bytes read; zero if the peer closed the stream
+    /// * `Err(...)` - Read error, including `WouldBlock`
+    pub fn read_from<R: Read>(&mut self, reader: &mut R) -> std::io::Result<usize> {
+        let filled = self.buffer.len();
+        self.buffer.resize(filled + READ_CHUNK, 0);
+        let res = reader.read(&mut self.buffer[filled..]);
+        self.buffer.truncate(filled + *res.as_ref().unwrap_or(&0));
+        res
+    }
+
+    /// Checks whether no data of this request has been received.
+    pub fn is_empty(&self) -> bool {
+        self.buffer.is_empty()
+    }
+
+    /// Parses as much of the request as is available.
+    ///
+    /// # Returns
+    /// * The parse status; once complete or in error, the status does not change until `next`
+    pub fn parse(&mut self) -> ParseStatus {
+        loop {
+            match self.state {
+                State::RequestLine | State::Header => {
+                    let line_start = self.parsed;
+                    let mut line_end = match find_byte(b'\n', &self.buffer[line_start..]) {
+                        Some(pos) => line_start + pos,
+                        None => {
+                            if self.buffer.len() > MAX_HEAD_SIZE {
+                                return self.fail(431, "Request header too large".into());
+                            }
+                            return ParseStatus::Incomplete;
+                        }
+                    };
+                    self.parsed = line_end + 1;
+                    if self.parsed > MAX_HEAD_SIZE {
+                        // the buffer starts at the request, so this bounds the complete head
+                        return self.fail(431, "Request header too large".into());
+                    }
+                    if line_end > line_start && self.buffer[line_end - 1] == b'\r' {
+                        line_end -= 1;
+                    }
+                    if self.state == State::RequestLine {
+                        if line_end == line_start {
+                            continue; // Ignore empty lines preceding the request line
+                        }
+                        if let Some(status) = self.parse_request_line(line_start..line_end) {
+                            return status;
+                        }
+                        self.state = State::Header;
+                    } else if line_end == line_start {
+                        // End of headers
+                        self.content = self.parsed..self.parsed + self.content_length;
+                        self.state = State::Content;
+                    } else if let Some(status) = self.parse_header(line_start..line_end) {
+                        return status;
+                    }
+                },
+                State::Content => {
+                    if self.buffer.len() < self.content.end {
+                        return ParseStatus::Incomplete;
+                    }
+                    self.parsed = self.content.end;
+                    self.state = State::Complete;
+                },
+                State::Complete => return ParseStatus::Complete,
+                State::Error => return ParseStatus::Error,
+            }
+        }
+    }
+
+    /// Parses the request line.
+    ///
+    /// # Parameters
+    /// * `line` - The line, without line termination
+    ///
+    /// # Returns
+    /// * `Some(ParseStatus::Error)` - If the request line is not valid
+    /// * `None` - If parsing can continue
+    fn parse_request_line(&mut self, line: Range<usize>) -> Option<ParseStatus> {
+        let mut words: [Range<usize>; 3] = [0..0, 0..0, 0..0];
+        let mut count = 0;
+        let mut pos = line.start;
+        while pos < line.end {
+            if self.buffer[pos] == b' ' || self.buffer[pos] == b'\t' {
+                pos += 1;
+                continue;
+            }
+            let start = pos;
+            while pos < line.end && self.buffer[pos] != b' ' && self.buffer[pos] != b'\t' {
+                pos += 1;
+            }
+            if count == words.len() {
+                return Some(self.fail(500, "Invalid request".into()));
+            }
+            words[count] = start..pos;
+            count += 1;
+        }
+        let [verb, location, protocol] = words;
+        let verb = &self.buffer[verb];
+        if verb.eq_ignore_ascii_case(b"get") {
+            self.is_get = true;
+        } else if verb.eq_ignore_ascii_case(b"post") {
+            self.is_get = false;
+        } else {
+            let error = format!("Invalid verb: {}", String::from_utf8_lossy(verb));
+            return Some(self.fail(500, error));
+        }
+        if count < 3 || std::str::from_utf8(&self.buffer[location.clone()]).is_err() {
+            return Some(self.fail(500, "Invalid request".into()));
+        }
+        self.location = location;
+        info!("==> Location: {}", self.get_location());
+        if !self.buffer[protocol.clone()].eq_ignore_ascii_case(b"http/1.1") {
+            let error = format!("Invalid protocol: {}", String::from_utf8_lossy(&self.buffer[protocol]));
+            return Some(self.fail(505, error)); // Unsupported protocol
+        }
+        None
+    }
+
+    /// Parses a header line.
+    ///
+    /// # Parameters
+    /// * `line` - The line, without line termination
+    ///
+    /// # Returns
+    /// * `Some(ParseStatus::Error)` - If the header is not valid
+    /// * `None` - If parsing can continue
+    fn parse_header(&mut self, line: Range<usize>) -> Option<ParseStatus> {
+        info!("==> Header: {}", String::from_utf8_lossy(&self.buffer[line.clone()]));
+        let colon = match find_byte(b':', &self.buffer[line.clone()]) {
+            Some(pos) => line.start + pos,
+            None => return None, // Ignore malformed headers
+        };
+        let name = trim(&self.buffer, line.start..colon);
+        let value = trim(&self.buffer, colon + 1..line.end);
+        if self.buffer[name.clone()].eq_ignore_ascii_case(b"content-length") {
+            let length = std::str::from_utf8(&self.buffer[value.clone()])
+                .map_err(|e| e.to_string())
+                .and_then(|v| v.parse::<usize>().map_err(|e| e.to_string()));
+            match length {
+                Ok(l) if l > MAX_CONTENT_SIZE => return Some(self.fail(413, "Content too large".into())),
+                Ok(l) => { self.content_length = l; },
+                Err(e) => return Some(self.fail(500, format!("Invalid content length: {}", e))),
+            }
+        }
+        self.headers.push((name, value));
+        None
+    }
+
+    /// Puts the request in error state.
+    fn fail(&mut self, error_code: i32, error: String) -> ParseStatus {
+        self.state = State::Error;
+        self.error_code = error_code;
+        self.error = error;
+        ParseStatus::Error
+    }
+
+    /// Indicates if the request is a GET (true) or POST (false).
+    pub fn is_get(&self) -> bool {
+        self.is_get
+    }
+
+    /// Gets the requested URL path.
+    pub fn get_location(&self) -> &str {
+        // validated when parsing the request line
+        std::str::from_utf8(&self.buffer[self.location.clone()]).unwrap_or("")
+    }
+
+    /// Gets the value of a header.
+    ///
+    /// # Parameters
+    /// * `name` - The header name, matched case-insensitively
+    ///
+    /// # Returns
+    /// * The value of the first header with the given name, without surrounding whitespace
+    pub fn get_header(&self, name: &str) -> Option<&[u8]> {
+        self.headers.iter()
+            .find(|(n, _)| self.buffer[n.clone()].eq_ignore_ascii_case(name.as_bytes()))
+            .map(|(_, v)| &self.buffer[v.clone()])
+    }
+
+    /// Gets the request body (POST).
+    pub fn get_content(&self) -> &[u8] {
+        if self.state == State::Complete {
+            &self.buffer[self.content.clone()]
+        } else {
+            &[]
+        }
+    }
+
+    /// Gets the error message, if parsing failed.
+    pub fn get_error(&self) -> &str {
+        &self.error
+    }
+
+    /// Gets the HTTP error code, if parsing failed.
+    pub fn get_error_code(&self) -> i32 {
+        self.error_code
+    }
+
+    /// Discards the current request, if complete, and takes the data received beyond it.
+    ///
+    /// Used when the connection switches to another protocol.
+    ///
+    /// # Returns
+    /// * The data that follows the current request
+    pub fn take_remaining(&mut self) -> Vec<u8> {
+        if self.state == State::Complete {
+            self.next();
+        }
+        let remaining = std::mem::take(&mut self.buffer);
+        self.next();
+        remaining
+    }
+
+    /// Discards the current request, and prepares for the next request.
+    ///
+    /// Data received beyond the current request is retained.
+    ///
+    /// # Returns
+    /// * `true` - If data of the next request is already available
+    /// * `false` - If the buffer is empty
+    pub fn next(&mut self) -> bool {
+        if self.state == State::Complete {
+            self.buffer.drain(..self.parsed);
+        } else {
+            self.buffer.clear();
+        }
+        self.parsed = 0;
+        self.state = State::RequestLine;
+        self.is_get = false;
+        self.location = 0..0;
+        self.headers.clear();
+        self.content_length = 0;
+        self.content = 0..0;
+        self.error.clear();
+        self.error_code = 500;
+        !self.buffer.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Feeds data to a request in pieces of the given size, and parses after each piece.
+    fn parse_in_pieces(data: &[u8], piece: usize) -> (Request, ParseStatus) {
+        let mut request = Request::new();
+        let mut status = request.parse();
+        for chunk in data.chunks(piece) {
+            let mut reader = chunk;
+            while !reader.is_empty() {
+                request.read_from(&mut reader).unwrap();
+            }
+            status = request.parse();
+            if status != ParseStatus::Incomplete {
+                break;
+            }
+        }
+        (request, status)
+    }
+
+    #[test]
+    fn find_byte_matches_position() {
+        let data: Vec<u8> = (0..=255u8).cycle().take(1000).collect();
+        for needle in [0u8, 1, 10, 127, 128, 255] {
+            for start in 0..17 {
+                assert_eq!(find_byte(needle, &data[start..]), data[start..].iter().position(|b| *b == needle));
+            }
+        }
+        assert_eq!(find_byte(b'\n', b""), None);
+        assert_eq!(find_byte(b'\n', b"abc"), None);
+    }
+
+    #[test]
+    fn post_split_at_every_position() {
+        let data = b"POST /update HTTP/1.1\r\nHost: 127.0.0.1\r\ncontent-LENGTH:  11 \r\nAccept-Encoding: gzip\r\n\r\nhello world";
+        for piece in 1..=data.len() {
+            let (request, status) = parse_in_pieces(data, piece);
+            assert_eq!(status, ParseStatus::Complete, "piece size {}", piece);
+            assert!(!request.is_get());
+            assert_eq!(request.get_location(), "/update");
+            assert_eq!(request.get_content(), b"hello world");
+            assert_eq!(request.get_header("accept-encoding"), Some(&b"gzip"[..]));
+            assert_eq!(request.get_header("If-None-Match"), None);
+        }
+    }
+
+    #[test]
+    fn pipelined_requests() {
+        let data = b"GET /a HTTP/1.1\n\nget /b http/1.1\r\n\r\nGET /c";
+        let (mut request, status) = parse_in_pieces(data, data.len());
+        assert_eq!(status, ParseStatus::Complete);
+        assert_eq!(request.get_location(), "/a");
+        assert!(request.next());
+        assert_eq!(request.parse(), ParseStatus::Complete);
+        assert!(request.is_get());
+        assert_eq!(request.get_location(), "/b");
+        assert!(request.next());
+        assert_eq!(request.parse(), ParseStatus::Incomplete);
+    }
+
+    #[test]
+    fn corpus() {
+        // malformed and hostile inputs: (data, expected status, expected error code)
+        let corpus: &[(&[u8], ParseStatus, i32)] = &[
+            (b"", ParseStatus::Incomplete, 500),
+            (b"\r\n\r\nGET / HTTP/1.1\r\n\r\n", ParseStatus::Complete, 500),
+            (b"PUT / HTTP/1.1\r\n\r\n", ParseStatus::Error, 500),
+            (b"GET\r\n\r\n", ParseStatus::Error, 500),
+            (b"GET /\r\n\r\n", ParseStatus::Error, 500),
+            (b"GET / HTTP/1.1 extra\r\n\r\n", ParseStatus::Error, 500),
+            (b"GET / HTTP/1.0\r\n\r\n", ParseStatus::Error, 505),
+            (b"GET /\xff HTTP/1.1\r\n\r\n", ParseStatus::Error, 500),
+            (b"POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n", ParseStatus::Error, 500),
+            (b"POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n", ParseStatus::Error, 500),
+            (b"POST / HTTP/1.1\r\nContent-Length: 1000000000\r\n\r\n", ParseStatus::Error, 413),
+            (b"POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nabc", ParseStatus::Incomplete, 500),
+            (b"GET / HTTP/1.1\r\nno colon here\r\n: empty name\r\n\r\n", ParseStatus::Complete, 500),
+            (b"\x00\x01\x02\x03 \x04 \x05\n", ParseStatus::Error, 500),
+        ];
+        for (data, expected_status, expected_code) in corpus {
+            for piece in [1, 3, data.len().max(1)] {
+                let (request, status) = parse_in_pieces(data, piece);
+                assert_eq!(status, *expected_status, "{:?}", String::from_utf8_lossy(data));
+                assert_eq!(request.get_error_code(), *expected_code, "{:?}", String::from_utf8_lossy(data));
+            }
+        }
+        // unterminated header block exceeding the limit
+        let mut data = b"GET / HTTP/1.1\r\nX: ".to_vec();
+        data.resize(MAX_HEAD_SIZE + 100, b'a');
+        let (request, status) = parse_in_pieces(&data, 4096);
+        assert_eq!(status, ParseStatus::Error);
+        assert_eq!(request.get_error_code(), 431);
+        // header block of short lines exceeding the limit
+        let mut data = b"GET / HTTP/1.1\r\n".to_vec();
+        while data.len() <= MAX_HEAD_SIZE {
+            data.extend_from_slice(b"X: a\r\n");
+        }
+        for piece in [4096, data.len()] {
+            let (request, status) = parse_in_pieces(&data, piece);
+            assert_eq!(status, ParseStatus::Error);
+            assert_eq!(request.get_error_code(), 431);
+        }
+        // empty lines preceding the request line count towards the limit
+        let data = vec![b'\n'; MAX_HEAD_SIZE + 1];
+        let (request, status) = parse_in_pieces(&data, data.len());
+        assert_eq!(status, ParseStatus::Error);
+        assert_eq!(request.get_error_code(), 431);
+        // a head just within the limit is accepted
+        let mut data = b"GET / HTTP/1.1\r\nX: ".to_vec();
+        data.resize(MAX_HEAD_SIZE - 4, b'a');
+        data.extend_from_slice(b"\r\n\r\n");
+        assert_eq!(parse_in_pieces(&data, 4096).1, ParseStatus::Complete);
+    }
+
+    /// Summary of the outcome of parsing, for comparison between ways of feeding the data.
+    fn outcome(request: &Request, status: ParseStatus) -> (ParseStatus, i32, String, Vec<u8>, Option<Vec<u8>>) {
+        (status, request.get_error_code(), request.get_location().to_string(), request.get_content().to_vec(),
+            request.get_header("content-length").map(<[u8]>::to_vec))
+    }
+
+    #[test]
+    fn mutated_corpus() {
+        // requests the dialog receives, mutated by replacing, inserting, removing and
+        // duplicating bytes; the outcome must not depend on how the data is split into reads
+        let seeds: &[&[u8]] = &[
+            b"GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nAccept-Encoding: gzip, deflate, br\r\nIf-None-Match: \"1a2b\"\r\n\r\n",
+            b"POST /update HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/json\r\nContent-Length: 17\r\n\r\n{\"value\":[1,2,3]}",
+            b"GET /socket HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n",
+            b"GET /a HTTP/1.1\n\nPOST /b HTTP/1.1\nContent-Length: 2\n\nok",
+        ];
+        const BYTES: &[u8] = b" \t\r\n:/-0123456789GETPOSTHTtp\x00\xff";
+        let mut state = 0x2545_f491_4f6c_dd1du64;
+        let mut random = move |n: usize| {
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            (state % n as u64) as usize
+        };
+        let mut counts = [0usize; 3];
+        for _ in 0..2000 {
+            let mut data = seeds[random(seeds.len())].to_vec();
+            for _ in 0..1 + random(4) {
+                let pos = random(data.len() + 1);
+                match random(4) {
+                    0 if pos < data.len() => data[pos] = BYTES[random(BYTES.len())],
+                    1 => data.insert(pos, BYTES[random(BYTES.len())]),
+                    2 if pos < data.len() => { data.remove(pos); },
+                    _ => {
+                        let end = (pos + random(16)).min(data.len());
+                        let copy = data[pos..end].to_vec();
+                        data.splice(pos..pos, copy);
+                    },
+                }
+            }
+            let (request, status) = parse_in_pieces(&data, data.len().max(1));
+            let expected = outcome(&request, status);
+            for piece in [1 + random(4), 5 + random(40)] {
+                let (request, status) = parse_in_pieces(&data, piece);
+                assert_eq!(outcome(&request, status), expected, "{:?}, piece size {}", String::from_utf8_lossy(&data), piece);
+            }
+            counts[match status { ParseStatus::Complete => 0, ParseStatus::Incomplete => 1, ParseStatus::Error => 2 }] += 1;
+        }
+        // the mutations exercise all outcomes
+        assert!(counts.iter().all(|&count| count > 50), "{:?}", counts);
+    }
+}
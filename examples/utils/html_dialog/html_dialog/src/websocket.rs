@@ -0,0 +1,346 @@
+//! WebSocket protocol support for the HTML dialog system.
+//!
+//! Implements the parts of RFC 6455 that the embedded web server needs: the
+//! handshake key, and reading and writing of frames. Frames from the browser
+//! are masked and may be fragmented; frames to the browser are sent unmasked
+//! and unfragmented.
+
+use std::io::Read;
+
+/// The number of bytes that is requested from the stream at a time
+const READ_CHUNK: usize = 8192;
+/// The maximum size of a message from the browser
+const MAX_MESSAGE_SIZE: usize = 16 * 1024 * 1024;
+/// GUID that is appended to the handshake key (RFC 6455, section 1.3)
+const HANDSHAKE_GUID: &[u8] = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/// Continuation frame
+const OPCODE_CONTINUATION: u8 = 0x0;
+/// Text frame
+pub(crate) const OPCODE_TEXT: u8 = 0x1;
+/// Binary frame
+const OPCODE_BINARY: u8 = 0x2;
+/// Close frame
+pub(crate) const OPCODE_CLOSE: u8 = 0x8;
+/// Ping frame
+const OPCODE_PING: u8 = 0x9;
+/// Pong frame
+pub(crate) const OPCODE_PONG: u8 = 0xA;
+
+/// Close status: normal closure
+pub(crate) const CLOSE_NORMAL: u16 = 1000;
+/// Close status: protocol error
+const CLOSE_PROTOCOL_ERROR: u16 = 1002;
+/// Close status: a text message is not valid UTF-8
+const CLOSE_INVALID_DATA: u16 = 1007;
+/// Close status: message too big
+const CLOSE_TOO_BIG: u16 = 1009;
+
+/// Computes the SHA-1 digest, as needed for the handshake.
+fn sha1(data: &[u8]) -> [u8; 20] {
+    let mut h: [u32; 5] = [0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0];
+    let mut message = data.to_vec();
+    message.push(0x80);
+    while message.len() % 64 != 56 {
+        message.push(0);
+    }
+    message.extend_from_slice(&((data.len() as u64) * 8).to_be_bytes());
+    for block in message.chunks_exact(64) {
+        let mut w = [0u32; 80];
+        for i in 0..16 {
+            w[i] = u32::from_be_bytes(block[i * 4..i * 4 + 4].try_into().unwrap());
+        }
+        for i in 16..80 {
+            w[i] = (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16]).rotate_left(1);
+        }
+        let [mut a, mut b, mut c, mut d, mut e] = h;
+        for (i, wi) in w.iter().enumerate() {
+            let (f, k) = match i {
+                0..=19 => ((b & c) | (!b & d), 0x5A827999),
+                20..=39 => (b ^ c ^ d, 0x6ED9EBA1),
+                40..=59 => ((b & c) | (b & d) | (c & d), 0x8F1BBCDC),
+                _ => (b ^ c ^ d, 0xCA62C1D6),
+            };
+            let temp = a.rotate_left(5).wrapping_add(f).wrapping_add(e).wrapping_add(k).wrapping_add(*wi);
+            e = d;
+            d = c;
+            c = b.rotate_left(30);
+            b = a;
+            a = temp;
+        }
+        for (hi, v) in h.iter_mut().zip([a, b, c, d, e]) {
+            *hi = hi.wrapping_add(v);
+        }
+    }
+    let mut digest = [0u8; 20];
+    for (i, hi) in h.iter().enumerate() {
+        digest[i * 4..i * 4 + 4].copy_from_slice(&hi.to_be_bytes());
+    }
+    digest
+}
+
+/// Encodes data as base64, with padding.
+fn base64(data: &[u8]) -> String {
+    const ALPHABET: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    let mut res = String::with_capacity(data.len().div_ceil(3) * 4);
+    for chunk in data.chunks(3) {
+        let n = (chunk[0] as u32) << 16
+            | (*chunk.get(1).unwrap_or(&0) as u32) << 8
+            | *chunk.get(2).unwrap_or(&0) as u32;
+        for i in 0..4 {
+            if i <= chunk.len() {
+                res.push(ALPHABET[(n >> (18 - 6 * i) & 0x3F) as usize] as char);
+            } else {
+                res.push('=');
+            }
+        }
+    }
+    res
+}
+
+/// Computes the value of the Sec-WebSocket-Accept header.
+///
+/// # Parameters
+/// * `key` - The value of the Sec-WebSocket-Key header
+///
+/// # Returns
+/// * The value for the Sec-WebSocket-Accept header
+pub(crate) fn accept_key(key: &[u8]) -> String {
+    let mut data = Vec::with_capacity(key.len() + HANDSHAKE_GUID.len());
+    data.extend_from_slice(key);
+    data.extend_from_slice(HANDSHAKE_GUID);
+    base64(&sha1(&data))
+}
+
+/// Creates the header of an unmasked, final frame.
+///
+/// # Parameters
+/// * `opcode` - The frame type
+/// * `length` - The length of the payload
+///
+/// # Returns
+/// * The frame header; the payload follows the header
+pub(crate) fn frame_header(opcode: u8, length: usize) -> Vec<u8> {
+    let mut header = Vec::with_capacity(10);
+    header.push(0x80 | opcode);
+    if length < 126 {
+        header.push(length as u8);
+    } else if length <= u16::MAX as usize {
+        header.push(126);
+        header.extend_from_slice(&(length as u16).to_be_bytes());
+    } else {
+        header.push(127);
+        header.extend_from_slice(&(length as u64).to_be_bytes());
+    }
+    header
+}
+
+/// A message received from the browser.
+#[derive(Debug, PartialEq)]
+pub(crate) enum Message {
+    /// A complete text message
+    Text(String),
+    /// A complete binary message
+    Binary(Vec<u8>),
+    /// A ping, with its payload
+    Ping(Vec<u8>),
+    /// A pong
+    Pong,
+    /// The browser closes the connection
+    Close,
+}
+
+/// Reads frames from the browser, and assembles them into messages.
+pub(crate) struct FrameReader {
+    /// Received data that has not been parsed
+    buffer: Vec<u8>,
+    /// Payload of the fragments of the message that is being received
+    message: Vec<u8>,
+    /// Opcode of the message that is being received, if any
+    message_opcode: Option<u8>,
+}
+
+impl FrameReader {
+    /// Creates a frame reader.
+    ///
+    /// # Parameters
+    /// * `buffer` - Data that was received after the handshake
+    pub fn new(buffer: Vec<u8>) -> Self {
+        FrameReader {
+            buffer,
+            message: Vec::new(),
+            message_opcode: None,
+        }
+    }
+
+    /// Reads available data.
+    ///
+    /// # Parameters
+    /// * `reader` - The source, typically a non-blocking stream
+    ///
+    /// # Returns
+    /// * `Ok(n)` - The number of bytes read; zero if the peer closed the stream
+    /// * `Err(...)` - Read error, including `WouldBlock`
+    pub fn read_from<R: Read>(&mut self, reader: &mut R) -> std::io::Result<usize> {
+        let filled = self.buffer.len();
+        self.buffer.resize(filled + READ_CHUNK, 0);
+        let res = reader.read(&mut self.buffer[filled..]);
+        self.buffer.truncate(filled + *res.as_ref().unwrap_or(&0));
+        res
+    }
+
+    /// Gets the next message from the received data.
+    ///
+    /// # Returns
+    /// * `Ok(Some(message))` - A message, or a control frame
+    /// * `Ok(None)` - If more data is needed
+    /// * `Err(status)` - If the browser violates the protocol; the connection must be closed with this status
+    pub fn next(&mut self) -> Result<Option<Message>, u16> {
+        loop {
+            let buffer = &self.buffer;
+            if buffer.len() < 2 {
+                return Ok(None);
+            }
+            let fin = buffer[0] & 0x80 != 0;
+            let opcode = buffer[0] & 0x0F;
+            if buffer[0] & 0x70 != 0 || buffer[1] & 0x80 == 0 {
+                // Extensions are not negotiated, and frames from the browser must be masked
+                return Err(CLOSE_PROTOCOL_ERROR);
+            }
+            let (length, mut pos) = match buffer[1] & 0x7F {
+                126 => {
+                    if buffer.len() < 4 {
+                        return Ok(None);
+                    }
+                    (u16::from_be_bytes([buffer[2], buffer[3]]) as u64, 4)
+                },
+                127 => {
+                    if buffer.len() < 10 {
+                        return Ok(None);
+                    }
+                    (u64::from_be_bytes(buffer[2..10].try_into().unwrap()), 10)
+                },
+                l => (l as u64, 2),
+            };
+            if length > (MAX_MESSAGE_SIZE - self.message.len()) as u64 {
+                return Err(CLOSE_TOO_BIG);
+            }
+            let length = length as usize;
+            if buffer.len() < pos + 4 + length {
+                return Ok(None);
+            }
+            let mask: [u8; 4] = buffer[pos..pos + 4].try_into().unwrap();
+            pos += 4;
+            let payload = pos..pos + length;
+            let is_control = opcode & 0x08 != 0;
+            if is_control && (!fin || length > 125) {
+                return Err(CLOSE_PROTOCOL_ERROR);
+            }
+            for (i, b) in self.buffer[payload.clone()].iter_mut().enumerate() {
+                *b ^= mask[i % 4];
+            }
+            let res = match opcode {
+                OPCODE_PING => Some(Message::Ping(self.buffer[payload.clone()].to_vec())),
+                OPCODE_PONG => Some(Message::Pong),
+                OPCODE_CLOSE => Some(Message::Close),
+                OPCODE_TEXT | OPCODE_BINARY | OPCODE_CONTINUATION => {
+                    let message_opcode = match (opcode, self.message_opcode) {
+                        (OPCODE_CONTINUATION, Some(o)) => o,
+                        (OPCODE_TEXT | OPCODE_BINARY, None) => opcode,
+                        _ => return Err(CLOSE_PROTOCOL_ERROR),
+                    };
+                    if fin && self.message.is_empty() {
+                        // Unfragmented message
+                        self.message_opcode = None;
+                        Some(self.buffer[payload.clone()].to_vec())
+                    } else {
+                        self.message.extend_from_slice(&self.buffer[payload.clone()]);
+                        if fin {
+                            self.message_opcode = None;
+                            Some(std::mem::take(&mut self.message))
+                        } else {
+                            self.message_opcode = Some(message_opcode);
+                            None
+                        }
+                    }
+                    .map(|data| {
+                        if message_opcode == OPCODE_TEXT {
+                            String::from_utf8(data).map(Message::Text).map_err(|_| CLOSE_INVALID_DATA)
+                        } else {
+                            Ok(Message::Binary(data))
+                        }
+                    })
+                    .transpose()?
+                },
+                _ => return Err(CLOSE_PROTOCOL_ERROR),
+            };
+            self.buffer.drain(..payload.end);
+            if res.is_some() {
+                return Ok(res);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Creates a masked frame, as sent by a browser.
+    fn masked_frame(first: u8, payload: &[u8]) -> Vec<u8> {
+        let mut frame = frame_header(first & 0x0F, payload.len());
+        frame[0] = first;
+        frame[1] |= 0x80;
+        let mask = [0x37, 0xfa, 0x21, 0x3d];
+        frame.extend_from_slice(&mask);
+        frame.extend(payload.iter().enumerate().map(|(i, b)| b ^ mask[i % 4]));
+        frame
+    }
+
+    #[test]
+    fn handshake_key() {
+        // Example from RFC 6455, section 1.3
+        assert_eq!(accept_key(b"dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    }
+
+    #[test]
+    fn frames() {
+        let mut data = masked_frame(0x81, b"Hello");
+        data.extend(masked_frame(0x02, b"ab"));
+        data.extend(masked_frame(0x89, b"p"));
+        data.extend(masked_frame(0x80, b"cd"));
+        data.extend(masked_frame(0x81, &[b'x'; 300]));
+        data.extend(masked_frame(0x88, &CLOSE_NORMAL.to_be_bytes()));
+        // Feed byte by byte, to cover partial frames
+        let mut reader = FrameReader::new(Vec::new());
+        let mut messages = Vec::new();
+        for byte in data.chunks(1) {
+            let mut byte = byte;
+            reader.read_from(&mut byte).unwrap();
+            while let Some(message) = reader.next().unwrap() {
+                messages.push(message);
+            }
+        }
+        assert_eq!(messages, vec![
+            Message::Text("Hello".into()),
+            Message::Ping(b"p".to_vec()),
+            Message::Binary(b"abcd".to_vec()),
+            Message::Text("x".repeat(300)),
+            Message::Close,
+        ]);
+    }
+
+    #[test]
+    fn protocol_errors() {
+        let unmasked = [frame_header(OPCODE_TEXT, 2), b"hi".to_vec()].concat();
+        let corpus: [(Vec<u8>, u16); 4] = [
+            (unmasked, CLOSE_PROTOCOL_ERROR),
+            (masked_frame(0x80, b"orphan continuation"), CLOSE_PROTOCOL_ERROR),
+            (masked_frame(0x09, b"fragmented ping"), CLOSE_PROTOCOL_ERROR),
+            (masked_frame(0x81, &[0xff, 0xfe]), CLOSE_INVALID_DATA),
+        ];
+        for (data, status) in corpus {
+            assert_eq!(FrameReader::new(data).next(), Err(status));
+        }
+    }
+}
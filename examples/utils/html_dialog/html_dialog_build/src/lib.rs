@@ -0,0 +1,136 @@
+//! # Build-time preparation of HTML dialog assets
+//!
+//! Static assets of an HTML dialog, such as the HTML page, style sheets, scripts and
+//! images, are embedded in the executable. This crate is used from the build script of
+//! the crate that shows the dialog; it compresses each asset with gzip and brotli, and
+//! generates a source file that embeds the raw and compressed content as
+//! `html_dialog::StaticAsset` values, each with an entity tag derived from the content.
+//! No compression takes place at run time.
+//!
+//! In `build.rs`:
+//! ```no_run
+//! html_dialog_build::embed_assets("gui_assets.rs", &[
+//!     ("GUI_HTML", "src/gui/gui.html", "text/html"),
+//!     ("GUI_PNG", "src/gui/gui.png", "image/png"),
+//! ]).unwrap();
+//! ```
+//!
+//! In the crate, the generated file is included and its assets are registered:
+//! ```ignore
+//! mod assets {
+//!     include!(concat!(env!("OUT_DIR"), "/gui_assets.rs"));
+//! }
+//! dlg.add("/".into(), HtmlDialogResourceType::Asset(&assets::GUI_HTML));
+//! ```
+
+use std::{
+    env,
+    fmt::Write as _,
+    fs,
+    io::{self, Write},
+    path::{Path, PathBuf},
+};
+
+/// Computes the entity tag of an asset.
+///
+/// The tag is the 64-bit FNV-1a hash of the content, so that it only changes
+/// when the content changes.
+///
+/// # Parameters
+/// * `content` - The raw content
+///
+/// # Returns
+/// * The entity tag, without quotes
+fn entity_tag(content: &[u8]) -> String {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for byte in content {
+        hash ^= *byte as u64;
+        hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    format!("{:016x}", hash)
+}
+
+/// Compresses content with gzip, at the highest compression level.
+fn gzip(content: &[u8]) -> io::Result<Vec<u8>> {
+    let mut encoder = flate2::write::GzEncoder::new(Vec::new(), flate2::Compression::best());
+    encoder.write_all(content)?;
+    encoder.finish()
+}
+
+/// Compresses content with brotli, at the highest quality.
+fn brotli(content: &[u8]) -> io::Result<Vec<u8>> {
+    let mut encoder = brotli::CompressorWriter::new(Vec::new(), 4096, 11, 22);
+    encoder.write_all(content)?;
+    Ok(encoder.into_inner())
+}
+
+/// Writes a compressed variant of an asset, if it is smaller than the raw content.
+///
+/// # Parameters
+/// * `path` - The file to write
+/// * `content` - The raw content
+/// * `compressed` - The compressed content
+///
+/// # Returns
+/// * `Ok(Some(path))` - If the variant was written
+/// * `Ok(None)` - If compression does not reduce the size, as for most image formats
+/// * `Err(...)` - If the file cannot be written
+fn write_variant(path: PathBuf, content: &[u8], compressed: Vec<u8>) -> io::Result<Option<PathBuf>> {
+    if compressed.len() >= content.len() {
+        return Ok(None);
+    }
+    fs::write(&path, compressed)?;
+    Ok(Some(path))
+}
+
+/// Formats an `include_bytes!` expression for an optional file.
+fn include_variant(path: &Option<PathBuf>) -> String {
+    match path {
+        Some(path) => format!("Some(include_bytes!({:?}))", path.display().to_string()),
+        None => "None".into(),
+    }
+}
+
+/// Gets a directory from an environment variable set by cargo.
+fn cargo_dir(name: &str) -> io::Result<PathBuf> {
+    env::var_os(name)
+        .map(PathBuf::from)
+        .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, format!("{} is not set; call from a build script", name)))
+}
+
+/// Compresses assets and generates the source code that embeds them.
+///
+/// For each asset, a `pub(crate) static` of type `html_dialog::StaticAsset` is generated.
+/// The compressed variants are written to `OUT_DIR`; a variant is omitted if it is not
+/// smaller than the raw content. Cargo is instructed to re-run the build script if an
+/// asset changes.
+///
+/// # Parameters
+/// * `output` - The name of the generated source file, relative to `OUT_DIR`
+/// * `assets` - For each asset, the name of the static, the path of the file relative to
+///   the crate root, and the MIME type
+///
+/// # Returns
+/// * `Ok(())` - If the source file was generated
+/// * `Err(...)` - If an asset cannot be read, or an output file cannot be written
+pub fn embed_assets(output: &str, assets: &[(&str, &str, &str)]) -> io::Result<()> {
+    let out_dir = cargo_dir("OUT_DIR")?;
+    let manifest_dir = cargo_dir("CARGO_MANIFEST_DIR")?;
+    let mut source = String::new();
+    for (name, path, content_type) in assets {
+        let path = manifest_dir.join(Path::new(path));
+        println!("cargo:rerun-if-changed={}", path.display());
+        let content = fs::read(&path)
+            .map_err(|e| io::Error::new(e.kind(), format!("Failed to read {}: {}", path.display(), e)))?;
+        let gzip_path = write_variant(out_dir.join(format!("{}.gz", name)), &content, gzip(&content)?)?;
+        let brotli_path = write_variant(out_dir.join(format!("{}.br", name)), &content, brotli(&content)?)?;
+        let _ = writeln!(source, "pub(crate) static {}: html_dialog::StaticAsset = html_dialog::StaticAsset {{", name);
+        let _ = writeln!(source, "    content: include_bytes!({:?}),", path.display().to_string());
+        let _ = writeln!(source, "    gzip: {},", include_variant(&gzip_path));
+        let _ = writeln!(source, "    brotli: {},", include_variant(&brotli_path));
+        let _ = writeln!(source, "    content_type: {:?},", content_type);
+        let _ = writeln!(source, "    etag: {:?},", entity_tag(&content));
+        let _ = writeln!(source, "}};");
+    }
+    fs::write(out_dir.join(output), source)
+}
@@ -0,0 +1,452 @@
+//! # Root finding
+//!
+//! Small collection of one-dimensional root finders that are shared by
+//! the example PMCs in this workspace:
+//!
+//! - [`newton_bracketed`]: Newton-Raphson iteration for monotonic functions, where
+//!   the root is kept inside a bracket that shrinks each iteration; whenever the
+//!   Newton step leaves the bracket, a bisection step is taken instead.
+//! - [`brent`]: Brent's method (inverse quadratic interpolation, secant and bisection).
+//! - [`illinois`]: regula falsi with the Illinois modification.
+//!
+//! None of the solvers allocate. Each solve records the number of iterations,
+//! the number of function evaluations and the final residual in a [`SolverStatistics`]
+//! structure, which is filled in also if the solve fails, so that the caller can
+//! report on convergence behaviour.
+//!
+//! Function evaluations return a `Result`, so that errors in the function (e.g.
+//! a correlation that is evaluated outside of its range of validity) terminate the solve.
+//!
+//! # Example
+//!
+//! ```
+//! use root_finding::*;
+//! let settings=SolverSettings{x_tolerance:1e-12,f_tolerance:1e-12,maximum_iterations:50};
+//! let mut statistics=SolverStatistics::default();
+//! let root=newton_bracketed(|x| Ok((x*x-2.0,2.0*x)),0.0,2.0,1.0,&settings,&mut statistics).unwrap();
+//! assert!(f64::abs(root-f64::sqrt(2.0))<1e-10);
+//! assert!(statistics.converged);
+//! ```
+
+/// Convergence settings for a root finding solve.
+
+#[derive(Debug, Clone, Copy)]
+pub struct SolverSettings {
+	/// The solve is converged if the bracket width or step size drops below this value
+	pub x_tolerance : f64,
+	/// The solve is converged if the absolute value of the function drops below this value
+	pub f_tolerance : f64,
+	/// Maximum number of iterations before the solve fails
+	pub maximum_iterations : u32,
+}
+
+/// Convergence statistics of a single root finding solve.
+///
+/// The statistics are reset at the start of each solve, and are
+/// filled in regardless of whether the solve succeeds.
+
+#[derive(Debug, Clone, Copy)]
+pub struct SolverStatistics {
+	/// Number of iterations taken
+	pub iterations : u32,
+	/// Number of function evaluations (including evaluations at the bracket end points)
+	pub function_evaluations : u32,
+	/// Number of iterations in which the solver fell back to bisection
+	pub bisection_steps : u32,
+	/// Function value at the last evaluated point
+	pub residual : f64,
+	/// Whether the solve converged
+	pub converged : bool,
+}
+
+impl std::default::Default for SolverStatistics {
+	/// Creates statistics for a solve that has not been performed.
+	fn default() -> Self {
+		Self {
+			iterations: 0,
+			function_evaluations: 0,
+			bisection_steps: 0,
+			residual: f64::NAN,
+			converged: false,
+		}
+	}
+}
+
+impl SolverStatistics {
+
+	/// Reset the statistics prior to a new solve.
+	pub fn reset(&mut self) {
+		*self=Self::default();
+	}
+
+	/// Record a function evaluation
+	///
+	/// # Arguments
+	/// * `value` - function value at the evaluated point
+	pub fn evaluated(&mut self,value:f64) {
+		self.function_evaluations+=1;
+		self.residual=value;
+	}
+}
+
+/// Convergence statistics accumulated over a number of solves.
+///
+/// # Example
+///
+/// ```
+/// use root_finding::*;
+/// let settings=SolverSettings{x_tolerance:1e-12,f_tolerance:1e-12,maximum_iterations:50};
+/// let mut statistics=SolverStatistics::default();
+/// let mut totals=SolverTotals::default();
+/// let _=newton_bracketed(|x| Ok((x*x-2.0,2.0*x)),0.0,2.0,1.0,&settings,&mut statistics);
+/// totals.record(&statistics);
+/// let _=brent(|x| Ok(x*x+1.0),-1.0,1.0,&settings,&mut statistics); //no root
+/// totals.record(&statistics);
+/// assert_eq!(totals.solves,2);
+/// assert_eq!(totals.failures,1);
+/// ```
+
+#[derive(Debug, Clone, Copy, Default)]
+pub struct SolverTotals {
+	/// Number of solves
+	pub solves : u64,
+	/// Number of solves that did not converge
+	pub failures : u64,
+	/// Total number of iterations
+	pub iterations : u64,
+	/// Total number of function evaluations
+	pub function_evaluations : u64,
+	/// Total number of bisection steps
+	pub bisection_steps : u64,
+	/// Maximum number of iterations of any solve
+	pub maximum_iterations : u32,
+}
+
+impl SolverTotals {
+
+	/// Add the statistics of a solve, regardless of its success.
+	///
+	/// # Arguments
+	/// * `statistics` - the statistics of the solve
+	pub fn record(&mut self,statistics:&SolverStatistics) {
+		self.solves+=1;
+		if !statistics.converged {
+			self.failures+=1;
+		}
+		self.iterations+=statistics.iterations as u64;
+		self.function_evaluations+=statistics.function_evaluations as u64;
+		self.bisection_steps+=statistics.bisection_steps as u64;
+		self.maximum_iterations=u32::max(self.maximum_iterations,statistics.iterations);
+	}
+
+	/// Average number of iterations per solve, or None if no solves were recorded
+	pub fn average_iterations(&self) -> Option<f64> {
+		if self.solves==0 {
+			None
+		} else {
+			Some(self.iterations as f64/self.solves as f64)
+		}
+	}
+}
+
+/// Newton-Raphson iteration, safeguarded by a bracket.
+///
+/// The function must be monotonic inside the bracket, and must change sign inside the
+/// bracket. The sign of the derivative is used to decide on which side of the current
+/// iterate the root lies, so that the function does not need to be evaluated at the
+/// end points of the bracket; this allows for bracket end points at which the function
+/// is singular, as is the case for the Underwood equation.
+///
+/// If the Newton step falls outside the current bracket, the bracket is bisected instead.
+///
+/// # Arguments
+/// * `f` - function returning the function value and its derivative at a given point, or an error
+/// * `x_min` - lower end of the bracket
+/// * `x_max` - upper end of the bracket
+/// * `x_initial` - initial guess; if not strictly inside the bracket, the bracket mid point is used
+/// * `settings` - convergence settings
+/// * `statistics` - receives the convergence statistics
+///
+/// # Returns
+/// The root, or an error
+pub fn newton_bracketed<F>(mut f:F,x_min:f64,x_max:f64,x_initial:f64,settings:&SolverSettings,statistics:&mut SolverStatistics) -> Result<f64,String>
+	where F: FnMut(f64) -> Result<(f64,f64),String> {
+	statistics.reset();
+	let mut low=f64::min(x_min,x_max);
+	let mut high=f64::max(x_min,x_max);
+	let mut x=if x_initial>low && x_initial<high {x_initial} else {0.5*(low+high)};
+	while statistics.iterations<settings.maximum_iterations {
+		statistics.iterations+=1;
+		let (value,derivative)=f(x)?;
+		statistics.evaluated(value);
+		if f64::abs(value)<=settings.f_tolerance {
+			statistics.converged=true;
+			return Ok(x);
+		}
+		if !value.is_finite() || !derivative.is_finite() || derivative==0.0 {
+			return Err(format!("invalid function value ({}) or derivative ({}) at x={}",value,derivative,x));
+		}
+		//for a monotonic function, the sign of the derivative tells on which side the root is
+		if (value>0.0)==(derivative>0.0) {
+			high=x;
+		} else {
+			low=x;
+		}
+		//Newton step; bisect if the step leaves the bracket
+		let mut x_new=x-value/derivative;
+		if !(x_new>low && x_new<high) {
+			x_new=0.5*(low+high);
+			statistics.bisection_steps+=1;
+		}
+		if f64::abs(x_new-x)<=settings.x_tolerance || high-low<=settings.x_tolerance {
+			statistics.converged=true;
+			return Ok(x_new);
+		}
+		x=x_new;
+	}
+	Err(format!("no convergence within {} iterations",settings.maximum_iterations))
+}
+
+/// Evaluate the function at both ends of the bracket, and check that the root is bracketed.
+///
+/// # Arguments
+/// * `f` - the function
+/// * `a` - one end of the bracket
+/// * `b` - other end of the bracket
+/// * `statistics` - receives the function evaluations
+///
+/// # Returns
+/// The function values at `a` and `b`, or an error if the root is not bracketed.
+fn evaluate_bracket<F>(f:&mut F,a:f64,b:f64,statistics:&mut SolverStatistics) -> Result<(f64,f64),String>
+	where F: FnMut(f64) -> Result<f64,String> {
+	let fa=f(a)?;
+	statistics.evaluated(fa);
+	let fb=f(b)?;
+	statistics.evaluated(fb);
+	if (fa>0.0 && fb>0.0) || (fa<0.0 && fb<0.0) || fa.is_nan() || fb.is_nan() {
+		return Err(format!("root is not bracketed in [{},{}]",a,b));
+	}
+	Ok((fa,fb))
+}
+
+/// Brent's method.
+///
+/// Combines inverse quadratic interpolation and secant steps with bisection; the
+/// root remains bracketed at all times and convergence is guaranteed for continuous
+/// functions. The function is evaluated at both end points of the bracket.
+///
+/// # Arguments
+/// * `f` - function returning the function value at a given point, or an error
+/// * `a` - one end of the bracket
+/// * `b` - other end of the bracket
+/// * `settings` - convergence settings
+/// * `statistics` - receives the convergence statistics
+///
+/// # Returns
+/// The root, or an error
+pub fn brent<F>(mut f:F,a:f64,b:f64,settings:&SolverSettings,statistics:&mut SolverStatistics) -> Result<f64,String>
+	where F: FnMut(f64) -> Result<f64,String> {
+	statistics.reset();
+	let (mut a,mut b)=(a,b);
+	let (mut fa,mut fb)=evaluate_bracket(&mut f,a,b,statistics)?;
+	//keep b as the best estimate
+	if f64::abs(fa)<f64::abs(fb) {
+		std::mem::swap(&mut a,&mut b);
+		std::mem::swap(&mut fa,&mut fb);
+	}
+	statistics.residual=fb;
+	let mut c=a;
+	let mut fc=fa;
+	let mut d=b-a;
+	let mut e=d;
+	while statistics.iterations<settings.maximum_iterations {
+		statistics.iterations+=1;
+		if f64::abs(fb)<=settings.f_tolerance {
+			statistics.converged=true;
+			return Ok(b);
+		}
+		//c is the counterpart of b in the bracket
+		if (fb>0.0)==(fc>0.0) {
+			c=a;
+			fc=fa;
+			d=b-a;
+			e=d;
+		}
+		if f64::abs(fc)<f64::abs(fb) {
+			a=b;
+			b=c;
+			c=a;
+			fa=fb;
+			fb=fc;
+			fc=fa;
+		}
+		let tolerance=0.5*settings.x_tolerance+2.0*f64::EPSILON*f64::abs(b);
+		let m=0.5*(c-b);
+		if f64::abs(m)<=tolerance || fb==0.0 {
+			statistics.converged=true;
+			return Ok(b);
+		}
+		if f64::abs(e)>=tolerance && f64::abs(fa)>f64::abs(fb) {
+			//interpolation
+			let s=fb/fa;
+			let (p,q)=if a==c {
+				//secant
+				(2.0*m*s,1.0-s)
+			} else {
+				//inverse quadratic
+				let q=fa/fc;
+				let r=fb/fc;
+				(s*(2.0*m*q*(q-r)-(b-a)*(r-1.0)),(q-1.0)*(r-1.0)*(s-1.0))
+			};
+			let (p,q)=if p>0.0 {(p,-q)} else {(-p,q)};
+			if 2.0*p<f64::min(3.0*m*q-f64::abs(tolerance*q),f64::abs(e*q)) {
+				//accept interpolation
+				e=d;
+				d=p/q;
+			} else {
+				d=m;
+				e=d;
+				statistics.bisection_steps+=1;
+			}
+		} else {
+			d=m;
+			e=d;
+			statistics.bisection_steps+=1;
+		}
+		a=b;
+		fa=fb;
+		b+=if f64::abs(d)>tolerance {d} else {f64::copysign(tolerance,m)};
+		fb=f(b)?;
+		statistics.evaluated(fb);
+	}
+	Err(format!("no convergence within {} iterations",settings.maximum_iterations))
+}
+
+/// End point of the bracket that was retained in an Illinois step
+#[derive(PartialEq)]
+enum Retained {
+	Neither,
+	A,
+	B,
+}
+
+/// Regula falsi with the Illinois modification.
+///
+/// Each step is a secant step between the end points of the bracket. If the same
+/// end point is retained twice in a row, its function value is halved, which
+/// avoids the slow one-sided convergence of plain regula falsi. The function
+/// is evaluated at both end points of the bracket.
+///
+/// # Arguments
+/// * `f` - function returning the function value at a given point, or an error
+/// * `a` - one end of the bracket
+/// * `b` - other end of the bracket
+/// * `settings` - convergence settings
+/// * `statistics` - receives the convergence statistics
+///
+/// # Returns
+/// The root, or an error
+pub fn illinois<F>(mut f:F,a:f64,b:f64,settings:&SolverSettings,statistics:&mut SolverStatistics) -> Result<f64,String>
+	where F: FnMut(f64) -> Result<f64,String> {
+	statistics.reset();
+	let (mut a,mut b)=(a,b);
+	let (mut fa,mut fb)=evaluate_bracket(&mut f,a,b,statistics)?;
+	if f64::abs(fa)<=settings.f_tolerance {
+		statistics.residual=fa;
+		statistics.converged=true;
+		return Ok(a);
+	}
+	if f64::abs(fb)<=settings.f_tolerance {
+		statistics.converged=true;
+		return Ok(b);
+	}
+	//end point that was retained in the previous step
+	let mut retained=Retained::Neither;
+	while statistics.iterations<settings.maximum_iterations {
+		statistics.iterations+=1;
+		let x=(a*fb-b*fa)/(fb-fa);
+		let fx=f(x)?;
+		statistics.evaluated(fx);
+		if f64::abs(fx)<=settings.f_tolerance {
+			statistics.converged=true;
+			return Ok(x);
+		}
+		if (fx>0.0)==(fb>0.0) {
+			//replace b, a is retained
+			b=x;
+			fb=fx;
+			if retained==Retained::A {
+				fa*=0.5;
+			}
+			retained=Retained::A;
+		} else {
+			//replace a, b is retained
+			a=x;
+			fa=fx;
+			if retained==Retained::B {
+				fb*=0.5;
+			}
+			retained=Retained::B;
+		}
+		if f64::abs(b-a)<=settings.x_tolerance {
+			statistics.converged=true;
+			return Ok(x);
+		}
+	}
+	Err(format!("no convergence within {} iterations",settings.maximum_iterations))
+}
+
+#[cfg(test)]
+mod tests {
+	use crate::*;
+
+	const SETTINGS : SolverSettings = SolverSettings{x_tolerance:1e-12,f_tolerance:1e-12,maximum_iterations:100};
+
+	#[test]
+	fn newton_singular_bracket() {
+		//function with poles at both ends of the bracket, like the Underwood equation
+		let f=|x:f64| Ok((1.0/(2.0-x)-1.0/(x-1.0)-0.5,1.0/((2.0-x)*(2.0-x))+1.0/((x-1.0)*(x-1.0))));
+		let mut statistics=SolverStatistics::default();
+		let root=newton_bracketed(f,1.0,2.0,1.5,&SETTINGS,&mut statistics).unwrap();
+		assert!(statistics.converged);
+		assert!(f64::abs(f(root).unwrap().0)<1e-10);
+		assert!(statistics.iterations<10);
+	}
+
+	#[test]
+	fn brent_and_illinois() {
+		let f=|x:f64| Ok(f64::cos(x)-x);
+		let mut statistics=SolverStatistics::default();
+		let root_brent=brent(f,0.0,1.0,&SETTINGS,&mut statistics).unwrap();
+		assert!(statistics.converged);
+		let root_illinois=illinois(f,0.0,1.0,&SETTINGS,&mut statistics).unwrap();
+		assert!(statistics.converged);
+		assert!(f64::abs(root_brent-0.7390851332151607)<1e-10);
+		assert!(f64::abs(root_illinois-0.7390851332151607)<1e-10);
+	}
+
+	#[test]
+	fn totals() {
+		let mut statistics=SolverStatistics::default();
+		let mut totals=SolverTotals::default();
+		assert_eq!(totals.average_iterations(),None);
+		let _=newton_bracketed(|x:f64| Ok((x*x-2.0,2.0*x)),0.0,2.0,1.0,&SETTINGS,&mut statistics);
+		totals.record(&statistics);
+		let iterations=statistics.iterations;
+		let function_evaluations=statistics.function_evaluations;
+		let _=brent(|x:f64| Ok(x*x+1.0),-1.0,1.0,&SETTINGS,&mut statistics);
+		totals.record(&statistics);
+		assert_eq!(totals.solves,2);
+		assert_eq!(totals.failures,1);
+		assert_eq!(totals.iterations,iterations as u64);
+		assert_eq!(totals.maximum_iterations,iterations);
+		assert_eq!(totals.function_evaluations,(function_evaluations+statistics.function_evaluations) as u64);
+	}
+
+	#[test]
+	fn not_bracketed() {
+		let mut statistics=SolverStatistics::default();
+		assert!(brent(|x:f64| Ok(x*x+1.0),-1.0,1.0,&SETTINGS,&mut statistics).is_err());
+		assert_eq!(statistics.function_evaluations,2);
+	}
+}